@@ -0,0 +1,147 @@
+#include "child_output.hpp"
+#include <atomic>
+#include <string>
+#include <system_error>
+
+namespace {
+std::system_error last_error(const char *what) { return std::system_error(static_cast<int>(GetLastError()), std::system_category(), what); }
+
+std::wstring unique_pipe_name() {
+  static std::atomic<uint32_t> counter{0};
+  return L"\\\\.\\pipe\\moonlight_hdr_launcher_output_" + std::to_wstring(GetCurrentProcessId()) + L"_" + std::to_wstring(counter++);
+}
+} // namespace
+
+ChildOutputPump::ChildOutputPump(EventLoop &loop, line_handler on_line, std::function<void()> on_closed, std::chrono::milliseconds exit_grace)
+    : m_loop{loop}, m_on_line{std::move(on_line)}, m_on_closed{std::move(on_closed)}, m_exit_grace{exit_grace} {
+  try {
+    create_pipe(m_out);
+    create_pipe(m_err);
+  } catch (...) {
+    release();
+    throw;
+  }
+}
+
+ChildOutputPump::~ChildOutputPump() { release(); }
+
+void ChildOutputPump::release() {
+  for (auto channel : {&m_out, &m_err}) {
+    if (channel->open) {
+      cancel_read(*channel);
+      m_loop.unwatch(channel->overlapped.hEvent);
+      channel->open = false;
+    }
+    for (auto handle : {channel->read_end, channel->write_end}) {
+      if (handle != INVALID_HANDLE_VALUE) {
+        CloseHandle(handle);
+      }
+    }
+    channel->read_end = channel->write_end = INVALID_HANDLE_VALUE;
+    if (channel->overlapped.hEvent) {
+      CloseHandle(channel->overlapped.hEvent);
+      channel->overlapped.hEvent = nullptr;
+    }
+  }
+  if (m_grace_timer) {
+    m_loop.cancel_timer(*m_grace_timer);
+    m_grace_timer.reset();
+  }
+}
+
+void ChildOutputPump::create_pipe(Channel &channel) {
+  // anonymous pipes cannot do overlapped I/O, so the read end is a uniquely named pipe
+  auto name = unique_pipe_name();
+  channel.read_end = CreateNamedPipeW(name.c_str(), PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+                                      PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS, 1, 0,
+                                      static_cast<DWORD>(channel.buffer.size()), 0, nullptr);
+  if (channel.read_end == INVALID_HANDLE_VALUE) {
+    throw last_error("CreateNamedPipe");
+  }
+  SECURITY_ATTRIBUTES inheritable{sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE};
+  channel.write_end = CreateFileW(name.c_str(), GENERIC_WRITE, 0, &inheritable, OPEN_EXISTING, 0, nullptr);
+  if (channel.write_end == INVALID_HANDLE_VALUE) {
+    throw last_error("CreateFile");
+  }
+  channel.overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+  if (!channel.overlapped.hEvent) {
+    throw last_error("CreateEvent");
+  }
+}
+
+void ChildOutputPump::start() {
+  for (auto channel : {&m_out, &m_err}) {
+    CloseHandle(channel->write_end);
+    channel->write_end = INVALID_HANDLE_VALUE;
+    channel->open = true;
+    m_loop.watch(channel->overlapped.hEvent, [this, channel]() { on_read(*channel); });
+  }
+  read(m_out);
+  read(m_err);
+}
+
+void ChildOutputPump::child_exited() {
+  if (closed() || m_grace_timer) {
+    return;
+  }
+  m_grace_timer = m_loop.add_timer(m_exit_grace, [this]() {
+    m_grace_timer.reset();
+    close(m_out);
+    close(m_err);
+  });
+}
+
+void ChildOutputPump::read(Channel &channel) {
+  // the event is signalled on completion even if ReadFile completes synchronously, on_read picks up the result
+  if (!ReadFile(channel.read_end, channel.buffer.data(), static_cast<DWORD>(channel.buffer.size()), nullptr, &channel.overlapped) &&
+      GetLastError() != ERROR_IO_PENDING) {
+    close(channel);
+    return;
+  }
+  channel.read_pending = true;
+}
+
+void ChildOutputPump::cancel_read(Channel &channel) {
+  if (channel.read_pending) {
+    CancelIoEx(channel.read_end, &channel.overlapped);
+    DWORD ignored;
+    GetOverlappedResult(channel.read_end, &channel.overlapped, &ignored, TRUE);
+    channel.read_pending = false;
+  }
+}
+
+void ChildOutputPump::on_read(Channel &channel) {
+  DWORD bytes_read = 0;
+  auto ok = GetOverlappedResult(channel.read_end, &channel.overlapped, &bytes_read, FALSE);
+  if (!ok && GetLastError() == ERROR_IO_INCOMPLETE) {
+    return;
+  }
+  channel.read_pending = false;
+  if (bytes_read > 0) {
+    channel.framer.feed(std::string_view{channel.buffer.data(), bytes_read}, [&](std::string_view line) { m_on_line(channel.stream, line); });
+  }
+  if (!ok) {
+    close(channel);
+    return;
+  }
+  read(channel);
+}
+
+void ChildOutputPump::close(Channel &channel) {
+  if (!channel.open) {
+    return;
+  }
+  channel.open = false;
+  cancel_read(channel);
+  m_loop.unwatch(channel.overlapped.hEvent);
+  channel.framer.flush([&](std::string_view line) { m_on_line(channel.stream, line); });
+  CloseHandle(channel.read_end);
+  channel.read_end = INVALID_HANDLE_VALUE;
+  if (closed()) {
+    if (m_grace_timer) {
+      m_loop.cancel_timer(*m_grace_timer);
+      m_grace_timer.reset();
+    }
+    m_on_closed();
+  }
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "event_loop.hpp"
+#include "line_framer.hpp"
+#include "output_filter.hpp"
+#include "windows.h"
+#include <array>
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <string_view>
+
+// Reads stdout and stderr of a child process with overlapped I/O driven by the session's event loop. Nothing runs
+// while the pipes are idle; every completion frames all the lines contained in one large read. After the child exits
+// the pipes are drained until EOF, or until the grace period runs out when a grandchild inherited the handles.
+class ChildOutputPump {
+public:
+  using line_handler = std::function<void(OutputStream, std::string_view)>;
+
+  // on_closed runs once both pipes are closed. Throws std::system_error if the pipes cannot be created.
+  ChildOutputPump(EventLoop &loop, line_handler on_line, std::function<void()> on_closed,
+                  std::chrono::milliseconds exit_grace = std::chrono::milliseconds{500});
+  ChildOutputPump(const ChildOutputPump &) = delete;
+  ChildOutputPump &operator=(const ChildOutputPump &) = delete;
+  ~ChildOutputPump();
+
+  // Inheritable write ends to hand to the child.
+  HANDLE out() const { return m_out.write_end; }
+  HANDLE err() const { return m_err.write_end; }
+
+  // Call once the child has been created: closes this process's copies of the write ends and starts reading.
+  void start();
+  void child_exited();
+  bool closed() const { return !m_out.open && !m_err.open; }
+
+private:
+  struct Channel {
+    explicit Channel(OutputStream stream) : stream{stream} {}
+    OutputStream stream;
+    HANDLE read_end = INVALID_HANDLE_VALUE;
+    HANDLE write_end = INVALID_HANDLE_VALUE;
+    OVERLAPPED overlapped{};
+    std::array<char, 64 * 1024> buffer;
+    LineFramer framer;
+    bool open = false;
+    bool read_pending = false;
+  };
+
+  void create_pipe(Channel &channel);
+  void release();
+  void read(Channel &channel);
+  void cancel_read(Channel &channel);
+  void on_read(Channel &channel);
+  void close(Channel &channel);
+
+  EventLoop &m_loop;
+  line_handler m_on_line;
+  std::function<void()> m_on_closed;
+  Channel m_out{OutputStream::out};
+  Channel m_err{OutputStream::err};
+  std::chrono::milliseconds m_exit_grace;
+  std::optional<EventLoop::TimerId> m_grace_timer;
+};
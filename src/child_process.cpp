@@ -0,0 +1,113 @@
+#include "child_process.hpp"
+#include <algorithm>
+#include <initializer_list>
+#include <system_error>
+#include <vector>
+
+namespace {
+// A PROC_THREAD_ATTRIBUTE_HANDLE_LIST, so that the child inherits the standard handles it is given and not every
+// inheritable handle the launcher happens to hold.
+class InheritedHandles {
+public:
+  explicit InheritedHandles(std::initializer_list<HANDLE> handles) {
+    for (auto handle : handles) {
+      // CreateProcess rejects a list with null, duplicate or non-inheritable handles
+      DWORD handle_flags = 0;
+      if (handle && handle != INVALID_HANDLE_VALUE && std::find(m_handles.begin(), m_handles.end(), handle) == m_handles.end() &&
+          GetHandleInformation(handle, &handle_flags) && (handle_flags & HANDLE_FLAG_INHERIT)) {
+        m_handles.push_back(handle);
+      }
+    }
+    if (m_handles.empty()) {
+      return;
+    }
+    SIZE_T size = 0;
+    InitializeProcThreadAttributeList(nullptr, 1, 0, &size);
+    m_buffer.resize(size);
+    if (!InitializeProcThreadAttributeList(attributes(), 1, 0, &size)) {
+      throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "InitializeProcThreadAttributeList");
+    }
+    if (!UpdateProcThreadAttribute(attributes(), 0, PROC_THREAD_ATTRIBUTE_HANDLE_LIST, m_handles.data(), m_handles.size() * sizeof(HANDLE), nullptr,
+                                   nullptr)) {
+      std::system_error error(static_cast<int>(GetLastError()), std::system_category(), "UpdateProcThreadAttribute");
+      DeleteProcThreadAttributeList(attributes());
+      throw error;
+    }
+  }
+  InheritedHandles(const InheritedHandles &) = delete;
+  InheritedHandles &operator=(const InheritedHandles &) = delete;
+  ~InheritedHandles() {
+    if (!m_handles.empty()) {
+      DeleteProcThreadAttributeList(attributes());
+    }
+  }
+
+  bool empty() const { return m_handles.empty(); }
+  LPPROC_THREAD_ATTRIBUTE_LIST attributes() { return m_buffer.empty() ? nullptr : reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(m_buffer.data()); }
+
+private:
+  std::vector<HANDLE> m_handles;
+  std::vector<char> m_buffer;
+};
+} // namespace
+
+ChildProcess::ChildProcess(const std::string &command_line, HANDLE std_out, HANDLE std_err, HANDLE job) {
+  STARTUPINFOEXA startup_info{};
+  startup_info.StartupInfo.cb = sizeof(startup_info);
+  startup_info.StartupInfo.dwFlags = STARTF_USESTDHANDLES;
+  startup_info.StartupInfo.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+  startup_info.StartupInfo.hStdOutput = std_out;
+  startup_info.StartupInfo.hStdError = std_err;
+  InheritedHandles inherited{startup_info.StartupInfo.hStdInput, std_out, std_err};
+  startup_info.lpAttributeList = inherited.attributes();
+  PROCESS_INFORMATION process_info{};
+  // CreateProcess may modify the command line in place
+  std::vector<char> mutable_command_line(command_line.begin(), command_line.end());
+  mutable_command_line.push_back('\0');
+  DWORD flags = EXTENDED_STARTUPINFO_PRESENT | (job ? CREATE_SUSPENDED : 0);
+  if (!CreateProcessA(nullptr, mutable_command_line.data(), nullptr, nullptr, !inherited.empty(), flags, nullptr, nullptr, &startup_info.StartupInfo,
+                      &process_info)) {
+    throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "CreateProcess");
+  }
+  if (job) {
+    // a process outside the job still runs, the caller falls back to waiting for it alone
+    m_in_job = AssignProcessToJobObject(job, process_info.hProcess) != FALSE;
+    if (!m_in_job) {
+      m_job_error = GetLastError();
+    }
+    ResumeThread(process_info.hThread);
+  }
+  CloseHandle(process_info.hThread);
+  m_process = process_info.hProcess;
+  m_id = process_info.dwProcessId;
+}
+
+ChildProcess::~ChildProcess() { CloseHandle(m_process); }
+
+bool ChildProcess::exited() const { return WaitForSingleObject(m_process, 0) == WAIT_OBJECT_0; }
+
+DWORD ChildProcess::exit_code() const {
+  DWORD exit_code = 0;
+  GetExitCodeProcess(m_process, &exit_code);
+  return exit_code;
+}
+
+void ChildProcess::terminate() { TerminateProcess(m_process, 1); }
+
+uint64_t process_start_time(HANDLE process) {
+  FILETIME creation, exit, kernel, user;
+  if (!GetProcessTimes(process, &creation, &exit, &kernel, &user)) {
+    return 0;
+  }
+  return uint64_t{creation.dwHighDateTime} << 32 | creation.dwLowDateTime;
+}
+
+bool process_alive(uint32_t pid, uint64_t start_time) {
+  auto process = OpenProcess(SYNCHRONIZE | PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+  if (!process) {
+    return false;
+  }
+  bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT && (start_time == 0 || process_start_time(process) == start_time);
+  CloseHandle(process);
+  return alive;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "windows.h"
+#include <cstdint>
+#include <string>
+
+// launcher_exe started with CreateProcess, so that the event loop can wait on its process handle.
+class ChildProcess {
+public:
+  // The command line is parsed by CreateProcess. With a job, the process is put into it before it runs so that all
+  // of its descendants belong to the job as well; if that fails, as it does on Windows 7 when the launcher is in a job
+  // itself, the process runs outside the job and in_job() is false. Of the launcher's handles only stdin and the two output handles are
+  // inherited. Throws std::system_error if the process cannot be started.
+  ChildProcess(const std::string &command_line, HANDLE std_out, HANDLE std_err, HANDLE job = nullptr);
+  ChildProcess(const ChildProcess &) = delete;
+  ChildProcess &operator=(const ChildProcess &) = delete;
+  // Closes the handles, a process that is still running is left running.
+  ~ChildProcess();
+
+  HANDLE handle() const { return m_process; }
+  DWORD id() const { return m_id; }
+  bool in_job() const { return m_in_job; }
+  // Why the process is not in the job, 0 if it is or no job was given.
+  DWORD job_error() const { return m_job_error; }
+  bool exited() const;
+  // Valid once exited() is true.
+  DWORD exit_code() const;
+  void terminate();
+
+private:
+  HANDLE m_process;
+  DWORD m_id;
+  bool m_in_job = false;
+  DWORD m_job_error = 0;
+};
+
+// The creation time of a process in FILETIME units, 0 if it cannot be read.
+uint64_t process_start_time(HANDLE process);
+// Whether the process is still running. With a start time, a later process that got the id once the original was
+// gone does not count.
+bool process_alive(uint32_t pid, uint64_t start_time);
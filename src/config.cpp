@@ -0,0 +1,147 @@
+#include "config.hpp"
+#include "logger.hpp"
+#include <charconv>
+#include <fstream>
+#include <iterator>
+
+namespace {
+const std::string default_launcher = "C:\\Program Files (x86)\\Steam\\steam.exe steam://open/bigpicture";
+
+std::string_view trim(std::string_view text) {
+  constexpr std::string_view whitespace = " \t\r\v\f";
+  auto first = text.find_first_not_of(whitespace);
+  if (first == std::string_view::npos) {
+    return {};
+  }
+  return text.substr(first, text.find_last_not_of(whitespace) - first + 1);
+}
+
+bool iequals(std::string_view a, std::string_view b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); ++i) {
+    auto ca = a[i] >= 'A' && a[i] <= 'Z' ? a[i] - 'A' + 'a' : a[i];
+    auto cb = b[i] >= 'A' && b[i] <= 'Z' ? b[i] - 'A' + 'a' : b[i];
+    if (ca != cb) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string_view printable(const std::string &value) { return value; }
+int printable(bool value) { return value; }
+uint16_t printable(uint16_t value) { return value; }
+} // namespace
+
+bool IniReader::next(Entry &entry) {
+  while (!m_rest.empty()) {
+    auto eol = m_rest.find('\n');
+    auto line = trim(m_rest.substr(0, eol));
+    m_rest.remove_prefix(eol == std::string_view::npos ? m_rest.size() : eol + 1);
+    ++m_line;
+
+    if (m_line == 1 && line.starts_with("\xEF\xBB\xBF")) {
+      line = trim(line.substr(3));
+    }
+    if (line.empty() || line.front() == ';' || line.front() == '#') {
+      continue;
+    }
+    if (line.front() == '[') {
+      if (line.back() != ']') {
+        ++m_malformed_lines;
+        continue;
+      }
+      m_section = trim(line.substr(1, line.size() - 2));
+      continue;
+    }
+    auto eq = line.find('=');
+    if (eq == std::string_view::npos || eq == 0) {
+      ++m_malformed_lines;
+      continue;
+    }
+    entry = {m_section, trim(line.substr(0, eq)), trim(line.substr(eq + 1)), m_line};
+    return true;
+  }
+  return false;
+}
+
+bool parse_config_value(std::string_view text, std::string &value) {
+  value.assign(text);
+  return true;
+}
+
+bool parse_config_value(std::string_view text, bool &value) {
+  if (text == "1" || iequals(text, "true")) {
+    value = true;
+  } else if (text == "0" || iequals(text, "false")) {
+    value = false;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool parse_config_value(std::string_view text, uint16_t &value) {
+  uint16_t parsed = 0;
+  auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), parsed);
+  if (ec != std::errc{} || end != text.data() + text.size()) {
+    return false;
+  }
+  value = parsed;
+  return true;
+}
+
+LauncherConfig parse_config(std::string_view document, Logger &logger) {
+  LauncherConfig config;
+  IniReader reader{document};
+  IniReader::Entry entry;
+  while (reader.next(entry)) {
+    if (entry.section != config_section) {
+      continue;
+    }
+    bool known = false;
+    for_each_config_field([&](const auto &field) {
+      if (known || entry.key != field.key) {
+        return;
+      }
+      known = true;
+      if (!parse_config_value(entry.value, config.*field.member)) {
+        logger.warn("Invalid value '{}' for {}.{} on line {}, using default", entry.value, config_section, field.key, entry.line);
+      }
+    });
+    if (!known) {
+      logger.warn("Unknown option {}.{} on line {}", config_section, entry.key, entry.line);
+    }
+  }
+  if (reader.malformed_lines() != 0) {
+    logger.warn("Skipped {} malformed line(s) in config file", reader.malformed_lines());
+  }
+  return config;
+}
+
+LauncherConfig load_config(const std::filesystem::path &path, Logger &logger) {
+  std::ifstream ini_f{path, std::ios::binary};
+  std::string document{std::istreambuf_iterator<char>{ini_f}, std::istreambuf_iterator<char>{}};
+  auto config = parse_config(document, logger);
+
+  if (config.launcher_exe != "") {
+    if (config.remote_desktop) {
+      logger.warn("remote_desktop and launcher_exe both specified, defaulting to launcher_exe");
+    }
+    config.remote_desktop = false;
+  }
+  if (!config.remote_desktop && config.launcher_exe == "") {
+    config.launcher_exe = default_launcher;
+  }
+  if (config.remote_desktop && !config.compatibility_window) {
+    logger.warn("compatibility_window required for remote_desktop, setting to true");
+    config.compatibility_window = true;
+  }
+  return config;
+}
+
+void log_config(const LauncherConfig &config, Logger &logger) {
+  for_each_config_field([&](const auto &field) { logger.info("{}.{}={}", config_section, field.key, printable(config.*field.member)); });
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <tuple>
+
+class Logger;
+
+// Defaults live in the member initializers, config_schema below maps every member to its INI key.
+struct LauncherConfig {
+  std::string launcher_exe;
+  bool wait_on_process = true;
+  bool track_process_tree = true;
+  std::string session_process;
+  std::string target_processes;
+  uint16_t target_start_timeout = 120;
+  bool toggle_hdr = false;
+  bool cache_hdr_capabilities = true;
+  uint16_t res_x = 0;
+  uint16_t res_y = 0;
+  uint16_t refresh_rate = 0;
+  std::string display_modes;
+  bool refresh_rate_use_max = true;
+  bool best_fit_mode = true;
+  uint16_t stream_fps = 0;
+  bool remote_desktop = false;
+  bool compatibility_window = true;
+  bool control_channel = true;
+  uint16_t child_output_rate = 50;
+  uint16_t child_output_tail_kb = 64;
+  uint16_t teardown_deadline = 5000;
+  bool binary_log = false;
+  bool trace = false;
+};
+
+template <typename T> struct ConfigField {
+  using value_type = T;
+  std::string_view key;
+  T LauncherConfig::*member;
+};
+
+constexpr auto config_schema = std::make_tuple(ConfigField<std::string>{"launcher_exe", &LauncherConfig::launcher_exe},
+                                               ConfigField<bool>{"wait_on_process", &LauncherConfig::wait_on_process},
+                                               ConfigField<bool>{"track_process_tree", &LauncherConfig::track_process_tree},
+                                               ConfigField<std::string>{"session_process", &LauncherConfig::session_process},
+                                               ConfigField<std::string>{"target_processes", &LauncherConfig::target_processes},
+                                               ConfigField<uint16_t>{"target_start_timeout", &LauncherConfig::target_start_timeout},
+                                               ConfigField<bool>{"toggle_hdr", &LauncherConfig::toggle_hdr},
+                                               ConfigField<bool>{"cache_hdr_capabilities", &LauncherConfig::cache_hdr_capabilities},
+                                               ConfigField<uint16_t>{"res_x", &LauncherConfig::res_x},
+                                               ConfigField<uint16_t>{"res_y", &LauncherConfig::res_y},
+                                               ConfigField<uint16_t>{"refresh_rate", &LauncherConfig::refresh_rate},
+                                               ConfigField<std::string>{"display_modes", &LauncherConfig::display_modes},
+                                               ConfigField<bool>{"refresh_rate_use_max", &LauncherConfig::refresh_rate_use_max},
+                                               ConfigField<bool>{"best_fit_mode", &LauncherConfig::best_fit_mode},
+                                               ConfigField<uint16_t>{"stream_fps", &LauncherConfig::stream_fps},
+                                               ConfigField<bool>{"remote_desktop", &LauncherConfig::remote_desktop},
+                                               ConfigField<bool>{"compatibility_window", &LauncherConfig::compatibility_window},
+                                               ConfigField<bool>{"control_channel", &LauncherConfig::control_channel},
+                                               ConfigField<uint16_t>{"child_output_rate", &LauncherConfig::child_output_rate},
+                                               ConfigField<uint16_t>{"child_output_tail_kb", &LauncherConfig::child_output_tail_kb},
+                                               ConfigField<uint16_t>{"teardown_deadline", &LauncherConfig::teardown_deadline},
+                                               ConfigField<bool>{"binary_log", &LauncherConfig::binary_log},
+                                               ConfigField<bool>{"trace", &LauncherConfig::trace});
+
+constexpr std::string_view config_section = "options";
+
+template <typename field_visitor> constexpr void for_each_config_field(field_visitor &&visit) {
+  std::apply([&](const auto &...fields) { (visit(fields), ...); }, config_schema);
+}
+
+// Forward-only reader over an INI document held in memory. Entries are string_views into the document,
+// nothing is copied or allocated while reading.
+class IniReader {
+public:
+  struct Entry {
+    std::string_view section;
+    std::string_view key;
+    std::string_view value;
+    size_t line;
+  };
+
+  explicit IniReader(std::string_view document) : m_rest{document} {}
+
+  // Returns false at the end of the document. Lines that are neither sections nor key=value pairs are skipped
+  // and counted in malformed_lines().
+  bool next(Entry &entry);
+  size_t malformed_lines() const { return m_malformed_lines; }
+
+private:
+  std::string_view m_rest;
+  std::string_view m_section;
+  size_t m_line = 0;
+  size_t m_malformed_lines = 0;
+};
+
+bool parse_config_value(std::string_view text, std::string &value);
+bool parse_config_value(std::string_view text, bool &value);
+bool parse_config_value(std::string_view text, uint16_t &value);
+
+// Applies the [options] entries of an INI document on top of the defaults. Unknown keys and values that fail
+// to parse are reported and leave the default in place.
+LauncherConfig parse_config(std::string_view document, Logger &logger);
+LauncherConfig load_config(const std::filesystem::path &path, Logger &logger);
+void log_config(const LauncherConfig &config, Logger &logger);
@@ -0,0 +1,199 @@
+#include "crash_reporting.hpp"
+#include "child_process.hpp"
+#include "logger.hpp"
+#include "report_spool.hpp"
+#include "report_uploader.hpp"
+#include "trace.hpp"
+#include "win_http_transport.hpp"
+#include "windows.h"
+#include <dbghelp.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <utility>
+
+#define SENTRY_BUILD_STATIC 1
+#include <sentry.h>
+
+namespace crash_reporting {
+namespace {
+std::mutex state_mutex;
+std::condition_variable ready_cv;
+bool ready = false;
+// false without a valid DSN, nothing is captured then
+bool enabled = false;
+std::vector<std::pair<std::string, std::string>> pending_breadcrumbs;
+std::thread init_thread;
+std::unique_ptr<ReportSpool> spool;
+std::unique_ptr<ReportUploader> uploader;
+// read by the exception filter, which takes no locks
+std::atomic_bool initialised{false};
+// filled in before anything can crash into it
+wchar_t startup_minidump_file[MAX_PATH];
+
+void breadcrumb(const std::string &name, const std::string &message) {
+  sentry_value_t crumb = sentry_value_new_breadcrumb("default", name.c_str());
+  sentry_value_set_by_key(crumb, "message", sentry_value_new_string(message.c_str()));
+  sentry_add_breadcrumb(crumb);
+}
+
+// Sentry's transport: a file write on the thread that captured the event, the network is the uploader's business.
+void spool_envelope(sentry_envelope_t *envelope, void *) {
+  size_t size = 0;
+  if (auto data = sentry_envelope_serialize(envelope, &size)) {
+    if (spool->add({data, size}) && uploader) {
+      uploader->wake();
+    }
+    sentry_free(data);
+  }
+  sentry_envelope_free(envelope);
+}
+
+std::string new_event_id() {
+  std::random_device random;
+  char id[33];
+  for (int i = 0; i < 4; ++i) {
+    std::snprintf(id + 8 * i, 9, "%08x", static_cast<unsigned>(random()));
+  }
+  return std::string(id, 32);
+}
+
+// The minidumps of crashes before Sentry was initialised, left by earlier launcher processes. The database is shared,
+// so the dump of a launcher that is still running, and may still be writing it, is left alone.
+void spool_startup_minidumps(const Settings &settings, Logger &logger) {
+  std::error_code ec;
+  for (const auto &path : orphaned_startup_minidumps(settings.database, process_alive)) {
+    std::string minidump;
+    if (std::ifstream in{path, std::ios::binary}) {
+      minidump.assign(std::istreambuf_iterator<char>(in), {});
+    }
+    // file times are not on the Unix clock everywhere, the age of the file is
+    int64_t age = 0;
+    if (auto written = std::filesystem::last_write_time(path, ec); !ec) {
+      age = std::max<int64_t>(0, std::chrono::duration_cast<std::chrono::seconds>(std::filesystem::file_time_type::clock::now() - written).count());
+    }
+    auto timestamp = static_cast<int64_t>(std::time(nullptr)) - age;
+    if (!minidump.empty() && spool->add(sentry_minidump_envelope(new_event_id(), settings.release, timestamp, minidump))) {
+      logger.info("Spooled the crash report of a launcher that crashed during startup");
+    }
+    std::filesystem::remove(path, ec);
+  }
+  if (uploader) {
+    uploader->wake();
+  }
+}
+} // namespace
+
+void start(Settings settings, Logger &logger) {
+  std::error_code ec;
+  auto endpoint = sentry_endpoint(settings.dsn, "moonlight_hdr_launcher/" + settings.release);
+  if (!endpoint) {
+    // nothing could ever send a report, so startup minidumps are neither written nor kept
+    logger.warn("Invalid Sentry DSN, crash reporting is off");
+    for (const auto &path : orphaned_startup_minidumps(settings.database, process_alive)) {
+      std::filesystem::remove(path, ec);
+    }
+    {
+      std::lock_guard lock{state_mutex};
+      pending_breadcrumbs.clear();
+      ready = true;
+    }
+    ready_cv.notify_all();
+    return;
+  }
+  std::filesystem::create_directories(settings.database, ec);
+  auto minidump_path = startup_minidump_path(settings.database, GetCurrentProcessId(), process_start_time(GetCurrentProcess()));
+  wcsncpy_s(startup_minidump_file, minidump_path.c_str(), _TRUNCATE);
+  spool = std::make_unique<ReportSpool>(settings.spool, GetCurrentProcessId());
+  // the client launcher and the service may both send a report, Sentry drops the duplicate by its event id
+  uploader = std::make_unique<ReportUploader>(
+      *spool, [endpoint = *endpoint](const std::string &report) { return post_sentry_envelope(endpoint, report, std::chrono::seconds{5}); },
+      UploadSchedule{}, []() { SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN); });
+  {
+    std::lock_guard lock{state_mutex};
+    enabled = true;
+  }
+
+  init_thread = std::thread([settings = std::move(settings), &logger]() {
+    TRACE_SCOPE("crash reporting init");
+    auto init_start = std::chrono::steady_clock::now();
+    sentry_options_t *options = sentry_options_new();
+    sentry_options_set_dsn(options, settings.dsn.c_str());
+    sentry_options_set_release(options, settings.release.c_str());
+    sentry_options_set_database_pathw(options, settings.database.c_str());
+    for (const auto &attachment : settings.attachments) {
+      sentry_options_add_attachment(options, attachment.string().c_str());
+    }
+    sentry_options_set_transport(options, sentry_transport_new(spool_envelope));
+    // sends the crashes of earlier runs through the transport, and so into the spool
+    if (sentry_init(options) == 0) {
+      // breakpad's exception handler is installed now
+      initialised.store(true);
+    } else {
+      logger.error("Sentry could not be initialised, crashes are still written as startup minidumps");
+    }
+    spool_startup_minidumps(settings, logger);
+    {
+      std::lock_guard lock{state_mutex};
+      for (const auto &[name, message] : pending_breadcrumbs) {
+        breadcrumb(name, message);
+      }
+      pending_breadcrumbs.clear();
+      ready = true;
+    }
+    ready_cv.notify_all();
+    logger.info("Crash reporting initialised in {} ms, off the startup path",
+                std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - init_start).count());
+  });
+}
+
+bool write_startup_minidump(_EXCEPTION_POINTERS *exception_info) {
+  if (initialised.load() || startup_minidump_file[0] == L'\0') {
+    return false;
+  }
+  auto file = CreateFileW(startup_minidump_file, GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  MINIDUMP_EXCEPTION_INFORMATION exception{GetCurrentThreadId(), exception_info, FALSE};
+  auto written = MiniDumpWriteDump(GetCurrentProcess(), GetCurrentProcessId(), file, MiniDumpNormal, &exception, nullptr, nullptr);
+  CloseHandle(file);
+  return written != FALSE;
+}
+
+void add_breadcrumb(const std::string &name, const std::string &message) {
+  std::lock_guard lock{state_mutex};
+  if (ready) {
+    if (enabled) {
+      breadcrumb(name, message);
+    }
+  } else {
+    pending_breadcrumbs.emplace_back(name, message);
+  }
+}
+
+bool wait_ready(std::chrono::milliseconds timeout) {
+  std::unique_lock lock{state_mutex};
+  return ready_cv.wait_for(lock, timeout, []() { return ready; });
+}
+
+void shutdown() {
+  if (init_thread.joinable()) {
+    init_thread.join();
+  }
+  if (ready && enabled) {
+    // flushes what is still queued into the spool
+    sentry_shutdown();
+  }
+  uploader.reset();
+  spool.reset();
+}
+} // namespace crash_reporting
@@ -0,0 +1,37 @@
+#pragma once
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+class Logger;
+struct _EXCEPTION_POINTERS;
+
+// Sentry, kept off the startup path. Only built with SENTRY_DEBUG.
+namespace crash_reporting {
+struct Settings {
+  std::string dsn;
+  std::string release;
+  // Sentry's own database, crashes are kept there until the next start spools them
+  std::filesystem::path database;
+  // events waiting to be uploaded
+  std::filesystem::path spool;
+  std::vector<std::filesystem::path> attachments;
+};
+
+// Initialises Sentry on a thread of its own. Captured events are written to the spool and sent later by an uploader
+// running at background priority, which starts once the stream is up and retries while the network is down. Sentry's
+// breakpad backend writes a crash into the database, the next start hands it to the spool like any other event.
+// Without a valid DSN crash reporting is off.
+void start(Settings settings, Logger &logger);
+// For the unhandled-exception filter, until Sentry handles crashes itself: writes a minidump into the database on the
+// crashing thread, the next start spools it. Returns false once Sentry is initialised, with crash reporting off, or
+// if no minidump was written.
+bool write_startup_minidump(_EXCEPTION_POINTERS *exception_info);
+// Kept until Sentry is initialised if it is not yet.
+void add_breadcrumb(const std::string &name, const std::string &message);
+// For code about to capture an event, which Sentry drops until it is initialised. False on timeout.
+bool wait_ready(std::chrono::milliseconds timeout);
+// Waits for initialisation, shuts Sentry down and stops the uploader.
+void shutdown();
+} // namespace crash_reporting
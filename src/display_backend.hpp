@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+struct DisplayMode {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t refresh_rate = 0;
+
+  friend bool operator==(const DisplayMode &, const DisplayMode &) = default;
+  friend auto operator<=>(const DisplayMode &a, const DisplayMode &b) {
+    return std::tie(a.width, a.height, a.refresh_rate) <=> std::tie(b.width, b.height, b.refresh_rate);
+  }
+};
+
+// Platform-independent view of the display stack, the Windows implementation lives in win_display_backend.
+class DisplayBackend {
+public:
+  virtual ~DisplayBackend() = default;
+
+  virtual std::vector<DisplayMode> enumerate_modes() = 0;
+  virtual std::optional<DisplayMode> current_mode() = 0;
+  // Identifies the monitor and driver the modes were enumerated for, empty if it cannot be determined.
+  virtual std::string identity() = 0;
+};
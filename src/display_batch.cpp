@@ -0,0 +1,115 @@
+#include "display_batch.hpp"
+#include <algorithm>
+#include <charconv>
+
+namespace {
+constexpr std::string_view device_prefix = "\\\\.\\";
+
+std::string_view trim(std::string_view text) {
+  constexpr std::string_view whitespace = " \t";
+  auto first = text.find_first_not_of(whitespace);
+  if (first == std::string_view::npos) {
+    return {};
+  }
+  return text.substr(first, text.find_last_not_of(whitespace) - first + 1);
+}
+
+bool parse_uint(std::string_view text, uint32_t &value) {
+  auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+  return ec == std::errc{} && end == text.data() + text.size() && !text.empty();
+}
+
+bool parse_mode(std::string_view text, DisplayMode &mode) {
+  auto x = text.find('x');
+  auto at = text.find('@');
+  if (x == std::string_view::npos || (at != std::string_view::npos && at < x)) {
+    return false;
+  }
+  auto height = text.substr(x + 1, at == std::string_view::npos ? std::string_view::npos : at - x - 1);
+  mode.refresh_rate = 0;
+  return parse_uint(text.substr(0, x), mode.width) && parse_uint(height, mode.height) && mode.width != 0 && mode.height != 0 &&
+         (at == std::string_view::npos || parse_uint(text.substr(at + 1), mode.refresh_rate));
+}
+
+bool stage_all(MultiDisplayBackend &backend, const std::vector<DisplayChange> &changes, DisplayMode DisplayChange::*staged,
+               DisplayMode DisplayChange::*fallback) {
+  for (size_t i = 0; i < changes.size(); ++i) {
+    if (!backend.stage(changes[i].device, changes[i].*staged)) {
+      for (size_t j = 0; j < i; ++j) {
+        backend.stage(changes[j].device, changes[j].*fallback);
+      }
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace
+
+std::optional<std::vector<DisplayTarget>> parse_display_targets(std::string_view text) {
+  std::vector<DisplayTarget> targets;
+  while (!text.empty()) {
+    auto separator = text.find(';');
+    auto entry = trim(text.substr(0, separator));
+    text.remove_prefix(separator == std::string_view::npos ? text.size() : separator + 1);
+    if (entry.empty()) {
+      continue;
+    }
+    auto eq = entry.find('=');
+    if (eq == std::string_view::npos) {
+      return {};
+    }
+    DisplayTarget target;
+    auto device = trim(entry.substr(0, eq));
+    if (device.empty() || !parse_mode(trim(entry.substr(eq + 1)), target.mode)) {
+      return {};
+    }
+    target.device = device.starts_with(device_prefix) ? std::string(device) : std::string(device_prefix) + std::string(device);
+    targets.push_back(std::move(target));
+  }
+  return targets;
+}
+
+std::vector<DisplayTarget> current_display_modes(MultiDisplayBackend &backend) {
+  std::vector<DisplayTarget> current;
+  for (auto &device : backend.devices()) {
+    if (auto mode = backend.current_mode(device)) {
+      current.push_back({std::move(device), *mode});
+    }
+  }
+  return current;
+}
+
+std::vector<DisplayChange> diff_display_targets(const std::vector<DisplayTarget> &current, const std::vector<DisplayTarget> &targets,
+                                                std::vector<std::string> &unknown) {
+  std::vector<DisplayChange> changes;
+  for (const auto &target : targets) {
+    auto it = std::find_if(current.begin(), current.end(), [&target](const DisplayTarget &display) { return display.device == target.device; });
+    if (it == current.end()) {
+      unknown.push_back(target.device);
+      continue;
+    }
+    // a target without refresh rate keeps the current one
+    auto wanted = target.mode;
+    if (wanted.refresh_rate == 0) {
+      wanted.refresh_rate = it->mode.refresh_rate;
+    }
+    if (wanted != it->mode) {
+      changes.push_back({target.device, it->mode, wanted});
+    }
+  }
+  return changes;
+}
+
+bool apply_display_changes(MultiDisplayBackend &backend, const std::vector<DisplayChange> &changes) {
+  if (changes.empty()) {
+    return true;
+  }
+  return stage_all(backend, changes, &DisplayChange::target, &DisplayChange::original) && backend.apply();
+}
+
+bool restore_display_changes(MultiDisplayBackend &backend, const std::vector<DisplayChange> &changes) {
+  if (changes.empty()) {
+    return true;
+  }
+  return stage_all(backend, changes, &DisplayChange::original, &DisplayChange::target) && backend.apply();
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "display_backend.hpp"
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Mode changes for several displays at once. Every change is staged first and then applied in a single
+// reconfiguration, so the displays resync once instead of once per display.
+struct DisplayTarget {
+  std::string device;
+  DisplayMode mode;
+};
+
+// Parses "DISPLAY1=1920x1080@60;DISPLAY2=2560x1440", the refresh rate is optional and device names may be given
+// with or without the \\.\ prefix. Returns nothing if any entry is malformed.
+std::optional<std::vector<DisplayTarget>> parse_display_targets(std::string_view text);
+
+// The displays attached to the desktop, addressed by device name (\\.\DISPLAY1). The Windows implementation lives
+// in win_display_backend.
+class MultiDisplayBackend {
+public:
+  virtual ~MultiDisplayBackend() = default;
+
+  virtual std::vector<std::string> devices() = 0;
+  virtual std::vector<DisplayMode> modes(const std::string &device) = 0;
+  virtual std::optional<DisplayMode> current_mode(const std::string &device) = 0;
+  // Records the mode for the next apply() without changing the display. Returns false if the device rejects it.
+  virtual bool stage(const std::string &device, const DisplayMode &mode) = 0;
+  // Applies everything staged in one reconfiguration.
+  virtual bool apply() = 0;
+};
+
+struct DisplayChange {
+  std::string device;
+  DisplayMode original;
+  DisplayMode target;
+};
+
+// The current mode of every attached display.
+std::vector<DisplayTarget> current_display_modes(MultiDisplayBackend &backend);
+
+// The changes that put every target display into its mode, given the current modes. Displays that are already in it
+// are left out, targets for devices that are not attached are added to `unknown`.
+std::vector<DisplayChange> diff_display_targets(const std::vector<DisplayTarget> &current, const std::vector<DisplayTarget> &targets,
+                                                std::vector<std::string> &unknown);
+
+// Stages every target mode, then applies them all at once. If a display rejects its mode the displays staged so far
+// are staged back to their original modes and nothing is applied.
+bool apply_display_changes(MultiDisplayBackend &backend, const std::vector<DisplayChange> &changes);
+// The same in reverse, every original mode is staged and applied at once.
+bool restore_display_changes(MultiDisplayBackend &backend, const std::vector<DisplayChange> &changes);
@@ -0,0 +1,117 @@
+#include "display_mode_catalog.hpp"
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <system_error>
+
+namespace {
+constexpr std::array<char, 8> cache_magic = {'M', 'H', 'D', 'R', 'L', 'D', 'M', '1'};
+constexpr uint32_t max_cached_modes = 1 << 16;
+
+template <typename T> void write_pod(std::ofstream &out, const T &value) { out.write(reinterpret_cast<const char *>(&value), sizeof(value)); }
+template <typename T> bool read_pod(std::ifstream &in, T &value) { return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(value))); }
+
+struct SizeKey {
+  uint32_t width;
+  uint32_t height;
+};
+
+bool size_less(const DisplayMode &mode, const SizeKey &key) { return mode.width < key.width || (mode.width == key.width && mode.height < key.height); }
+bool size_less(const SizeKey &key, const DisplayMode &mode) { return key.width < mode.width || (key.width == mode.width && key.height < mode.height); }
+} // namespace
+
+DisplayModeCatalog::DisplayModeCatalog(std::vector<DisplayMode> modes, std::string identity) : m_modes{std::move(modes)}, m_identity{std::move(identity)} {
+  std::sort(m_modes.begin(), m_modes.end());
+  m_modes.erase(std::unique(m_modes.begin(), m_modes.end()), m_modes.end());
+  m_modes.shrink_to_fit();
+}
+
+DisplayModeCatalog DisplayModeCatalog::open(DisplayBackend &backend, const std::filesystem::path &cache_path, const std::optional<DisplayMode> &required) {
+  auto identity = backend.identity();
+  if (!identity.empty()) {
+    if (auto cached = load(cache_path, identity); cached && (!required || cached->offers(*required))) {
+      return std::move(*cached);
+    }
+  }
+  auto catalog = DisplayModeCatalog{backend.enumerate_modes(), identity};
+  if (!identity.empty()) {
+    catalog.save(cache_path);
+  }
+  return catalog;
+}
+
+std::optional<DisplayModeCatalog> DisplayModeCatalog::load(const std::filesystem::path &path, const std::string &identity) {
+  std::ifstream in{path, std::ios::binary};
+  if (!in) {
+    return {};
+  }
+  std::array<char, cache_magic.size()> magic{};
+  uint32_t identity_size = 0;
+  if (!in.read(magic.data(), magic.size()) || magic != cache_magic || !read_pod(in, identity_size) || identity_size != identity.size()) {
+    return {};
+  }
+  std::string stored_identity(identity_size, '\0');
+  uint32_t count = 0;
+  if (!in.read(stored_identity.data(), identity_size) || stored_identity != identity || !read_pod(in, count) || count > max_cached_modes) {
+    return {};
+  }
+  std::vector<DisplayMode> modes(count);
+  if (!in.read(reinterpret_cast<char *>(modes.data()), count * sizeof(DisplayMode))) {
+    return {};
+  }
+  DisplayModeCatalog catalog{std::move(modes), identity};
+  catalog.m_from_cache = true;
+  return catalog;
+}
+
+bool DisplayModeCatalog::save(const std::filesystem::path &path) const {
+  auto temp_path = path;
+  temp_path += ".tmp";
+  {
+    std::ofstream out{temp_path, std::ios::binary | std::ios::trunc};
+    if (!out) {
+      return false;
+    }
+    out.write(cache_magic.data(), cache_magic.size());
+    write_pod(out, static_cast<uint32_t>(m_identity.size()));
+    out.write(m_identity.data(), m_identity.size());
+    write_pod(out, static_cast<uint32_t>(m_modes.size()));
+    out.write(reinterpret_cast<const char *>(m_modes.data()), m_modes.size() * sizeof(DisplayMode));
+    if (!out.flush()) {
+      return false;
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(temp_path, path, ec);
+  return !ec;
+}
+
+std::span<const DisplayMode> DisplayModeCatalog::modes_for(uint32_t width, uint32_t height) const {
+  auto key = SizeKey{width, height};
+  auto [first, last] = std::equal_range(m_modes.begin(), m_modes.end(), key, [](const auto &a, const auto &b) { return size_less(a, b); });
+  return {first, last};
+}
+
+uint32_t DisplayModeCatalog::max_refresh_rate(uint32_t width, uint32_t height) const {
+  auto modes = modes_for(width, height);
+  return modes.empty() ? 0 : modes.back().refresh_rate;
+}
+
+bool DisplayModeCatalog::contains(const DisplayMode &mode) const { return std::binary_search(m_modes.begin(), m_modes.end(), mode); }
+
+bool DisplayModeCatalog::offers(const DisplayMode &mode) const { return mode.refresh_rate != 0 ? contains(mode) : !modes_for(mode.width, mode.height).empty(); }
+
+std::optional<DisplayMode> DisplayModeCatalog::nearest_refresh_rate(uint32_t width, uint32_t height, uint32_t refresh_rate) const {
+  auto modes = modes_for(width, height);
+  if (modes.empty()) {
+    return {};
+  }
+  auto above = std::lower_bound(modes.begin(), modes.end(), refresh_rate, [](const DisplayMode &mode, uint32_t rate) { return mode.refresh_rate < rate; });
+  if (above == modes.end()) {
+    return modes.back();
+  }
+  if (above == modes.begin() || above->refresh_rate - refresh_rate <= refresh_rate - std::prev(above)->refresh_rate) {
+    return *above;
+  }
+  return *std::prev(above);
+}
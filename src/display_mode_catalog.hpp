@@ -0,0 +1,39 @@
+#pragma once
+#include "display_backend.hpp"
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+// Sorted, deduplicated list of the modes a display supports. Modes are ordered by (width, height, refresh_rate)
+// so every query is a binary search.
+class DisplayModeCatalog {
+public:
+  DisplayModeCatalog() = default;
+  explicit DisplayModeCatalog(std::vector<DisplayMode> modes, std::string identity = {});
+
+  // Loads the catalog from the cache file if it was written for the same backend identity and offers the required
+  // mode, otherwise enumerates the backend and rewrites the cache. A custom resolution added in the driver's control
+  // panel leaves the identity unchanged, so a cached catalog that lacks the requested mode may just be stale.
+  static DisplayModeCatalog open(DisplayBackend &backend, const std::filesystem::path &cache_path, const std::optional<DisplayMode> &required = {});
+  static std::optional<DisplayModeCatalog> load(const std::filesystem::path &path, const std::string &identity);
+  bool save(const std::filesystem::path &path) const;
+
+  std::span<const DisplayMode> modes() const { return m_modes; }
+  std::span<const DisplayMode> modes_for(uint32_t width, uint32_t height) const;
+  const std::string &identity() const { return m_identity; }
+  bool from_cache() const { return m_from_cache; }
+
+  uint32_t max_refresh_rate(uint32_t width, uint32_t height) const;
+  bool contains(const DisplayMode &mode) const;
+  // Like contains(), a refresh rate of 0 matches any refresh rate of that size.
+  bool offers(const DisplayMode &mode) const;
+  // Mode of the requested size with the refresh rate closest to the requested one, preferring the higher rate on ties.
+  std::optional<DisplayMode> nearest_refresh_rate(uint32_t width, uint32_t height, uint32_t refresh_rate) const;
+
+private:
+  std::vector<DisplayMode> m_modes;
+  std::string m_identity;
+  bool m_from_cache = false;
+};
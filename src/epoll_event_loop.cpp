@@ -0,0 +1,86 @@
+#include "event_loop.hpp"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace {
+std::system_error last_error(const char *what) { return std::system_error(errno, std::generic_category(), what); }
+
+void control(int poll_fd, int operation, int fd) {
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.fd = fd;
+  if (epoll_ctl(poll_fd, operation, fd, &event) != 0) {
+    throw last_error("epoll_ctl");
+  }
+}
+} // namespace
+
+const int EventLoop::no_object = -1;
+
+EventLoop::EventLoop() : m_posted_event{eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)}, m_poll_fd{epoll_create1(EPOLL_CLOEXEC)} {
+  if (m_posted_event < 0 || m_poll_fd < 0) {
+    auto error = last_error("EventLoop");
+    close(m_posted_event);
+    close(m_poll_fd);
+    throw error;
+  }
+  control(m_poll_fd, EPOLL_CTL_ADD, m_posted_event);
+}
+
+EventLoop::~EventLoop() {
+  close(m_poll_fd);
+  close(m_posted_event);
+}
+
+void EventLoop::watch(int object, Handler on_signaled) {
+  control(m_poll_fd, EPOLL_CTL_ADD, object);
+  m_watches.push_back({object, std::move(on_signaled)});
+}
+
+void EventLoop::unwatch(int object) {
+  auto it = std::remove_if(m_watches.begin(), m_watches.end(), [object](const Watch &w) { return w.object == object; });
+  if (it != m_watches.end()) {
+    // the descriptor may already be closed, which removed it from the epoll set
+    epoll_ctl(m_poll_fd, EPOLL_CTL_DEL, object, nullptr);
+    m_watches.erase(it, m_watches.end());
+  }
+}
+
+void EventLoop::wake() {
+  uint64_t one = 1;
+  // fails only once the counter would overflow, the loop is woken up either way
+  [[maybe_unused]] auto ignored = ::write(m_posted_event, &one, sizeof(one));
+}
+
+void EventLoop::wait_once(int extra_object, std::vector<int> &ready) {
+  if (extra_object != no_object) {
+    control(m_poll_fd, EPOLL_CTL_ADD, extra_object);
+  }
+  auto timeout = time_to_next_timer();
+  std::array<epoll_event, 16> events;
+  int count;
+  do {
+    count = epoll_wait(m_poll_fd, events.data(), static_cast<int>(events.size()), timeout ? static_cast<int>(timeout->count()) : -1);
+  } while (count < 0 && errno == EINTR);
+  auto error = errno;
+  if (extra_object != no_object) {
+    epoll_ctl(m_poll_fd, EPOLL_CTL_DEL, extra_object, nullptr);
+  }
+  if (count < 0) {
+    throw std::system_error(error, std::generic_category(), "epoll_wait");
+  }
+  for (int i = 0; i < count; ++i) {
+    if (events[i].data.fd == m_posted_event) {
+      // reset like an auto-reset event
+      uint64_t value;
+      [[maybe_unused]] auto ignored = ::read(m_posted_event, &value, sizeof(value));
+    }
+    ready.push_back(events[i].data.fd);
+  }
+}
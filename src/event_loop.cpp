@@ -0,0 +1,109 @@
+#include "event_loop.hpp"
+#include <algorithm>
+
+EventLoop::TimerId EventLoop::add_timer(std::chrono::milliseconds delay, Handler on_expired) {
+  auto id = m_next_timer++;
+  m_timers.emplace(id, Timer{clock::now() + delay, std::move(on_expired)});
+  return id;
+}
+
+void EventLoop::cancel_timer(TimerId id) { m_timers.erase(id); }
+
+void EventLoop::post(Handler handler) {
+  {
+    std::lock_guard lock{m_posted_mutex};
+    if (!m_accepting_posts) {
+      return;
+    }
+    m_posted.push_back(std::move(handler));
+  }
+  wake();
+}
+
+void EventLoop::shutdown() {
+  std::vector<Handler> dropped;
+  {
+    std::lock_guard lock{m_posted_mutex};
+    m_accepting_posts = false;
+    dropped.swap(m_posted);
+  }
+  m_stopped = true;
+}
+
+void EventLoop::run() {
+  m_stopped = false;
+  bool unused = false;
+  while (!m_stopped) {
+    run_once(no_object, unused);
+  }
+}
+
+void EventLoop::run_until(Handle object) {
+  bool signaled = false;
+  while (!signaled) {
+    run_once(object, signaled);
+  }
+}
+
+void EventLoop::run_once(Handle extra_object, bool &extra_signaled) {
+  std::vector<Handle> ready;
+  wait_once(extra_object, ready);
+  ++m_wakeups;
+  for (auto object : ready) {
+    if (object == m_posted_event) {
+      run_posted();
+    } else if (object == extra_object) {
+      extra_signaled = true;
+    } else {
+      run_watch(object);
+    }
+  }
+  run_expired_timers();
+}
+
+std::optional<std::chrono::milliseconds> EventLoop::time_to_next_timer() const {
+  if (m_timers.empty()) {
+    return std::nullopt;
+  }
+  auto next = std::min_element(m_timers.begin(), m_timers.end(), [](const auto &a, const auto &b) { return a.second.expiry < b.second.expiry; });
+  return std::max(std::chrono::ceil<std::chrono::milliseconds>(next->second.expiry - clock::now()), std::chrono::milliseconds{0});
+}
+
+void EventLoop::run_watch(Handle object) {
+  // the handler may unwatch anything, including itself, so it is looked up and copied first
+  auto it = std::find_if(m_watches.begin(), m_watches.end(), [object](const Watch &w) { return w.object == object; });
+  if (it != m_watches.end()) {
+    auto handler = it->on_signaled;
+    handler();
+  }
+}
+
+void EventLoop::run_expired_timers() {
+  auto now = clock::now();
+  std::vector<TimerId> expired;
+  for (const auto &[id, timer] : m_timers) {
+    if (timer.expiry <= now) {
+      expired.push_back(id);
+    }
+  }
+  // a handler may cancel timers that expired at the same time
+  for (auto id : expired) {
+    auto it = m_timers.find(id);
+    if (it != m_timers.end()) {
+      auto handler = std::move(it->second.on_expired);
+      m_timers.erase(it);
+      handler();
+    }
+  }
+}
+
+void EventLoop::run_posted() {
+  std::vector<Handler> posted;
+  {
+    std::lock_guard lock{m_posted_mutex};
+    posted.swap(m_posted);
+  }
+  for (auto &handler : posted) {
+    handler();
+  }
+}
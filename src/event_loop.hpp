@@ -0,0 +1,94 @@
+#pragma once
+#ifdef _WIN32
+#include "windows.h"
+#endif
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+// Single-threaded reactor for a session: one wait for the watched objects, the nearest timer and work posted from
+// other threads. Handlers run on the thread running the loop, one at a time. The wait is the only platform specific
+// part: MsgWaitForMultipleObjectsEx on Windows, which also dispatches the window messages of the thread running the
+// loop (win_event_loop.cpp), and epoll on Linux (epoll_event_loop.cpp).
+class EventLoop {
+public:
+  using Handler = std::function<void()>;
+  using TimerId = uint64_t;
+#ifdef _WIN32
+  // A kernel object: a process, an overlapped I/O event.
+  using Handle = HANDLE;
+#else
+  // A file descriptor, signaled while it is readable.
+  using Handle = int;
+#endif
+
+  EventLoop();
+  EventLoop(const EventLoop &) = delete;
+  EventLoop &operator=(const EventLoop &) = delete;
+  ~EventLoop();
+
+  // on_signaled runs whenever the object is found signaled, so an object that stays signaled (a process, a
+  // manual-reset event, a readable descriptor) has to be unwatched or reset by its handler. Each object is watched
+  // once, at most MAXIMUM_WAIT_OBJECTS - 3 of them on Windows.
+  void watch(Handle object, Handler on_signaled);
+  void unwatch(Handle object);
+
+  TimerId add_timer(std::chrono::milliseconds delay, Handler on_expired);
+  void cancel_timer(TimerId id);
+
+  // May be called from any thread. After shutdown() the handler is dropped without running.
+  void post(Handler handler);
+
+  // Runs until stop() is called by a handler.
+  void run();
+  // Runs the loop until the object is signaled, for blocking calls that have to keep the thread's windows responsive.
+  void run_until(Handle object);
+  void stop() { m_stopped = true; }
+  // Drops pending and future posted work. Whoever waits for posted work to complete sees it abandoned.
+  void shutdown();
+
+  // Number of times the wait returned, to check that an idle session does not spin.
+  uint64_t wakeups() const { return m_wakeups; }
+
+private:
+  using clock = std::chrono::steady_clock;
+
+  // nullptr on Windows, -1 elsewhere
+  static const Handle no_object;
+
+  // Platform specific: signals m_posted_event, and waits for the next event, appending the signaled objects to ready.
+  void wake();
+  void wait_once(Handle extra_object, std::vector<Handle> &ready);
+
+  void run_once(Handle extra_object, bool &extra_signaled);
+  std::optional<std::chrono::milliseconds> time_to_next_timer() const;
+  void run_watch(Handle object);
+  void run_expired_timers();
+  void run_posted();
+
+  struct Watch {
+    Handle object;
+    Handler on_signaled;
+  };
+  struct Timer {
+    clock::time_point expiry;
+    Handler on_expired;
+  };
+
+  std::vector<Watch> m_watches;
+  std::map<TimerId, Timer> m_timers;
+  TimerId m_next_timer = 1;
+  // signaled by post(); an auto-reset event on Windows, an eventfd elsewhere
+  Handle m_posted_event;
+  // the epoll instance, unused on Windows
+  int m_poll_fd = -1;
+  std::mutex m_posted_mutex;
+  std::vector<Handler> m_posted;
+  bool m_accepting_posts = true;
+  bool m_stopped = false;
+  uint64_t m_wakeups = 0;
+};
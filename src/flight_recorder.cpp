@@ -0,0 +1,199 @@
+#include "flight_recorder.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+namespace flight {
+namespace {
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t capacity;
+  uint32_t owner_pid;
+  uint32_t clean;
+  uint64_t start_time;
+  uint64_t next;
+  uint8_t reserved[24];
+};
+
+struct Slot {
+  uint64_t sequence;
+  uint64_t time;
+  uint64_t a;
+  uint16_t event;
+  uint16_t reserved;
+  uint32_t b;
+};
+
+static_assert(sizeof(Header) == header_size);
+static_assert(sizeof(Slot) == slot_size);
+
+constexpr std::array<std::string_view, static_cast<size_t>(Event::count)> event_names{
+    "session_start", "session_end",  "display_mode_set", "display_mode_restored", "display_batch_set", "display_batch_restored",
+    "hdr_enabled",   "hdr_disabled", "child_spawned",    "child_exited",          "process_joined",    "process_left",
+    "teardown_done", "child_output_dropped", "unhandled_exception"};
+
+std::atomic<Header *> ring{nullptr};
+
+uint64_t now() {
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+bool power_of_two(uint32_t value) { return value != 0 && (value & (value - 1)) == 0; }
+
+std::string local_time(uint64_t time) {
+  auto seconds = static_cast<std::time_t>(time / 1000000);
+  char buffer[64];
+  auto length = std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %X", std::localtime(&seconds));
+  return std::string(buffer, length);
+}
+
+std::string describe_mode(uint64_t packed, uint32_t refresh_rate) {
+  return std::to_string(packed >> 32) + "x" + std::to_string(packed & 0xffffffff) + "@" + std::to_string(refresh_rate);
+}
+
+std::string describe_args(const Record &record) {
+  switch (static_cast<Event>(record.event)) {
+  case Event::display_mode_set:
+  case Event::display_mode_restored:
+    return describe_mode(record.a, record.b);
+  case Event::display_batch_set:
+  case Event::display_batch_restored:
+    return std::to_string(record.a) + " displays";
+  case Event::child_spawned:
+  case Event::process_joined:
+  case Event::process_left:
+    return "pid " + std::to_string(record.a);
+  case Event::child_exited:
+    return "pid " + std::to_string(record.a) + ", exit code " + std::to_string(record.b);
+  case Event::teardown_done:
+    return std::to_string(record.a) + " actions, " + std::to_string(record.b) + " did not finish in time";
+  case Event::child_output_dropped:
+    return std::to_string(record.a) + " lines";
+  case Event::unhandled_exception: {
+    char code[16];
+    std::snprintf(code, sizeof(code), "%#llx", static_cast<unsigned long long>(record.a));
+    return std::string("code ") + code;
+  }
+  case Event::session_start:
+  case Event::session_end:
+  case Event::hdr_enabled:
+  case Event::hdr_disabled:
+    return {};
+  default:
+    return std::to_string(record.a) + " " + std::to_string(record.b);
+  }
+}
+} // namespace
+
+std::string_view event_name(Event event) {
+  auto index = static_cast<size_t>(event);
+  return index < event_names.size() ? event_names[index] : "unknown";
+}
+
+uint64_t pack_mode(uint32_t width, uint32_t height) { return uint64_t{width} << 32 | height; }
+
+bool attach(void *memory, size_t size, uint32_t capacity, uint32_t pid) {
+  if (!power_of_two(capacity) || size < region_size(capacity) || reinterpret_cast<uintptr_t>(memory) % alignof(Header) != 0) {
+    return false;
+  }
+  std::memset(memory, 0, region_size(capacity));
+  auto header = static_cast<Header *>(memory);
+  std::memcpy(header->magic, magic.data(), magic.size());
+  header->version = format_version;
+  header->capacity = capacity;
+  header->owner_pid = pid;
+  header->start_time = now();
+  ring.store(header, std::memory_order_release);
+  return true;
+}
+
+void detach(bool clean) {
+  auto header = ring.exchange(nullptr, std::memory_order_acq_rel);
+  if (header && clean) {
+    std::atomic_ref{header->clean}.store(1, std::memory_order_release);
+  }
+}
+
+bool attached() { return ring.load(std::memory_order_relaxed) != nullptr; }
+
+void record(Event event, uint64_t a, uint32_t b) {
+  auto header = ring.load(std::memory_order_acquire);
+  if (!header) {
+    return;
+  }
+  auto sequence = std::atomic_ref{header->next}.fetch_add(1, std::memory_order_relaxed);
+  auto &slot = reinterpret_cast<Slot *>(header + 1)[sequence & (header->capacity - 1)];
+  std::atomic_ref slot_sequence{slot.sequence};
+  slot_sequence.store(0, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.time = now();
+  slot.a = a;
+  slot.event = static_cast<uint16_t>(event);
+  slot.b = b;
+  slot_sequence.store(sequence + 1, std::memory_order_release);
+}
+
+std::optional<Report> recover(std::string_view data) {
+  Header header;
+  if (data.size() < sizeof(header)) {
+    return std::nullopt;
+  }
+  std::memcpy(&header, data.data(), sizeof(header));
+  if (std::string_view(header.magic, sizeof(header.magic)) != magic || header.version != format_version || !power_of_two(header.capacity) ||
+      data.size() < region_size(header.capacity)) {
+    return std::nullopt;
+  }
+
+  Report report;
+  report.owner_pid = header.owner_pid;
+  report.start_time = header.start_time;
+  report.clean = header.clean != 0;
+  report.recorded = header.next;
+  // only the last `capacity` sequence numbers can still be in the ring
+  auto kept = std::min<uint64_t>(header.next, header.capacity);
+  auto oldest = header.next - kept;
+  for (uint32_t index = 0; index < header.capacity; ++index) {
+    Slot slot;
+    std::memcpy(&slot, data.data() + header_size + size_t{index} * slot_size, sizeof(slot));
+    if (slot.sequence == 0) {
+      continue;
+    }
+    auto sequence = slot.sequence - 1;
+    // a slot left over from an earlier lap was claimed again, but its owner died before clearing it
+    if (sequence < oldest || sequence >= header.next || (sequence & (header.capacity - 1)) != index) {
+      continue;
+    }
+    report.records.push_back({sequence, slot.time, slot.event, slot.a, slot.b});
+  }
+  std::sort(report.records.begin(), report.records.end(), [](const Record &a, const Record &b) { return a.sequence < b.sequence; });
+  report.torn = kept - report.records.size();
+  return report;
+}
+
+std::vector<std::string> describe(const Report &report) {
+  std::vector<std::string> lines;
+  lines.push_back("Launcher process " + std::to_string(report.owner_pid) + " started at " + local_time(report.start_time) +
+                  (report.clean ? " and ended cleanly" : " and did not end cleanly"));
+  if (report.recorded > report.records.size() + report.torn) {
+    lines.push_back(std::to_string(report.recorded) + " events were recorded, only the last " + std::to_string(report.records.size() + report.torn) +
+                    " are kept");
+  }
+  if (report.torn != 0) {
+    lines.push_back(std::to_string(report.torn) + " events were still being written");
+  }
+  for (const auto &record : report.records) {
+    char offset[32];
+    // recorded with the wall clock, an adjustment of the clock can put an event before the start
+    auto micros = static_cast<int64_t>(record.time - report.start_time);
+    std::snprintf(offset, sizeof(offset), "%+.3f s", static_cast<double>(micros) / 1e6);
+    auto args = describe_args(record);
+    auto event = record.event < event_names.size() ? std::string(event_names[record.event]) : "event_" + std::to_string(record.event);
+    lines.push_back(std::string(offset) + " " + event + (args.empty() ? "" : " " + args));
+  }
+  return lines;
+}
+} // namespace flight
@@ -0,0 +1,88 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Last events of the launcher in a fixed-size ring, meant to live in a memory-mapped file so that it survives the
+// process: the next start finds out whether the previous one ended cleanly and reports what it was doing. Recording
+// an event claims a slot with one atomic increment and fills it with plain stores, no locks and no system calls.
+namespace flight {
+// The IDs are stored in the ring, so new events are only ever appended.
+enum class Event : uint16_t {
+  session_start,
+  session_end,
+  // a: width << 32 | height, b: refresh rate
+  display_mode_set,
+  display_mode_restored,
+  // a: number of displays
+  display_batch_set,
+  display_batch_restored,
+  hdr_enabled,
+  hdr_disabled,
+  // a: pid
+  child_spawned,
+  // a: pid, b: exit code
+  child_exited,
+  // a: pid
+  process_joined,
+  process_left,
+  // a: number of actions, b: number that did not finish in time
+  teardown_done,
+  // a: lines of child output that were not logged
+  child_output_dropped,
+  // a: exception code
+  unhandled_exception,
+  count
+};
+
+std::string_view event_name(Event event);
+uint64_t pack_mode(uint32_t width, uint32_t height);
+
+// Layout, little-endian: a 64 byte header, then `capacity` 32 byte slots. The header holds the magic, the format
+// version, the capacity, the owner's pid, the clean flag, the start time and the number of slots claimed so far.
+// A slot holds its sequence number plus one, the time in microseconds since the Unix epoch, the event and its two
+// arguments. The sequence number is cleared first and stored last, so a slot the owner died writing is recognised.
+constexpr std::string_view magic = "MHDRLFR1";
+constexpr uint32_t format_version = 1;
+constexpr size_t header_size = 64;
+constexpr size_t slot_size = 32;
+constexpr size_t region_size(uint32_t capacity) { return header_size + size_t{capacity} * slot_size; }
+
+// Formats the memory as an empty ring and records into it from now on. The memory must be aligned to 8 bytes and
+// stay valid as long as a record() call may still be running, even after detach(); capacity must be a power of two.
+// Returns false, and records nothing, if the ring does not fit.
+bool attach(void *memory, size_t size, uint32_t capacity, uint32_t pid);
+// Stops recording; a clean detach marks the ring so that the next start does not report it.
+void detach(bool clean);
+bool attached();
+
+void record(Event event, uint64_t a = 0, uint32_t b = 0);
+
+struct Record {
+  uint64_t sequence = 0;
+  uint64_t time = 0;
+  uint16_t event = 0;
+  uint64_t a = 0;
+  uint32_t b = 0;
+};
+
+struct Report {
+  uint32_t owner_pid = 0;
+  uint64_t start_time = 0;
+  bool clean = false;
+  // slots claimed over the lifetime of the ring, older ones were overwritten
+  uint64_t recorded = 0;
+  // oldest first
+  std::vector<Record> records;
+  // slots the owner claimed but did not finish writing
+  uint64_t torn = 0;
+};
+
+// Reads a ring left behind by another process. Returns nothing unless the header is valid.
+std::optional<Report> recover(std::string_view data);
+std::vector<std::string> describe(const Report &report);
+} // namespace flight
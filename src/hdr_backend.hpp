@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct HdrError : public std::runtime_error {
+  explicit HdrError(const std::string &what) : std::runtime_error(what) {}
+  explicit HdrError(const char *what) : std::runtime_error(what) {}
+};
+
+// GPU/display calls HdrToggle is built on. Implementations signal failures by throwing HdrError and must allow
+// set_hdr_mode to be called concurrently for different displays.
+class HdrBackend {
+public:
+  virtual ~HdrBackend() = default;
+
+  // Changes whenever an update could invalidate previously discovered capabilities.
+  virtual std::string driver_version() = 0;
+  virtual uint32_t gpu_count() = 0;
+  virtual std::vector<uint32_t> connected_display_ids(uint32_t gpu_index) = 0;
+  virtual bool is_hdr_supported(uint32_t display_id) = 0;
+  virtual bool is_hdr_enabled(uint32_t display_id) = 0;
+  virtual void set_hdr_mode(uint32_t display_id, bool enabled) = 0;
+};
@@ -1,134 +1,210 @@
 #include "hdr_toggle.hpp"
+#include "trace.hpp"
+#include "worker_pool.hpp"
 #include <algorithm>
-#include <string>
-
-bool _check_status(const NvAPI_Status &s, const std::string &message, bool should_raise) {
-  if (s != NVAPI_OK) {
-    NvAPI_ShortString err_msg;
-    if (NvAPI_GetErrorMessage(s, err_msg) != NVAPI_OK) {
-      if (should_raise) {
-        throw NvapiException(message + std::string("Failed to get NVAPI error message"));
-      } else {
-        return false;
+#include <fstream>
+#include <system_error>
+
+bool any_succeeded(const std::vector<HdrDisplayResult> &results) {
+  return std::any_of(std::begin(results), std::end(results), [](const auto &r) { return r.success; });
+}
+
+HdrToggle::HdrToggle(std::unique_ptr<HdrBackend> backend, size_t max_parallel, std::optional<std::filesystem::path> cache_path)
+    : m_backend{std::move(backend)}, m_max_parallel{max_parallel}, m_cache_path{std::move(cache_path)} {}
+
+std::vector<HdrDisplayResult> HdrToggle::set_hdr_mode(bool enabled) {
+  std::vector<HdrDisplay> displays;
+  if (!enabled && m_enabled_displays) {
+    displays = *m_enabled_displays;
+  } else {
+    for (const auto &capability : capabilities().displays) {
+      if (capability.hdr_supported) {
+        displays.push_back(capability.display);
       }
     }
-    if (should_raise) {
-      throw NvapiException(message + std::string("NVAPI Error") + std::string(err_msg));
-    } else {
-      return false;
+  }
+  if (enabled) {
+    return enable_hdr(displays);
+  }
+  auto results = toggle(displays, false);
+  if (m_enabled_displays) {
+    // the ones that failed are still ours to switch back
+    m_enabled_displays->clear();
+    for (const auto &result : results) {
+      if (!result.success) {
+        m_enabled_displays->push_back(result.display);
+      }
     }
-  } else {
-    return true;
   }
+  return results;
 }
 
-HdrToggle::HdrToggle() { check_status(NvAPI_Initialize()); }
-
-HdrToggle::~HdrToggle() { check_status(NvAPI_Unload()); }
-
-void HdrToggle::calc_mastering_data(NV_HDR_COLOR_DATA *hdr_data) {
-  double rx = 0.64;
-  double ry = 0.33;
-  double gx = 0.30;
-  double gy = 0.60;
-  double bx = 0.15;
-  double by = 0.06;
-  double wx = 0.3127;
-  double wy = 0.3290;
-  double min_master = 1.0;
-  double max_master = 1000;
-  double max_cll = 1000;
-  double max_fall = 100;
-
-  hdr_data->mastering_display_data.displayPrimary_x0 = (NvU16)ceil(rx * 0xC350 + 0.5);
-  hdr_data->mastering_display_data.displayPrimary_y0 = (NvU16)ceil(ry * 0xC350 + 0.5);
-  hdr_data->mastering_display_data.displayPrimary_x1 = (NvU16)ceil(gx * 0xC350 + 0.5);
-  hdr_data->mastering_display_data.displayPrimary_y1 = (NvU16)ceil(gy * 0xC350 + 0.5);
-  hdr_data->mastering_display_data.displayPrimary_x2 = (NvU16)ceil(bx * 0xC350 + 0.5);
-  hdr_data->mastering_display_data.displayPrimary_y2 = (NvU16)ceil(by * 0xC350 + 0.5);
-  hdr_data->mastering_display_data.displayWhitePoint_x = (NvU16)ceil(wx * 0xC350 + 0.5);
-  hdr_data->mastering_display_data.displayWhitePoint_y = (NvU16)ceil(wy * 0xC350 + 0.5);
-  hdr_data->mastering_display_data.max_content_light_level = (NvU16)ceil(max_cll + 0.5);
-  hdr_data->mastering_display_data.max_display_mastering_luminance = (NvU16)ceil(max_master + 0.5);
-  hdr_data->mastering_display_data.max_frame_average_light_level = (NvU16)ceil(max_fall + 0.5);
-  hdr_data->mastering_display_data.min_display_mastering_luminance = (NvU16)ceil(min_master * 10000.0 + 0.5);
+std::vector<HdrDisplayResult> HdrToggle::enable_hdr(const std::vector<HdrDisplay> &displays) {
+  auto results = toggle(displays, true);
+  m_enabled_displays.emplace();
+  for (const auto &result : results) {
+    if (result.success) {
+      m_enabled_displays->push_back(result.display);
+    }
+  }
+  return results;
 }
 
-NV_HDR_COLOR_DATA HdrToggle::set_hdr_data(bool enabled) {
-  NV_HDR_COLOR_DATA color = {0};
-
-  color.version = NV_HDR_COLOR_DATA_VER;
-  color.cmd = NV_HDR_CMD_SET;
-
-  if (enabled) {
-    color.hdrColorFormat = NV_COLOR_FORMAT_RGB;
-    color.hdrBpc = NV_BPC_8;
+std::vector<HdrDisplay> HdrToggle::hdr_off_displays() {
+  TRACE_SCOPE("HDR state");
+  std::vector<HdrDisplay> displays;
+  for (const auto &capability : capabilities().displays) {
+    if (!capability.hdr_supported) {
+      continue;
+    }
+    bool enabled = false;
+    try {
+      enabled = m_backend->is_hdr_enabled(capability.display.display_id);
+    } catch (HdrError &) {
+      // switching it on again is harmless
+    }
+    if (!enabled) {
+      displays.push_back(capability.display);
+    }
   }
+  return displays;
+}
 
-  color.hdrDynamicRange = NV_DYNAMIC_RANGE_AUTO;
-  color.hdrMode = enabled ? NV_HDR_MODE_UHDA : NV_HDR_MODE_OFF;
-
-  calc_mastering_data(&color);
-
-  return color;
+const HdrCapabilitySnapshot &HdrToggle::capabilities() {
+  if (!m_capabilities) {
+    m_capabilities = discover();
+  }
+  return *m_capabilities;
 }
 
-bool HdrToggle::set_hdr_mode(bool enabled) {
-  auto disp_ids_hdr = get_hdr_display_ids();
+HdrCapabilitySnapshot HdrToggle::discover() {
+  TRACE_SCOPE("HDR capability discovery");
+  HdrCapabilitySnapshot snapshot;
+  std::string key;
+  try {
+    key = m_backend->driver_version();
+  } catch (HdrError &e) {
+    snapshot.errors.push_back(std::string("driver version: ") + e.what());
+  }
 
-  std::vector<bool> statuses;
-  for (const auto &disp_id : disp_ids_hdr) {
-    auto color = set_hdr_data(enabled);
-    auto status = check_status_nothrow(NvAPI_Disp_HdrColorControl(disp_id.displayId, &color));
-    statuses.push_back(status);
+  uint32_t gpu_count = 0;
+  try {
+    gpu_count = m_backend->gpu_count();
+  } catch (HdrError &e) {
+    snapshot.errors.push_back(std::string("GPU enumeration: ") + e.what());
+    return snapshot;
   }
 
-  if (std::any_of(std::begin(statuses), std::end(statuses), [](auto s) { return s; })) {
-    return true;
+  std::vector<HdrDisplay> connected;
+  for (uint32_t gpu_index = 0; gpu_index < gpu_count; ++gpu_index) {
+    key += "|";
+    try {
+      for (auto display_id : m_backend->connected_display_ids(gpu_index)) {
+        connected.push_back({gpu_index, display_id});
+        key += std::to_string(display_id) + ",";
+      }
+    } catch (HdrError &e) {
+      snapshot.errors.push_back("GPU " + std::to_string(gpu_index) + ": " + e.what());
+    }
   }
-  return false;
-}
 
-std::vector<NV_GPU_DISPLAYIDS> HdrToggle::get_hdr_display_ids() {
-  NvU32 disp_id_count = 0;
+  // the key is only trustworthy if every part of it could be read
+  if (snapshot.errors.empty()) {
+    snapshot.key = std::move(key);
+    if (auto cached = load_cache(snapshot.key)) {
+      return std::move(*cached);
+    }
+  }
 
-  auto gpu_handles = std::vector<NvPhysicalGpuHandle>(NVAPI_MAX_PHYSICAL_GPUS);
-  NvU32 num_of_gp_us = 0;
+  bool complete = snapshot.errors.empty();
+  for (const auto &display : connected) {
+    HdrCapability capability{display, false, {}};
+    try {
+      capability.hdr_supported = m_backend->is_hdr_supported(display.display_id);
+    } catch (HdrError &e) {
+      capability.error = e.what();
+      complete = false;
+    }
+    snapshot.displays.push_back(std::move(capability));
+  }
+  if (complete) {
+    save_cache(snapshot);
+  }
+  return snapshot;
+}
 
-  auto status = check_status(NvAPI_EnumPhysicalGPUs(gpu_handles.data(), &num_of_gp_us));
-  if (!status) {
+std::optional<HdrCapabilitySnapshot> HdrToggle::load_cache(const std::string &key) const {
+  if (!m_cache_path) {
     return {};
   }
-
-  NvU32 connected_displays = 0;
-
-  status = check_status(NvAPI_GPU_GetConnectedDisplayIds(gpu_handles[0], NULL, &disp_id_count, NULL));
-  if (!status) {
+  std::ifstream in{*m_cache_path};
+  std::string stored_key;
+  if (!std::getline(in, stored_key) || stored_key != key) {
     return {};
   }
-
-  auto disp_ids = std::vector<NV_GPU_DISPLAYIDS>(disp_id_count);
-  for (auto &disp_id : disp_ids) {
-    disp_id.version = NV_GPU_DISPLAYIDS_VER;
+  HdrCapabilitySnapshot snapshot;
+  snapshot.key = key;
+  snapshot.from_cache = true;
+  HdrCapability capability{};
+  while (in >> capability.display.gpu_index >> capability.display.display_id >> capability.hdr_supported) {
+    snapshot.displays.push_back(capability);
   }
-
-  status = check_status(NvAPI_GPU_GetConnectedDisplayIds(gpu_handles[0], disp_ids.data(), &disp_id_count, NULL));
-  if (!status) {
+  if (!in.eof()) {
     return {};
   }
+  return snapshot;
+}
 
-  std::vector<NV_GPU_DISPLAYIDS> display_ids_hdr;
-  for (auto &disp_id : disp_ids) {
-    NV_HDR_CAPABILITIES hdr_capabilities;
-    hdr_capabilities.version = NV_HDR_CAPABILITIES_VER;
-    status = check_status(NvAPI_Disp_GetHdrCapabilities(disp_id.displayId, &hdr_capabilities));
-    if (!status) {
-      return {};
+void HdrToggle::save_cache(const HdrCapabilitySnapshot &snapshot) const {
+  if (!m_cache_path || snapshot.key.empty()) {
+    return;
+  }
+  auto temp_path = *m_cache_path;
+  temp_path += ".tmp";
+  {
+    std::ofstream out{temp_path, std::ios::trunc};
+    out << snapshot.key << "\n";
+    for (const auto &capability : snapshot.displays) {
+      out << capability.display.gpu_index << " " << capability.display.display_id << " " << capability.hdr_supported << "\n";
     }
-    if (hdr_capabilities.isST2084EotfSupported == 1) {
-      display_ids_hdr.push_back(disp_id);
+    if (!out.flush()) {
+      return;
     }
   }
+  std::error_code ec;
+  std::filesystem::rename(temp_path, *m_cache_path, ec);
+}
 
-  return display_ids_hdr;
-}
\ No newline at end of file
+std::vector<HdrDisplayResult> HdrToggle::toggle(const std::vector<HdrDisplay> &displays, bool enabled) {
+  auto toggle_one = [this, enabled](HdrDisplay display) {
+    TRACE_SCOPE("HDR colour control");
+    auto start = std::chrono::steady_clock::now();
+    HdrDisplayResult result{display, true, {}, {}};
+    try {
+      m_backend->set_hdr_mode(display.display_id, enabled);
+    } catch (HdrError &e) {
+      result.success = false;
+      result.error = e.what();
+    }
+    result.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    return result;
+  };
+
+  std::vector<HdrDisplayResult> results;
+  if (displays.size() <= 1 || m_max_parallel <= 1) {
+    for (const auto &display : displays) {
+      results.push_back(toggle_one(display));
+    }
+    return results;
+  }
+
+  WorkerPool pool{std::min(displays.size(), m_max_parallel)};
+  std::vector<std::future<HdrDisplayResult>> pending;
+  for (const auto &display : displays) {
+    pending.push_back(pool.submit([&toggle_one, display]() { return toggle_one(display); }));
+  }
+  for (auto &future : pending) {
+    results.push_back(future.get());
+  }
+  return results;
+}
@@ -1,25 +1,72 @@
 #pragma once
-#include <stdexcept>
+#include "hdr_backend.hpp"
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
 #include <vector>
-#include <nvapi.h>
 
-bool _check_status(const NvAPI_Status &s, const std::string &message, bool should_raise = true);
-#define check_status(s) _check_status(s, std::string(__func__) + "," + std::to_string(__LINE__) + ": ");
-#define check_status_nothrow(s) _check_status(s, std::string(__func__) + "," + std::to_string(__LINE__) + ": ", false);
+struct HdrDisplay {
+  uint32_t gpu_index;
+  uint32_t display_id;
 
-struct NvapiException : public std::runtime_error {
-  explicit NvapiException(const std::string &what) : std::runtime_error(what) {}
-  explicit NvapiException(const char *what) : std::runtime_error(what) {}
+  friend bool operator==(const HdrDisplay &, const HdrDisplay &) = default;
 };
 
+struct HdrDisplayResult {
+  HdrDisplay display;
+  bool success;
+  std::string error;
+  std::chrono::milliseconds elapsed;
+};
+
+struct HdrCapability {
+  HdrDisplay display;
+  bool hdr_supported;
+  std::string error; // set if the capability query failed, the display is then treated as not supporting HDR
+};
+
+// Outcome of one discovery pass. Failures are recorded per GPU or per display and never hide the displays
+// that could be queried.
+struct HdrCapabilitySnapshot {
+  std::string key;
+  std::vector<HdrCapability> displays;
+  std::vector<std::string> errors;
+  bool from_cache = false;
+};
+
+bool any_succeeded(const std::vector<HdrDisplayResult> &results);
+
 class HdrToggle {
 public:
-  HdrToggle();
-  virtual ~HdrToggle();
-  bool set_hdr_mode(bool enabled);
+  // Each colour control call blocks on a monitor resync, up to max_parallel displays are switched at the same time.
+  // With a cache path the capability snapshot is reused across sessions as long as the driver version and the
+  // connected displays are unchanged.
+  explicit HdrToggle(std::unique_ptr<HdrBackend> backend, size_t max_parallel = 4, std::optional<std::filesystem::path> cache_path = {});
+
+  // Enabling switches every HDR capable display; disabling switches back exactly the displays the last enable
+  // changed and a previous disable failed on, or every HDR capable display if enable was not called in this session.
+  std::vector<HdrDisplayResult> set_hdr_mode(bool enabled);
+  // Enables HDR on the given displays only, a later disable switches back the ones that succeeded.
+  std::vector<HdrDisplayResult> enable_hdr(const std::vector<HdrDisplay> &displays);
+  // Disables HDR on the given displays only, for restoring what another launcher process enabled.
+  std::vector<HdrDisplayResult> disable_hdr(const std::vector<HdrDisplay> &displays) { return toggle(displays, false); }
+  // HDR capable displays that have HDR off. A display whose state cannot be read counts as off.
+  std::vector<HdrDisplay> hdr_off_displays();
+  const HdrCapabilitySnapshot &capabilities();
+  // The next call to capabilities() discovers again, which is cheap if the cache still matches.
+  void invalidate_capabilities() { m_capabilities.reset(); }
 
 private:
-  NV_HDR_COLOR_DATA set_hdr_data(bool enabled);
-  std::vector<NV_GPU_DISPLAYIDS> get_hdr_display_ids();
-  void calc_mastering_data(NV_HDR_COLOR_DATA *hdr_data);
-};
\ No newline at end of file
+  HdrCapabilitySnapshot discover();
+  std::optional<HdrCapabilitySnapshot> load_cache(const std::string &key) const;
+  void save_cache(const HdrCapabilitySnapshot &snapshot) const;
+  std::vector<HdrDisplayResult> toggle(const std::vector<HdrDisplay> &displays, bool enabled);
+
+  std::unique_ptr<HdrBackend> m_backend;
+  size_t m_max_parallel;
+  std::optional<std::filesystem::path> m_cache_path;
+  std::optional<HdrCapabilitySnapshot> m_capabilities;
+  std::optional<std::vector<HdrDisplay>> m_enabled_displays;
+};
@@ -0,0 +1,231 @@
+#include "ipc.hpp"
+#include <array>
+
+namespace {
+enum class MessageType : uint8_t {
+  session_request = 1,
+  session_started,
+  session_ended,
+  session_rejected,
+  set_display_mode,
+  set_hdr,
+  query_state,
+  end_session,
+  session_state,
+  control_reply
+};
+
+class PayloadWriter {
+public:
+  explicit PayloadWriter(MessageType type) { u8(static_cast<uint8_t>(type)); }
+
+  void u8(uint8_t value) { m_payload.push_back(static_cast<char>(value)); }
+  void u32(uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+      u8(static_cast<uint8_t>(value >> shift));
+    }
+  }
+  void string(std::string_view value) {
+    u32(static_cast<uint32_t>(value.size()));
+    m_payload.append(value);
+  }
+
+  void mode(const DisplayMode &value) {
+    u32(value.width);
+    u32(value.height);
+    u32(value.refresh_rate);
+  }
+
+  std::string take() { return std::move(m_payload); }
+
+private:
+  std::string m_payload;
+};
+
+class PayloadReader {
+public:
+  explicit PayloadReader(std::string_view payload) : m_rest{payload} {}
+
+  uint8_t u8() {
+    need(1);
+    auto value = static_cast<uint8_t>(m_rest.front());
+    m_rest.remove_prefix(1);
+    return value;
+  }
+  uint32_t u32() {
+    uint32_t value = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+      value |= static_cast<uint32_t>(u8()) << shift;
+    }
+    return value;
+  }
+  std::string string() {
+    auto size = u32();
+    need(size);
+    auto value = std::string(m_rest.substr(0, size));
+    m_rest.remove_prefix(size);
+    return value;
+  }
+
+  DisplayMode mode() {
+    DisplayMode value;
+    value.width = u32();
+    value.height = u32();
+    value.refresh_rate = u32();
+    return value;
+  }
+
+  void finish() const {
+    if (!m_rest.empty()) {
+      throw IpcError("trailing bytes in message");
+    }
+  }
+
+private:
+  void need(size_t size) const {
+    if (m_rest.size() < size) {
+      throw IpcError("truncated message");
+    }
+  }
+
+  std::string_view m_rest;
+};
+
+struct Encoder {
+  std::string operator()(const SessionRequest &m) const {
+    PayloadWriter w{MessageType::session_request};
+    w.u8(m.protocol_version);
+    w.u32(static_cast<uint32_t>(m.args.size()));
+    for (const auto &arg : m.args) {
+      w.string(arg);
+    }
+    return w.take();
+  }
+  std::string operator()(const SessionStarted &m) const {
+    PayloadWriter w{MessageType::session_started};
+    w.u8(m.compatibility_window);
+    return w.take();
+  }
+  std::string operator()(const SessionEnded &m) const {
+    PayloadWriter w{MessageType::session_ended};
+    w.u32(static_cast<uint32_t>(m.exit_code));
+    return w.take();
+  }
+  std::string operator()(const SessionRejected &m) const {
+    PayloadWriter w{MessageType::session_rejected};
+    w.string(m.reason);
+    return w.take();
+  }
+  std::string operator()(const SetDisplayModeCommand &m) const {
+    PayloadWriter w{MessageType::set_display_mode};
+    w.mode(m.mode);
+    return w.take();
+  }
+  std::string operator()(const SetHdrCommand &m) const {
+    PayloadWriter w{MessageType::set_hdr};
+    w.u8(m.enabled);
+    return w.take();
+  }
+  std::string operator()(const QueryStateCommand &) const { return PayloadWriter{MessageType::query_state}.take(); }
+  std::string operator()(const EndSessionCommand &) const { return PayloadWriter{MessageType::end_session}.take(); }
+  std::string operator()(const SessionState &m) const {
+    PayloadWriter w{MessageType::session_state};
+    w.mode(m.mode);
+    w.u8(m.hdr_enabled);
+    w.string(m.launcher_exe);
+    return w.take();
+  }
+  std::string operator()(const ControlReply &m) const {
+    PayloadWriter w{MessageType::control_reply};
+    w.u8(m.ok);
+    w.string(m.message);
+    return w.take();
+  }
+};
+} // namespace
+
+std::string encode_message(const IpcMessage &message) { return std::visit(Encoder{}, message); }
+
+IpcMessage decode_message(std::string_view payload) {
+  PayloadReader r{payload};
+  IpcMessage message;
+  switch (static_cast<MessageType>(r.u8())) {
+  case MessageType::session_request: {
+    SessionRequest m;
+    m.protocol_version = r.u8();
+    if (m.protocol_version != ipc_protocol_version) {
+      // a client from another release, only the version is meaningful
+      return m;
+    }
+    auto count = r.u32();
+    for (uint32_t i = 0; i < count; ++i) {
+      m.args.push_back(r.string());
+    }
+    message = std::move(m);
+  } break;
+  case MessageType::session_started:
+    message = SessionStarted{r.u8() != 0};
+    break;
+  case MessageType::session_ended:
+    message = SessionEnded{static_cast<int32_t>(r.u32())};
+    break;
+  case MessageType::session_rejected:
+    message = SessionRejected{r.string()};
+    break;
+  case MessageType::set_display_mode:
+    message = SetDisplayModeCommand{r.mode()};
+    break;
+  case MessageType::set_hdr:
+    message = SetHdrCommand{r.u8() != 0};
+    break;
+  case MessageType::query_state:
+    message = QueryStateCommand{};
+    break;
+  case MessageType::end_session:
+    message = EndSessionCommand{};
+    break;
+  case MessageType::session_state: {
+    SessionState m;
+    m.mode = r.mode();
+    m.hdr_enabled = r.u8() != 0;
+    m.launcher_exe = r.string();
+    message = std::move(m);
+  } break;
+  case MessageType::control_reply: {
+    ControlReply m;
+    m.ok = r.u8() != 0;
+    m.message = r.string();
+    message = std::move(m);
+  } break;
+  default:
+    throw IpcError("unknown message type");
+  }
+  r.finish();
+  return message;
+}
+
+void send_message(IpcChannel &channel, const IpcMessage &message) {
+  auto payload = encode_message(message);
+  std::array<char, 4> header;
+  for (size_t i = 0; i < header.size(); ++i) {
+    header[i] = static_cast<char>(payload.size() >> (8 * i));
+  }
+  // one write per frame so that a message never straddles two transport writes
+  payload.insert(0, header.data(), header.size());
+  channel.write(payload.data(), payload.size());
+}
+
+IpcMessage receive_message(IpcChannel &channel) {
+  std::array<char, 4> header;
+  channel.read(header.data(), header.size());
+  uint32_t size = 0;
+  for (size_t i = 0; i < header.size(); ++i) {
+    size |= static_cast<uint32_t>(static_cast<uint8_t>(header[i])) << (8 * i);
+  }
+  if (size == 0 || size > max_ipc_frame_size) {
+    throw IpcError("invalid frame size " + std::to_string(size));
+  }
+  std::string payload(size, '\0');
+  channel.read(payload.data(), payload.size());
+  return decode_message(payload);
+}
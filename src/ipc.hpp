@@ -0,0 +1,90 @@
+#pragma once
+#include "display_backend.hpp"
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+// Messages between the launcher executable and the resident launcher service, and the control commands a running
+// session accepts. Every message travels as one frame: the payload size as a little-endian uint32, then the payload,
+// whose first byte is the message type.
+constexpr uint8_t ipc_protocol_version = 1;
+constexpr uint32_t max_ipc_frame_size = 64 * 1024;
+
+struct SessionRequest {
+  uint8_t protocol_version = ipc_protocol_version;
+  std::vector<std::string> args;
+};
+
+// Startup is done. GameStream looks for a window of the process it launched, so the client shows the compatibility
+// window itself when asked to.
+struct SessionStarted {
+  bool compatibility_window;
+};
+
+struct SessionEnded {
+  int32_t exit_code;
+};
+
+// The service cannot take the session, the client runs it on its own.
+struct SessionRejected {
+  std::string reason;
+};
+
+struct SetDisplayModeCommand {
+  DisplayMode mode; // refresh_rate 0 picks the configured default
+};
+
+struct SetHdrCommand {
+  bool enabled;
+};
+
+struct QueryStateCommand {};
+
+struct EndSessionCommand {};
+
+struct SessionState {
+  DisplayMode mode;
+  bool hdr_enabled;
+  std::string launcher_exe;
+};
+
+struct ControlReply {
+  bool ok;
+  std::string message;
+};
+
+using IpcMessage = std::variant<SessionRequest, SessionStarted, SessionEnded, SessionRejected, SetDisplayModeCommand, SetHdrCommand, QueryStateCommand,
+                                EndSessionCommand, SessionState, ControlReply>;
+
+struct IpcError : public std::runtime_error {
+  explicit IpcError(const std::string &what) : std::runtime_error(what) {}
+};
+
+std::string encode_message(const IpcMessage &message);
+// Throws IpcError if the payload is not a well-formed message.
+IpcMessage decode_message(std::string_view payload);
+
+// Reliable byte stream to the peer. Both calls block until all bytes are transferred and throw IpcError once the
+// peer has gone away.
+class IpcChannel {
+public:
+  virtual ~IpcChannel() = default;
+  virtual void write(const char *data, size_t size) = 0;
+  virtual void read(char *data, size_t size) = 0;
+};
+
+class IpcListener {
+public:
+  virtual ~IpcListener() = default;
+  // Blocks until the next client connects. Throws IpcError once the listener is closed.
+  virtual std::unique_ptr<IpcChannel> accept() = 0;
+  // Wakes up a pending accept(); may be called from any thread.
+  virtual void close() = 0;
+};
+
+void send_message(IpcChannel &channel, const IpcMessage &message);
+IpcMessage receive_message(IpcChannel &channel);
@@ -0,0 +1,87 @@
+#include "job_object.hpp"
+#include "event_loop.hpp"
+#include <system_error>
+
+namespace {
+constexpr ULONG_PTR job_key = 1;
+constexpr ULONG_PTR stop_key = 2;
+
+std::system_error last_error(const char *what) { return std::system_error(static_cast<int>(GetLastError()), std::system_category(), what); }
+
+std::string process_image_path(DWORD pid) {
+  auto process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+  if (!process) {
+    return {};
+  }
+  char path[MAX_PATH];
+  DWORD size = MAX_PATH;
+  std::string result;
+  if (QueryFullProcessImageNameA(process, 0, path, &size)) {
+    result.assign(path, size);
+  }
+  CloseHandle(process);
+  return result;
+}
+} // namespace
+
+JobObject::JobObject(EventLoop &loop, Handlers handlers) : m_loop{loop}, m_handlers{std::move(handlers)} {
+  m_job = CreateJobObjectW(nullptr, nullptr);
+  if (!m_job) {
+    throw last_error("CreateJobObject");
+  }
+  m_port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1);
+  if (!m_port) {
+    auto error = last_error("CreateIoCompletionPort");
+    CloseHandle(m_job);
+    throw error;
+  }
+  JOBOBJECT_ASSOCIATE_COMPLETION_PORT port{reinterpret_cast<PVOID>(job_key), m_port};
+  // launchers that explicitly ask to break away from their job are allowed to, instead of failing to start the game
+  JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits{};
+  limits.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_BREAKAWAY_OK;
+  if (!SetInformationJobObject(m_job, JobObjectAssociateCompletionPortInformation, &port, sizeof(port)) ||
+      !SetInformationJobObject(m_job, JobObjectExtendedLimitInformation, &limits, sizeof(limits))) {
+    auto error = last_error("SetInformationJobObject");
+    CloseHandle(m_port);
+    CloseHandle(m_job);
+    throw error;
+  }
+  m_thread = std::thread([this]() { watch(); });
+}
+
+JobObject::~JobObject() {
+  PostQueuedCompletionStatus(m_port, 0, stop_key, nullptr);
+  m_thread.join();
+  CloseHandle(m_port);
+  CloseHandle(m_job);
+}
+
+void JobObject::terminate(UINT exit_code) { TerminateJobObject(m_job, exit_code); }
+
+void JobObject::watch() {
+  for (;;) {
+    DWORD message;
+    ULONG_PTR key;
+    LPOVERLAPPED data;
+    if (!GetQueuedCompletionStatus(m_port, &message, &key, &data, INFINITE) || key == stop_key) {
+      return;
+    }
+    // for job notifications the overlapped pointer carries the process id
+    auto pid = static_cast<DWORD>(reinterpret_cast<ULONG_PTR>(data));
+    switch (message) {
+    case JOB_OBJECT_MSG_NEW_PROCESS:
+      // looked up here rather than on the loop, a short-lived process may be gone by then
+      m_loop.post([this, pid, path = process_image_path(pid)]() { m_handlers.process_started(pid, path); });
+      break;
+    case JOB_OBJECT_MSG_EXIT_PROCESS:
+    case JOB_OBJECT_MSG_ABNORMAL_EXIT_PROCESS:
+      m_loop.post([this, pid]() { m_handlers.process_exited(pid); });
+      break;
+    case JOB_OBJECT_MSG_ACTIVE_PROCESS_ZERO:
+      m_loop.post([this]() { m_handlers.empty(); });
+      break;
+    default:
+      break;
+    }
+  }
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "windows.h"
+#include <functional>
+#include <string>
+#include <thread>
+
+class EventLoop;
+
+// A job object that launcher_exe and all of its descendants belong to. Its notifications arrive on a completion port
+// and are posted to the event loop, so the handlers run on the loop's thread. Nothing is polled.
+class JobObject {
+public:
+  struct Handlers {
+    // The image path is empty if the process was gone before it could be looked up.
+    std::function<void(DWORD pid, const std::string &image_path)> process_started;
+    std::function<void(DWORD pid)> process_exited;
+    std::function<void()> empty;
+  };
+
+  // Throws std::system_error if the job cannot be created.
+  JobObject(EventLoop &loop, Handlers handlers);
+  JobObject(const JobObject &) = delete;
+  JobObject &operator=(const JobObject &) = delete;
+  // Processes in the job keep running.
+  ~JobObject();
+
+  HANDLE handle() const { return m_job; }
+  void terminate(UINT exit_code);
+
+private:
+  void watch();
+
+  EventLoop &m_loop;
+  Handlers m_handlers;
+  HANDLE m_job = nullptr;
+  HANDLE m_port = nullptr;
+  std::thread m_thread;
+};
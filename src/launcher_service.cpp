@@ -0,0 +1,71 @@
+#include "launcher_service.hpp"
+#include "logger.hpp"
+
+void serve_sessions(IpcListener &listener, const SessionRunner &run_session, Logger &logger) {
+  for (;;) {
+    auto channel = listener.accept();
+    try {
+      auto message = receive_message(*channel);
+      auto request = std::get_if<SessionRequest>(&message);
+      if (!request) {
+        logger.warn("Launcher service: unexpected message from client, ignoring");
+        continue;
+      }
+      if (request->protocol_version != ipc_protocol_version) {
+        logger.warn("Launcher service: client speaks protocol version {}, expected {}", request->protocol_version, ipc_protocol_version);
+        send_message(*channel, SessionRejected{"protocol version mismatch"});
+        continue;
+      }
+      logger.info("Launcher service: session requested");
+      // the session runs to completion even if the client goes away, the display and HDR state still have to be restored
+      bool client_connected = true;
+      auto exit_code = run_session(*request, [&](bool compatibility_window) {
+        if (!client_connected) {
+          return;
+        }
+        try {
+          send_message(*channel, SessionStarted{compatibility_window});
+        } catch (IpcError &e) {
+          logger.warn("Launcher service: client went away: {}", e.what());
+          client_connected = false;
+        }
+      });
+      logger.info("Launcher service: session ended with exit code {}", exit_code);
+      if (client_connected) {
+        send_message(*channel, SessionEnded{exit_code});
+      }
+    } catch (IpcError &e) {
+      logger.warn("Launcher service: client connection failed: {}", e.what());
+    }
+  }
+}
+
+std::optional<int> request_session(IpcChannel &channel, std::vector<std::string> args, const std::function<void(bool)> &open_window,
+                                   const std::function<void()> &close_window, Logger &logger) {
+  bool started = false;
+  try {
+    send_message(channel, SessionRequest{ipc_protocol_version, std::move(args)});
+    for (;;) {
+      auto message = receive_message(channel);
+      if (auto m = std::get_if<SessionStarted>(&message)) {
+        started = true;
+        open_window(m->compatibility_window);
+      } else if (auto m = std::get_if<SessionEnded>(&message)) {
+        close_window();
+        return m->exit_code;
+      } else if (auto m = std::get_if<SessionRejected>(&message)) {
+        logger.warn("Launcher service rejected the session: {}", m->reason);
+        return {};
+      } else {
+        throw IpcError("unexpected message from service");
+      }
+    }
+  } catch (IpcError &e) {
+    close_window();
+    logger.error("Lost connection to the launcher service: {}", e.what());
+    if (started) {
+      return 1;
+    }
+    return {};
+  }
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include "ipc.hpp"
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+class Logger;
+
+// Runs one session inside the service process. started(compatibility_window) is called once startup is done.
+using SessionRunner = std::function<int(const SessionRequest &request, const std::function<void(bool)> &started)>;
+
+// Serves clients one session at a time. Returns only if the listener fails.
+void serve_sessions(IpcListener &listener, const SessionRunner &run_session, Logger &logger);
+
+// Hands a session over to the service behind the channel and blocks until it has ended. Returns nothing if the
+// service rejected the session or went away before starting it, the caller then runs the session itself.
+std::optional<int> request_session(IpcChannel &channel, std::vector<std::string> args, const std::function<void(bool)> &open_window,
+                                   const std::function<void()> &close_window, Logger &logger);
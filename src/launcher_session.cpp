@@ -0,0 +1,924 @@
+#include "windows.h"
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include "child_output.hpp"
+#include "child_process.hpp"
+#include "display_batch.hpp"
+#include "event_loop.hpp"
+#include "flight_recorder.hpp"
+#include "job_object.hpp"
+#include "launcher_session.hpp"
+#include "logger.hpp"
+#include "mode_selector.hpp"
+#include "named_pipe.hpp"
+#include "nvapi_hdr_backend.hpp"
+#include "prep_command.hpp"
+#include "process_tree.hpp"
+#include "restore_journal.hpp"
+#include "session_control.hpp"
+#include "session_plan.hpp"
+#include "target_processes.hpp"
+#include "task_graph.hpp"
+#include "teardown.hpp"
+#include "trace.hpp"
+#include "win_display_backend.hpp"
+
+#ifdef SENTRY_DEBUG
+#include "crash_reporting.hpp"
+#define SENTRY_BUILD_STATIC 1
+#include <sentry.h>
+#endif
+
+namespace fs = std::filesystem;
+using namespace std::string_literals;
+
+namespace {
+constexpr std::chrono::milliseconds hdr_restore_timeout{3000};
+constexpr std::chrono::milliseconds display_restore_timeout{3000};
+
+DEVMODE const get_primary_display_registry_settings() {
+  DEVMODE devmode{};
+  devmode.dmSize = sizeof(devmode);
+  EnumDisplaySettings(nullptr, ENUM_REGISTRY_SETTINGS, &devmode);
+  return devmode;
+}
+
+LONG _ChangeDisplaySettings(DEVMODE *devmode, DWORD dwFlags) {
+  DEVMODE current_settings{};
+  current_settings.dmSize = sizeof(current_settings);
+  EnumDisplaySettings(0, ENUM_CURRENT_SETTINGS, &current_settings);
+  if (current_settings.dmPelsWidth == devmode->dmPelsWidth && current_settings.dmPelsHeight == devmode->dmPelsHeight &&
+      ((devmode->dmFields & DM_DISPLAYFREQUENCY) == 0 || devmode->dmDisplayFrequency == current_settings.dmDisplayFrequency)) {
+    return DISP_CHANGE_SUCCESSFUL;
+  }
+
+  return ChangeDisplaySettings(devmode, dwFlags);
+}
+
+// Applies refresh_rate_use_max and best_fit_mode to a requested mode.
+DisplayMode resolve_display_mode(DisplayMode target, const LauncherConfig &config, const DisplayModeCatalog &catalog, Logger &logger) {
+  if (target.refresh_rate == 0 && config.refresh_rate_use_max) {
+    logger.debug("Setting max refresh_rate");
+    target.refresh_rate = catalog.max_refresh_rate(target.width, target.height);
+    logger.info("Detected max refresh rate: {}", target.refresh_rate);
+  } else {
+    if (config.refresh_rate_use_max) {
+      logger.warn("refresh_rate and refresh_rate_use_max specified, defaulting to specified rate");
+    }
+  }
+  if (!catalog.offers(target) && config.best_fit_mode) {
+    auto request = ModeRequest{target.width, target.height, target.refresh_rate, config.stream_fps};
+    if (auto best_fit = select_display_mode(catalog.modes(), request)) {
+      logger.info("Display mode {}x{}@{} is not available, using best fit {}x{}@{}", target.width, target.height, target.refresh_rate, best_fit->width,
+                  best_fit->height, best_fit->refresh_rate);
+      target = *best_fit;
+    }
+  }
+  return target;
+}
+
+bool set_primary_mode(const DisplayMode &target, Logger &logger) {
+  TRACE_SCOPE("set_resolution");
+  DEVMODE devmode{};
+  devmode.dmSize = sizeof(devmode);
+  devmode.dmPelsWidth = target.width;
+  devmode.dmPelsHeight = target.height;
+  devmode.dmFields = DM_PELSHEIGHT | DM_PELSWIDTH;
+  if (target.refresh_rate != 0) {
+    devmode.dmDisplayFrequency = target.refresh_rate;
+    devmode.dmFields |= DM_DISPLAYFREQUENCY;
+  }
+  // a dynamic change only, the registry keeps the mode Windows returns to after a crash, logoff or reboot
+  auto result = _ChangeDisplaySettings(&devmode, 0);
+  if (result != DISP_CHANGE_SUCCESSFUL) {
+    logger.error("ChangeDisplaySettings failed error:{}", result);
+    return false;
+  }
+  flight::record(flight::Event::display_mode_set, flight::pack_mode(target.width, target.height), target.refresh_rate);
+  return true;
+}
+
+bool restore_primary_mode(const DisplayMode &original, Logger &logger) {
+  DEVMODE devmode{};
+  devmode.dmSize = sizeof(devmode);
+  devmode.dmPelsWidth = original.width;
+  devmode.dmPelsHeight = original.height;
+  devmode.dmDisplayFrequency = original.refresh_rate;
+  devmode.dmFields = DM_PELSWIDTH | DM_PELSHEIGHT | (original.refresh_rate != 0 ? DM_DISPLAYFREQUENCY : 0);
+  logger.info("Restoring display mode {}x{}@{}", devmode.dmPelsWidth, devmode.dmPelsHeight, devmode.dmDisplayFrequency);
+  auto result = _ChangeDisplaySettings(&devmode, 0);
+  if (result != DISP_CHANGE_SUCCESSFUL) {
+    logger.error("ChangeDisplaySettings failed error:{}", result);
+    return false;
+  }
+  flight::record(flight::Event::display_mode_restored, flight::pack_mode(original.width, original.height), original.refresh_rate);
+  return true;
+}
+
+bool set_resolution(const LauncherConfig &config, const DisplayModeCatalog &catalog, Logger &logger) {
+  return set_primary_mode(resolve_display_mode(DisplayMode{config.res_x, config.res_y, config.refresh_rate}, config, catalog, logger), logger);
+}
+
+// Puts every display into its mode with a single reconfiguration. The original modes are recorded in the journal,
+// if given, before anything changes.
+bool apply_display_batch(const std::vector<DisplayChange> &changes, SessionJournal *journal, Logger &logger) {
+  TRACE_SCOPE("set display batch");
+  for (const auto &change : changes) {
+    if (journal && !journal->display_changing({change.device, change.original})) {
+      logger.error("Cannot write the restore journal, keeping the display modes");
+      return false;
+    }
+  }
+  WinMultiDisplayBackend backend;
+  if (!apply_display_changes(backend, changes)) {
+    logger.error("Failed to apply the display modes");
+    for (const auto &change : changes) {
+      if (journal) {
+        journal->display_restored(change.device);
+      }
+    }
+    return false;
+  }
+  flight::record(flight::Event::display_batch_set, changes.size());
+  return true;
+}
+
+// The modes of the primary display, with the required one among them if the display offers it.
+using PrimaryDisplayModes = std::function<const DisplayModeCatalog &(const DisplayMode &required)>;
+
+// The display modes the config asks for, resolved against the available modes, and the current modes of the displays
+// they are for.
+void read_display_goal(const LauncherConfig &config, const PrimaryDisplayModes &primary_modes, SessionGoal &goal, SessionSnapshot &snapshot,
+                       Logger &logger) {
+  if (!config.display_modes.empty()) {
+    if (config.res_x != 0 || config.res_y != 0) {
+      logger.warn("display_modes and res_x/res_y both specified, defaulting to display_modes");
+    }
+    auto targets = parse_display_targets(config.display_modes);
+    if (!targets) {
+      logger.error("Invalid display_modes '{}'", config.display_modes);
+      return;
+    }
+    WinMultiDisplayBackend backend;
+    for (auto &target : *targets) {
+      target.mode = resolve_display_mode(target.mode, config, DisplayModeCatalog{backend.modes(target.device)}, logger);
+    }
+    goal.displays = std::move(*targets);
+    snapshot.displays = current_display_modes(backend);
+  } else if (config.res_x != 0 && config.res_y != 0) {
+    auto requested = DisplayMode{config.res_x, config.res_y, config.refresh_rate};
+    goal.primary_mode = resolve_display_mode(requested, config, primary_modes(requested), logger);
+    snapshot.primary_mode = WinDisplayBackend{}.current_mode();
+  }
+}
+
+// Looks an executable up much like CreateProcess: with .exe appended if it has no extension, in the launcher's
+// folder, the system folders, the working folder and PATH.
+std::optional<std::string> find_executable(const std::string &executable) {
+  char path[MAX_PATH];
+  auto length = SearchPathA(nullptr, executable.c_str(), ".exe", MAX_PATH, path, nullptr);
+  if (length == 0 || length >= MAX_PATH) {
+    return {};
+  }
+  auto attributes = GetFileAttributesA(path);
+  if (attributes == INVALID_FILE_ATTRIBUTES || (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
+    return {};
+  }
+  return std::string(path, length);
+}
+
+void log_hdr_capabilities(const HdrCapabilitySnapshot &snapshot, Logger &logger) {
+  logger.debug("HDR capabilities {}", snapshot.from_cache ? "loaded from cache" : "discovered");
+  for (const auto &error : snapshot.errors) {
+    logger.warn("HDR discovery failed for {}", error);
+  }
+  for (const auto &c : snapshot.displays) {
+    if (!c.error.empty()) {
+      logger.warn("HDR capability query failed for display {} on GPU {}: {}", c.display.display_id, c.display.gpu_index, c.error);
+    } else {
+      logger.debug("Display {} on GPU {} HDR supported: {:d}", c.display.display_id, c.display.gpu_index, c.hdr_supported);
+    }
+  }
+}
+
+bool log_hdr_results(const std::vector<HdrDisplayResult> &results, Logger &logger) {
+  for (const auto &r : results) {
+    if (r.success) {
+      logger.event<LogEvent::hdr_display_done>(r.display.display_id, r.display.gpu_index, r.elapsed.count());
+    } else {
+      logger.event<LogEvent::hdr_display_failed>(r.display.display_id, r.display.gpu_index, r.elapsed.count(), r.error);
+    }
+  }
+  return any_succeeded(results);
+}
+
+// What the session changed and teardown has to restore.
+struct SessionChanges {
+  std::optional<DEVMODE> original_display_mode;
+  // displays changed through display_modes
+  std::vector<DisplayChange> display_batch;
+  HdrToggle *hdr_toggle = nullptr;
+  bool hdr_enabled = false;
+};
+
+// Applies control commands through the same paths as the startup steps and records every change in SessionChanges.
+class LiveSessionController : public SessionController {
+public:
+  LiveSessionController(LauncherState &state, const LauncherConfig &config, SessionChanges &changes, std::function<void()> end_session, Logger &logger)
+      : m_state{state}, m_config{config}, m_changes{changes}, m_end_session{std::move(end_session)}, m_logger{logger} {}
+
+  ControlReply set_display_mode(const DisplayMode &mode) override {
+    if (mode.width == 0 || mode.height == 0 || mode.width > UINT16_MAX || mode.height > UINT16_MAX || mode.refresh_rate > UINT16_MAX) {
+      return {false, "invalid display mode"};
+    }
+    m_logger.info("Control: setting display mode {}x{}@{}", mode.width, mode.height, mode.refresh_rate);
+    // the first switch of the session records the original mode, kept only once the mode has actually changed
+    std::optional<DEVMODE> original;
+    if (!m_changes.original_display_mode) {
+      original = get_primary_display_registry_settings();
+      if (!m_state.journal().display_changing({"", to_display_mode(*original)})) {
+        return {false, "cannot write the restore journal"};
+      }
+    }
+    auto mode_config = m_config;
+    mode_config.res_x = static_cast<uint16_t>(mode.width);
+    mode_config.res_y = static_cast<uint16_t>(mode.height);
+    mode_config.refresh_rate = static_cast<uint16_t>(mode.refresh_rate);
+    if (!set_resolution(mode_config, m_state.display_modes(mode), m_logger)) {
+      if (original) {
+        m_state.journal().display_restored("");
+      }
+      return {false, "ChangeDisplaySettings failed"};
+    }
+    if (original) {
+      m_changes.original_display_mode = original;
+    }
+    return {true, {}};
+  }
+
+  ControlReply set_hdr(bool enabled) override {
+    m_logger.info("Control: turning HDR {}", enabled ? "on" : "off");
+    try {
+      if (!m_changes.hdr_toggle) {
+        m_changes.hdr_toggle = m_state.hdr_toggle(m_config);
+      }
+      if (enabled == m_changes.hdr_enabled) {
+        return {true, "unchanged"};
+      }
+      // as at startup, only the displays that have HDR off are switched on and journaled
+      std::vector<HdrDisplay> displays;
+      if (enabled) {
+        displays = m_changes.hdr_toggle->hdr_off_displays();
+        if (!m_state.journal().hdr_enabling(displays)) {
+          return {false, "cannot write the restore journal"};
+        }
+      }
+      auto results = enabled ? m_changes.hdr_toggle->enable_hdr(displays) : m_changes.hdr_toggle->set_hdr_mode(false);
+      if (!log_hdr_results(results, m_logger)) {
+        if (enabled) {
+          m_state.journal().hdr_restored();
+        }
+        return {false, "no display was switched"};
+      }
+      flight::record(enabled ? flight::Event::hdr_enabled : flight::Event::hdr_disabled);
+    } catch (HdrError &e) {
+      m_logger.error("Control: failed to set HDR mode: {}", e.what());
+      if (enabled) {
+        m_state.journal().hdr_restored();
+      }
+      return {false, e.what()};
+    }
+    m_changes.hdr_enabled = enabled;
+    if (!enabled) {
+      m_state.journal().hdr_restored();
+    }
+    return {true, {}};
+  }
+
+  SessionState query_state() override {
+    WinDisplayBackend backend;
+    return {backend.current_mode().value_or(DisplayMode{}), m_changes.hdr_enabled, m_config.launcher_exe};
+  }
+
+  ControlReply end_session() override {
+    m_logger.info("Control: ending session");
+    m_end_session();
+    return {true, {}};
+  }
+
+private:
+  LauncherState &m_state;
+  const LauncherConfig &m_config;
+  SessionChanges &m_changes;
+  std::function<void()> m_end_session;
+  Logger &m_logger;
+};
+
+// Runs wait() on a thread of its own while the loop keeps dispatching the messages of this thread's windows, and
+// rethrows what wait() threw.
+void wait_pumping(EventLoop &loop, const std::function<void()> &wait) {
+  auto done = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+  std::exception_ptr error;
+  std::thread waiter{[&]() {
+    try {
+      wait();
+    } catch (...) {
+      error = std::current_exception();
+    }
+    SetEvent(done);
+  }};
+  loop.run_until(done);
+  waiter.join();
+  CloseHandle(done);
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+// Undoes what the session changed. What misses the deadline is retried in the background, the client does not wait for
+// a hung driver call.
+void restore_session_changes(LauncherState &state, const LauncherConfig &config, const SessionChanges &changes, EventLoop &loop, Logger &logger) {
+  TeardownPlan teardown;
+  std::vector<TeardownPlan::ActionId> after_hdr;
+  if (changes.hdr_toggle && changes.hdr_enabled) {
+    after_hdr.push_back(teardown.add(
+        "restore HDR mode",
+        [hdr_toggle = changes.hdr_toggle, &journal = state.journal(), &logger]() {
+          logger.info("Attempting to disable HDR mode");
+          if (!log_hdr_results(hdr_toggle->set_hdr_mode(false), logger)) {
+            throw HdrError("no display was switched");
+          }
+          flight::record(flight::Event::hdr_disabled);
+          journal.hdr_restored();
+        },
+        hdr_restore_timeout));
+  }
+  if (changes.original_display_mode) {
+    // NVAPI and ChangeDisplaySettings both reconfigure the displays, so the mode is restored after HDR unless that hangs
+    teardown.add(
+        "restore display mode",
+        [original = *changes.original_display_mode, &journal = state.journal(), &logger]() mutable {
+          logger.info("Resetting to original display mode");
+          auto result = _ChangeDisplaySettings(&original, 0);
+          if (result != DISP_CHANGE_SUCCESSFUL) {
+            throw std::runtime_error("ChangeDisplaySettings failed with " + std::to_string(result));
+          }
+          flight::record(flight::Event::display_mode_restored, flight::pack_mode(original.dmPelsWidth, original.dmPelsHeight), original.dmDisplayFrequency);
+          journal.display_restored("");
+        },
+        display_restore_timeout, after_hdr);
+  }
+  if (!changes.display_batch.empty()) {
+    teardown.add(
+        "restore display modes",
+        [batch = changes.display_batch, &journal = state.journal(), &logger]() {
+          logger.info("Resetting {} displays to their original modes", batch.size());
+          WinMultiDisplayBackend backend;
+          if (!restore_display_changes(backend, batch)) {
+            throw std::runtime_error("ChangeDisplaySettingsEx failed");
+          }
+          flight::record(flight::Event::display_batch_restored, batch.size());
+          for (const auto &change : batch) {
+            journal.display_restored(change.device);
+          }
+        },
+        display_restore_timeout, after_hdr);
+  }
+  std::vector<TeardownTiming> timings;
+  wait_pumping(loop, [&]() { timings = teardown.run(std::chrono::milliseconds{config.teardown_deadline}, state.teardown_retry()); });
+  uint32_t late = 0;
+  for (const auto &timing : timings) {
+    logger.event<LogEvent::restore_action>(timing.name, teardown_outcome_name(timing.outcome), timing.duration.count() / 1000.0,
+                                           timing.error.empty() ? "" : ": " + timing.error);
+    late += timing.outcome == TeardownOutcome::timed_out || timing.outcome == TeardownOutcome::missed_deadline ? 1 : 0;
+  }
+  flight::record(flight::Event::teardown_done, timings.size(), late);
+}
+
+} // namespace
+
+LauncherPaths::LauncherPaths(const fs::path &pwd)
+    : pwd{pwd}, inifile{pwd / fs::path("moonlight_hdr_launcher.ini")}, mode_cache{pwd / fs::path("moonlight_hdr_launcher_modes.bin")},
+      hdr_cache{pwd / fs::path("moonlight_hdr_launcher_hdr.cache")}, journal{journal_path(pwd, GetCurrentProcessId())},
+      child_output{pwd / fs::path("moonlight_hdr_launcher_child_output.txt")}, binary_log{pwd / fs::path("moonlight_hdr_launcher_log.bin")},
+      prep_state{pwd / fs::path("moonlight_hdr_launcher_prep_state.bin")} {}
+
+LauncherState::LauncherState(LauncherPaths paths, Logger &logger)
+    : m_paths{std::move(paths)}, m_logger{logger}, m_journal{m_paths.journal, GetCurrentProcessId(), process_start_time(GetCurrentProcess())}, m_teardown_retry{logger} {}
+
+LauncherConfig LauncherState::config() {
+  std::error_code ec;
+  auto write_time = fs::last_write_time(m_paths.inifile, ec);
+  if (ec) {
+    m_config.reset();
+    return {};
+  }
+  if (!m_config || write_time != m_config_write_time) {
+    m_logger.info("Found config file: {}", m_paths.inifile.string());
+    {
+      TRACE_SCOPE("parse config");
+      m_config = load_config(m_paths.inifile, m_logger);
+    }
+    m_config_write_time = write_time;
+    log_config(*m_config, m_logger);
+  }
+  return *m_config;
+}
+
+const DisplayModeCatalog &LauncherState::display_modes(const std::optional<DisplayMode> &required) {
+  WinDisplayBackend backend;
+  if (!m_display_modes || m_display_modes->identity().empty() || m_display_modes->identity() != backend.identity() ||
+      (required && !m_display_modes->offers(*required))) {
+    m_display_modes = DisplayModeCatalog::open(backend, m_paths.mode_cache, required);
+    m_logger.debug("Display mode catalog with {} modes {}", m_display_modes->modes().size(),
+                   m_display_modes->from_cache() ? "loaded from cache" : "enumerated");
+  }
+  return *m_display_modes;
+}
+
+HdrToggle *LauncherState::hdr_toggle(const LauncherConfig &config) {
+  // HdrToggle is not thread safe, and a restore action still retrying or hanging in the driver may be using it
+  if (!m_teardown_retry.idle()) {
+    throw HdrError("HDR is still being restored after the previous session");
+  }
+  if (m_hdr_toggle) {
+    // displays may have been connected or the driver updated since the last session
+    m_hdr_toggle->invalidate_capabilities();
+  } else {
+    m_hdr_toggle = std::make_unique<HdrToggle>(std::make_unique<NvapiHdrBackend>(), 4,
+                                               config.cache_hdr_capabilities ? std::optional{m_paths.hdr_cache} : std::nullopt);
+  }
+  return m_hdr_toggle.get();
+}
+
+int run_session(LauncherState &state, const SessionWindow &window, bool trace_requested, Logger &logger) {
+  LauncherConfig config;
+  SessionChanges changes;
+  // the child's exit, its output, the window and control commands are all handled on this thread, whose windows
+  // stay responsive while it waits for the startup and teardown steps
+  EventLoop loop;
+  flight::record(flight::Event::session_start);
+
+  // the service may still be retrying what the previous session could not restore
+  if (!state.teardown_retry().wait_idle(std::chrono::seconds{5})) {
+    logger.warn("Restore actions of the previous session are still pending, HDR is left alone this session");
+  }
+
+  // independent startup steps overlap, the child is launched once the display, HDR and window steps are done
+  WorkerPool startup_pool{4};
+  TaskGraph startup;
+  auto config_task = startup.add("load config", [&]() {
+    config = state.config();
+#ifdef SENTRY_DEBUG
+    crash_reporting::add_breadcrumb("launcher_exe", config.launcher_exe);
+#endif
+    if (!config.trace && !trace_requested) {
+      trace::disable();
+    }
+    logger.set_binary_log(config.binary_log ? std::optional{state.paths().binary_log} : std::nullopt);
+  });
+  // what the session wants and what is in place are read once, the plan then only holds the changes that are needed
+  SessionGoal goal;
+  SessionSnapshot snapshot;
+  SessionPlan plan;
+  SessionPlan hdr_plan;
+  auto display_state_task = startup.add(
+      "read display state",
+      [&]() {
+        read_display_goal(
+            config, [&state](const DisplayMode &required) -> const DisplayModeCatalog & { return state.display_modes(required); }, goal, snapshot,
+            logger);
+      },
+      {config_task});
+  auto nvapi_task = startup.add(
+      "initialize NVAPI",
+      [&]() {
+        if (config.wait_on_process && config.toggle_hdr) {
+          // a session without HDR is still a session, the failure is only reported
+          try {
+            changes.hdr_toggle = state.hdr_toggle(config);
+            snapshot.hdr_off = changes.hdr_toggle->hdr_off_displays();
+            log_hdr_capabilities(changes.hdr_toggle->capabilities(), logger);
+          } catch (HdrError &e) {
+            logger.error("Failed to initialize NVAPI: {}", e.what());
+#ifdef SENTRY_DEBUG
+            crash_reporting::add_breadcrumb("nvapi_error", e.what());
+#endif
+          }
+        }
+      },
+      {config_task});
+  // planned apart, so that the display modes are switched while NVAPI is still being initialised
+  auto plan_task = startup.add(
+      "plan displays",
+      [&]() {
+        if (!config.wait_on_process || !config.remote_desktop) {
+          goal.launch = config.launcher_exe;
+        }
+        plan = plan_displays(goal, snapshot, find_executable);
+        logger.info("Session plan:");
+        for (const auto &line : describe_session_plan(plan)) {
+          logger.info("  {}", line);
+        }
+      },
+      {display_state_task});
+  auto hdr_plan_task = startup.add(
+      "plan HDR",
+      [&]() {
+        hdr_plan = plan_hdr(config.wait_on_process && config.toggle_hdr, snapshot.hdr_off);
+        if (!hdr_plan.actions.empty() || !hdr_plan.notes.empty()) {
+          logger.info("HDR plan:");
+        }
+        for (const auto &line : describe_session_plan(hdr_plan)) {
+          logger.info("  {}", line);
+        }
+      },
+      {nvapi_task});
+  auto display_mode_task = startup.add(
+      "set display mode",
+      [&]() {
+        if (auto action = plan.find(SessionAction::Kind::set_primary_mode)) {
+          auto original = get_primary_display_registry_settings();
+          logger.info("Original display mode: {}x{}@{}", original.dmPelsWidth, original.dmPelsHeight, original.dmDisplayFrequency);
+          // recorded before anything changes, the next launcher start restores it if this one does not
+          if (config.wait_on_process && !state.journal().display_changing({"", to_display_mode(original)})) {
+            logger.error("Cannot write the restore journal, keeping the display mode");
+            return;
+          }
+          // only a mode that was switched is restored, and only then is the journal entry kept
+          if (set_primary_mode(action->display_changes.front().target, logger)) {
+            changes.original_display_mode = original;
+          } else if (config.wait_on_process) {
+            state.journal().display_restored("");
+          }
+        }
+        if (auto action = plan.find(SessionAction::Kind::set_display_modes)) {
+          if (apply_display_batch(action->display_changes, config.wait_on_process ? &state.journal() : nullptr, logger)) {
+            changes.display_batch = action->display_changes;
+          }
+        }
+      },
+      {plan_task});
+  startup.add(
+      "enable HDR",
+      [&]() {
+        // nothing is changed for a blocked launch
+        if (!plan.blocked.empty()) {
+          return;
+        }
+        if (auto action = hdr_plan.find(SessionAction::Kind::enable_hdr)) {
+          logger.info("Attempting to set HDR mode");
+          try {
+            if (!state.journal().hdr_enabling(action->hdr_displays)) {
+              logger.error("Cannot write the restore journal, not setting HDR mode");
+              return;
+            }
+            changes.hdr_enabled = log_hdr_results(changes.hdr_toggle->enable_hdr(action->hdr_displays), logger);
+            if (changes.hdr_enabled) {
+              flight::record(flight::Event::hdr_enabled);
+            } else {
+              logger.error("Failed to set HDR mode");
+              state.journal().hdr_restored();
+            }
+          } catch (HdrError &e) {
+            logger.error("Failed to set HDR mode: {}", e.what());
+#ifdef SENTRY_DEBUG
+            crash_reporting::add_breadcrumb("nvapi_error", e.what());
+#endif
+            state.journal().hdr_restored();
+          }
+        }
+      },
+      {display_mode_task, hdr_plan_task});
+  startup.start(startup_pool);
+  // the window is created on this thread, whose event loop dispatches its messages, while the display and HDR steps run
+  bool config_loaded = true;
+  try {
+    startup.wait(config_task);
+  } catch (...) {
+    // rethrown by wait_all()
+    config_loaded = false;
+  }
+  if (config_loaded && config.wait_on_process) {
+    TRACE_SCOPE("create compatibility window");
+    window.open(config.compatibility_window);
+  }
+  try {
+    wait_pumping(loop, [&startup]() { startup.wait_all(); });
+  } catch (...) {
+    window.close();
+    // the steps that did succeed may have switched the display mode or HDR
+    restore_session_changes(state, config, changes, loop, logger);
+    throw;
+  }
+  for (const auto &timing : startup.timings()) {
+    logger.event<LogEvent::startup_task>(timing.name, timing.started.count() / 1000.0, timing.duration.count() / 1000.0);
+  }
+  if (!plan.blocked.empty()) {
+    window.close();
+    throw std::runtime_error("Nothing was changed, " + plan.blocked);
+  }
+
+  if (config.wait_on_process) {
+    if (config.remote_desktop) {
+      logger.info("Running in remote desktop mode");
+      // the session lasts until the user closes the compatibility window, or it is ended from the control channel
+      LiveSessionController controller{state, config, changes, [&loop]() { loop.stop(); }, logger};
+      std::optional<ControlServer> control;
+      if (config.control_channel) {
+        control.emplace(std::make_unique<NamedPipeListener>(session_control_pipe), controller, logger,
+                        [&loop](std::function<void()> command) { loop.post(std::move(command)); });
+      }
+      if (window.watch_closed([&loop]() { loop.stop(); }) || control) {
+        TRACE_SCOPE("remote desktop session");
+        loop.run();
+        loop.shutdown();
+      } else {
+        logger.warn("The compatibility window is not open, the remote desktop session ends now");
+      }
+    } else {
+      logger.info("Launching '{}' and waiting for it to complete.", config.launcher_exe);
+      try {
+        // without track_process_tree the session is over when launcher_exe exits, with it when its process tree is done
+        ProcessTreeTracker tree{config.session_process};
+        bool child_exited = false;
+        // cleared if launcher_exe cannot be put into the job
+        bool tracking_tree = config.track_process_tree;
+        // with target_processes the session also lasts until the targets that started have exited
+        std::optional<TargetProcessWatch> targets;
+        bool targets_timed_out = false;
+        auto session_over = [&]() {
+          bool launcher_done = tracking_tree ? tree.session_over() : child_exited;
+          return launcher_done && (!targets || targets_timed_out || (targets->seen() && targets->running() == 0));
+        };
+        // a launcher stuck in a retry loop must not grow the log without bound
+        OutputFilter output{OutputLimits{config.child_output_rate, 100, size_t{config.child_output_tail_kb} * 1024},
+                            [&logger](OutputStream stream, std::string_view line) {
+                              if (stream == OutputStream::err) {
+                                logger.event<LogEvent::child_error_output>(line);
+                              } else {
+                                logger.event<LogEvent::child_output>(line);
+                              }
+                            }};
+        ChildOutputPump pump{loop, [&output](OutputStream stream, std::string_view line) { output.line(stream, line); },
+                             [&]() {
+                               if (session_over()) {
+                                 loop.stop();
+                               }
+                             }};
+        auto stop_if_over = [&]() {
+          if (session_over()) {
+            pump.child_exited();
+            if (pump.closed()) {
+              loop.stop();
+            }
+          }
+        };
+        if (!ProcessMatcher{config.target_processes}.empty()) {
+          targets.emplace(loop, config.target_processes, stop_if_over, logger);
+          if (config.target_start_timeout != 0) {
+            loop.add_timer(std::chrono::seconds{config.target_start_timeout}, [&]() {
+              if (!targets->seen()) {
+                logger.warn("No target process started within {} seconds", config.target_start_timeout);
+                targets_timed_out = true;
+                stop_if_over();
+              }
+            });
+          }
+        }
+        std::optional<JobObject> job;
+        if (config.track_process_tree) {
+          job.emplace(loop, JobObject::Handlers{[&](DWORD pid, const std::string &image_path) {
+                                                  logger.event<LogEvent::process_joined>(pid, image_path);
+                                                  flight::record(flight::Event::process_joined, pid);
+                                                  tree.started(pid, image_path);
+                                                  if (targets) {
+                                                    targets->process_started(pid, image_path);
+                                                  }
+                                                },
+                                                [&](DWORD pid) {
+                                                  logger.event<LogEvent::process_left>(pid);
+                                                  flight::record(flight::Event::process_left, pid);
+                                                  tree.exited(pid);
+                                                  stop_if_over();
+                                                },
+                                                [&]() {
+                                                  tree.tree_empty();
+                                                  stop_if_over();
+                                                }});
+        }
+        auto spawn_start = trace::clock::now();
+        ChildProcess child{config.launcher_exe, pump.out(), pump.err(), job ? job->handle() : nullptr};
+        trace::complete_event("child spawn", spawn_start, trace::clock::now());
+        if (job && !child.in_job()) {
+          logger.warn("Cannot track the processes started by launcher_exe, the session ends when it exits. Error code: {}, message: {}",
+                      child.job_error(), std::system_category().message(static_cast<int>(child.job_error())));
+          tracking_tree = false;
+          job.reset();
+        }
+        flight::record(flight::Event::child_spawned, child.id());
+        pump.start();
+        loop.watch(child.handle(), [&]() {
+          loop.unwatch(child.handle());
+          trace::instant_event("child exit");
+          flight::record(flight::Event::child_exited, child.id(), child.exit_code());
+          child_exited = true;
+          stop_if_over();
+        });
+        {
+          // ending the session from the control channel terminates the tracked processes, teardown then runs as usual
+          auto terminate = [&]() {
+            if (job) {
+              job->terminate(1);
+            } else {
+              child.terminate();
+            }
+          };
+          LiveSessionController controller{state, config, changes, terminate, logger};
+          std::optional<ControlServer> control;
+          if (config.control_channel) {
+            control.emplace(std::make_unique<NamedPipeListener>(session_control_pipe), controller, logger,
+                            [&loop](std::function<void()> command) { loop.post(std::move(command)); });
+          }
+          TRACE_SCOPE("child session");
+          loop.run();
+          // commands still in flight are answered with "the session is ending"
+          loop.shutdown();
+        }
+        logger.event<LogEvent::loop_wakeups>(loop.wakeups());
+        output.flush();
+        if (output.dropped() != 0) {
+          flight::record(flight::Event::child_output_dropped, output.dropped());
+          std::ofstream tail{state.paths().child_output, std::ios::binary | std::ios::trunc};
+          tail << output.tail().contents();
+          logger.info("{} lines of output were not logged, the last {} KB are in {}", output.dropped(), config.child_output_tail_kb,
+                      state.paths().child_output.string());
+        }
+        if (tracking_tree && !config.session_process.empty() && !tree.session_process_seen()) {
+          logger.warn("'{}' never ran as part of the session", config.session_process);
+        }
+        // with a tracked process tree or target processes the session can end while launcher_exe still runs
+        if (!child.exited()) {
+          logger.info("The command \"{}\" is still running", config.launcher_exe);
+        } else if (child.exit_code() != 0) {
+          logger.warn("The command \"{}\" has terminated with exit code {}", config.launcher_exe, child.exit_code());
+        }
+      } catch (std::system_error const &e) {
+        logger.error("Error executing command. Error code: {}, message: {}", e.code().value(), e.code().message());
+#ifdef SENTRY_DEBUG
+        sentry_value_t exc = sentry_value_new_object();
+        sentry_value_set_by_key(exc, "type", sentry_value_new_string("process_error"));
+        sentry_value_set_by_key(exc, "code", sentry_value_new_int32(e.code().value()));
+
+        sentry_value_t event = sentry_value_new_event();
+        sentry_value_set_by_key(event, "exception", exc);
+        // Sentry drops events until it is initialised
+        crash_reporting::wait_ready(std::chrono::seconds{5});
+        sentry_capture_event(event);
+#endif
+      }
+    }
+    window.close();
+
+    restore_session_changes(state, config, changes, loop, logger);
+  } else {
+    logger.info("Launching '{}' and detaching immediately.", config.launcher_exe);
+    // like bp::spawn did, the detached process gets the launcher's own standard handles
+    ChildProcess child{config.launcher_exe, GetStdHandle(STD_OUTPUT_HANDLE), GetStdHandle(STD_ERROR_HANDLE)};
+    flight::record(flight::Event::child_spawned, child.id());
+  }
+  flight::record(flight::Event::session_end);
+  return 0;
+}
+
+void replay_restore_journals(LauncherState &state, Logger &logger) {
+  class Target : public JournalReplayTarget {
+  public:
+    Target(LauncherState &state, Logger &logger) : m_state{state}, m_logger{logger} {}
+
+    bool process_alive(uint32_t pid, uint64_t start_time) override {
+      // a journal with this process's id was left by an earlier process that had the same id
+      if (pid == GetCurrentProcessId()) {
+        return false;
+      }
+      return ::process_alive(pid, start_time);
+    }
+
+    bool restore_display(const JournalDisplay &display) override {
+      if (!display.device.empty()) {
+        m_logger.info("Restoring display mode {}x{}@{} on {}", display.original_mode.width, display.original_mode.height,
+                      display.original_mode.refresh_rate, display.device);
+        WinMultiDisplayBackend backend;
+        return backend.stage(display.device, display.original_mode) && backend.apply();
+      }
+      return restore_primary_mode(display.original_mode, m_logger);
+    }
+
+    bool disable_hdr(const std::vector<HdrDisplay> &displays) override {
+      m_logger.info("Disabling HDR mode");
+      try {
+        auto hdr_toggle = m_state.hdr_toggle(m_state.config());
+        return log_hdr_results(displays.empty() ? hdr_toggle->set_hdr_mode(false) : hdr_toggle->disable_hdr(displays), m_logger);
+      } catch (HdrError &e) {
+        m_logger.error("Failed to disable HDR mode: {}", e.what());
+        return false;
+      }
+    }
+
+  private:
+    LauncherState &m_state;
+    Logger &m_logger;
+  };
+  Target target{state, logger};
+  replay_stale_journals(state.paths().pwd, target, logger);
+}
+
+int run_prep_command(const LauncherPaths &paths, bool undo, Logger &logger) {
+  class Target : public PrepTarget {
+  public:
+    explicit Target(Logger &logger) : m_logger{logger} {}
+
+    bool apply_primary_mode(const DisplayMode &mode) override { return set_primary_mode(mode, m_logger); }
+    bool apply_display_modes(const std::vector<DisplayChange> &changes) override { return apply_display_batch(changes, nullptr, m_logger); }
+
+    std::vector<JournalDisplay> restore_displays(const std::vector<JournalDisplay> &displays) override {
+      std::vector<JournalDisplay> failed;
+      std::vector<DisplayChange> batch;
+      for (const auto &display : displays) {
+        if (!display.device.empty()) {
+          batch.push_back({display.device, display.original_mode, display.original_mode});
+        } else if (!restore_primary_mode(display.original_mode, m_logger)) {
+          failed.push_back(display);
+        }
+      }
+      if (!batch.empty()) {
+        m_logger.info("Resetting {} displays to their original modes", batch.size());
+        WinMultiDisplayBackend backend;
+        if (restore_display_changes(backend, batch)) {
+          flight::record(flight::Event::display_batch_restored, batch.size());
+        } else {
+          std::copy_if(displays.begin(), displays.end(), std::back_inserter(failed), [](const JournalDisplay &display) { return !display.device.empty(); });
+        }
+      }
+      return failed;
+    }
+
+  private:
+    Logger &m_logger;
+  };
+
+  Target target{logger};
+  PrepOutcome outcome;
+  if (undo) {
+    logger.info("Undoing the display modes of --do");
+    outcome = prep_undo(paths.prep_state, target);
+  } else {
+    LauncherConfig config;
+    if (std::error_code ec; fs::exists(paths.inifile, ec)) {
+      logger.info("Found config file: {}", paths.inifile.string());
+      config = load_config(paths.inifile, logger);
+      log_config(config, logger);
+    }
+    if (config.toggle_hdr) {
+      logger.info("HDR is not switched by --do, NVAPI would switch it back off as soon as this process exits");
+    }
+    SessionGoal goal;
+    SessionSnapshot snapshot;
+    std::optional<DisplayModeCatalog> catalog;
+    read_display_goal(
+        config,
+        [&](const DisplayMode &required) -> const DisplayModeCatalog & {
+          WinDisplayBackend backend;
+          catalog = DisplayModeCatalog::open(backend, paths.mode_cache, required);
+          return *catalog;
+        },
+        goal, snapshot, logger);
+    outcome = prep_do(goal, snapshot, paths.prep_state, GetCurrentProcessId(), target);
+  }
+  for (const auto &message : outcome.messages) {
+    logger.info("  {}", message);
+  }
+  return outcome.ok ? 0 : 1;
+}
+
+void write_session_trace(const fs::path &pwd, Logger &logger) {
+  if (!trace::enabled()) {
+    return;
+  }
+  auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+  char timestamp[32];
+  std::strftime(timestamp, sizeof(timestamp), "%Y%m%d_%H%M%S", std::localtime(&now));
+  auto trace_path = pwd / fs::path("moonlight_hdr_launcher_trace_"s + timestamp + ".json");
+  if (trace::write(trace_path)) {
+    logger.info("Trace written to {}", trace_path.string());
+  }
+}
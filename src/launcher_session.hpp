@@ -0,0 +1,80 @@
+#pragma once
+#include "config.hpp"
+#include "display_mode_catalog.hpp"
+#include "hdr_toggle.hpp"
+#include "restore_journal.hpp"
+#include "teardown.hpp"
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+
+class Logger;
+
+struct LauncherPaths {
+  explicit LauncherPaths(const std::filesystem::path &pwd);
+
+  std::filesystem::path pwd;
+  std::filesystem::path inifile;
+  std::filesystem::path mode_cache;
+  std::filesystem::path hdr_cache;
+  std::filesystem::path journal;
+  std::filesystem::path child_output;
+  std::filesystem::path binary_log;
+  // what --do changed, until --undo
+  std::filesystem::path prep_state;
+};
+
+// Everything a session needs that can outlive it. The one-shot launcher uses it for a single session, the launcher
+// service keeps it between sessions: the config is parsed again only when the INI file changes, NVAPI stays loaded
+// and the display modes are enumerated again only when the display changes.
+class LauncherState {
+public:
+  LauncherState(LauncherPaths paths, Logger &logger);
+
+  const LauncherPaths &paths() const { return m_paths; }
+  LauncherConfig config();
+  // Enumerated again when the display changed or the catalog lacks the required mode.
+  const DisplayModeCatalog &display_modes(const std::optional<DisplayMode> &required = {});
+  // Loads NVAPI on first use; throws HdrError if it cannot be initialized, the next session then tries again. Also
+  // throws while restore actions of an earlier session are pending, they may still be using the toggle.
+  HdrToggle *hdr_toggle(const LauncherConfig &config);
+  SessionJournal &journal() { return m_journal; }
+  // Restore actions that missed a session's teardown deadline
+  TeardownRetry &teardown_retry() { return m_teardown_retry; }
+
+private:
+  LauncherPaths m_paths;
+  Logger &m_logger;
+  std::optional<LauncherConfig> m_config;
+  std::filesystem::file_time_type m_config_write_time;
+  std::optional<DisplayModeCatalog> m_display_modes;
+  std::unique_ptr<HdrToggle> m_hdr_toggle;
+  SessionJournal m_journal;
+  // last, the retries and the attempts it waits for on destruction use the journal and the HDR toggle
+  TeardownRetry m_teardown_retry;
+};
+
+// Shows and hides the compatibility window; for a session run by the service the client process owns the window.
+struct SessionWindow {
+  std::function<void(bool compatibility_window)> open;
+  std::function<void()> close;
+  // Calls on_closed on the window's thread once the user has closed the open window. Returns false if there is no
+  // window this process can watch.
+  std::function<bool(std::function<void()> on_closed)> watch_closed;
+};
+
+// Applies the configured display mode and HDR, runs launcher_exe and restores everything once it has exited.
+// Returns the exit code for the launcher process, failures are thrown.
+int run_session(LauncherState &state, const SessionWindow &window, bool trace_requested, Logger &logger);
+
+// The --do and --undo prep commands: switches the configured display modes and returns, or restores the modes
+// recorded by --do. Returns the exit code for the launcher process. Needs no LauncherState, only the config and the
+// display modes are read.
+int run_prep_command(const LauncherPaths &paths, bool undo, Logger &logger);
+
+// Restores what launcher processes that are gone changed without restoring, as recorded in their journals.
+void replay_restore_journals(LauncherState &state, Logger &logger);
+
+// Writes the trace of the session to the working folder if tracing is enabled.
+void write_session_trace(const std::filesystem::path &pwd, Logger &logger);
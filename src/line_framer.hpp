@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Splits a byte stream into lines. Complete lines inside a chunk are handed out as views into the chunk,
+// only a trailing partial line is copied and kept until the next chunk arrives. Lines longer than max_line, such as
+// '\r'-only progress output or binary data, are handed out in pieces of max_line bytes, so the partial line never
+// grows beyond that.
+class LineFramer {
+public:
+  static constexpr size_t default_max_line = 16 * 1024;
+
+  explicit LineFramer(size_t max_line = default_max_line) : m_max_line{max_line} { m_partial.reserve(max_line); }
+
+  template <typename line_handler> void feed(std::string_view chunk, line_handler &&on_line) {
+    for (auto eol = chunk.find('\n'); eol != std::string_view::npos; eol = chunk.find('\n')) {
+      if (m_partial.empty()) {
+        emit(chunk.substr(0, eol), on_line);
+      } else {
+        keep(chunk.substr(0, eol), on_line);
+        emit(m_partial, on_line);
+        m_partial.clear();
+      }
+      chunk.remove_prefix(eol + 1);
+    }
+    keep(chunk, on_line);
+  }
+
+  template <typename line_handler> void flush(line_handler &&on_line) {
+    emit(m_partial, on_line);
+    m_partial.clear();
+  }
+
+private:
+  // Appends to the partial line, handing out a full piece whenever it reaches max_line.
+  template <typename line_handler> void keep(std::string_view text, line_handler &on_line) {
+    while (m_partial.size() + text.size() > m_max_line) {
+      auto take = m_max_line - m_partial.size();
+      if (m_partial.empty()) {
+        emit_piece(text.substr(0, take), on_line);
+      } else {
+        m_partial.append(text.data(), take);
+        emit_piece(m_partial, on_line);
+        m_partial.clear();
+      }
+      text.remove_prefix(take);
+    }
+    m_partial.append(text);
+  }
+
+  template <typename line_handler> void emit(std::string_view line, line_handler &on_line) {
+    for (; line.size() > m_max_line; line.remove_prefix(m_max_line)) {
+      emit_piece(line.substr(0, m_max_line), on_line);
+    }
+    emit_piece(line, on_line);
+  }
+
+  template <typename line_handler> static void emit_piece(std::string_view line, line_handler &on_line) {
+    if (!line.empty() && line.back() == '\r') {
+      line.remove_suffix(1);
+    }
+    if (!line.empty()) {
+      on_line(line);
+    }
+  }
+
+  size_t m_max_line;
+  std::string m_partial;
+};
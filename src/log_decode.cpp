@@ -0,0 +1,188 @@
+// Renders a binary log written with options.binary_log as text, CSV or JSON lines.
+#include "log_format.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+enum class OutputFormat { text, csv, json };
+
+std::string event_name(uint16_t event) {
+  return event < log_event_formats.size() ? std::string(log_event_formats[event].name) : "event_" + std::to_string(event);
+}
+
+std::string timestamp(uint64_t time) {
+  auto seconds = static_cast<std::time_t>(time / 1000000);
+  char buffer[64];
+  auto length = std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %X", std::localtime(&seconds));
+  char micros[16];
+  std::snprintf(micros, sizeof(micros), ".%06u", static_cast<unsigned>(time % 1000000));
+  return std::string(buffer, length) + micros;
+}
+
+std::string csv_field(const std::string &text) {
+  if (text.find_first_of(",\"\r\n") == std::string::npos) {
+    return text;
+  }
+  std::string quoted = "\"";
+  for (auto c : text) {
+    quoted += c == '"' ? "\"\"" : std::string(1, c);
+  }
+  return quoted + "\"";
+}
+
+std::string json_string(const std::string &text) {
+  std::string quoted = "\"";
+  for (auto c : text) {
+    switch (c) {
+    case '"':
+      quoted += "\\\"";
+      break;
+    case '\\':
+      quoted += "\\\\";
+      break;
+    case '\n':
+      quoted += "\\n";
+      break;
+    case '\r':
+      quoted += "\\r";
+      break;
+    case '\t':
+      quoted += "\\t";
+      break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        char escaped[8];
+        std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+        quoted += escaped;
+      } else {
+        quoted += c;
+      }
+    }
+  }
+  return quoted + "\"";
+}
+
+std::string json_value(const LogArg &arg) {
+  if (auto text = std::get_if<std::string>(&arg)) {
+    return json_string(*text);
+  }
+  return log_arg_text(arg);
+}
+
+int usage() {
+  std::fprintf(stderr, "usage: mhdrl_log_decode <moonlight_hdr_launcher_log.bin> [--event <name>[,<name>...]] [--format text|csv|json]\n");
+  std::fprintf(stderr, "events:");
+  for (const auto &format : log_event_formats) {
+    std::fprintf(stderr, " %.*s", static_cast<int>(format.name.size()), format.name.data());
+  }
+  std::fprintf(stderr, "\n");
+  return 2;
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+  std::string path;
+  std::set<uint16_t> events;
+  auto output = OutputFormat::text;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--event" && i + 1 < argc) {
+      std::string names = argv[++i];
+      for (size_t start = 0; start <= names.size();) {
+        auto end = std::min(names.find(',', start), names.size());
+        auto event = find_log_event(std::string_view(names).substr(start, end - start));
+        if (!event) {
+          std::fprintf(stderr, "unknown event '%s'\n", names.substr(start, end - start).c_str());
+          return usage();
+        }
+        events.insert(static_cast<uint16_t>(*event));
+        start = end + 1;
+      }
+    } else if (arg == "--format" && i + 1 < argc) {
+      std::string name = argv[++i];
+      if (name == "text") {
+        output = OutputFormat::text;
+      } else if (name == "csv") {
+        output = OutputFormat::csv;
+      } else if (name == "json") {
+        output = OutputFormat::json;
+      } else {
+        return usage();
+      }
+    } else if (path.empty() && !arg.starts_with("--")) {
+      path = arg;
+    } else {
+      return usage();
+    }
+  }
+  if (path.empty()) {
+    return usage();
+  }
+
+  std::ifstream in{path, std::ios::binary};
+  std::string data{std::istreambuf_iterator<char>(in), {}};
+  if (!in && !in.eof()) {
+    std::fprintf(stderr, "cannot read %s\n", path.c_str());
+    return 1;
+  }
+  BinaryLogReader reader{data};
+  if (!reader.valid_header()) {
+    std::fprintf(stderr, "%s is not a binary launcher log\n", path.c_str());
+    return 1;
+  }
+
+  std::string out;
+  if (output == OutputFormat::csv) {
+    out += "time_us,event,level,message,arguments\n";
+  }
+  BinaryLogRecord record;
+  while (reader.next(record)) {
+    if (!events.empty() && !events.contains(record.event)) {
+      continue;
+    }
+    auto args = decode_log_args(record.args);
+    if (!args) {
+      std::fprintf(stderr, "damaged arguments in a %s record\n", event_name(record.event).c_str());
+      continue;
+    }
+    auto known = record.event < log_event_formats.size();
+    auto message = render_log_event(known ? log_event_formats[record.event].format : event_name(record.event), *args);
+    auto level = known ? std::string(log_level_name(log_event_formats[record.event].level)) : "unknown";
+    switch (output) {
+    case OutputFormat::text:
+      out += timestamp(record.time) + ": " + message + "\n";
+      break;
+    case OutputFormat::csv: {
+      std::string joined;
+      for (const auto &arg : *args) {
+        joined += (joined.empty() ? "" : ";") + log_arg_text(arg);
+      }
+      out += std::to_string(record.time) + "," + event_name(record.event) + "," + level + "," + csv_field(message) + "," + csv_field(joined) + "\n";
+      break;
+    }
+    case OutputFormat::json: {
+      out += "{\"time_us\":" + std::to_string(record.time) + ",\"event\":" + json_string(event_name(record.event)) + ",\"level\":" + json_string(level) +
+             ",\"message\":" + json_string(message) + ",\"args\":[";
+      for (size_t i = 0; i < args->size(); ++i) {
+        out += (i == 0 ? "" : ",") + json_value((*args)[i]);
+      }
+      out += "]}\n";
+      break;
+    }
+    }
+    if (out.size() >= 64 * 1024) {
+      std::fwrite(out.data(), 1, out.size(), stdout);
+      out.clear();
+    }
+  }
+  std::fwrite(out.data(), 1, out.size(), stdout);
+  if (reader.error()) {
+    std::fprintf(stderr, "the log ends with a damaged record, it was probably cut short\n");
+  }
+  return 0;
+}
@@ -0,0 +1,55 @@
+#include "log_file.hpp"
+#include <string>
+#include <system_error>
+
+std::filesystem::path rotated_log_path(const std::filesystem::path &path, uint32_t index) {
+  auto rotated = path.parent_path() / path.stem();
+  rotated += "." + std::to_string(index);
+  rotated += path.extension();
+  return rotated;
+}
+
+RotatingLogFile::RotatingLogFile(std::filesystem::path path, LogRotation rotation, bool binary)
+    : m_path{std::move(path)}, m_rotation{rotation}, m_binary{binary} {
+  if (m_rotation.on_open || m_rotation.max_bytes == 0) {
+    rotate();
+    m_rotations = 0;
+    return;
+  }
+  // what earlier runs wrote counts towards the cap
+  std::error_code ec;
+  auto size = std::filesystem::file_size(m_path, ec);
+  m_size = ec ? 0 : size;
+  auto mode = std::ios::out | std::ios::app;
+  m_file.open(m_path, m_binary ? mode | std::ios::binary : mode);
+}
+
+void RotatingLogFile::write(const char *data, size_t size) {
+  if (m_rotation.max_bytes != 0 && m_size != 0 && m_size + size > m_rotation.max_bytes) {
+    rotate();
+  }
+  m_file.write(data, static_cast<std::streamsize>(size));
+  m_size += size;
+}
+
+void RotatingLogFile::rotate() {
+  if (m_file.is_open()) {
+    m_file.close();
+  }
+  ++m_rotations;
+  auto mode = std::ios::out | std::ios::trunc;
+  if (m_rotation.keep != 0) {
+    std::error_code ec;
+    for (auto index = m_rotation.keep - 1; index != 0; --index) {
+      std::filesystem::rename(rotated_log_path(m_path, index), rotated_log_path(m_path, index + 1), ec);
+    }
+    std::filesystem::rename(m_path, rotated_log_path(m_path, 1), ec);
+    // the file is in use elsewhere or the folder is not writable, keep appending rather than lose what is there
+    if (ec && ec != std::errc::no_such_file_or_directory) {
+      mode = std::ios::out | std::ios::app;
+    }
+  }
+  m_file.open(m_path, m_binary ? mode | std::ios::binary : mode);
+  // the cap counts what this process wrote, a file that could not be rotated is not retried on every write
+  m_size = 0;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+
+struct LogRotation {
+  // the file is rotated before it grows beyond this, 0 only rotates when the file is opened
+  uint64_t max_bytes = 0;
+  // rotated files kept next to the current one, <name>.1<ext> is the newest; with 0 the file is simply truncated
+  uint32_t keep = 0;
+  // false appends to the file when it is opened and rotates it only once it reaches max_bytes, ignored without a cap
+  bool on_open = true;
+};
+
+// <name>.<index><ext>, e.g. moonlight_hdr_launcher_log.2.txt
+std::filesystem::path rotated_log_path(const std::filesystem::path &path, uint32_t index);
+
+// Append-only log file. Opening it rotates the previous run's file out of the way instead of truncating it, unless
+// it is only rotated by size, and it is rotated again whenever a write would take it past the size cap. Only the
+// logger's writer thread touches it, so a rotation (a few renames) never blocks the threads that log.
+class RotatingLogFile {
+public:
+  // A text file keeps CRLF line ends on Windows, a binary one is written as is.
+  RotatingLogFile(std::filesystem::path path, LogRotation rotation, bool binary = false);
+
+  void write(const char *data, size_t size);
+  void flush() { m_file.flush(); }
+  uint64_t rotations() const { return m_rotations; }
+
+private:
+  void rotate();
+
+  std::filesystem::path m_path;
+  LogRotation m_rotation;
+  bool m_binary;
+  std::ofstream m_file;
+  uint64_t m_size = 0;
+  uint64_t m_rotations = 0;
+};
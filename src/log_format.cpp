@@ -0,0 +1,208 @@
+#include "log_format.hpp"
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstring>
+
+namespace {
+bool get_varint(std::string_view &data, uint64_t &value) {
+  value = 0;
+  for (unsigned shift = 0; shift < 64; shift += 7) {
+    if (data.empty()) {
+      return false;
+    }
+    auto byte = static_cast<uint8_t>(data.front());
+    data.remove_prefix(1);
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool get_u64(std::string_view &data, uint64_t &value) {
+  if (data.size() < 8) {
+    return false;
+  }
+  value = 0;
+  for (int i = 7; i >= 0; --i) {
+    value = (value << 8) | static_cast<uint8_t>(data[i]);
+  }
+  data.remove_prefix(8);
+  return true;
+}
+
+void put_fixed_u64(std::string &out, uint64_t value) {
+  for (int i = 0; i < 8; ++i) {
+    out.push_back(static_cast<char>(value >> (8 * i)));
+  }
+}
+} // namespace
+
+std::string_view log_level_name(LogLevel level) {
+  switch (level) {
+  case LogLevel::trace:
+    return "trace";
+  case LogLevel::debug:
+    return "debug";
+  case LogLevel::info:
+    return "info";
+  case LogLevel::warn:
+    return "warn";
+  case LogLevel::error:
+    return "error";
+  }
+  return "unknown";
+}
+
+std::optional<LogEvent> find_log_event(std::string_view name) {
+  auto it = std::find_if(log_event_formats.begin(), log_event_formats.end(), [name](const LogEventFormat &f) { return f.name == name; });
+  if (it == log_event_formats.end()) {
+    return {};
+  }
+  return static_cast<LogEvent>(it - log_event_formats.begin());
+}
+
+namespace log_encoding {
+void put_varint(std::string &out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+void put_unsigned(std::string &out, uint64_t value) {
+  out.push_back(static_cast<char>(Tag::u64));
+  put_varint(out, value);
+}
+
+void put_signed(std::string &out, int64_t value) {
+  out.push_back(static_cast<char>(Tag::i64));
+  put_varint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+void put_double(std::string &out, double value) {
+  out.push_back(static_cast<char>(Tag::f64));
+  put_fixed_u64(out, std::bit_cast<uint64_t>(value));
+}
+
+void put_string(std::string &out, std::string_view value) {
+  out.push_back(static_cast<char>(Tag::str));
+  put_varint(out, value.size());
+  out.append(value);
+}
+} // namespace log_encoding
+
+std::optional<std::vector<LogArg>> decode_log_args(std::string_view data) {
+  using log_encoding::Tag;
+  std::vector<LogArg> args;
+  while (!data.empty()) {
+    auto tag = static_cast<Tag>(data.front());
+    data.remove_prefix(1);
+    uint64_t value = 0;
+    switch (tag) {
+    case Tag::u64:
+      if (!get_varint(data, value)) {
+        return {};
+      }
+      args.emplace_back(value);
+      break;
+    case Tag::i64:
+      if (!get_varint(data, value)) {
+        return {};
+      }
+      args.emplace_back(static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1)));
+      break;
+    case Tag::f64:
+      if (!get_u64(data, value)) {
+        return {};
+      }
+      args.emplace_back(std::bit_cast<double>(value));
+      break;
+    case Tag::str:
+      if (!get_varint(data, value) || value > data.size()) {
+        return {};
+      }
+      args.emplace_back(std::string(data.substr(0, value)));
+      data.remove_prefix(value);
+      break;
+    default:
+      return {};
+    }
+  }
+  return args;
+}
+
+std::string log_arg_text(const LogArg &arg) {
+  return std::visit(
+      [](const auto &value) -> std::string {
+        if constexpr (std::is_same_v<std::decay_t<decltype(value)>, std::string>) {
+          return value;
+        } else {
+          char buffer[32];
+          auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+          return std::string(buffer, result.ptr);
+        }
+      },
+      arg);
+}
+
+std::string render_log_event(std::string_view format, const std::vector<LogArg> &args) {
+  std::string text;
+  size_t next = 0;
+  for (auto pos = format.find("{}"); pos != std::string_view::npos; pos = format.find("{}")) {
+    text.append(format.substr(0, pos));
+    if (next < args.size()) {
+      text.append(log_arg_text(args[next++]));
+    }
+    format.remove_prefix(pos + 2);
+  }
+  text.append(format);
+  for (; next < args.size(); ++next) {
+    text.append(" ").append(log_arg_text(args[next]));
+  }
+  return text;
+}
+
+std::string encode_binary_log_header(uint64_t start_time) {
+  std::string header{binary_log_magic};
+  put_fixed_u64(header, start_time);
+  return header;
+}
+
+void encode_binary_log_record(std::string &out, uint64_t delta, uint16_t event, std::string_view args) {
+  log_encoding::put_varint(out, delta);
+  log_encoding::put_varint(out, event);
+  log_encoding::put_varint(out, args.size());
+  out.append(args);
+}
+
+BinaryLogReader::BinaryLogReader(std::string_view data) : m_data{data} {
+  if (m_data.starts_with(binary_log_magic)) {
+    m_data.remove_prefix(binary_log_magic.size());
+    m_valid = get_u64(m_data, m_time);
+  }
+  m_error = !m_valid;
+}
+
+bool BinaryLogReader::next(BinaryLogRecord &record) {
+  if (m_error || m_data.empty()) {
+    return false;
+  }
+  uint64_t delta = 0;
+  uint64_t event = 0;
+  uint64_t size = 0;
+  if (!get_varint(m_data, delta) || !get_varint(m_data, event) || event > UINT16_MAX || !get_varint(m_data, size) || size > m_data.size()) {
+    // a record cut short by a crash, everything before it is still good
+    m_error = true;
+    return false;
+  }
+  m_time += delta;
+  record.time = m_time;
+  record.event = static_cast<uint16_t>(event);
+  record.args = m_data.substr(0, size);
+  m_data.remove_prefix(size);
+  return true;
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include <array>
+#include <concepts>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+enum class LogLevel : int { trace = 0, debug = 1, info = 2, warn = 3, error = 4 };
+
+std::string_view log_level_name(LogLevel level);
+
+// Structured log events. The IDs are written to binary logs, so new events are only ever appended.
+enum class LogEvent : uint16_t {
+  child_output,
+  child_error_output,
+  startup_task,
+  restore_action,
+  hdr_display_done,
+  hdr_display_failed,
+  process_joined,
+  process_left,
+  loop_wakeups,
+  count
+};
+
+struct LogEventFormat {
+  std::string_view name;
+  LogLevel level;
+  // "{}" stands for the next argument
+  std::string_view format;
+};
+
+constexpr std::array<LogEventFormat, static_cast<size_t>(LogEvent::count)> log_event_formats{{
+    {"child_output", LogLevel::info, "SUBPROCESS: {}"},
+    {"child_error_output", LogLevel::info, "SUBPROCESS (stderr): {}"},
+    {"startup_task", LogLevel::debug, "Startup task '{}' started at +{} ms, took {} ms"},
+    {"restore_action", LogLevel::info, "Restore action '{}' {} after {} ms{}"},
+    {"hdr_display_done", LogLevel::info, "HDR display {} on GPU {}: done in {} ms"},
+    {"hdr_display_failed", LogLevel::error, "HDR display {} on GPU {}: failed after {} ms: {}"},
+    {"process_joined", LogLevel::debug, "Process {} joined the session: {}"},
+    {"process_left", LogLevel::debug, "Process {} left the session"},
+    {"loop_wakeups", LogLevel::debug, "Session event loop woke up {} times"},
+}};
+
+constexpr const LogEventFormat &log_event_format(LogEvent event) { return log_event_formats[static_cast<size_t>(event)]; }
+std::optional<LogEvent> find_log_event(std::string_view name);
+
+// Binary log: an 8 byte magic and the start time in microseconds since the Unix epoch, then one record per event:
+// the time since the previous record in microseconds, the event ID and the size of the arguments as LEB128 varints,
+// then the arguments, each a one byte type tag followed by its value. Unsigned integers are varints, signed ones
+// zigzag varints, doubles 8 bytes little-endian and strings a varint length and the bytes.
+constexpr std::string_view binary_log_magic = "MHDRLBL1";
+
+using LogArg = std::variant<uint64_t, int64_t, double, std::string>;
+
+namespace log_encoding {
+enum class Tag : uint8_t { u64 = 0, i64 = 1, f64 = 2, str = 3 };
+
+void put_varint(std::string &out, uint64_t value);
+void put_unsigned(std::string &out, uint64_t value);
+void put_signed(std::string &out, int64_t value);
+void put_double(std::string &out, double value);
+void put_string(std::string &out, std::string_view value);
+
+template <typename T> void put_arg(std::string &out, const T &value) {
+  if constexpr (std::is_same_v<T, bool>) {
+    put_unsigned(out, value ? 1 : 0);
+  } else if constexpr (std::is_enum_v<T>) {
+    put_arg(out, static_cast<std::underlying_type_t<T>>(value));
+  } else if constexpr (std::unsigned_integral<T>) {
+    put_unsigned(out, value);
+  } else if constexpr (std::signed_integral<T>) {
+    put_signed(out, value);
+  } else if constexpr (std::floating_point<T>) {
+    put_double(out, static_cast<double>(value));
+  } else {
+    put_string(out, std::string_view{value});
+  }
+}
+} // namespace log_encoding
+
+// Appends the typed arguments of an event to out.
+template <typename... Args> void encode_log_args(std::string &out, const Args &...args) { (log_encoding::put_arg(out, args), ...); }
+
+std::optional<std::vector<LogArg>> decode_log_args(std::string_view data);
+// The event's format with its arguments filled in, arguments without a placeholder are appended.
+std::string render_log_event(std::string_view format, const std::vector<LogArg> &args);
+std::string log_arg_text(const LogArg &arg);
+
+struct BinaryLogRecord {
+  // microseconds since the Unix epoch
+  uint64_t time = 0;
+  uint16_t event = 0;
+  std::string_view args;
+};
+
+// Header and record framing, shared by the logger and the decoder.
+std::string encode_binary_log_header(uint64_t start_time);
+void encode_binary_log_record(std::string &out, uint64_t delta, uint16_t event, std::string_view args);
+
+class BinaryLogReader {
+public:
+  // The data has to stay alive while records are read.
+  explicit BinaryLogReader(std::string_view data);
+
+  bool valid_header() const { return m_valid; }
+  // False at the end of the data or at a damaged record, error() tells them apart.
+  bool next(BinaryLogRecord &record);
+  bool error() const { return m_error; }
+
+private:
+  std::string_view m_data;
+  uint64_t m_time = 0;
+  bool m_valid = false;
+  bool m_error = false;
+};
@@ -0,0 +1,295 @@
+#include "logger.hpp"
+#include <ctime>
+#include <iostream>
+
+namespace {
+constexpr uint32_t pool_size = 512;
+// a record that held a longer message gives the memory back instead of keeping it in the pool
+constexpr size_t max_pooled_message = 4096;
+constexpr size_t reserved_message = 256;
+
+uint64_t free_list_head(uint64_t previous, uint32_t index) { return ((previous >> 32) + 1) << 32 | index; }
+} // namespace
+
+Logger::Logger(const std::filesystem::path &path, bool log_to_stdout, FlushPolicy policy, std::chrono::milliseconds flush_interval,
+               LogRotation rotation)
+    : m_file{path, rotation}, m_log_to_stdout{log_to_stdout}, m_policy{policy}, m_flush_interval{flush_interval} {
+  m_file_buffer.reserve(64 * 1024);
+  m_pool = std::make_unique<Record[]>(pool_size);
+  for (uint32_t index = 0; index < pool_size; ++index) {
+    m_pool[index].pool_index = index + 1;
+    m_pool[index].free_next.store(index + 2 <= pool_size ? index + 2 : 0, std::memory_order_relaxed);
+  }
+  m_free_head.store(1);
+  m_reserved.message.reserve(reserved_message);
+  m_last_flush = std::chrono::steady_clock::now();
+  m_writer = std::thread([this]() { writer_loop(); });
+}
+
+Logger::~Logger() { shutdown(); }
+
+Logger::Record *Logger::acquire() {
+  auto head = m_free_head.load(std::memory_order_acquire);
+  for (;;) {
+    auto index = static_cast<uint32_t>(head);
+    if (index == 0) {
+      return new Record;
+    }
+    // may be stale if another producer took the record meanwhile, the tag then fails the exchange
+    auto next = m_pool[index - 1].free_next.load(std::memory_order_relaxed);
+    if (m_free_head.compare_exchange_weak(head, free_list_head(head, next), std::memory_order_acquire, std::memory_order_acquire)) {
+      return &m_pool[index - 1];
+    }
+  }
+}
+
+void Logger::release(Record *record) {
+  if (record == &m_reserved) {
+    return;
+  }
+  if (record->pool_index == 0) {
+    delete record;
+    return;
+  }
+  if (record->message.capacity() > max_pooled_message) {
+    std::string{}.swap(record->message);
+  }
+  record->message.clear();
+  record->event.reset();
+  auto head = m_free_head.load(std::memory_order_relaxed);
+  do {
+    record->free_next.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+  } while (!m_free_head.compare_exchange_weak(head, free_list_head(head, record->pool_index), std::memory_order_release, std::memory_order_relaxed));
+}
+
+void Logger::push_record(Record *record, LogLevel level, std::optional<LogEvent> event) {
+  record->time = std::chrono::system_clock::now();
+  record->level = level;
+  record->event = event;
+  push(record);
+  wake_writer();
+}
+
+void Logger::write_reserved(LogLevel level, std::string_view message) {
+  if (!enabled(level) || m_reserved_used.test_and_set()) {
+    return;
+  }
+  m_reserved.message.assign(message.substr(0, m_reserved.message.capacity()));
+  push_record(&m_reserved, level, {});
+}
+
+void Logger::set_binary_log(std::optional<std::filesystem::path> path) {
+  {
+    std::lock_guard lock{m_binary_path_mutex};
+    m_binary_path_change = std::move(path);
+  }
+  m_binary_path_changed.store(true);
+}
+
+void Logger::switch_binary_log() {
+  std::optional<std::filesystem::path> path;
+  {
+    std::lock_guard lock{m_binary_path_mutex};
+    m_binary_path_changed.store(false);
+    if (!m_binary_path_change) {
+      return;
+    }
+    path = std::move(*m_binary_path_change);
+    m_binary_path_change.reset();
+  }
+  if (m_binary_file) {
+    m_binary_file->write(m_binary_buffer.data(), m_binary_buffer.size());
+    m_binary_buffer.clear();
+    m_binary_file.reset();
+  }
+  if (path) {
+    // one file per session, the previous ones are kept like the text logs
+    m_binary_file = std::make_unique<RotatingLogFile>(*path, LogRotation{0, 5}, true);
+    m_binary_time = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+    auto header = encode_binary_log_header(m_binary_time);
+    m_binary_file->write(header.data(), header.size());
+  }
+}
+
+void Logger::write_event(const Record &record) {
+  auto time = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(record.time.time_since_epoch()).count());
+  // records from different threads may be a little out of order
+  auto delta = time > m_binary_time ? time - m_binary_time : 0;
+  m_binary_time += delta;
+  encode_binary_log_record(m_binary_buffer, delta, static_cast<uint16_t>(*record.event), record.message);
+}
+
+bool Logger::drain(std::chrono::milliseconds timeout) {
+  if (!m_writer.joinable()) {
+    return true;
+  }
+  auto ticket = m_drain_requested.fetch_add(1) + 1;
+  wake_writer();
+  if (timeout == std::chrono::milliseconds::max()) {
+    for (auto completed = m_drain_completed.load(); completed < ticket; completed = m_drain_completed.load()) {
+      m_drain_completed.wait(completed);
+    }
+    return true;
+  }
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (m_drain_completed.load() < ticket) {
+    if (std::chrono::steady_clock::now() >= deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+  }
+  return true;
+}
+
+void Logger::shutdown() {
+  if (!m_writer.joinable()) {
+    return;
+  }
+  m_stopping.store(true);
+  wake_writer();
+  m_writer.join();
+}
+
+void Logger::push(Record *record) {
+  record->next.store(nullptr, std::memory_order_relaxed);
+  auto prev = m_head.exchange(record);
+  prev->next.store(record, std::memory_order_release);
+}
+
+Logger::Record *Logger::pop() {
+  auto tail = m_tail;
+  auto next = tail->next.load(std::memory_order_acquire);
+  if (tail == &m_stub) {
+    if (next == nullptr) {
+      return nullptr;
+    }
+    m_tail = next;
+    tail = next;
+    next = next->next.load(std::memory_order_acquire);
+  }
+  if (next) {
+    m_tail = next;
+    return tail;
+  }
+  if (tail != m_head.load()) {
+    // a producer is between exchanging the head and linking its record
+    return nullptr;
+  }
+  push(&m_stub);
+  next = tail->next.load(std::memory_order_acquire);
+  if (next) {
+    m_tail = next;
+    return tail;
+  }
+  return nullptr;
+}
+
+void Logger::wake_writer() {
+  if (m_writer_sleeping.load() && m_writer_sleeping.exchange(false)) {
+    m_wakeup.release();
+  }
+}
+
+void Logger::writer_loop() {
+  for (;;) {
+    auto drain_ticket = m_drain_requested.load();
+    auto stopping = m_stopping.load();
+
+    write_batch();
+
+    auto now = std::chrono::steady_clock::now();
+    if (m_dirty && (m_policy == FlushPolicy::every_record || (m_policy == FlushPolicy::interval && now - m_last_flush >= m_flush_interval) ||
+                    drain_ticket > m_drain_completed.load() || stopping)) {
+      flush();
+    }
+    if (drain_ticket > m_drain_completed.load()) {
+      m_drain_completed.store(drain_ticket);
+      m_drain_completed.notify_all();
+    }
+    if (stopping && m_head.load() == m_tail) {
+      break;
+    }
+
+    m_writer_sleeping.store(true);
+    if (m_head.load() != m_tail || m_drain_requested.load() != drain_ticket || m_stopping.load() != stopping) {
+      if (!m_writer_sleeping.exchange(false)) {
+        m_wakeup.acquire();
+      }
+      continue;
+    }
+    bool woken = true;
+    if (m_dirty && m_policy == FlushPolicy::interval) {
+      woken = m_wakeup.try_acquire_for(m_flush_interval - (now - m_last_flush));
+    } else {
+      m_wakeup.acquire();
+    }
+    if (!woken && !m_writer_sleeping.exchange(false)) {
+      // a producer claimed the wakeup just as the timeout expired, consume its release
+      m_wakeup.acquire();
+    }
+  }
+}
+
+void Logger::write_batch() {
+  if (m_binary_path_changed.load()) {
+    switch_binary_log();
+  }
+  std::string rendered;
+  while (auto record = pop()) {
+    if (record->event && m_binary_file) {
+      write_event(*record);
+      release(record);
+      continue;
+    }
+    std::string_view message = record->message;
+    if (record->event) {
+      auto args = decode_log_args(record->message);
+      rendered = render_log_event(log_event_format(*record->event).format, args.value_or(std::vector<LogArg>{}));
+      message = rendered;
+    }
+    auto &time = timestamp(record->time);
+    m_file_buffer.append(time).append(": ").append(message).push_back('\n');
+    if (m_log_to_stdout) {
+      m_stdout_buffer.append(time).append(": ").append(message).push_back('\n');
+    }
+    release(record);
+  }
+  if (!m_binary_buffer.empty()) {
+    m_binary_file->write(m_binary_buffer.data(), m_binary_buffer.size());
+    m_binary_buffer.clear();
+    m_dirty = true;
+  }
+  if (!m_file_buffer.empty()) {
+    m_file.write(m_file_buffer.data(), m_file_buffer.size());
+    m_file_buffer.clear();
+    m_dirty = true;
+  }
+  if (!m_stdout_buffer.empty()) {
+    std::cout.write(m_stdout_buffer.data(), m_stdout_buffer.size());
+    m_stdout_buffer.clear();
+  }
+}
+
+void Logger::flush() {
+  m_file.flush();
+  if (m_binary_file) {
+    m_binary_file->flush();
+  }
+  if (m_log_to_stdout) {
+    std::cout.flush();
+  }
+  m_dirty = false;
+  m_last_flush = std::chrono::steady_clock::now();
+}
+
+const std::string &Logger::timestamp(std::chrono::system_clock::time_point time) {
+  auto in_time_t = std::chrono::system_clock::to_time_t(time);
+  if (in_time_t != m_cached_time || m_cached_timestamp.empty()) {
+    char buffer[64];
+    auto length = std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %X", std::localtime(&in_time_t));
+    m_cached_timestamp.assign(buffer, length);
+    m_cached_time = in_time_t;
+  }
+  return m_cached_timestamp;
+}
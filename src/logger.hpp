@@ -0,0 +1,161 @@
+#pragma once
+#include "log_file.hpp"
+#include "log_format.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <semaphore>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <version>
+
+// Standard libraries without <format> (libstdc++ before 13) use {fmt}, which has the same interface.
+#if defined(__cpp_lib_format)
+#include <format>
+namespace log_fmt = std;
+#else
+#include <fmt/format.h>
+namespace log_fmt = fmt;
+#endif
+
+// Calls below this level are compiled out entirely, the runtime level can only raise it further.
+#ifndef MHDRL_MIN_LOG_LEVEL
+#define MHDRL_MIN_LOG_LEVEL 0
+#endif
+constexpr LogLevel min_log_level = static_cast<LogLevel>(MHDRL_MIN_LOG_LEVEL);
+
+enum class FlushPolicy {
+  every_record, // flush after every batch the writer takes off the queue
+  interval,     // flush at most once per flush_interval while there is unflushed data
+  on_shutdown   // flush only on drain() and shutdown()
+};
+
+// Asynchronous logger. Callers push records onto a lock-free multi-producer queue and return immediately;
+// a single writer thread timestamps, coalesces and writes them out in large blocks, rotating the file when needed.
+// Messages are only formatted once the level check has passed, so disabled calls neither format nor allocate.
+// Records come from a pool and keep the capacity of their message, so a call that is logged allocates only when
+// more records are in flight than the pool holds or its message is longer than any its record held before.
+class Logger {
+public:
+  explicit Logger(const std::filesystem::path &path, bool log_to_stdout = true, FlushPolicy policy = FlushPolicy::interval,
+                  std::chrono::milliseconds flush_interval = std::chrono::milliseconds{250}, LogRotation rotation = {});
+  Logger(const Logger &) = delete;
+  Logger &operator=(const Logger &) = delete;
+  virtual ~Logger();
+
+  template <typename... Args> void trace(log_fmt::format_string<Args...> fmt, Args &&...args) { write<LogLevel::trace>(fmt, std::forward<Args>(args)...); }
+  template <typename... Args> void debug(log_fmt::format_string<Args...> fmt, Args &&...args) { write<LogLevel::debug>(fmt, std::forward<Args>(args)...); }
+  template <typename... Args> void info(log_fmt::format_string<Args...> fmt, Args &&...args) { write<LogLevel::info>(fmt, std::forward<Args>(args)...); }
+  template <typename... Args> void warn(log_fmt::format_string<Args...> fmt, Args &&...args) { write<LogLevel::warn>(fmt, std::forward<Args>(args)...); }
+  template <typename... Args> void error(log_fmt::format_string<Args...> fmt, Args &&...args) { write<LogLevel::error>(fmt, std::forward<Args>(args)...); }
+
+  template <LogLevel level, typename... Args> void write(log_fmt::format_string<Args...> fmt, Args &&...args) {
+    if constexpr (level >= min_log_level) {
+      if (enabled(level)) {
+        auto record = acquire();
+        log_fmt::format_to(std::back_inserter(record->message), fmt, std::forward<Args>(args)...);
+        push_record(record, level, {});
+      }
+    }
+  }
+
+  // A structured event from the table in log_format.hpp. Only the typed arguments are encoded here, the writer thread
+  // renders the text or, while a binary log is set, writes the record to it instead of the text log.
+  template <LogEvent id, typename... Args> void event(const Args &...args) {
+    constexpr auto level = log_event_format(id).level;
+    if constexpr (level >= min_log_level) {
+      if (enabled(level)) {
+        auto record = acquire();
+        encode_log_args(record->message, args...);
+        push_record(record, level, id);
+      }
+    }
+  }
+
+  // Sends events to a binary log from the next batch on, or back to the text log without a path.
+  void set_binary_log(std::optional<std::filesystem::path> path);
+
+  // For an unhandled-exception filter, where the heap may be corrupt: logs through a record reserved at construction
+  // without allocating. Only the first call is logged and the message is cut to the reserved capacity.
+  void write_reserved(LogLevel level, std::string_view message);
+
+  bool enabled(LogLevel level) const { return level >= min_log_level && level >= m_level.load(std::memory_order_relaxed); }
+  void set_level(LogLevel level) { m_level.store(level, std::memory_order_relaxed); }
+
+  // Blocks until every record logged before the call is written and flushed, or the timeout expires.
+  bool drain(std::chrono::milliseconds timeout = std::chrono::milliseconds::max());
+  void shutdown();
+
+private:
+  struct Record {
+    std::atomic<Record *> next{nullptr};
+    std::chrono::system_clock::time_point time;
+    LogLevel level = LogLevel::info;
+    // the encoded arguments for an event
+    std::string message;
+    std::optional<LogEvent> event;
+    // position in m_pool plus one, 0 for a record allocated while the pool was empty
+    uint32_t pool_index = 0;
+    std::atomic<uint32_t> free_next{0};
+  };
+
+  Record *acquire();
+  void release(Record *record);
+  void push_record(Record *record, LogLevel level, std::optional<LogEvent> event);
+  void switch_binary_log();
+  void write_event(const Record &record);
+  void push(Record *record);
+  Record *pop();
+  void wake_writer();
+  void writer_loop();
+  void write_batch();
+  void flush();
+  const std::string &timestamp(std::chrono::system_clock::time_point time);
+
+  RotatingLogFile m_file;
+  bool m_log_to_stdout;
+  std::atomic<LogLevel> m_level{LogLevel::info};
+  FlushPolicy m_policy;
+  std::chrono::milliseconds m_flush_interval;
+
+  // Vyukov intrusive MPSC queue: producers exchange m_head, only the writer touches m_tail
+  Record m_stub;
+  std::atomic<Record *> m_head{&m_stub};
+  Record *m_tail = &m_stub;
+
+  // Free records: a lock-free stack whose head packs the pool index plus one with a tag that changes on every update,
+  // so a pop that raced with another pop and a push fails its compare-exchange. Only the writer pushes.
+  std::unique_ptr<Record[]> m_pool;
+  std::atomic<uint64_t> m_free_head{0};
+  Record m_reserved;
+  std::atomic_flag m_reserved_used;
+
+  std::atomic_bool m_writer_sleeping{false};
+  std::binary_semaphore m_wakeup{0};
+  std::atomic_bool m_stopping{false};
+  std::atomic<uint64_t> m_drain_requested{0};
+  std::atomic<uint64_t> m_drain_completed{0};
+
+  std::mutex m_binary_path_mutex;
+  std::optional<std::optional<std::filesystem::path>> m_binary_path_change;
+  std::atomic_bool m_binary_path_changed{false};
+
+  // writer-thread state
+  std::unique_ptr<RotatingLogFile> m_binary_file;
+  std::string m_binary_buffer;
+  uint64_t m_binary_time = 0;
+  std::string m_file_buffer;
+  std::string m_stdout_buffer;
+  bool m_dirty = false;
+  std::chrono::steady_clock::time_point m_last_flush;
+  std::time_t m_cached_time = 0;
+  std::string m_cached_timestamp;
+
+  std::thread m_writer;
+};
@@ -1,116 +1,52 @@
-#pragma warning(push)
-#pragma warning(disable : 4244)
-#include <boost/process.hpp>
-#pragma warning(pop)
 #include "windows.h"
-#include <atomic>
-#include <boost/property_tree/ini_parser.hpp>
-#include <chrono>
+#include <algorithm>
+#include <cstdio>
 #include <filesystem>
-#include <fstream>
-#include <iostream>
+#include <functional>
+#include <memory>
 #include <optional>
-#include <sstream>
 #include <string>
-#include <thread>
+#include <vector>
 
 #include "WinReg.hpp"
-#include "hdr_toggle.hpp"
+#include "event_loop.hpp"
+#include "flight_recorder.hpp"
+#include "launcher_service.hpp"
+#include "launcher_session.hpp"
+#include "logger.hpp"
+#include "named_pipe.hpp"
+#include "session_control.hpp"
+#include "trace.hpp"
+#include "win_flight_recorder.hpp"
 
 #ifdef SENTRY_DEBUG
-#define SENTRY_BUILD_STATIC 1
-#include <sentry.h>
+#include "crash_reporting.hpp"
 #endif
 
 #ifndef MHDRL_VERSION
 #define MHDRL_VERSION "develop"
 #endif
 
-namespace bp = boost::process;
 namespace fs = std::filesystem;
-namespace pt = boost::property_tree;
 using namespace std::string_literals;
 
-const static std::string default_launcher = "C:\\Program Files (x86)\\Steam\\steam.exe steam://open/bigpicture";
-
-DEVMODE const get_primary_display_registry_settings() {
-  DEVMODE devmode{};
-  devmode.dmSize = sizeof(devmode);
-  EnumDisplaySettings(nullptr, ENUM_REGISTRY_SETTINGS, &devmode);
-  return devmode;
-}
-
-DWORD get_max_refresh_rate(uint16_t width, uint16_t height) {
-  DWORD max_refresh_rate = 0;
-  for (DWORD graphics_mode_index = 0;; ++graphics_mode_index) {
-    DEVMODE devmode{};
-    devmode.dmSize = sizeof(devmode);
-    auto rval = EnumDisplaySettings(0, graphics_mode_index, &devmode);
-    if (rval == 0) {
-      break;
-    }
-    if (devmode.dmPelsWidth == width && devmode.dmPelsHeight == height) {
-      max_refresh_rate = std::max(max_refresh_rate, devmode.dmDisplayFrequency);
-    }
-  }
-
-  return max_refresh_rate;
-}
-
-LONG _ChangeDisplaySettings(DEVMODE *devmode, DWORD dwFlags) {
-  DEVMODE current_settings{};
-  current_settings.dmSize = sizeof(current_settings);
-  EnumDisplaySettings(0, ENUM_CURRENT_SETTINGS, &current_settings);
-  if (current_settings.dmPelsWidth == devmode->dmPelsWidth && current_settings.dmPelsHeight == devmode->dmPelsHeight &&
-      ((devmode->dmFields & DM_DISPLAYFREQUENCY == 0) || devmode->dmDisplayFrequency == current_settings.dmDisplayFrequency)) {
-    return DISP_CHANGE_SUCCESSFUL;
-  }
-
-  return ChangeDisplaySettings(devmode, dwFlags);
-}
-
-template <typename log_function>
-void set_resolution(uint16_t width, uint16_t height, uint16_t refresh_rate, bool wait_on_process, bool refresh_rate_use_max, log_function log_func) {
-  DEVMODE devmode{};
-  devmode.dmSize = sizeof(devmode);
-  devmode.dmPelsWidth = width;
-  devmode.dmPelsHeight = height;
-  devmode.dmFields = DM_PELSHEIGHT | DM_PELSWIDTH;
-  if (refresh_rate == 0 && refresh_rate_use_max) {
-    log_func("Setting max refresh_rate"s);
-    refresh_rate = get_max_refresh_rate(width, height);
-    log_func("Detected max refresh rate: "s + std::to_string(refresh_rate));
-  } else {
-    if (refresh_rate_use_max) {
-      log_func("refresh_rate and refresh_rate_use_max specified, defaulting to specified rate"s);
-    }
-  }
-  if (refresh_rate != 0) {
-    devmode.dmDisplayFrequency = refresh_rate;
-    devmode.dmFields |= DM_DISPLAYFREQUENCY;
-  }
-  DWORD result;
-  if (wait_on_process) {
-    // if we are waiting on the process we can clean up at the end
-    result = _ChangeDisplaySettings(&devmode, CDS_UPDATEREGISTRY);
-  } else {
-    // otherwise we do the best we can
-    result = _ChangeDisplaySettings(&devmode, 0);
-  }
-  if (result != DISP_CHANGE_SUCCESSFUL) {
-    log_func("ChangeDisplaySettings failed error:" + std::to_string(result));
+static Logger *crash_logger = nullptr;
+static LPTOP_LEVEL_EXCEPTION_FILTER previous_exception_filter = nullptr;
+
+LONG WINAPI drain_log_on_crash(EXCEPTION_POINTERS *exception_info) {
+  flight::record(flight::Event::unhandled_exception, exception_info->ExceptionRecord->ExceptionCode);
+  if (crash_logger) {
+    // the heap may be corrupt, nothing here allocates
+    char message[64];
+    std::snprintf(message, sizeof(message), "Unhandled exception, code: %#lx", exception_info->ExceptionRecord->ExceptionCode);
+    crash_logger->write_reserved(LogLevel::error, message);
+    crash_logger->drain(std::chrono::milliseconds{500});
   }
-}
-
-void log(const std::string &message, std::ofstream &file, bool log_to_stdout = true) {
-  auto now = std::chrono::system_clock::now();
-  auto in_time_t = std::chrono::system_clock::to_time_t(now);
-  auto time = std::put_time(std::localtime(&in_time_t), "%Y-%m-%d %X");
-  file << time << ": " << message << std::endl;
-  if (log_to_stdout) {
-    std::cout << time << ": " << message << std::endl;
-  }
-  file.flush();
+#ifdef SENTRY_DEBUG
+  // Sentry only catches crashes once it is initialised on its thread, earlier ones are written here
+  crash_reporting::write_startup_minidump(exception_info);
+#endif
+  return previous_exception_filter ? previous_exception_filter(exception_info) : EXCEPTION_CONTINUE_SEARCH;
 }
 
 std::optional<fs::path> get_destination_folder_path() {
@@ -136,24 +72,22 @@ public:
     RegisterClass(&m_wc);
     m_window = CreateWindowW(L"DummyWindow", L"MoonLight HDR Launcher Do Not Close", WS_OVERLAPPEDWINDOW, 0, 0, 1, 1, nullptr, nullptr, hInstance, nullptr);
     if (m_window) {
+      SetWindowLongPtrW(m_window, GWLP_USERDATA, reinterpret_cast<LONG_PTR>(this));
       ShowWindow(m_window, nCmdShow);
     }
   }
   virtual ~DummyWindow() {
+    // closed by the launcher, not the user
+    m_on_destroyed = nullptr;
     if (m_window) {
       DestroyWindow(m_window);
     }
   }
-  void message_loop() {
-    MSG msg;
-    while (GetMessage(&msg, m_window, 0, 0)) {
-      if (msg.hwnd == 0) {
-        break;
-      }
-      DispatchMessage(&msg);
-    }
-  }
+  bool is_open() const { return m_window != nullptr; }
+  // Runs once the window is destroyed by anyone but the launcher, i.e. the user closed it.
+  void on_destroyed(std::function<void()> handler) { m_on_destroyed = std::move(handler); }
   void close() {
+    m_on_destroyed = nullptr;
     DestroyWindow(m_window);
     m_window = 0UL;
   }
@@ -170,6 +104,12 @@ public:
       }
     } break;
     case WM_DESTROY:
+      if (auto self = reinterpret_cast<DummyWindow *>(GetWindowLongPtrW(hWnd, GWLP_USERDATA))) {
+        self->m_window = nullptr;
+        if (auto handler = std::move(self->m_on_destroyed)) {
+          handler();
+        }
+      }
       break;
     default:
       return DefWindowProc(hWnd, message, wParam, lParam);
@@ -180,49 +120,167 @@ public:
 private:
   HWND m_window;
   WNDCLASS m_wc;
+  std::function<void()> m_on_destroyed;
 };
 
+// Sends one command to the control channel of the running session and prints the reply to the console the
+// launcher was started from.
+int send_control_command(const std::vector<std::string> &words) {
+  if (AttachConsole(ATTACH_PARENT_PROCESS)) {
+    FILE *stream;
+    freopen_s(&stream, "CONOUT$", "w", stdout);
+    freopen_s(&stream, "CONOUT$", "w", stderr);
+  }
+  auto command = parse_control_command(words);
+  if (!command) {
+    std::fputs("usage: --control set-mode <width> <height> [<refresh rate>] | hdr on|off | state | end\n", stderr);
+    return 2;
+  }
+  auto channel = NamedPipeChannel::connect(session_control_pipe);
+  if (!channel) {
+    std::fputs("No session is running or another control client is connected\n", stderr);
+    return 1;
+  }
+  try {
+    send_message(*channel, *command);
+    auto reply = receive_message(*channel);
+    std::printf("%s\n", describe_control_reply(reply).c_str());
+    auto control_reply = std::get_if<ControlReply>(&reply);
+    return control_reply && !control_reply->ok ? 1 : 0;
+  } catch (IpcError &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+}
+
+// The dummy window of this process. It belongs to the thread that opens it, whose event loop dispatches its messages.
+class CompatibilityWindow {
+public:
+  CompatibilityWindow(HINSTANCE hInstance, INT nCmdShow) : m_instance{hInstance}, m_show{nCmdShow} {}
+  ~CompatibilityWindow() { close(); }
+
+  void open(bool compatibility_window) {
+    if (compatibility_window) {
+      m_window = std::make_unique<DummyWindow>(m_instance, m_show);
+    }
+  }
+  void close() { m_window.reset(); }
+  bool watch_closed(std::function<void()> on_closed) {
+    if (!m_window || !m_window->is_open()) {
+      return false;
+    }
+    m_window->on_destroyed(std::move(on_closed));
+    return true;
+  }
+  SessionWindow session_window() {
+    return {[this](bool compatibility_window) { open(compatibility_window); }, [this]() { close(); },
+            [this](std::function<void()> on_closed) { return watch_closed(std::move(on_closed)); }};
+  }
+
+private:
+  HINSTANCE m_instance;
+  INT m_show;
+  std::unique_ptr<DummyWindow> m_window;
+};
+
+// Hands the session over to the launcher service, if one is running, before anything else is set up: the service has
+// the config, NVAPI and the display modes warm, the client only shows the compatibility window. Returns nothing if
+// there is no service or it did not take the session, the caller then runs the session itself.
+std::optional<int> hand_over_to_service(const fs::path &pwd, const std::vector<std::string> &args, HINSTANCE hInstance, INT nCmdShow) {
+  // waiting for the service keeps the compatibility window responsive
+  EventLoop loop;
+  auto channel = NamedPipeChannel::connect(launcher_service_pipe, &loop);
+  if (!channel) {
+    return std::nullopt;
+  }
+  trace::disable();
+  // a log of its own, not rotated, the service logs the session and the launcher's own logs are left alone
+  Logger logger{pwd / fs::path("moonlight_hdr_launcher_client_log.txt")};
+  logger.info("Moonlight HDR Launcher Version {}, handing the session over to the launcher service", MHDRL_VERSION);
+  CompatibilityWindow window{hInstance, nCmdShow};
+  auto session_window = window.session_window();
+  auto retcode = request_session(*channel, args, session_window.open, session_window.close, logger);
+  if (retcode) {
+    logger.info("Launcher service ended the session with exit code {}", *retcode);
+  }
+  return retcode;
+}
+
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR lpCmdLine, INT nCmdShow) {
   auto argc = __argc;
   auto argv = __argv;
+  auto args = std::vector<std::string>(argv + 1, argv + argc);
+  auto has_arg = [&args](std::string_view arg) { return std::find(args.begin(), args.end(), arg) != args.end(); };
+  // handled before anything else, the session's log file must not be touched
+  if (auto control = std::find(args.begin(), args.end(), "--control"); control != args.end()) {
+    return send_control_command({std::next(control), args.end()});
+  }
+  // the resident service keeps NVAPI, the display modes and the config warm for the sessions it runs
+  auto service_mode = has_arg("--service");
+  // Sunshine style prep commands, they return as soon as the display modes are switched or restored
+  auto prep_command = has_arg("--do") || has_arg("--undo");
 
   auto pwd = fs::path(argv[0]).parent_path();
-  auto reg_dest_path = get_destination_folder_path();
+  if (!prep_command) {
+    trace::enable();
+  }
+  std::optional<fs::path> reg_dest_path;
+  {
+    TRACE_SCOPE("registry lookup");
+    reg_dest_path = get_destination_folder_path();
+  }
 
   if (reg_dest_path) {
     pwd = *reg_dest_path;
   }
 
-  auto log_path = pwd / fs::path("moonlight_hdr_launcher_log.txt");
-  auto logfile = std::ofstream{log_path.string()};
-  auto inifile = pwd / fs::path("moonlight_hdr_launcher.ini");
+  // no window, no service, no crash reporting and a log of their own, so that a prep command never waits for them
+  if (prep_command) {
+    // appended to, --do and --undo are one run each, and only rotated once it is large
+    Logger logger{pwd / fs::path("moonlight_hdr_launcher_prep_log.txt"), true, FlushPolicy::interval, std::chrono::milliseconds{250},
+                  LogRotation{1024 * 1024, 2, false}};
+    logger.info("Moonlight HDR Launcher Version {}, {}", MHDRL_VERSION, has_arg("--undo") ? "--undo" : "--do");
+    try {
+      return run_prep_command(LauncherPaths{pwd}, has_arg("--undo"), logger);
+    } catch (std::exception &e) {
+      logger.error("Error: {}", e.what());
+      return 1;
+    }
+  }
 
-#ifdef SENTRY_DEBUG
-  sentry_options_t *options = sentry_options_new();
-  sentry_options_set_dsn(options, "https://31576029989d413dbf37509b44ef4ce1@o498001.ingest.sentry.io/5574936");
-  sentry_options_set_release(options, (std::string("moonlight_hdr_launcher@") + MHDRL_VERSION).c_str());
-  auto sentry_temp = fs::temp_directory_path() / "moonlight_hdr_launcher-sentry";
-  sentry_options_set_database_pathw(options, sentry_temp.c_str());
-  sentry_options_add_attachment(options, log_path.string().c_str());
-  sentry_options_add_attachment(options, inifile.string().c_str());
-  sentry_init(options);
+  if (!service_mode) {
+    if (auto retcode = hand_over_to_service(pwd, args, hInstance, nCmdShow)) {
+      return *retcode;
+    }
+  }
+
+  auto file_prefix = service_mode ? "moonlight_hdr_launcher_service"s : "moonlight_hdr_launcher"s;
+  auto log_path = pwd / fs::path(file_prefix + "_log.txt");
+  // every start keeps the previous logs, the service's log is also capped while it runs
+  Logger logger{log_path, true, FlushPolicy::interval, std::chrono::milliseconds{250}, LogRotation{8 * 1024 * 1024, 5}};
+  crash_logger = &logger;
+  previous_exception_filter = SetUnhandledExceptionFilter(drain_log_on_crash);
+  auto paths = LauncherPaths{pwd};
 
-  sentry_value_t pwd_c = sentry_value_new_breadcrumb("default", "pwd");
-  sentry_value_set_by_key(pwd_c, "message", sentry_value_new_string(pwd.string().c_str()));
-  sentry_add_breadcrumb(pwd_c);
-  sentry_value_t inifile_c = sentry_value_new_breadcrumb("default", "inifile");
-  sentry_value_set_by_key(inifile_c, "message", sentry_value_new_string(inifile.string().c_str()));
-  sentry_add_breadcrumb(inifile_c);
+#ifdef SENTRY_DEBUG
+  // initialised on a thread of its own, reports are spooled and uploaded once the stream is up
+  crash_reporting::start({"https://31576029989d413dbf37509b44ef4ce1@o498001.ingest.sentry.io/5574936", "moonlight_hdr_launcher@"s + MHDRL_VERSION,
+                          fs::temp_directory_path() / "moonlight_hdr_launcher-sentry", fs::temp_directory_path() / "moonlight_hdr_launcher-sentry-spool",
+                          {log_path, paths.inifile}},
+                         logger);
+  crash_reporting::add_breadcrumb("pwd", pwd.string());
+  crash_reporting::add_breadcrumb("inifile", paths.inifile.string());
 #endif
 
-  log("Moonlight HDR Launcher Version "s + std::string(MHDRL_VERSION), logfile);
+  logger.info("Moonlight HDR Launcher Version {}", MHDRL_VERSION);
+  start_flight_recorder(pwd / fs::path(file_prefix + "_flight.bin"), pwd / fs::path(file_prefix + "_crash_report.txt"), 4096, logger);
 
   if (reg_dest_path) {
-    log("Working folder read from registry: "s + pwd.string(), logfile);
+    logger.info("Working folder read from registry: {}", pwd.string());
   }
 
   for (int i = 0; i < argc; ++i) {
-    log(std::string("argv[") + std::to_string(i) + std::string("]: ") + std::string(argv[i]), logfile);
+    logger.info("argv[{}]: {}", i, argv[i]);
   }
 
   int retcode = 1;
@@ -230,173 +288,57 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PSTR lpCmdLine,
   try
 #endif
   {
-    log("Setting current working directory to "s + pwd.string(), logfile);
+    logger.info("Setting current working directory to {}", pwd.string());
     fs::current_path(pwd);
 
-    std::string launcher_exe;
-    bool wait_on_process = true;
-    bool toggle_hdr = false;
-    uint16_t res_x = 0;
-    uint16_t res_y = 0;
-    uint16_t refresh_rate = 0;
-    bool refresh_rate_use_max = true;
-    bool remote_desktop = false;
-    bool compatibility_window = true;
-
-    if (fs::exists(inifile)) {
-      log("Found config file: "s + inifile.string(), logfile);
-
-      std::ifstream ini_f{inifile.c_str()};
-      pt::ptree ini;
-      pt::read_ini(ini_f, ini);
-
-      launcher_exe = ini.get_optional<std::string>("options.launcher_exe").get_value_or(launcher_exe);
-      wait_on_process = ini.get_optional<bool>("options.wait_on_process").get_value_or(wait_on_process);
-      toggle_hdr = ini.get_optional<bool>("options.toggle_hdr").get_value_or(toggle_hdr);
-      res_x = ini.get_optional<uint16_t>("options.res_x").get_value_or(res_x);
-      res_y = ini.get_optional<uint16_t>("options.res_y").get_value_or(res_y);
-      refresh_rate = ini.get_optional<uint16_t>("options.refresh_rate").get_value_or(refresh_rate);
-      refresh_rate_use_max = ini.get_optional<bool>("options.refresh_rate_use_max").get_value_or(refresh_rate_use_max);
-      remote_desktop = ini.get_optional<bool>("options.remote_desktop").get_value_or(remote_desktop);
-      compatibility_window = ini.get_optional<bool>("options.compatibility_window").get_value_or(compatibility_window);
-      if (launcher_exe != ""s) {
-        if (remote_desktop) {
-          log("remote_desktop and launcher_exe both specified, defaulting to launcher_exe"s, logfile);
-        }
-        remote_desktop = false;
-      }
-      if (!remote_desktop && launcher_exe == ""s) {
-        launcher_exe = default_launcher;
-      }
-      if (remote_desktop && !compatibility_window) {
-        log("compatibility_window required for remote_desktop, setting to true"s, logfile);
-        compatibility_window = true;
-      }
-
-      log("options.launcher_exe="s + launcher_exe, logfile);
-      log("options.wait_on_process="s + std::to_string(wait_on_process), logfile);
-      log("options.toggle_hdr="s + std::to_string(toggle_hdr), logfile);
-
-#ifdef SENTRY_DEBUG
-      sentry_value_t le_c = sentry_value_new_breadcrumb("default", "launcher_exe");
-      sentry_value_set_by_key(le_c, "message", sentry_value_new_string(launcher_exe.c_str()));
-      sentry_add_breadcrumb(le_c);
-#endif
-    }
-
-    // set display mode
-    std::optional<DEVMODE> original_display_mode;
-    if (res_x != 0 && res_y != 0) {
-      original_display_mode = get_primary_display_registry_settings();
-      log("Original display mode: "s + std::to_string(original_display_mode->dmPelsWidth) + "x"s + std::to_string(original_display_mode->dmPelsHeight) + "@"s +
-              std::to_string(original_display_mode->dmDisplayFrequency),
-          logfile);
-      log("Setting display mode: "s + std::to_string(res_x) + "x"s + std::to_string(res_y) + "@"s + std::to_string(refresh_rate), logfile);
-      set_resolution(res_x, res_y, refresh_rate, wait_on_process, refresh_rate_use_max, [&logfile](std::string a) -> void { log(a, logfile); });
-    }
-
-    if (wait_on_process) {
-      std::atomic_bool dummy_window_ready = {false};
-      std::unique_ptr<DummyWindow> dummy_window;
-      std::thread dummy_window_thread = std::thread([&]() {
-        if (compatibility_window) {
-          dummy_window = std::make_unique<DummyWindow>(hInstance, nCmdShow);
-          dummy_window_ready.store(true);
-          if (dummy_window) {
-            dummy_window->message_loop();
-          }
-        } else {
-          dummy_window_ready.store(true);
-        }
-      });
-
-      std::optional<HdrToggle> hdr_toggle;
-      if (toggle_hdr) {
-        log("Attempting to set HDR mode", logfile);
-#ifndef SENTRY_DEBUG
-        try
-#endif
-        {
-          hdr_toggle = HdrToggle{};
-          if (!hdr_toggle->set_hdr_mode(true)) {
-            log("Failed to set HDR mode", logfile);
-          }
-        }
-#ifndef SENTRY_DEBUG
-        catch (NvapiException &e) {
-          log("Failed to set HDR mode: "s + e.what(), logfile);
-        }
-#endif
-      }
-
-      if (dummy_window_ready == false) {
-        dummy_window_ready.wait(true);
-      }
-      if (remote_desktop) {
-        log("Running in remote desktop mode"s, logfile);
-      } else {
-        log("Launching '"s + launcher_exe + "' and waiting for it to complete."s, logfile);
-        bp::ipstream is; // reading pipe-stream
-        try {
-          auto c = bp::child{launcher_exe, bp::std_out > is, bp::std_err > is};
-          while (c.running()) {
-            std::string line;
-            if (std::getline(is, line) && !line.empty()) {
-              log("SUBPROCESS: "s + line, logfile);
+    LauncherState state{paths, logger};
+    replay_restore_journals(state, logger);
+    if (service_mode) {
+      trace::disable();
+      logger.info("Running as launcher service");
+      NamedPipeListener listener{launcher_service_pipe};
+      serve_sessions(
+          listener,
+          [&](const SessionRequest &request, const std::function<void(bool)> &started) {
+            auto trace_requested = std::find(request.args.begin(), request.args.end(), "--trace") != request.args.end();
+            trace::enable();
+            int session_retcode = 1;
+            try {
+              session_retcode = run_session(state, SessionWindow{started, []() {}, [](std::function<void()>) { return false; }}, trace_requested, logger);
+            } catch (std::exception &e) {
+              logger.error("Error: {}", e.what());
+            } catch (...) {
+              logger.error("Unknown error");
             }
-          }
-          c.wait();
-          if (c.exit_code() != 0) {
-            log(std::string("The command \"") + launcher_exe + std::string("\" has terminated with exit code ") + std::to_string(c.exit_code()), logfile);
-          }
-        } catch (bp::process_error const &e) {
-          log("Error executing command. Error code: "s + std::to_string(e.code().value()) + ", message: " + e.code().message(), logfile);
-#ifdef SENTRY_DEBUG
-          sentry_value_t exc = sentry_value_new_object();
-          sentry_value_set_by_key(exc, "type", sentry_value_new_string("bp::process_error"));
-          sentry_value_set_by_key(exc, "code", sentry_value_new_int32(e.code().value()));
-
-          sentry_value_t event = sentry_value_new_event();
-          sentry_value_set_by_key(event, "exception", exc);
-          sentry_capture_event(event);
-#endif
-        }
-      }
-      if (dummy_window) {
-        dummy_window->close();
-      }
-      dummy_window_thread.join();
-
-      if (toggle_hdr) {
-        log("Attempting to disable HDR mode", logfile);
-        try {
-          hdr_toggle->set_hdr_mode(false);
-        } catch (NvapiException &e) {
-          log("Failed to disable HDR mode: "s + e.what(), logfile);
-        }
-      }
-      if (original_display_mode) {
-        log("Resetting to original display mode", logfile);
-        _ChangeDisplaySettings(&original_display_mode.value(), CDS_UPDATEREGISTRY);
-      }
+            // one trace per session
+            write_session_trace(pwd, logger);
+            trace::disable();
+            return session_retcode;
+          },
+          logger);
     } else {
-      log("Launching '"s + launcher_exe + "' and detaching immediately."s, logfile);
-      bp::spawn(launcher_exe);
+      CompatibilityWindow window{hInstance, nCmdShow};
+      retcode = run_session(state, window.session_window(), has_arg("--trace"), logger);
     }
-    retcode = 0;
   }
 #ifndef SENTRY_DEBUG
   catch (std::runtime_error &e) {
-    log("Error: "s + std::string(e.what()), logfile);
+    logger.error("Error: {}", e.what());
   } catch (std::exception &e) {
-    log("Error: "s + std::string(e.what()), logfile);
+    logger.error("Error: {}", e.what());
   } catch (...) {
-    log("Unknown error", logfile);
+    logger.error("Unknown error");
   }
 #endif
 
+  if (!service_mode) {
+    write_session_trace(pwd, logger);
+  }
+  // a crash or a kill leaves the flight recorder unmarked, the next start reports it
+  flight::detach(true);
+
 #ifdef SENTRY_DEBUG
-  sentry_shutdown();
+  crash_reporting::shutdown();
 #endif
 
   return retcode;
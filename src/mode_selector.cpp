@@ -0,0 +1,76 @@
+#include "mode_selector.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// scores closer than this are considered equal and decided by the tie-break rule
+constexpr double score_epsilon = 1e-9;
+
+double log_ratio(double a, double b) { return std::abs(std::log(a / b)); }
+
+double refresh_rate_penalty(uint32_t refresh_rate, const ModeRequest &request) {
+  if (refresh_rate == 0) {
+    return 0.0;
+  }
+  double penalty = 0.0;
+  if (request.refresh_rate != 0) {
+    penalty += log_ratio(refresh_rate, request.refresh_rate);
+  }
+  if (request.stream_frame_rate != 0) {
+    if (refresh_rate < request.stream_frame_rate) {
+      penalty += log_ratio(refresh_rate, request.stream_frame_rate);
+    } else {
+      // distance to the nearest integer multiple of the stream frame rate, 0 if the frames line up with refreshes
+      double multiple = static_cast<double>(refresh_rate) / request.stream_frame_rate;
+      penalty += std::abs(multiple - std::round(multiple)) / std::round(multiple);
+    }
+  }
+  return penalty;
+}
+
+bool tie_break_less(const DisplayMode &a, const DisplayMode &b, ModeTieBreak tie_break) {
+  auto pixels_a = static_cast<uint64_t>(a.width) * a.height;
+  auto pixels_b = static_cast<uint64_t>(b.width) * b.height;
+  if (tie_break == ModeTieBreak::higher_refresh_rate) {
+    return std::tie(b.refresh_rate, pixels_b, b.width) < std::tie(a.refresh_rate, pixels_a, a.width);
+  }
+  return std::tie(pixels_b, b.width, b.refresh_rate) < std::tie(pixels_a, a.width, a.refresh_rate);
+}
+} // namespace
+
+double score_display_mode(const DisplayMode &mode, const ModeRequest &request, const ModeSelectionWeights &weights) {
+  if (mode.width == 0 || mode.height == 0) {
+    return HUGE_VAL;
+  }
+  double aspect_penalty = log_ratio(static_cast<double>(mode.width) / mode.height, static_cast<double>(request.width) / request.height);
+  double pixels = static_cast<double>(mode.width) * mode.height;
+  double requested_pixels = static_cast<double>(request.width) * request.height;
+  double pixel_penalty = log_ratio(pixels, requested_pixels);
+  if (pixels < requested_pixels) {
+    pixel_penalty *= weights.undersize;
+  }
+  return weights.aspect_ratio * aspect_penalty + weights.pixel_count * pixel_penalty + weights.refresh_rate * refresh_rate_penalty(mode.refresh_rate, request);
+}
+
+std::optional<DisplayMode> select_display_mode(std::span<const DisplayMode> modes, const ModeRequest &request, const ModeSelectionPolicy &policy) {
+  if (modes.empty() || request.width == 0 || request.height == 0) {
+    return {};
+  }
+  if (request.refresh_rate != 0) {
+    auto exact = std::find(modes.begin(), modes.end(), DisplayMode{request.width, request.height, request.refresh_rate});
+    if (exact != modes.end()) {
+      return *exact;
+    }
+  }
+
+  const DisplayMode *best = nullptr;
+  double best_score = HUGE_VAL;
+  for (const auto &mode : modes) {
+    auto score = score_display_mode(mode, request, policy.weights);
+    if (best == nullptr || score < best_score - score_epsilon || (score <= best_score + score_epsilon && tie_break_less(mode, *best, policy.tie_break))) {
+      best = &mode;
+      best_score = std::min(score, best_score);
+    }
+  }
+  return *best;
+}
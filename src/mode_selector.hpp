@@ -0,0 +1,34 @@
+#pragma once
+#include "display_backend.hpp"
+#include <optional>
+#include <span>
+
+struct ModeRequest {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t refresh_rate = 0;      // 0 if any refresh rate is acceptable
+  uint32_t stream_frame_rate = 0; // 0 if the stream frame rate is unknown
+};
+
+// Penalty weights, a candidate's score is the weighted sum of its penalties and the lowest score wins.
+struct ModeSelectionWeights {
+  double aspect_ratio = 4.0; // |log(aspect ratio / requested aspect ratio)|
+  double pixel_count = 1.0;  // |log(pixels / requested pixels)|
+  double refresh_rate = 2.0; // distance from the requested rate, or from the nearest multiple of the stream frame rate
+  double undersize = 2.0;    // multiplies the pixel count penalty of modes smaller than requested
+};
+
+enum class ModeTieBreak {
+  higher_refresh_rate, // on equal scores prefer the higher refresh rate, then the larger mode
+  larger_mode          // on equal scores prefer the larger mode, then the higher refresh rate
+};
+
+struct ModeSelectionPolicy {
+  ModeSelectionWeights weights;
+  ModeTieBreak tie_break = ModeTieBreak::higher_refresh_rate;
+};
+
+double score_display_mode(const DisplayMode &mode, const ModeRequest &request, const ModeSelectionWeights &weights);
+
+// Picks the best available mode for the request: an exact match if there is one, otherwise the lowest scoring mode.
+std::optional<DisplayMode> select_display_mode(std::span<const DisplayMode> modes, const ModeRequest &request, const ModeSelectionPolicy &policy = {});
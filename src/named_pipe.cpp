@@ -0,0 +1,115 @@
+#include "named_pipe.hpp"
+#include "event_loop.hpp"
+#include <system_error>
+
+namespace {
+IpcError last_error(const char *what) { return IpcError(std::string(what) + ": " + std::system_category().message(static_cast<int>(GetLastError()))); }
+
+// Waits for the overlapped operation to complete, or cancels it and returns false once closed_event is set.
+bool wait_overlapped(HANDLE handle, OVERLAPPED &overlapped, HANDLE closed_event) {
+  if (!closed_event) {
+    return WaitForSingleObject(overlapped.hEvent, INFINITE) == WAIT_OBJECT_0;
+  }
+  HANDLE events[] = {overlapped.hEvent, closed_event};
+  if (WaitForMultipleObjects(2, events, FALSE, INFINITE) == WAIT_OBJECT_0) {
+    return true;
+  }
+  CancelIoEx(handle, &overlapped);
+  DWORD ignored;
+  GetOverlappedResult(handle, &overlapped, &ignored, TRUE);
+  return false;
+}
+} // namespace
+
+NamedPipeChannel::NamedPipeChannel(HANDLE pipe, bool server, HANDLE closed_event, EventLoop *loop)
+    : m_pipe{pipe}, m_server{server}, m_closed_event{closed_event}, m_loop{loop}, m_io_event{CreateEventW(nullptr, TRUE, FALSE, nullptr)} {}
+
+NamedPipeChannel::~NamedPipeChannel() {
+  if (m_server) {
+    // let the client read the last reply, unless the listener is shutting down
+    if (!m_closed_event || WaitForSingleObject(m_closed_event, 0) != WAIT_OBJECT_0) {
+      FlushFileBuffers(m_pipe);
+    }
+    DisconnectNamedPipe(m_pipe);
+  }
+  CloseHandle(m_pipe);
+  CloseHandle(m_io_event);
+}
+
+std::unique_ptr<NamedPipeChannel> NamedPipeChannel::connect(const std::wstring &name, EventLoop *loop) {
+  auto pipe = CreateFileW(name.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING,
+                          FILE_FLAG_OVERLAPPED | SECURITY_SQOS_PRESENT | SECURITY_IDENTIFICATION, nullptr);
+  if (pipe == INVALID_HANDLE_VALUE) {
+    return nullptr;
+  }
+  return std::make_unique<NamedPipeChannel>(pipe, false, nullptr, loop);
+}
+
+DWORD NamedPipeChannel::transfer(bool reading, char *data, DWORD size) {
+  OVERLAPPED overlapped{};
+  overlapped.hEvent = m_io_event;
+  ResetEvent(m_io_event);
+  auto started = reading ? ReadFile(m_pipe, data, size, nullptr, &overlapped) : WriteFile(m_pipe, data, size, nullptr, &overlapped);
+  if (!started && GetLastError() != ERROR_IO_PENDING) {
+    throw last_error(reading ? "ReadFile" : "WriteFile");
+  }
+  if (!started && m_loop) {
+    m_loop->run_until(m_io_event);
+  } else if (!started && !wait_overlapped(m_pipe, overlapped, m_closed_event)) {
+    throw IpcError("listener closed");
+  }
+  DWORD transferred = 0;
+  if (!GetOverlappedResult(m_pipe, &overlapped, &transferred, FALSE)) {
+    throw last_error(reading ? "ReadFile" : "WriteFile");
+  }
+  return transferred;
+}
+
+void NamedPipeChannel::write(const char *data, size_t size) {
+  while (size > 0) {
+    auto written = transfer(false, const_cast<char *>(data), static_cast<DWORD>(size));
+    data += written;
+    size -= written;
+  }
+}
+
+void NamedPipeChannel::read(char *data, size_t size) {
+  while (size > 0) {
+    auto read = transfer(true, data, static_cast<DWORD>(size));
+    if (read == 0) {
+      throw IpcError("pipe closed");
+    }
+    data += read;
+    size -= read;
+  }
+}
+
+NamedPipeListener::NamedPipeListener(std::wstring name) : m_name{std::move(name)}, m_closed_event{CreateEventW(nullptr, TRUE, FALSE, nullptr)} {}
+
+NamedPipeListener::~NamedPipeListener() { CloseHandle(m_closed_event); }
+
+std::unique_ptr<IpcChannel> NamedPipeListener::accept() {
+  if (WaitForSingleObject(m_closed_event, 0) == WAIT_OBJECT_0) {
+    throw IpcError("listener closed");
+  }
+  // a single instance that is recreated for every client; FILE_FLAG_FIRST_PIPE_INSTANCE fails if another process owns the name
+  auto pipe = CreateNamedPipeW(m_name.c_str(), PIPE_ACCESS_DUPLEX | FILE_FLAG_FIRST_PIPE_INSTANCE | FILE_FLAG_OVERLAPPED,
+                               PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS, 1, max_ipc_frame_size,
+                               max_ipc_frame_size, 0, nullptr);
+  if (pipe == INVALID_HANDLE_VALUE) {
+    throw last_error("CreateNamedPipe");
+  }
+  OVERLAPPED overlapped{};
+  overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+  bool connected = ConnectNamedPipe(pipe, &overlapped) || GetLastError() == ERROR_PIPE_CONNECTED;
+  if (!connected && GetLastError() == ERROR_IO_PENDING && wait_overlapped(pipe, overlapped, m_closed_event)) {
+    DWORD ignored;
+    connected = GetOverlappedResult(pipe, &overlapped, &ignored, FALSE);
+  }
+  CloseHandle(overlapped.hEvent);
+  if (!connected) {
+    CloseHandle(pipe);
+    throw IpcError("no client connected");
+  }
+  return std::make_unique<NamedPipeChannel>(pipe, true, m_closed_event);
+}
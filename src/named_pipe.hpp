@@ -0,0 +1,53 @@
+#pragma once
+#include "ipc.hpp"
+#include "windows.h"
+#include <memory>
+#include <string>
+
+class EventLoop;
+
+constexpr auto launcher_service_pipe = L"\\\\.\\pipe\\moonlight_hdr_launcher";
+constexpr auto session_control_pipe = L"\\\\.\\pipe\\moonlight_hdr_launcher_control";
+
+// One end of a byte-mode named pipe connection. I/O is overlapped so that a server side channel gives up as soon as
+// its listener is closed, and so that a client channel with an event loop keeps its thread's windows responsive.
+class NamedPipeChannel : public IpcChannel {
+public:
+  NamedPipeChannel(HANDLE pipe, bool server, HANDLE closed_event = nullptr, EventLoop *loop = nullptr);
+  NamedPipeChannel(const NamedPipeChannel &) = delete;
+  NamedPipeChannel &operator=(const NamedPipeChannel &) = delete;
+  ~NamedPipeChannel() override;
+
+  // Returns nullptr when nobody is listening or the listener is busy with another client.
+  // Blocking reads and writes run the loop, if given, until they complete.
+  static std::unique_ptr<NamedPipeChannel> connect(const std::wstring &name, EventLoop *loop = nullptr);
+
+  void write(const char *data, size_t size) override;
+  void read(char *data, size_t size) override;
+
+private:
+  DWORD transfer(bool reading, char *data, DWORD size);
+
+  HANDLE m_pipe;
+  bool m_server;
+  HANDLE m_closed_event;
+  EventLoop *m_loop;
+  HANDLE m_io_event;
+};
+
+// Serves one client at a time: while a client is connected there is no listening instance, so other clients are
+// turned away immediately instead of queueing. The listener has to outlive the channels it accepted.
+class NamedPipeListener : public IpcListener {
+public:
+  explicit NamedPipeListener(std::wstring name);
+  NamedPipeListener(const NamedPipeListener &) = delete;
+  NamedPipeListener &operator=(const NamedPipeListener &) = delete;
+  ~NamedPipeListener() override;
+
+  std::unique_ptr<IpcChannel> accept() override;
+  void close() override { SetEvent(m_closed_event); }
+
+private:
+  std::wstring m_name;
+  HANDLE m_closed_event;
+};
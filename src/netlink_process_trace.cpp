@@ -0,0 +1,94 @@
+#include "netlink_process_trace.hpp"
+#include "event_loop.hpp"
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <linux/cn_proc.h>
+#include <linux/connector.h>
+#include <linux/netlink.h>
+#include <sys/socket.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace {
+std::system_error last_error(const char *what) { return std::system_error(errno, std::generic_category(), what); }
+
+std::string process_image_path(pid_t pid) {
+  std::error_code error;
+  return std::filesystem::read_symlink("/proc/" + std::to_string(pid) + "/exe", error).string();
+}
+
+void set_listening(int socket, bool listen) {
+  // a netlink header, then the connector message with the operation as its payload
+  alignas(nlmsghdr) char request[NLMSG_SPACE(sizeof(cn_msg) + sizeof(proc_cn_mcast_op))]{};
+  auto header = reinterpret_cast<nlmsghdr *>(request);
+  header->nlmsg_len = NLMSG_LENGTH(sizeof(cn_msg) + sizeof(proc_cn_mcast_op));
+  header->nlmsg_type = NLMSG_DONE;
+  auto message = static_cast<cn_msg *>(NLMSG_DATA(header));
+  message->id = {CN_IDX_PROC, CN_VAL_PROC};
+  message->len = sizeof(proc_cn_mcast_op);
+  proc_cn_mcast_op operation = listen ? PROC_CN_MCAST_LISTEN : PROC_CN_MCAST_IGNORE;
+  std::memcpy(message->data, &operation, sizeof(operation));
+  if (send(socket, request, header->nlmsg_len, 0) < 0) {
+    throw last_error("send");
+  }
+}
+} // namespace
+
+NetlinkProcessTrace::NetlinkProcessTrace(EventLoop &loop, Handler on_started) : m_loop{loop}, m_on_started{std::move(on_started)} {
+  m_socket = socket(PF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_CONNECTOR);
+  if (m_socket < 0) {
+    throw last_error("socket");
+  }
+  try {
+    sockaddr_nl address{};
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = CN_IDX_PROC;
+    if (bind(m_socket, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+      throw last_error("bind");
+    }
+    set_listening(m_socket, true);
+    m_loop.watch(m_socket, [this]() { receive(); });
+  } catch (...) {
+    close(m_socket);
+    throw;
+  }
+}
+
+NetlinkProcessTrace::~NetlinkProcessTrace() {
+  m_loop.unwatch(m_socket);
+  try {
+    set_listening(m_socket, false);
+  } catch (std::system_error &) {
+    // closing the socket unsubscribes as well
+  }
+  close(m_socket);
+}
+
+void NetlinkProcessTrace::receive() {
+  alignas(nlmsghdr) char buffer[8192];
+  for (;;) {
+    auto size = recv(m_socket, buffer, sizeof(buffer), 0);
+    if (size < 0 && errno == ENOBUFS) {
+      m_overrun = true;
+      continue;
+    }
+    if (size <= 0) {
+      // EAGAIN: drained until the next event
+      return;
+    }
+    for (auto header = reinterpret_cast<nlmsghdr *>(buffer); NLMSG_OK(header, size); header = NLMSG_NEXT(header, size)) {
+      auto message = static_cast<cn_msg *>(NLMSG_DATA(header));
+      if (message->id.idx != CN_IDX_PROC || message->len < sizeof(proc_event)) {
+        continue;
+      }
+      proc_event event;
+      std::memcpy(&event, message->data, sizeof(event));
+      if (event.what == proc_event::PROC_EVENT_EXEC) {
+        // looked up right away, a short-lived process may be gone by the next event
+        auto pid = static_cast<pid_t>(event.event_data.exec.process_tgid);
+        m_on_started(pid, process_image_path(pid));
+      }
+    }
+  }
+}
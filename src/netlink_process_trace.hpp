@@ -0,0 +1,33 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <sys/types.h>
+
+class EventLoop;
+
+// The Linux counterpart of ProcessStartTrace: reports every program started on the system, as the kernel announces
+// its exec through the netlink process connector. The socket is watched by the event loop, so the handler runs on the
+// loop's thread, as soon as the event arrives.
+class NetlinkProcessTrace {
+public:
+  // The image path is empty if the process was gone before it could be looked up.
+  using Handler = std::function<void(pid_t pid, const std::string &image_path)>;
+
+  // Throws std::system_error if the connector cannot be subscribed to, it needs CAP_NET_ADMIN and only reports
+  // processes to the initial network namespace.
+  NetlinkProcessTrace(EventLoop &loop, Handler on_started);
+  NetlinkProcessTrace(const NetlinkProcessTrace &) = delete;
+  NetlinkProcessTrace &operator=(const NetlinkProcessTrace &) = delete;
+  ~NetlinkProcessTrace();
+
+  // Events the kernel dropped because the socket's buffer was full.
+  bool overrun() const { return m_overrun; }
+
+private:
+  void receive();
+
+  EventLoop &m_loop;
+  Handler m_on_started;
+  int m_socket = -1;
+  bool m_overrun = false;
+};
@@ -0,0 +1,131 @@
+#include "nvapi_hdr_backend.hpp"
+#include "trace.hpp"
+#include <cmath>
+#include <string>
+
+bool _check_status(const NvAPI_Status &s, const std::string &message, bool should_raise) {
+  if (s != NVAPI_OK) {
+    NvAPI_ShortString err_msg;
+    if (NvAPI_GetErrorMessage(s, err_msg) != NVAPI_OK) {
+      if (should_raise) {
+        throw NvapiException(message + std::string("Failed to get NVAPI error message"));
+      } else {
+        return false;
+      }
+    }
+    if (should_raise) {
+      throw NvapiException(message + std::string("NVAPI Error") + std::string(err_msg));
+    } else {
+      return false;
+    }
+  } else {
+    return true;
+  }
+}
+
+NvapiHdrBackend::Library::Library() {
+  TRACE_SCOPE("NvAPI_Initialize");
+  check_status(NvAPI_Initialize());
+}
+
+NvapiHdrBackend::Library::~Library() { check_status_nothrow(NvAPI_Unload()); }
+
+NvapiHdrBackend::NvapiHdrBackend() {
+  m_gpu_handles.resize(NVAPI_MAX_PHYSICAL_GPUS);
+  NvU32 num_of_gpus = 0;
+  check_status(NvAPI_EnumPhysicalGPUs(m_gpu_handles.data(), &num_of_gpus));
+  m_gpu_handles.resize(num_of_gpus);
+}
+
+void NvapiHdrBackend::calc_mastering_data(NV_HDR_COLOR_DATA *hdr_data) {
+  double rx = 0.64;
+  double ry = 0.33;
+  double gx = 0.30;
+  double gy = 0.60;
+  double bx = 0.15;
+  double by = 0.06;
+  double wx = 0.3127;
+  double wy = 0.3290;
+  double min_master = 1.0;
+  double max_master = 1000;
+  double max_cll = 1000;
+  double max_fall = 100;
+
+  hdr_data->mastering_display_data.displayPrimary_x0 = (NvU16)ceil(rx * 0xC350 + 0.5);
+  hdr_data->mastering_display_data.displayPrimary_y0 = (NvU16)ceil(ry * 0xC350 + 0.5);
+  hdr_data->mastering_display_data.displayPrimary_x1 = (NvU16)ceil(gx * 0xC350 + 0.5);
+  hdr_data->mastering_display_data.displayPrimary_y1 = (NvU16)ceil(gy * 0xC350 + 0.5);
+  hdr_data->mastering_display_data.displayPrimary_x2 = (NvU16)ceil(bx * 0xC350 + 0.5);
+  hdr_data->mastering_display_data.displayPrimary_y2 = (NvU16)ceil(by * 0xC350 + 0.5);
+  hdr_data->mastering_display_data.displayWhitePoint_x = (NvU16)ceil(wx * 0xC350 + 0.5);
+  hdr_data->mastering_display_data.displayWhitePoint_y = (NvU16)ceil(wy * 0xC350 + 0.5);
+  hdr_data->mastering_display_data.max_content_light_level = (NvU16)ceil(max_cll + 0.5);
+  hdr_data->mastering_display_data.max_display_mastering_luminance = (NvU16)ceil(max_master + 0.5);
+  hdr_data->mastering_display_data.max_frame_average_light_level = (NvU16)ceil(max_fall + 0.5);
+  hdr_data->mastering_display_data.min_display_mastering_luminance = (NvU16)ceil(min_master * 10000.0 + 0.5);
+}
+
+NV_HDR_COLOR_DATA NvapiHdrBackend::set_hdr_data(bool enabled) {
+  NV_HDR_COLOR_DATA color = {0};
+
+  color.version = NV_HDR_COLOR_DATA_VER;
+  color.cmd = NV_HDR_CMD_SET;
+
+  if (enabled) {
+    color.hdrColorFormat = NV_COLOR_FORMAT_RGB;
+    color.hdrBpc = NV_BPC_8;
+  }
+
+  color.hdrDynamicRange = NV_DYNAMIC_RANGE_AUTO;
+  color.hdrMode = enabled ? NV_HDR_MODE_UHDA : NV_HDR_MODE_OFF;
+
+  calc_mastering_data(&color);
+
+  return color;
+}
+
+std::string NvapiHdrBackend::driver_version() {
+  NvU32 driver_version = 0;
+  NvAPI_ShortString branch;
+  check_status(NvAPI_SYS_GetDriverAndBranchVersion(&driver_version, branch));
+  return std::to_string(driver_version) + "/" + std::string(branch);
+}
+
+uint32_t NvapiHdrBackend::gpu_count() { return static_cast<uint32_t>(m_gpu_handles.size()); }
+
+std::vector<uint32_t> NvapiHdrBackend::connected_display_ids(uint32_t gpu_index) {
+  NvU32 disp_id_count = 0;
+  check_status(NvAPI_GPU_GetConnectedDisplayIds(m_gpu_handles.at(gpu_index), NULL, &disp_id_count, NULL));
+
+  auto disp_ids = std::vector<NV_GPU_DISPLAYIDS>(disp_id_count);
+  for (auto &disp_id : disp_ids) {
+    disp_id.version = NV_GPU_DISPLAYIDS_VER;
+  }
+  check_status(NvAPI_GPU_GetConnectedDisplayIds(m_gpu_handles.at(gpu_index), disp_ids.data(), &disp_id_count, NULL));
+
+  std::vector<uint32_t> display_ids;
+  for (NvU32 i = 0; i < disp_id_count; ++i) {
+    display_ids.push_back(disp_ids[i].displayId);
+  }
+  return display_ids;
+}
+
+bool NvapiHdrBackend::is_hdr_supported(uint32_t display_id) {
+  NV_HDR_CAPABILITIES hdr_capabilities = {0};
+  hdr_capabilities.version = NV_HDR_CAPABILITIES_VER;
+  check_status(NvAPI_Disp_GetHdrCapabilities(display_id, &hdr_capabilities));
+  return hdr_capabilities.isST2084EotfSupported == 1;
+}
+
+bool NvapiHdrBackend::is_hdr_enabled(uint32_t display_id) {
+  NV_HDR_COLOR_DATA color = {0};
+  color.version = NV_HDR_COLOR_DATA_VER;
+  color.cmd = NV_HDR_CMD_GET;
+  check_status(NvAPI_Disp_HdrColorControl(display_id, &color));
+  return color.hdrMode != NV_HDR_MODE_OFF;
+}
+
+void NvapiHdrBackend::set_hdr_mode(uint32_t display_id, bool enabled) {
+  auto color = set_hdr_data(enabled);
+  check_status(NvAPI_Disp_HdrColorControl(display_id, &color));
+}
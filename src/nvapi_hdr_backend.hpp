@@ -0,0 +1,43 @@
+#pragma once
+#include "hdr_backend.hpp"
+#include <nvapi.h>
+
+bool _check_status(const NvAPI_Status &s, const std::string &message, bool should_raise = true);
+#define check_status(s) _check_status(s, std::string(__func__) + "," + std::to_string(__LINE__) + ": ");
+#define check_status_nothrow(s) _check_status(s, std::string(__func__) + "," + std::to_string(__LINE__) + ": ", false);
+
+struct NvapiException : public HdrError {
+  explicit NvapiException(const std::string &what) : HdrError(what) {}
+  explicit NvapiException(const char *what) : HdrError(what) {}
+};
+
+class NvapiHdrBackend : public HdrBackend {
+public:
+  NvapiHdrBackend();
+  NvapiHdrBackend(const NvapiHdrBackend &) = delete;
+  NvapiHdrBackend &operator=(const NvapiHdrBackend &) = delete;
+  virtual ~NvapiHdrBackend() = default;
+
+  std::string driver_version() override;
+  uint32_t gpu_count() override;
+  std::vector<uint32_t> connected_display_ids(uint32_t gpu_index) override;
+  bool is_hdr_supported(uint32_t display_id) override;
+  bool is_hdr_enabled(uint32_t display_id) override;
+  void set_hdr_mode(uint32_t display_id, bool enabled) override;
+
+private:
+  // NVAPI stays loaded while this is alive, it is a member so that NVAPI is also unloaded when enumerating the GPUs
+  // in the constructor throws.
+  struct Library {
+    Library();
+    Library(const Library &) = delete;
+    Library &operator=(const Library &) = delete;
+    ~Library();
+  };
+
+  NV_HDR_COLOR_DATA set_hdr_data(bool enabled);
+  void calc_mastering_data(NV_HDR_COLOR_DATA *hdr_data);
+
+  Library m_library;
+  std::vector<NvPhysicalGpuHandle> m_gpu_handles;
+};
@@ -0,0 +1,125 @@
+#include "output_filter.hpp"
+#include <algorithm>
+
+namespace {
+uint64_t fnv1a(std::string_view text) {
+  uint64_t hash = 14695981039346656037ull;
+  for (auto c : text) {
+    hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+  }
+  return hash;
+}
+} // namespace
+
+OutputTail::OutputTail(size_t capacity) : m_buffer(capacity) {}
+
+void OutputTail::append(OutputStream stream, std::string_view line) {
+  if (m_buffer.empty()) {
+    return;
+  }
+  if (stream == OutputStream::err) {
+    write("stderr: ");
+  }
+  write(line);
+  write("\n");
+}
+
+void OutputTail::write(std::string_view bytes) {
+  // only the last capacity bytes of a line longer than the buffer survive anyway
+  if (bytes.size() > m_buffer.size()) {
+    bytes.remove_prefix(bytes.size() - m_buffer.size());
+  }
+  auto first = std::min(bytes.size(), m_buffer.size() - m_next);
+  std::copy_n(bytes.data(), first, m_buffer.data() + m_next);
+  std::copy_n(bytes.data() + first, bytes.size() - first, m_buffer.data());
+  m_next += bytes.size();
+  if (m_next >= m_buffer.size()) {
+    m_next -= m_buffer.size();
+    m_wrapped = true;
+  }
+}
+
+std::string OutputTail::contents() const {
+  if (!m_wrapped) {
+    return std::string(m_buffer.data(), m_next);
+  }
+  std::string text(m_buffer.data() + m_next, m_buffer.size() - m_next);
+  text.append(m_buffer.data(), m_next);
+  // the oldest line was partly overwritten
+  auto eol = text.find('\n');
+  text.erase(0, eol == std::string::npos ? text.size() : eol + 1);
+  return text;
+}
+
+OutputFilter::OutputFilter(OutputLimits limits, log_handler on_log) : m_limits{limits}, m_on_log{std::move(on_log)}, m_tail{limits.tail_bytes} {
+  if (m_limits.sample_every == 0) {
+    m_limits.sample_every = 1;
+  }
+}
+
+void OutputFilter::line(OutputStream stream, std::string_view text, clock::time_point now) {
+  m_tail.append(stream, text);
+  auto &state = state_of(stream);
+  auto hash = fnv1a(text);
+  if (state.has_last && state.last_hash == hash && state.last_size == text.size()) {
+    ++state.repeats;
+    ++m_dropped;
+    return;
+  }
+  if (state.repeats != 0) {
+    if (admit(stream, state, now)) {
+      flush_repeats(stream, state);
+    } else {
+      state.sampled_out += state.repeats;
+      state.repeats = 0;
+    }
+  }
+  state.last_hash = hash;
+  state.last_size = text.size();
+  state.has_last = true;
+
+  if (!admit(stream, state, now)) {
+    ++state.sampled_out;
+    ++m_dropped;
+    return;
+  }
+  m_on_log(stream, text);
+}
+
+bool OutputFilter::admit(OutputStream stream, StreamState &state, clock::time_point now) {
+  if (m_limits.lines_per_second == 0) {
+    return true;
+  }
+  if (now - state.window_start >= std::chrono::seconds{1}) {
+    flush_sampled(stream, state);
+    state.window_start = now;
+    state.window_lines = 0;
+  }
+  if (++state.window_lines <= m_limits.lines_per_second) {
+    return true;
+  }
+  return (state.window_lines - m_limits.lines_per_second) % m_limits.sample_every == 0;
+}
+
+void OutputFilter::flush() {
+  for (auto stream : {OutputStream::out, OutputStream::err}) {
+    auto &state = state_of(stream);
+    flush_repeats(stream, state);
+    flush_sampled(stream, state);
+    state.has_last = false;
+  }
+}
+
+void OutputFilter::flush_repeats(OutputStream stream, StreamState &state) {
+  if (state.repeats != 0) {
+    m_on_log(stream, "(previous line repeated " + std::to_string(state.repeats) + " more times)");
+    state.repeats = 0;
+  }
+}
+
+void OutputFilter::flush_sampled(OutputStream stream, StreamState &state) {
+  if (state.sampled_out != 0) {
+    m_on_log(stream, "(" + std::to_string(state.sampled_out) + " lines over the rate limit not logged)");
+    state.sampled_out = 0;
+  }
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class OutputStream { out, err };
+
+// The last `capacity` bytes of child output, kept verbatim in a buffer allocated once.
+class OutputTail {
+public:
+  explicit OutputTail(size_t capacity);
+
+  void append(OutputStream stream, std::string_view line);
+  // Oldest first, starting at the first complete line.
+  std::string contents() const;
+  size_t capacity() const { return m_buffer.size(); }
+
+private:
+  void write(std::string_view bytes);
+
+  std::vector<char> m_buffer;
+  size_t m_next = 0;
+  bool m_wrapped = false;
+};
+
+struct OutputLimits {
+  // per stream, lines beyond this within one second are sampled; 0 logs every line
+  uint32_t lines_per_second = 50;
+  // of the lines beyond the rate, one in sample_every is logged
+  uint32_t sample_every = 100;
+  size_t tail_bytes = 64 * 1024;
+};
+
+// Decides which child output lines reach the log in fixed memory: repeats of the previous line of a stream are
+// collapsed into a count, and above the rate limit only a sample of the lines is logged. Every line still goes
+// into the tail. Summaries ("... repeated 12 times") are passed to the log handler like lines.
+class OutputFilter {
+public:
+  using clock = std::chrono::steady_clock;
+  using log_handler = std::function<void(OutputStream, std::string_view)>;
+
+  OutputFilter(OutputLimits limits, log_handler on_log);
+
+  void line(OutputStream stream, std::string_view text, clock::time_point now = clock::now());
+  // Logs the counts that are still pending, at the end of the session.
+  void flush();
+
+  const OutputTail &tail() const { return m_tail; }
+  // lines that were not logged, repeats included
+  uint64_t dropped() const { return m_dropped; }
+
+private:
+  struct StreamState {
+    uint64_t last_hash = 0;
+    size_t last_size = 0;
+    bool has_last = false;
+    uint64_t repeats = 0;
+    clock::time_point window_start;
+    uint64_t window_lines = 0;
+    uint64_t sampled_out = 0;
+  };
+
+  // Counts a log entry against the rate limit of the stream, false if it is sampled out.
+  bool admit(OutputStream stream, StreamState &state, clock::time_point now);
+  void flush_repeats(OutputStream stream, StreamState &state);
+  void flush_sampled(OutputStream stream, StreamState &state);
+  StreamState &state_of(OutputStream stream) { return m_streams[stream == OutputStream::err ? 1 : 0]; }
+
+  OutputLimits m_limits;
+  log_handler m_on_log;
+  OutputTail m_tail;
+  StreamState m_streams[2];
+  uint64_t m_dropped = 0;
+};
@@ -0,0 +1,137 @@
+#include "posix_http_transport.hpp"
+#include <cerrno>
+#include <charconv>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <string_view>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+class Socket {
+public:
+  explicit Socket(int fd) : m_fd{fd} {}
+  Socket(const Socket &) = delete;
+  Socket &operator=(const Socket &) = delete;
+  ~Socket() {
+    if (m_fd >= 0) {
+      ::close(m_fd);
+    }
+  }
+  int get() const { return m_fd; }
+
+private:
+  int m_fd;
+};
+
+bool wait_ready(int fd, short events, std::chrono::milliseconds timeout) {
+  pollfd ready{fd, events, 0};
+  for (;;) {
+    auto result = poll(&ready, 1, static_cast<int>(timeout.count()));
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    return result > 0;
+  }
+}
+
+bool connect_within(int fd, const sockaddr *address, socklen_t size, std::chrono::milliseconds timeout) {
+  if (::connect(fd, address, size) == 0) {
+    return true;
+  }
+  if (errno != EINPROGRESS || !wait_ready(fd, POLLOUT, timeout)) {
+    return false;
+  }
+  int error = 0;
+  socklen_t error_size = sizeof(error);
+  return getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &error_size) == 0 && error == 0;
+}
+
+bool send_all(int fd, std::string_view data, std::chrono::milliseconds timeout) {
+  while (!data.empty()) {
+    if (!wait_ready(fd, POLLOUT, timeout)) {
+      return false;
+    }
+    auto sent = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+    if (sent < 0 && errno == EINTR) {
+      continue;
+    }
+    if (sent <= 0) {
+      return false;
+    }
+    data.remove_prefix(static_cast<size_t>(sent));
+  }
+  return true;
+}
+
+// The status code of the response, 0 if none arrived. Only the status line is read, the connection is closed after.
+int read_status(int fd, std::chrono::milliseconds timeout) {
+  std::string response;
+  char buffer[512];
+  while (response.find("\r\n") == std::string::npos && response.size() < 4096) {
+    if (!wait_ready(fd, POLLIN, timeout)) {
+      return 0;
+    }
+    auto received = ::recv(fd, buffer, sizeof(buffer), 0);
+    if (received < 0 && errno == EINTR) {
+      continue;
+    }
+    if (received <= 0) {
+      break;
+    }
+    response.append(buffer, static_cast<size_t>(received));
+  }
+  // HTTP/1.1 200 OK
+  auto space = response.find(' ');
+  if (!response.starts_with("HTTP/") || space == std::string::npos) {
+    return 0;
+  }
+  int status = 0;
+  auto [end, ec] = std::from_chars(response.data() + space + 1, response.data() + response.size(), status);
+  return ec == std::errc{} ? status : 0;
+}
+} // namespace
+
+UploadResult post_sentry_envelope(const SentryEndpoint &endpoint, const std::string &envelope, std::chrono::milliseconds timeout) {
+  constexpr std::string_view scheme = "http://";
+  std::string_view url = endpoint.url;
+  if (!url.starts_with(scheme)) {
+    return UploadResult::rejected;
+  }
+  url.remove_prefix(scheme.size());
+  auto slash = url.find('/');
+  auto authority = url.substr(0, slash);
+  auto path = slash == std::string_view::npos ? std::string_view{"/"} : url.substr(slash);
+  auto colon = authority.rfind(':');
+  auto host = std::string(authority.substr(0, colon));
+  auto port = colon == std::string_view::npos ? std::string("80") : std::string(authority.substr(colon + 1));
+
+  addrinfo hints{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo *addresses = nullptr;
+  if (getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses) != 0) {
+    return UploadResult::retry_later;
+  }
+  int fd = -1;
+  for (auto address = addresses; address && fd < 0; address = address->ai_next) {
+    fd = ::socket(address->ai_family, address->ai_socktype | SOCK_CLOEXEC | SOCK_NONBLOCK, address->ai_protocol);
+    if (fd >= 0 && !connect_within(fd, address->ai_addr, address->ai_addrlen, timeout)) {
+      ::close(fd);
+      fd = -1;
+    }
+  }
+  freeaddrinfo(addresses);
+  if (fd < 0) {
+    return UploadResult::retry_later;
+  }
+  Socket connection{fd};
+  auto request = "POST " + std::string(path) + " HTTP/1.1\r\nHost: " + std::string(authority) +
+                 "\r\nUser-Agent: moonlight_hdr_launcher\r\nContent-Type: application/x-sentry-envelope\r\nX-Sentry-Auth: " + endpoint.auth +
+                 "\r\nContent-Length: " + std::to_string(envelope.size()) + "\r\nConnection: close\r\n\r\n";
+  if (!send_all(connection.get(), request, timeout) || !send_all(connection.get(), envelope, timeout)) {
+    return UploadResult::retry_later;
+  }
+  return classify_upload_status(read_status(connection.get(), timeout));
+}
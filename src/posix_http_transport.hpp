@@ -0,0 +1,9 @@
+#pragma once
+#include "report_uploader.hpp"
+#include <chrono>
+#include <string>
+
+// The POSIX counterpart of win_http_transport: posts a Sentry envelope over plain HTTP/1.1, so that the uploader can
+// be run against a local HTTP stand-in. There is no TLS, an https endpoint is rejected. The timeout bounds each step
+// of the request, as with WinHTTP.
+UploadResult post_sentry_envelope(const SentryEndpoint &endpoint, const std::string &envelope, std::chrono::milliseconds timeout);
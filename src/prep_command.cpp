@@ -0,0 +1,109 @@
+#include "prep_command.hpp"
+#include <algorithm>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace {
+std::string describe_display(const JournalDisplay &display) {
+  return (display.device.empty() ? std::string("primary display") : display.device) + " " + std::to_string(display.original_mode.width) + "x" +
+         std::to_string(display.original_mode.height) + "@" + std::to_string(display.original_mode.refresh_rate);
+}
+
+bool save_state(const fs::path &path, const RestoreJournal &state) {
+  if (!state.displays.empty()) {
+    return write_journal(path, state);
+  }
+  std::error_code ec;
+  fs::remove(path, ec);
+  return !ec;
+}
+} // namespace
+
+PrepOutcome prep_do(const SessionGoal &goal, const SessionSnapshot &snapshot, const fs::path &state_path, uint32_t pid, PrepTarget &target) {
+  PrepOutcome outcome;
+  auto plan = plan_session(goal, snapshot, {});
+  outcome.messages = describe_session_plan(plan);
+  // a mode that cannot be read cannot be restored either
+  if (plan.find(SessionAction::Kind::set_primary_mode) && !snapshot.primary_mode) {
+    outcome.ok = false;
+    outcome.messages.push_back("the current mode of the primary display is unknown, nothing was changed");
+    return outcome;
+  }
+
+  auto state = read_journal(state_path).value_or(RestoreJournal{});
+  state.owner_pid = pid;
+  std::vector<std::string> recorded;
+  for (const auto &action : plan.actions) {
+    for (const auto &change : action.display_changes) {
+      auto known = std::any_of(state.displays.begin(), state.displays.end(), [&](const JournalDisplay &d) { return d.device == change.device; });
+      if (!known) {
+        state.displays.push_back({change.device, change.original});
+        recorded.push_back(change.device);
+      }
+    }
+  }
+  if (!recorded.empty() && !write_journal(state_path, state)) {
+    outcome.ok = false;
+    outcome.messages.push_back("cannot write " + state_path.string() + ", nothing was changed");
+    return outcome;
+  }
+
+  // only what this --do recorded is forgotten again, the originals of an earlier one still have to be restored
+  auto forget = [&](const std::string &device) {
+    if (std::find(recorded.begin(), recorded.end(), device) != recorded.end()) {
+      std::erase_if(state.displays, [&](const JournalDisplay &d) { return d.device == device; });
+    }
+  };
+  auto changed_state = false;
+  if (auto action = plan.find(SessionAction::Kind::set_primary_mode); action && !target.apply_primary_mode(action->display_changes.front().target)) {
+    outcome.ok = false;
+    outcome.messages.push_back("failed to set the primary display mode");
+    forget("");
+    changed_state = true;
+  }
+  if (auto action = plan.find(SessionAction::Kind::set_display_modes); action && !target.apply_display_modes(action->display_changes)) {
+    outcome.ok = false;
+    outcome.messages.push_back("failed to set the display modes");
+    for (const auto &change : action->display_changes) {
+      forget(change.device);
+    }
+    changed_state = true;
+  }
+  if (changed_state) {
+    save_state(state_path, state);
+  }
+  return outcome;
+}
+
+PrepOutcome prep_undo(const fs::path &state_path, PrepTarget &target) {
+  PrepOutcome outcome;
+  std::error_code ec;
+  if (!fs::exists(state_path, ec)) {
+    outcome.messages.push_back("nothing to undo");
+    return outcome;
+  }
+  auto state = read_journal(state_path);
+  if (!state) {
+    outcome.ok = false;
+    outcome.messages.push_back(state_path.string() + " is damaged, deleting it");
+    fs::remove(state_path, ec);
+    return outcome;
+  }
+
+  auto failed = target.restore_displays(state->displays);
+  for (const auto &display : state->displays) {
+    auto restored = std::find(failed.begin(), failed.end(), display) == failed.end();
+    outcome.messages.push_back((restored ? "restored " : "failed to restore ") + describe_display(display));
+  }
+  state->displays = std::move(failed);
+  if (!state->displays.empty()) {
+    outcome.ok = false;
+    outcome.messages.push_back("kept for the next --undo");
+  }
+  if (!save_state(state_path, *state)) {
+    outcome.ok = false;
+    outcome.messages.push_back("cannot update " + state_path.string());
+  }
+  return outcome;
+}
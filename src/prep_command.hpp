@@ -0,0 +1,36 @@
+#pragma once
+#include "restore_journal.hpp"
+#include "session_plan.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// The prep commands that hosts such as Sunshine run before and after a stream instead of wrapping the game: --do
+// switches the display modes and returns, --undo restores them from a later process. The original modes are kept in
+// a state file in the restore journal format, so undo reads one small file and enumerates nothing.
+
+// What the prep commands need from the platform.
+class PrepTarget {
+public:
+  virtual ~PrepTarget() = default;
+
+  virtual bool apply_primary_mode(const DisplayMode &mode) = 0;
+  // Every display with a single reconfiguration.
+  virtual bool apply_display_modes(const std::vector<DisplayChange> &changes) = 0;
+  // Returns the displays that could not be restored.
+  virtual std::vector<JournalDisplay> restore_displays(const std::vector<JournalDisplay> &displays) = 0;
+};
+
+struct PrepOutcome {
+  bool ok = true;
+  // for the log
+  std::vector<std::string> messages;
+};
+
+// The state file is written before anything changes. The originals of an earlier --do that was not undone are kept,
+// so that --undo returns to the modes from before the first one.
+PrepOutcome prep_do(const SessionGoal &goal, const SessionSnapshot &snapshot, const std::filesystem::path &state_path, uint32_t pid,
+                    PrepTarget &target);
+// What cannot be restored stays in the state file for the next --undo.
+PrepOutcome prep_undo(const std::filesystem::path &state_path, PrepTarget &target);
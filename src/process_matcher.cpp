@@ -0,0 +1,101 @@
+#include "process_matcher.hpp"
+
+namespace {
+std::string_view trim(std::string_view text) {
+  constexpr std::string_view whitespace = " \t";
+  auto first = text.find_first_not_of(whitespace);
+  if (first == std::string_view::npos) {
+    return {};
+  }
+  return text.substr(first, text.find_last_not_of(whitespace) - first + 1);
+}
+
+char fold(char c) {
+  if (c >= 'A' && c <= 'Z') {
+    return c - 'A' + 'a';
+  }
+  return c == '/' ? '\\' : c;
+}
+
+std::string folded(std::string_view text) {
+  std::string result(text.size(), '\0');
+  for (size_t i = 0; i < text.size(); ++i) {
+    result[i] = fold(text[i]);
+  }
+  return result;
+}
+
+bool ends_with_folded(std::string_view text, std::string_view suffix) {
+  if (text.size() < suffix.size()) {
+    return false;
+  }
+  auto tail = text.substr(text.size() - suffix.size());
+  for (size_t i = 0; i < suffix.size(); ++i) {
+    if (fold(tail[i]) != suffix[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Iterative wildcard match that backtracks only to the most recent *, linear in practice.
+bool glob_match(std::string_view pattern, std::string_view text) {
+  size_t p = 0, t = 0, star = std::string_view::npos, star_t = 0;
+  while (t < text.size()) {
+    if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == fold(text[t]))) {
+      ++p;
+      ++t;
+    } else if (p < pattern.size() && pattern[p] == '*') {
+      star = p++;
+      star_t = t;
+    } else if (star != std::string_view::npos) {
+      p = star + 1;
+      t = ++star_t;
+    } else {
+      return false;
+    }
+  }
+  while (p < pattern.size() && pattern[p] == '*') {
+    ++p;
+  }
+  return p == pattern.size();
+}
+} // namespace
+
+ProcessMatcher::ProcessMatcher(std::string_view patterns) {
+  while (!patterns.empty()) {
+    auto separator = patterns.find(';');
+    auto pattern = folded(trim(patterns.substr(0, separator)));
+    patterns.remove_prefix(separator == std::string_view::npos ? patterns.size() : separator + 1);
+    if (pattern.empty()) {
+      continue;
+    }
+    if (pattern.find_first_of("\\*?") == std::string::npos) {
+      if (!pattern.ends_with(".exe")) {
+        m_names.insert(pattern + ".exe");
+      }
+      m_names.insert(std::move(pattern));
+    } else {
+      auto wildcard = pattern.find_last_of("*?");
+      auto suffix = wildcard == std::string::npos ? pattern : pattern.substr(wildcard + 1);
+      m_paths.push_back({std::move(pattern), std::move(suffix)});
+    }
+  }
+}
+
+bool ProcessMatcher::matches(std::string_view image_path) const {
+  if (!m_names.empty()) {
+    auto separator = image_path.find_last_of("\\/");
+    auto name = separator == std::string_view::npos ? image_path : image_path.substr(separator + 1);
+    // executable names are short, folding one is cheaper than hashing case-insensitively
+    if (m_names.count(folded(name))) {
+      return true;
+    }
+  }
+  for (const auto &path : m_paths) {
+    if (ends_with_folded(image_path, path.suffix) && glob_match(path.pattern, image_path)) {
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+// Matches process image paths against a list of executable names ("game.exe", "game") and path patterns
+// ("C:\Games\*\bin\game*.exe", where * and ? match any characters and one character). Patterns are compiled once, a
+// process that matches no name costs one hash lookup plus a suffix comparison per path pattern.
+class ProcessMatcher {
+public:
+  // Patterns are separated by semicolons. Matching ignores case and treats / and \ alike.
+  explicit ProcessMatcher(std::string_view patterns = {});
+
+  bool empty() const { return m_names.empty() && m_paths.empty(); }
+  bool has_path_patterns() const { return !m_paths.empty(); }
+  bool matches(std::string_view image_path) const;
+
+private:
+  struct PathPattern {
+    std::string pattern;
+    // the literal text after the last wildcard, every match ends with it
+    std::string suffix;
+  };
+
+  std::unordered_set<std::string> m_names;
+  std::vector<PathPattern> m_paths;
+};
@@ -0,0 +1,117 @@
+#include "process_reaper.hpp"
+#include "event_loop.hpp"
+#include <cerrno>
+#include <csignal>
+#include <filesystem>
+#include <fstream>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+std::system_error last_error(const char *what) { return std::system_error(errno, std::generic_category(), what); }
+
+// through syscall(), glibc only wraps them from 2.36 on
+int pidfd_open(pid_t pid) { return static_cast<int>(syscall(SYS_pidfd_open, pid, 0)); }
+int pidfd_send_signal(int pidfd, int signal) { return static_cast<int>(syscall(SYS_pidfd_send_signal, pidfd, signal, nullptr, 0)); }
+
+std::string process_image_path(pid_t pid) {
+  std::error_code error;
+  return std::filesystem::read_symlink("/proc/" + std::to_string(pid) + "/exe", error).string();
+}
+
+// The children of every thread of the process
+std::vector<pid_t> children_of(pid_t pid) {
+  std::vector<pid_t> children;
+  std::error_code error;
+  for (const auto &task : std::filesystem::directory_iterator("/proc/" + std::to_string(pid) + "/task", error)) {
+    std::ifstream file{task.path() / "children"};
+    for (pid_t child; file >> child;) {
+      children.push_back(child);
+    }
+  }
+  return children;
+}
+} // namespace
+
+ProcessReaper::ProcessReaper(EventLoop &loop, Handlers handlers) : m_loop{loop}, m_handlers{std::move(handlers)} {
+  if (prctl(PR_SET_CHILD_SUBREAPER, 1) != 0) {
+    throw last_error("prctl");
+  }
+}
+
+ProcessReaper::~ProcessReaper() {
+  for (const auto &[pid, pidfd] : m_processes) {
+    m_loop.unwatch(pidfd);
+    close(pidfd);
+  }
+}
+
+void ProcessReaper::add(pid_t pid) {
+  track(pid);
+  find_children();
+  if (m_processes.empty()) {
+    m_handlers.empty();
+  }
+}
+
+void ProcessReaper::terminate(int signal) {
+  for (const auto &[pid, pidfd] : m_processes) {
+    pidfd_send_signal(pidfd, signal);
+  }
+}
+
+void ProcessReaper::track(pid_t pid) {
+  if (m_processes.count(pid) || m_exited.count(pid)) {
+    return;
+  }
+  // looked up before anything else, a short-lived process may be gone by then
+  m_handlers.process_started(pid, process_image_path(pid));
+  auto pidfd = pidfd_open(pid);
+  if (pidfd < 0) {
+    // gone already
+    exited(pid);
+    return;
+  }
+  m_processes.emplace(pid, pidfd);
+  m_loop.watch(pidfd, [this, pid]() {
+    auto it = m_processes.find(pid);
+    m_loop.unwatch(it->second);
+    close(it->second);
+    m_processes.erase(it);
+    exited(pid);
+    // its children were reparented before the pidfd became readable
+    find_children();
+    if (m_processes.empty()) {
+      m_handlers.empty();
+    }
+  });
+}
+
+void ProcessReaper::exited(pid_t pid) {
+  // a zombie stays in its parent's children until it is reaped; the launcher reaps its own, the others are left to their parent
+  m_exited.insert(pid);
+  waitpid(pid, nullptr, WNOHANG);
+  m_handlers.process_exited(pid);
+}
+
+void ProcessReaper::find_children() {
+  std::vector<pid_t> parents{getpid()};
+  for (const auto &[pid, pidfd] : m_processes) {
+    parents.push_back(pid);
+  }
+  // newly found processes are searched as well
+  for (size_t i = 0; i < parents.size(); ++i) {
+    for (auto child : children_of(parents[i])) {
+      if (!m_processes.count(child) && !m_exited.count(child)) {
+        track(child);
+        if (m_processes.count(child)) {
+          parents.push_back(child);
+        }
+      }
+    }
+  }
+}
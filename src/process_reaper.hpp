@@ -0,0 +1,46 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <sys/types.h>
+#include <unordered_map>
+#include <unordered_set>
+
+class EventLoop;
+
+// The Linux counterpart of JobObject. The launcher becomes the child subreaper of its descendants, so a process whose
+// parent exits is reparented to the launcher instead of init, and every process of the tree is watched through a
+// pidfd on the event loop. Nothing is polled: whenever a process exits, the children of the launcher and of the
+// processes still known are looked up, so a grandchild is reported once its parent exits or the tree changes.
+// Every child of the launcher process counts as part of the tree.
+class ProcessReaper {
+public:
+  struct Handlers {
+    // The image path is empty if the process was gone before it could be looked up.
+    std::function<void(pid_t pid, const std::string &image_path)> process_started;
+    std::function<void(pid_t pid)> process_exited;
+    std::function<void()> empty;
+  };
+
+  // Throws std::system_error if the launcher cannot become a subreaper.
+  ProcessReaper(EventLoop &loop, Handlers handlers);
+  ProcessReaper(const ProcessReaper &) = delete;
+  ProcessReaper &operator=(const ProcessReaper &) = delete;
+  // Processes in the tree keep running.
+  ~ProcessReaper();
+
+  // Adds launcher_exe once it was started. The handlers run on the loop's thread, the first one from here.
+  void add(pid_t pid);
+  void terminate(int signal);
+
+private:
+  void track(pid_t pid);
+  void exited(pid_t pid);
+  void find_children();
+
+  EventLoop &m_loop;
+  Handlers m_handlers;
+  // pid -> pidfd
+  std::unordered_map<pid_t, int> m_processes;
+  // not looked at again, a zombie is still listed as a child until its parent reaps it
+  std::unordered_set<pid_t> m_exited;
+};
@@ -0,0 +1,103 @@
+#include "process_start_trace.hpp"
+#include <cstddef>
+#include <cstring>
+#include <system_error>
+#include <tdh.h>
+#include <vector>
+
+namespace {
+// Microsoft-Windows-Kernel-Process
+constexpr GUID kernel_process_provider = {0x22fb2cd6, 0x0e7b, 0x422b, {0xa0, 0xc7, 0x2f, 0xad, 0x1f, 0xd0, 0xe7, 0x16}};
+constexpr ULONGLONG process_keyword = 0x10;
+constexpr USHORT process_start_event = 1;
+
+struct SessionProperties {
+  EVENT_TRACE_PROPERTIES properties;
+  wchar_t name[128];
+};
+
+SessionProperties session_properties() {
+  SessionProperties result{};
+  result.properties.Wnode.BufferSize = sizeof(result);
+  result.properties.Wnode.Flags = WNODE_FLAG_TRACED_GUID;
+  result.properties.Wnode.ClientContext = 1;
+  result.properties.LogFileMode = EVENT_TRACE_REAL_TIME_MODE;
+  result.properties.FlushTimer = 1;
+  result.properties.LoggerNameOffset = offsetof(SessionProperties, name);
+  return result;
+}
+
+bool read_property(PEVENT_RECORD record, LPCWSTR name, std::vector<BYTE> &value) {
+  PROPERTY_DATA_DESCRIPTOR descriptor{reinterpret_cast<ULONGLONG>(name), ULONG_MAX, 0};
+  ULONG size = 0;
+  if (TdhGetPropertySize(record, 0, nullptr, 1, &descriptor, &size) != ERROR_SUCCESS || size == 0) {
+    return false;
+  }
+  value.resize(size);
+  return TdhGetProperty(record, 0, nullptr, 1, &descriptor, size, value.data()) == ERROR_SUCCESS;
+}
+
+std::system_error trace_error(ULONG status, const char *what) { return std::system_error(static_cast<int>(status), std::system_category(), what); }
+} // namespace
+
+ProcessStartTrace::ProcessStartTrace(Handler on_started)
+    : m_on_started{std::move(on_started)}, m_name{L"moonlight_hdr_launcher_processes_" + std::to_wstring(GetCurrentProcessId())} {
+  auto properties = session_properties();
+  auto status = StartTraceW(&m_session, m_name.c_str(), &properties.properties);
+  if (status == ERROR_ALREADY_EXISTS) {
+    // left behind by a launcher that crashed with the same process id
+    ControlTraceW(0, m_name.c_str(), &properties.properties, EVENT_TRACE_CONTROL_STOP);
+    properties = session_properties();
+    status = StartTraceW(&m_session, m_name.c_str(), &properties.properties);
+  }
+  if (status != ERROR_SUCCESS) {
+    throw trace_error(status, "StartTrace");
+  }
+  status = EnableTraceEx2(m_session, &kernel_process_provider, EVENT_CONTROL_CODE_ENABLE_PROVIDER, TRACE_LEVEL_INFORMATION, process_keyword, 0, 0,
+                          nullptr);
+  const char *failed = "EnableTraceEx2";
+  EVENT_TRACE_LOGFILEW logfile{};
+  logfile.LoggerName = m_name.data();
+  logfile.ProcessTraceMode = PROCESS_TRACE_MODE_REAL_TIME | PROCESS_TRACE_MODE_EVENT_RECORD;
+  logfile.EventRecordCallback = on_event;
+  logfile.Context = this;
+  if (status == ERROR_SUCCESS) {
+    m_trace = OpenTraceW(&logfile);
+    if (m_trace == INVALID_PROCESSTRACE_HANDLE) {
+      status = GetLastError();
+      failed = "OpenTrace";
+    }
+  }
+  if (status != ERROR_SUCCESS) {
+    properties = session_properties();
+    ControlTraceW(m_session, nullptr, &properties.properties, EVENT_TRACE_CONTROL_STOP);
+    throw trace_error(status, failed);
+  }
+  m_thread = std::thread([this]() { ProcessTrace(&m_trace, 1, nullptr, nullptr); });
+}
+
+ProcessStartTrace::~ProcessStartTrace() {
+  auto properties = session_properties();
+  ControlTraceW(m_session, nullptr, &properties.properties, EVENT_TRACE_CONTROL_STOP);
+  CloseTrace(m_trace);
+  m_thread.join();
+}
+
+void WINAPI ProcessStartTrace::on_event(PEVENT_RECORD record) {
+  if (record->EventHeader.EventDescriptor.Id != process_start_event || !IsEqualGUID(record->EventHeader.ProviderId, kernel_process_provider)) {
+    return;
+  }
+  // the header's process id is the parent's, the started process is in the payload
+  thread_local std::vector<BYTE> pid;
+  thread_local std::vector<BYTE> image_name;
+  if (!read_property(record, L"ProcessID", pid) || pid.size() < sizeof(DWORD) || !read_property(record, L"ImageName", image_name)) {
+    return;
+  }
+  DWORD process_id;
+  memcpy(&process_id, pid.data(), sizeof(process_id));
+  std::wstring_view image_path{reinterpret_cast<const wchar_t *>(image_name.data()), image_name.size() / sizeof(wchar_t)};
+  if (auto end = image_path.find(L'\0'); end != std::wstring_view::npos) {
+    image_path = image_path.substr(0, end);
+  }
+  static_cast<ProcessStartTrace *>(record->UserContext)->m_on_started(process_id, image_path);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "windows.h"
+#include <evntcons.h>
+#include <evntrace.h>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+// Reports every process started on the system, as the kernel announces it through a real-time ETW session of the
+// Microsoft-Windows-Kernel-Process provider. Events are delivered when the session's buffers are flushed, within a
+// second of the process starting.
+class ProcessStartTrace {
+public:
+  // Runs on the trace's own thread, for every process on the system, so it has to be cheap. The image path is a
+  // native path like \Device\HarddiskVolume3\Games\game.exe.
+  using Handler = std::function<void(DWORD pid, std::wstring_view image_path)>;
+
+  // Throws std::system_error if the session cannot be started, it needs administrator rights or membership in the
+  // Performance Log Users group.
+  explicit ProcessStartTrace(Handler on_started);
+  ProcessStartTrace(const ProcessStartTrace &) = delete;
+  ProcessStartTrace &operator=(const ProcessStartTrace &) = delete;
+  ~ProcessStartTrace();
+
+private:
+  static void WINAPI on_event(PEVENT_RECORD record);
+
+  Handler m_on_started;
+  std::wstring m_name;
+  TRACEHANDLE m_session = 0;
+  TRACEHANDLE m_trace = INVALID_PROCESSTRACE_HANDLE;
+  std::thread m_thread;
+};
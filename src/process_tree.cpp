@@ -0,0 +1,61 @@
+#include "process_tree.hpp"
+#include <algorithm>
+#include <cctype>
+
+namespace {
+bool iequals(std::string_view a, std::string_view b) {
+  return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+                    [](char x, char y) { return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y)); });
+}
+} // namespace
+
+std::string_view image_name(std::string_view image_path) {
+  auto separator = image_path.find_last_of("\\/");
+  return separator == std::string_view::npos ? image_path : image_path.substr(separator + 1);
+}
+
+ProcessTreeTracker::ProcessTreeTracker(std::string session_process) : m_session_process{std::move(session_process)} {}
+
+bool ProcessTreeTracker::is_session_process(std::string_view image_path) const {
+  if (m_session_process.empty()) {
+    return false;
+  }
+  auto name = image_name(image_path);
+  // "game" matches game.exe
+  return iequals(name, m_session_process) || iequals(name, m_session_process + ".exe");
+}
+
+void ProcessTreeTracker::started(uint32_t pid, std::string_view image_path) {
+  if (m_running.count(pid)) {
+    return;
+  }
+  bool session_process = is_session_process(image_path);
+  m_running.emplace(pid, session_process);
+  m_tree_empty = false;
+  if (session_process) {
+    m_session_process_seen = true;
+    ++m_session_process_running;
+  }
+}
+
+void ProcessTreeTracker::exited(uint32_t pid) {
+  auto it = m_running.find(pid);
+  if (it == m_running.end()) {
+    return;
+  }
+  if (it->second && --m_session_process_running == 0) {
+    m_session_process_exited = true;
+  }
+  m_running.erase(it);
+}
+
+void ProcessTreeTracker::tree_empty() {
+  m_tree_empty = true;
+  m_running.clear();
+  if (m_session_process_running > 0) {
+    m_session_process_running = 0;
+    m_session_process_exited = true;
+  }
+}
+
+bool ProcessTreeTracker::session_over() const { return m_tree_empty || m_session_process_exited; }
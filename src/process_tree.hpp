@@ -0,0 +1,37 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Decides when a session is over from the start and exit notifications of launcher_exe's process tree. Knows nothing
+// about where the notifications come from.
+class ProcessTreeTracker {
+public:
+  // Without a session process the session is over once the tree is empty. With one, it is over once a process of that
+  // executable has run and none is left, or once the tree is empty without it ever having started.
+  explicit ProcessTreeTracker(std::string session_process = {});
+
+  // A process may be reported more than once, repeated notifications are ignored.
+  void started(uint32_t pid, std::string_view image_path);
+  void exited(uint32_t pid);
+  void tree_empty();
+
+  bool session_over() const;
+  bool session_process_seen() const { return m_session_process_seen; }
+  size_t running() const { return m_running.size(); }
+
+private:
+  bool is_session_process(std::string_view image_path) const;
+
+  std::string m_session_process;
+  // pid -> whether it is the session process
+  std::unordered_map<uint32_t, bool> m_running;
+  size_t m_session_process_running = 0;
+  bool m_session_process_seen = false;
+  bool m_session_process_exited = false;
+  bool m_tree_empty = false;
+};
+
+// The file name part of a Windows or POSIX path.
+std::string_view image_name(std::string_view image_path);
@@ -0,0 +1,113 @@
+#include "report_spool.hpp"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr std::string_view report_extension = ".envelope";
+constexpr std::string_view minidump_prefix = "startup_crash_";
+constexpr std::string_view minidump_extension = ".dmp";
+
+template <typename T> bool parse_number(std::string_view text, T &value) {
+  auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+  return ec == std::errc{} && end == text.data() + text.size() && !text.empty();
+}
+} // namespace
+
+ReportSpool::ReportSpool(fs::path folder, uint32_t pid, size_t max_reports) : m_folder{std::move(folder)}, m_pid{pid}, m_max_reports{max_reports} {}
+
+bool ReportSpool::add(std::string_view report) {
+  std::error_code ec;
+  fs::create_directories(m_folder, ec);
+  // names sort by time, the pid and a counter keep reports of the same microsecond apart
+  auto time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+  char name[64];
+  {
+    std::lock_guard lock{m_mutex};
+    std::snprintf(name, sizeof(name), "%016llx-%08x-%08x", static_cast<unsigned long long>(time), static_cast<unsigned>(m_pid), m_counter++);
+  }
+  auto path = m_folder / (std::string(name) + std::string(report_extension));
+  auto temp_path = path;
+  temp_path += ".tmp";
+  {
+    std::ofstream out{temp_path, std::ios::binary | std::ios::trunc};
+    if (!out) {
+      return false;
+    }
+    out.write(report.data(), report.size());
+    if (!out.flush()) {
+      out.close();
+      fs::remove(temp_path, ec);
+      return false;
+    }
+  }
+  fs::rename(temp_path, path, ec);
+  if (ec) {
+    fs::remove(temp_path, ec);
+    return false;
+  }
+
+  auto reports = pending();
+  for (size_t i = 0; i + m_max_reports < reports.size(); ++i) {
+    remove(reports[i]);
+  }
+  return true;
+}
+
+std::vector<fs::path> ReportSpool::pending() const {
+  std::error_code ec;
+  std::vector<fs::path> reports;
+  for (const auto &entry : fs::directory_iterator{m_folder, ec}) {
+    if (entry.path().extension() == report_extension) {
+      reports.push_back(entry.path());
+    }
+  }
+  std::sort(reports.begin(), reports.end(), [](const fs::path &a, const fs::path &b) { return a.filename() < b.filename(); });
+  return reports;
+}
+
+std::optional<std::string> ReportSpool::read(const fs::path &path) {
+  std::ifstream in{path, std::ios::binary};
+  if (!in) {
+    return std::nullopt;
+  }
+  return std::string{std::istreambuf_iterator<char>(in), {}};
+}
+
+void ReportSpool::remove(const fs::path &path) {
+  std::error_code ec;
+  fs::remove(path, ec);
+}
+
+fs::path startup_minidump_path(const fs::path &folder, uint32_t pid, uint64_t start_time) {
+  return folder / (std::string(minidump_prefix) + std::to_string(pid) + "_" + std::to_string(start_time) + std::string(minidump_extension));
+}
+
+std::vector<fs::path> orphaned_startup_minidumps(const fs::path &folder, const std::function<bool(uint32_t pid, uint64_t start_time)> &owner_alive) {
+  std::error_code ec;
+  std::vector<fs::path> orphaned;
+  for (const auto &entry : fs::directory_iterator{folder, ec}) {
+    auto name = entry.path().filename().string();
+    if (!name.starts_with(minidump_prefix) || !name.ends_with(minidump_extension)) {
+      continue;
+    }
+    auto owner = std::string_view{name}.substr(minidump_prefix.size(), name.size() - minidump_prefix.size() - minidump_extension.size());
+    auto separator = owner.find('_');
+    uint32_t pid = 0;
+    uint64_t start_time = 0;
+    if (!parse_number(owner.substr(0, separator), pid) || (separator != std::string_view::npos && !parse_number(owner.substr(separator + 1), start_time))) {
+      continue;
+    }
+    if (!owner_alive(pid, start_time)) {
+      orphaned.push_back(entry.path());
+    }
+  }
+  std::sort(orphaned.begin(), orphaned.end());
+  return orphaned;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Crash reporting events waiting to be uploaded, one file each. Capturing an event only writes a file, the
+// uploader sends it whenever the network allows and deletes it once it is delivered. Safe to use from several
+// threads and several launcher processes.
+class ReportSpool {
+public:
+  // The pid keeps the names of reports from different processes apart. Above max_reports, the oldest reports are dropped.
+  ReportSpool(std::filesystem::path folder, uint32_t pid, size_t max_reports = 50);
+
+  // Writes a temporary file and renames it, so the uploader never sees half a report.
+  bool add(std::string_view report);
+  // Oldest first.
+  std::vector<std::filesystem::path> pending() const;
+  static std::optional<std::string> read(const std::filesystem::path &path);
+  void remove(const std::filesystem::path &path);
+
+  const std::filesystem::path &folder() const { return m_folder; }
+
+private:
+  std::filesystem::path m_folder;
+  uint32_t m_pid;
+  size_t m_max_reports;
+  std::mutex m_mutex;
+  uint32_t m_counter = 0;
+};
+
+// Minidumps of launchers that crashed before crash reporting was initialised, startup_crash_<pid>_<start time>.dmp in
+// Sentry's database. The start time is the one the restore journal's owner check compares.
+std::filesystem::path startup_minidump_path(const std::filesystem::path &folder, uint32_t pid, uint64_t start_time);
+// The minidumps whose launcher is gone, a live launcher may still be writing its own. Dumps named without a start time
+// are checked by their pid alone.
+std::vector<std::filesystem::path> orphaned_startup_minidumps(const std::filesystem::path &folder,
+                                                              const std::function<bool(uint32_t pid, uint64_t start_time)> &owner_alive);
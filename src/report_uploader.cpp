@@ -0,0 +1,123 @@
+#include "report_uploader.hpp"
+#include <algorithm>
+
+std::optional<SentryEndpoint> sentry_endpoint(std::string_view dsn, std::string_view client) {
+  auto scheme_end = dsn.find("://");
+  if (scheme_end == std::string_view::npos) {
+    return std::nullopt;
+  }
+  auto scheme = dsn.substr(0, scheme_end);
+  auto rest = dsn.substr(scheme_end + 3);
+  auto at = rest.find('@');
+  auto slash = rest.find('/');
+  if (at == std::string_view::npos || slash == std::string_view::npos || at > slash) {
+    return std::nullopt;
+  }
+  // the secret of old DSNs is not needed
+  auto key = rest.substr(0, std::min(rest.find(':'), at));
+  auto host = rest.substr(at + 1, slash - at - 1);
+  auto path = rest.substr(slash + 1);
+  while (!path.empty() && path.back() == '/') {
+    path.remove_suffix(1);
+  }
+  auto project_start = path.rfind('/');
+  auto project = project_start == std::string_view::npos ? path : path.substr(project_start + 1);
+  auto prefix = project_start == std::string_view::npos ? std::string_view{} : path.substr(0, project_start + 1);
+  if ((scheme != "https" && scheme != "http") || key.empty() || host.empty() || project.empty()) {
+    return std::nullopt;
+  }
+  return SentryEndpoint{std::string(scheme) + "://" + std::string(host) + "/" + std::string(prefix) + "api/" + std::string(project) + "/envelope/",
+                        "Sentry sentry_version=7, sentry_key=" + std::string(key) + ", sentry_client=" + std::string(client)};
+}
+
+std::string sentry_minidump_envelope(std::string_view event_id, std::string_view release, int64_t timestamp, std::string_view minidump) {
+  std::string escaped_release;
+  for (auto c : release) {
+    if (c == '"' || c == '\\') {
+      escaped_release.push_back('\\');
+    }
+    escaped_release.push_back(c);
+  }
+  auto event = "{\"event_id\":\"" + std::string(event_id) + "\",\"timestamp\":" + std::to_string(timestamp) +
+               ",\"platform\":\"native\",\"level\":\"fatal\",\"release\":\"" + escaped_release + "\"}";
+  std::string envelope = "{\"event_id\":\"" + std::string(event_id) + "\"}\n";
+  envelope += "{\"type\":\"event\",\"length\":" + std::to_string(event.size()) + "}\n" + event + "\n";
+  envelope += "{\"type\":\"attachment\",\"length\":" + std::to_string(minidump.size()) +
+              ",\"filename\":\"minidump.dmp\",\"attachment_type\":\"event.minidump\"}\n";
+  envelope.append(minidump);
+  envelope += "\n";
+  return envelope;
+}
+
+UploadResult classify_upload_status(int status) {
+  if (status >= 200 && status < 300) {
+    return UploadResult::sent;
+  }
+  if (status == 0 || status == 429 || status >= 500) {
+    return UploadResult::retry_later;
+  }
+  return UploadResult::rejected;
+}
+
+ReportUploader::ReportUploader(ReportSpool &spool, upload_function upload, UploadSchedule schedule, std::function<void()> on_start)
+    : m_spool{spool}, m_upload{std::move(upload)}, m_schedule{schedule}, m_on_start{std::move(on_start)}, m_thread{[this]() { run(); }} {}
+
+ReportUploader::~ReportUploader() {
+  {
+    std::lock_guard lock{m_mutex};
+    m_stopping = true;
+  }
+  m_cv.notify_all();
+  m_thread.join();
+}
+
+void ReportUploader::wake() {
+  {
+    std::lock_guard lock{m_mutex};
+    m_woken = true;
+  }
+  m_cv.notify_all();
+}
+
+void ReportUploader::run() {
+  if (m_on_start) {
+    m_on_start();
+  }
+  std::unique_lock lock{m_mutex};
+  if (m_cv.wait_for(lock, m_schedule.start_delay, [this]() { return m_stopping; })) {
+    return;
+  }
+  auto backoff = m_schedule.initial_backoff;
+  while (!m_stopping) {
+    m_woken = false;
+    lock.unlock();
+    bool retry = false;
+    for (const auto &path : m_spool.pending()) {
+      // another launcher may have sent it already
+      auto report = ReportSpool::read(path);
+      if (!report) {
+        continue;
+      }
+      auto result = m_upload(*report);
+      if (result == UploadResult::retry_later) {
+        ++m_failed_attempts;
+        retry = true;
+        break;
+      }
+      ++(result == UploadResult::sent ? m_sent : m_rejected);
+      m_spool.remove(path);
+      std::lock_guard stopping_lock{m_mutex};
+      if (m_stopping) {
+        break;
+      }
+    }
+    lock.lock();
+    if (retry) {
+      m_cv.wait_for(lock, backoff, [this]() { return m_stopping; });
+      backoff = std::min(backoff * 2, m_schedule.max_backoff);
+    } else {
+      backoff = m_schedule.initial_backoff;
+      m_cv.wait(lock, [this]() { return m_stopping || m_woken; });
+    }
+  }
+}
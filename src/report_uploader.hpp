@@ -0,0 +1,75 @@
+#pragma once
+#include "report_spool.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+// Where Sentry accepts envelopes, derived from a DSN such as https://<key>@<host>/<project id>.
+struct SentryEndpoint {
+  std::string url;
+  // the value of the X-Sentry-Auth header
+  std::string auth;
+};
+
+std::optional<SentryEndpoint> sentry_endpoint(std::string_view dsn, std::string_view client);
+
+// A fatal event with the minidump attached, Sentry symbolicates the crash from the minidump. For crashes the launcher
+// recorded itself, before Sentry was initialised. The event id is 32 lowercase hex digits, the timestamp in seconds
+// since the Unix epoch.
+std::string sentry_minidump_envelope(std::string_view event_id, std::string_view release, int64_t timestamp, std::string_view minidump);
+
+enum class UploadResult { sent, rejected, retry_later };
+
+// 2xx is delivered, 429 and 5xx are worth retrying, anything else is dropped. 0 stands for no response at all.
+UploadResult classify_upload_status(int status);
+
+struct UploadSchedule {
+  // nothing is sent before this, so that uploads do not compete with the start of a stream
+  std::chrono::milliseconds start_delay{30000};
+  std::chrono::milliseconds initial_backoff{30000};
+  std::chrono::milliseconds max_backoff{30 * 60 * 1000};
+};
+
+// Sends spooled reports on a thread of its own, oldest first. A report is deleted once it was delivered or
+// rejected. While the endpoint cannot be reached the uploader waits, twice as long after every failure.
+class ReportUploader {
+public:
+  using upload_function = std::function<UploadResult(const std::string &report)>;
+
+  // on_start runs first on the uploader's thread, to lower its priority.
+  ReportUploader(ReportSpool &spool, upload_function upload, UploadSchedule schedule = {}, std::function<void()> on_start = {});
+  ReportUploader(const ReportUploader &) = delete;
+  ReportUploader &operator=(const ReportUploader &) = delete;
+  // Waits for an upload in progress, reports not sent yet stay in the spool for the next launcher start.
+  ~ReportUploader();
+
+  // A report was added to the spool.
+  void wake();
+
+  uint64_t sent() const { return m_sent.load(); }
+  uint64_t rejected() const { return m_rejected.load(); }
+  uint64_t failed_attempts() const { return m_failed_attempts.load(); }
+
+private:
+  void run();
+
+  ReportSpool &m_spool;
+  upload_function m_upload;
+  UploadSchedule m_schedule;
+  std::function<void()> m_on_start;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  bool m_stopping = false;
+  bool m_woken = false;
+  std::atomic<uint64_t> m_sent{0};
+  std::atomic<uint64_t> m_rejected{0};
+  std::atomic<uint64_t> m_failed_attempts{0};
+  std::thread m_thread;
+};
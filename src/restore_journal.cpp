@@ -0,0 +1,269 @@
+#include "restore_journal.hpp"
+#include "logger.hpp"
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+
+namespace {
+constexpr std::array<char, 8> journal_magic = {'M', 'H', 'D', 'R', 'L', 'R', 'J', '3'};
+// without the HDR displays
+constexpr std::array<char, 8> journal_magic_v2 = {'M', 'H', 'D', 'R', 'L', 'R', 'J', '2'};
+// without the owner's start time either
+constexpr std::array<char, 8> journal_magic_v1 = {'M', 'H', 'D', 'R', 'L', 'R', 'J', '1'};
+constexpr std::string_view journal_prefix = "moonlight_hdr_launcher_journal_";
+constexpr std::string_view journal_extension = ".bin";
+constexpr uint32_t max_journal_displays = 64;
+constexpr uint32_t max_journal_hdr_displays = 64;
+
+uint32_t fnv1a(std::string_view data) {
+  uint32_t hash = 2166136261u;
+  for (auto c : data) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+  }
+  return hash;
+}
+
+void put_u32(std::string &out, uint32_t value) {
+  for (int shift = 0; shift < 32; shift += 8) {
+    out.push_back(static_cast<char>(value >> shift));
+  }
+}
+
+bool get_u32(std::string_view &in, uint32_t &value) {
+  if (in.size() < 4) {
+    return false;
+  }
+  value = 0;
+  for (int i = 0; i < 4; ++i) {
+    value |= static_cast<uint32_t>(static_cast<uint8_t>(in[i])) << (8 * i);
+  }
+  in.remove_prefix(4);
+  return true;
+}
+
+void put_u64(std::string &out, uint64_t value) {
+  put_u32(out, static_cast<uint32_t>(value));
+  put_u32(out, static_cast<uint32_t>(value >> 32));
+}
+
+bool get_u64(std::string_view &in, uint64_t &value) {
+  uint32_t low = 0;
+  uint32_t high = 0;
+  if (!get_u32(in, low) || !get_u32(in, high)) {
+    return false;
+  }
+  value = uint64_t{high} << 32 | low;
+  return true;
+}
+} // namespace
+
+std::string encode_journal(const RestoreJournal &journal) {
+  std::string out(journal_magic.begin(), journal_magic.end());
+  put_u32(out, journal.owner_pid);
+  put_u64(out, journal.owner_start_time);
+  out.push_back(journal.hdr_enabled ? 1 : 0);
+  put_u32(out, static_cast<uint32_t>(journal.hdr_displays.size()));
+  for (const auto &display : journal.hdr_displays) {
+    put_u32(out, display.gpu_index);
+    put_u32(out, display.display_id);
+  }
+  put_u32(out, static_cast<uint32_t>(journal.displays.size()));
+  for (const auto &display : journal.displays) {
+    put_u32(out, static_cast<uint32_t>(display.device.size()));
+    out.append(display.device);
+    put_u32(out, display.original_mode.width);
+    put_u32(out, display.original_mode.height);
+    put_u32(out, display.original_mode.refresh_rate);
+  }
+  put_u32(out, fnv1a(out));
+  return out;
+}
+
+std::optional<RestoreJournal> decode_journal(std::string_view data) {
+  if (data.size() < journal_magic.size() + 4) {
+    return {};
+  }
+  auto v1 = std::equal(journal_magic_v1.begin(), journal_magic_v1.end(), data.begin());
+  auto v2 = std::equal(journal_magic_v2.begin(), journal_magic_v2.end(), data.begin());
+  if (!v1 && !v2 && !std::equal(journal_magic.begin(), journal_magic.end(), data.begin())) {
+    return {};
+  }
+  auto body = data.substr(0, data.size() - 4);
+  auto checksum_bytes = data.substr(data.size() - 4);
+  uint32_t checksum = 0;
+  if (!get_u32(checksum_bytes, checksum) || checksum != fnv1a(body)) {
+    return {};
+  }
+  body.remove_prefix(journal_magic.size());
+  RestoreJournal journal;
+  uint32_t count = 0;
+  if (!get_u32(body, journal.owner_pid) || (!v1 && !get_u64(body, journal.owner_start_time)) || body.empty()) {
+    return {};
+  }
+  journal.hdr_enabled = body.front() != 0;
+  body.remove_prefix(1);
+  if (!v1 && !v2) {
+    if (!get_u32(body, count) || count > max_journal_hdr_displays) {
+      return {};
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+      HdrDisplay display{};
+      if (!get_u32(body, display.gpu_index) || !get_u32(body, display.display_id)) {
+        return {};
+      }
+      journal.hdr_displays.push_back(display);
+    }
+  }
+  if (!get_u32(body, count) || count > max_journal_displays) {
+    return {};
+  }
+  for (uint32_t i = 0; i < count; ++i) {
+    JournalDisplay display;
+    uint32_t device_size = 0;
+    if (!get_u32(body, device_size) || device_size > body.size()) {
+      return {};
+    }
+    display.device.assign(body.substr(0, device_size));
+    body.remove_prefix(device_size);
+    if (!get_u32(body, display.original_mode.width) || !get_u32(body, display.original_mode.height) ||
+        !get_u32(body, display.original_mode.refresh_rate)) {
+      return {};
+    }
+    journal.displays.push_back(std::move(display));
+  }
+  if (!body.empty()) {
+    return {};
+  }
+  return journal;
+}
+
+std::optional<RestoreJournal> read_journal(const std::filesystem::path &path) {
+  std::ifstream in{path, std::ios::binary};
+  std::string data{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+  return decode_journal(data);
+}
+
+std::filesystem::path journal_path(const std::filesystem::path &folder, uint32_t pid) {
+  return folder / (std::string(journal_prefix) + std::to_string(pid) + std::string(journal_extension));
+}
+
+bool write_journal(const std::filesystem::path &path, const RestoreJournal &journal) {
+  auto temp_path = path;
+  temp_path += ".tmp";
+  {
+    std::ofstream out{temp_path, std::ios::binary | std::ios::trunc};
+    if (!out) {
+      return false;
+    }
+    auto data = encode_journal(journal);
+    out.write(data.data(), data.size());
+    if (!out.flush()) {
+      return false;
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(temp_path, path, ec);
+  return !ec;
+}
+
+SessionJournal::SessionJournal(std::filesystem::path path, uint32_t pid, uint64_t start_time) : m_path{std::move(path)} {
+  m_journal.owner_pid = pid;
+  m_journal.owner_start_time = start_time;
+}
+
+bool SessionJournal::display_changing(const JournalDisplay &display) {
+  std::lock_guard lock{m_mutex};
+  auto &displays = m_journal.displays;
+  if (std::any_of(displays.begin(), displays.end(), [&](const JournalDisplay &d) { return d.device == display.device; })) {
+    return true;
+  }
+  displays.push_back(display);
+  if (!save()) {
+    displays.pop_back();
+    return false;
+  }
+  return true;
+}
+
+bool SessionJournal::hdr_enabling(const std::vector<HdrDisplay> &displays) {
+  std::lock_guard lock{m_mutex};
+  if (displays.empty()) {
+    return true;
+  }
+  auto previous = m_journal;
+  m_journal.hdr_enabled = true;
+  for (const auto &display : displays) {
+    if (std::find(m_journal.hdr_displays.begin(), m_journal.hdr_displays.end(), display) == m_journal.hdr_displays.end()) {
+      m_journal.hdr_displays.push_back(display);
+    }
+  }
+  if (m_journal == previous) {
+    return true;
+  }
+  if (!save()) {
+    m_journal = std::move(previous);
+    return false;
+  }
+  return true;
+}
+
+void SessionJournal::display_restored(const std::string &device) {
+  std::lock_guard lock{m_mutex};
+  auto &displays = m_journal.displays;
+  displays.erase(std::remove_if(displays.begin(), displays.end(), [&](const JournalDisplay &d) { return d.device == device; }), displays.end());
+  save();
+}
+
+void SessionJournal::hdr_restored() {
+  std::lock_guard lock{m_mutex};
+  m_journal.hdr_enabled = false;
+  m_journal.hdr_displays.clear();
+  save();
+}
+
+bool SessionJournal::save() {
+  if (m_journal.empty()) {
+    std::error_code ec;
+    std::filesystem::remove(m_path, ec);
+    return !ec;
+  }
+  return write_journal(m_path, m_journal);
+}
+
+void replay_stale_journals(const std::filesystem::path &folder, JournalReplayTarget &target, Logger &logger) {
+  std::error_code ec;
+  std::vector<std::filesystem::path> paths;
+  for (const auto &entry : std::filesystem::directory_iterator{folder, ec}) {
+    auto name = entry.path().filename().string();
+    if (name.starts_with(journal_prefix) && name.ends_with(journal_extension)) {
+      paths.push_back(entry.path());
+    }
+  }
+  for (const auto &path : paths) {
+    auto journal = read_journal(path);
+    if (!journal) {
+      logger.warn("Deleting unreadable restore journal {}", path.string());
+      std::filesystem::remove(path, ec);
+      continue;
+    }
+    if (target.process_alive(journal->owner_pid, journal->owner_start_time)) {
+      continue;
+    }
+    logger.warn("Launcher process {} ended without restoring its changes, restoring them now", journal->owner_pid);
+    // HDR first, as during teardown
+    if (journal->hdr_enabled && target.disable_hdr(journal->hdr_displays)) {
+      journal->hdr_enabled = false;
+      journal->hdr_displays.clear();
+    }
+    auto &displays = journal->displays;
+    displays.erase(std::remove_if(displays.begin(), displays.end(), [&](const JournalDisplay &d) { return target.restore_display(d); }), displays.end());
+    if (journal->empty()) {
+      std::filesystem::remove(path, ec);
+    } else {
+      logger.error("Could not restore everything launcher process {} changed, trying again on the next start", journal->owner_pid);
+      write_journal(path, *journal);
+    }
+  }
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "display_backend.hpp"
+#include "hdr_toggle.hpp"
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class Logger;
+
+// What a session has changed and not yet restored, kept on disk so that the next launcher start can restore it if
+// the process that made the changes is gone.
+struct JournalDisplay {
+  // empty for the primary display
+  std::string device;
+  DisplayMode original_mode;
+
+  friend bool operator==(const JournalDisplay &, const JournalDisplay &) = default;
+};
+
+struct RestoreJournal {
+  uint32_t owner_pid = 0;
+  // when the owner was created, in FILETIME units, so that a later process that got the same id is not mistaken for
+  // it; 0 if unknown
+  uint64_t owner_start_time = 0;
+  std::vector<JournalDisplay> displays;
+  // the session turned HDR on, on these displays; the list is empty in journals written before it was recorded
+  bool hdr_enabled = false;
+  std::vector<HdrDisplay> hdr_displays;
+
+  bool empty() const { return displays.empty() && !hdr_enabled; }
+  friend bool operator==(const RestoreJournal &, const RestoreJournal &) = default;
+};
+
+std::string encode_journal(const RestoreJournal &journal);
+// Returns nothing unless the data is a complete journal with a matching checksum. Journals written before the start
+// time or the HDR displays were recorded are read with an owner_start_time of 0 or without HDR displays.
+std::optional<RestoreJournal> decode_journal(std::string_view data);
+// Returns nothing if the file is missing or damaged.
+std::optional<RestoreJournal> read_journal(const std::filesystem::path &path);
+
+// One journal per launcher process, so that the service and a launcher running its own session never share one.
+std::filesystem::path journal_path(const std::filesystem::path &folder, uint32_t pid);
+// Writes a temporary file and renames it over the journal, the journal is always either the old or the new version.
+bool write_journal(const std::filesystem::path &path, const RestoreJournal &journal);
+
+// The journal of this process. Changes are recorded before they are made and removed once they have been restored,
+// the file is deleted when nothing is left to restore. Safe to use from several threads.
+class SessionJournal {
+public:
+  SessionJournal(std::filesystem::path path, uint32_t pid, uint64_t start_time);
+
+  // Returns false if the journal could not be written, the change must not be made then. Only the first original
+  // mode of a display is kept.
+  bool display_changing(const JournalDisplay &display);
+  // Adds to the displays already recorded. An empty list records nothing, it would read as a journal from before the
+  // displays were recorded.
+  bool hdr_enabling(const std::vector<HdrDisplay> &displays);
+  void display_restored(const std::string &device);
+  void hdr_restored();
+
+private:
+  bool save();
+
+  std::mutex m_mutex;
+  std::filesystem::path m_path;
+  RestoreJournal m_journal;
+};
+
+// What replaying a journal needs from the platform.
+class JournalReplayTarget {
+public:
+  virtual ~JournalReplayTarget() = default;
+
+  // A start time of 0 is not compared.
+  virtual bool process_alive(uint32_t pid, uint64_t start_time) = 0;
+  virtual bool restore_display(const JournalDisplay &display) = 0;
+  // Switches back only the given displays, or every HDR capable display if the journal did not record them.
+  virtual bool disable_hdr(const std::vector<HdrDisplay> &displays) = 0;
+};
+
+// Restores what the journals of launcher processes that are gone recorded. Restored entries are removed and a
+// journal is deleted once empty, what fails to restore is kept for the next start. Unreadable journals are deleted.
+void replay_stale_journals(const std::filesystem::path &folder, JournalReplayTarget &target, Logger &logger);
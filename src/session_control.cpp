@@ -0,0 +1,116 @@
+#include "session_control.hpp"
+#include "logger.hpp"
+#include <charconv>
+#include <future>
+
+namespace {
+bool parse_uint(const std::string &text, uint32_t &value) {
+  auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+  return ec == std::errc{} && end == text.data() + text.size();
+}
+
+struct CommandHandler {
+  SessionController &controller;
+
+  IpcMessage operator()(const SetDisplayModeCommand &m) const { return controller.set_display_mode(m.mode); }
+  IpcMessage operator()(const SetHdrCommand &m) const { return controller.set_hdr(m.enabled); }
+  IpcMessage operator()(const QueryStateCommand &) const { return controller.query_state(); }
+  IpcMessage operator()(const EndSessionCommand &) const { return controller.end_session(); }
+  template <typename message_type> IpcMessage operator()(const message_type &) const { return ControlReply{false, "not a control command"}; }
+};
+} // namespace
+
+ControlServer::ControlServer(std::unique_ptr<IpcListener> listener, SessionController &controller, Logger &logger, Executor executor)
+    : m_listener{std::move(listener)}, m_controller{controller}, m_logger{logger}, m_executor{std::move(executor)} {
+  m_thread = std::thread([this]() { serve(); });
+}
+
+void ControlServer::stop() {
+  if (m_thread.joinable()) {
+    m_listener->close();
+    m_thread.join();
+  }
+}
+
+void ControlServer::serve() {
+  for (;;) {
+    std::unique_ptr<IpcChannel> channel;
+    try {
+      channel = m_listener->accept();
+    } catch (IpcError &e) {
+      m_logger.debug("Control channel closed: {}", e.what());
+      return;
+    }
+    serve_client(*channel);
+  }
+}
+
+void ControlServer::serve_client(IpcChannel &channel) {
+  try {
+    for (;;) {
+      auto command = receive_message(channel);
+      send_message(channel, execute(command));
+    }
+  } catch (IpcError &) {
+    // the client hung up or the server is stopping
+  } catch (std::exception &e) {
+    m_logger.error("Control command failed: {}", e.what());
+  }
+}
+
+IpcMessage ControlServer::execute(const IpcMessage &command) {
+  if (!m_executor) {
+    return std::visit(CommandHandler{m_controller}, command);
+  }
+  // owned by the task alone, an executor that drops the task breaks the promise
+  auto promise = std::make_shared<std::promise<IpcMessage>>();
+  auto reply = promise->get_future();
+  m_executor([this, promise = std::move(promise), command]() {
+    try {
+      promise->set_value(std::visit(CommandHandler{m_controller}, command));
+    } catch (...) {
+      promise->set_exception(std::current_exception());
+    }
+  });
+  try {
+    return reply.get();
+  } catch (std::future_error &) {
+    return ControlReply{false, "the session is ending"};
+  }
+}
+
+std::optional<IpcMessage> parse_control_command(const std::vector<std::string> &words) {
+  if (words.empty()) {
+    return {};
+  }
+  const auto &name = words[0];
+  if (name == "set-mode" && (words.size() == 3 || words.size() == 4)) {
+    SetDisplayModeCommand command{};
+    if (!parse_uint(words[1], command.mode.width) || !parse_uint(words[2], command.mode.height) ||
+        (words.size() == 4 && !parse_uint(words[3], command.mode.refresh_rate))) {
+      return {};
+    }
+    return command;
+  }
+  if (name == "hdr" && words.size() == 2 && (words[1] == "on" || words[1] == "off")) {
+    return SetHdrCommand{words[1] == "on"};
+  }
+  if (name == "state" && words.size() == 1) {
+    return QueryStateCommand{};
+  }
+  if (name == "end" && words.size() == 1) {
+    return EndSessionCommand{};
+  }
+  return {};
+}
+
+std::string describe_control_reply(const IpcMessage &reply) {
+  if (auto m = std::get_if<ControlReply>(&reply)) {
+    return (m->ok ? "ok" : "failed") + (m->message.empty() ? std::string() : ": " + m->message);
+  }
+  if (auto m = std::get_if<SessionState>(&reply)) {
+    return "mode " + std::to_string(m->mode.width) + "x" + std::to_string(m->mode.height) + "@" + std::to_string(m->mode.refresh_rate) + ", HDR " +
+           (m->hdr_enabled ? "on" : "off") + ", launcher_exe " + m->launcher_exe;
+  }
+  return "unexpected reply";
+}
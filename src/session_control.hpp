@@ -0,0 +1,56 @@
+#pragma once
+#include "ipc.hpp"
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Logger;
+
+// What a running session can be asked to do. Calls come one at a time, from the thread the server's executor runs them on.
+class SessionController {
+public:
+  virtual ~SessionController() = default;
+
+  virtual ControlReply set_display_mode(const DisplayMode &mode) = 0;
+  virtual ControlReply set_hdr(bool enabled) = 0;
+  virtual SessionState query_state() = 0;
+  // Asks the session to end, teardown then runs as if launcher_exe had exited.
+  virtual ControlReply end_session() = 0;
+};
+
+// Serves control clients on its own thread while a session runs. Each client may send any number of commands,
+// every command gets exactly one reply.
+class ControlServer {
+public:
+  // Runs a command on the thread that owns the session state. If the executor drops the command without running
+  // it, the client is told that the session is ending.
+  using Executor = std::function<void(std::function<void()>)>;
+
+  // Without an executor commands run on the server's thread.
+  ControlServer(std::unique_ptr<IpcListener> listener, SessionController &controller, Logger &logger, Executor executor = {});
+  ControlServer(const ControlServer &) = delete;
+  ControlServer &operator=(const ControlServer &) = delete;
+  ~ControlServer() { stop(); }
+
+  // Returns once no command is being handled anymore; a connected client sees the connection close. When called on
+  // the executor's thread, the executor has to drop pending commands first or stop() would wait for them forever.
+  void stop();
+
+private:
+  void serve();
+  void serve_client(IpcChannel &channel);
+  IpcMessage execute(const IpcMessage &command);
+
+  std::unique_ptr<IpcListener> m_listener;
+  SessionController &m_controller;
+  Logger &m_logger;
+  Executor m_executor;
+  std::thread m_thread;
+};
+
+// Parses "set-mode <width> <height> [<refresh rate>]", "hdr on|off", "state" and "end".
+std::optional<IpcMessage> parse_control_command(const std::vector<std::string> &words);
+std::string describe_control_reply(const IpcMessage &reply);
@@ -0,0 +1,145 @@
+#include "session_plan.hpp"
+#include <algorithm>
+
+namespace {
+std::string describe_mode(const DisplayMode &mode) {
+  return std::to_string(mode.width) + "x" + std::to_string(mode.height) + "@" + std::to_string(mode.refresh_rate);
+}
+
+bool already_in_mode(const DisplayMode &current, const DisplayMode &wanted) {
+  return current.width == wanted.width && current.height == wanted.height && (wanted.refresh_rate == 0 || current.refresh_rate == wanted.refresh_rate);
+}
+} // namespace
+
+const SessionAction *SessionPlan::find(SessionAction::Kind kind) const {
+  auto it = std::find_if(actions.begin(), actions.end(), [kind](const SessionAction &action) { return action.kind == kind; });
+  return it != actions.end() ? &*it : nullptr;
+}
+
+std::vector<std::string> executable_candidates(std::string_view command_line) {
+  constexpr std::string_view whitespace = " \t";
+  auto first = command_line.find_first_not_of(whitespace);
+  if (first == std::string_view::npos) {
+    return {};
+  }
+  command_line.remove_prefix(first);
+  if (command_line.front() == '"') {
+    auto end = command_line.find('"', 1);
+    return {std::string(command_line.substr(1, end == std::string_view::npos ? std::string_view::npos : end - 1))};
+  }
+  command_line = command_line.substr(0, command_line.find_last_not_of(whitespace) + 1);
+  std::vector<std::string> candidates;
+  for (size_t pos = command_line.find_first_of(whitespace); pos != std::string_view::npos;
+       pos = command_line.find_first_of(whitespace, command_line.find_first_not_of(whitespace, pos))) {
+    candidates.emplace_back(command_line.substr(0, pos));
+  }
+  candidates.emplace_back(command_line);
+  return candidates;
+}
+
+SessionPlan plan_displays(const SessionGoal &goal, const SessionSnapshot &snapshot, const ExecutableResolver &resolve) {
+  SessionPlan plan;
+
+  // checked first, a launch that is going to fail does not get a mode switch
+  std::string executable;
+  if (goal.launch) {
+    for (const auto &candidate : executable_candidates(*goal.launch)) {
+      if (auto path = resolve(candidate)) {
+        executable = std::move(*path);
+        break;
+      }
+    }
+    if (executable.empty()) {
+      plan.blocked = goal.launch->empty() ? "launcher_exe is not set" : "the executable of '" + *goal.launch + "' was not found";
+      return plan;
+    }
+  }
+
+  if (goal.primary_mode) {
+    if (snapshot.primary_mode && already_in_mode(*snapshot.primary_mode, *goal.primary_mode)) {
+      plan.notes.push_back("primary display is already in " + describe_mode(*snapshot.primary_mode));
+    } else {
+      plan.actions.push_back({SessionAction::Kind::set_primary_mode, {{"", snapshot.primary_mode.value_or(DisplayMode{}), *goal.primary_mode}}, {}, {}});
+    }
+  }
+
+  if (!goal.displays.empty()) {
+    std::vector<std::string> unknown;
+    auto changes = diff_display_targets(snapshot.displays, goal.displays, unknown);
+    for (const auto &device : unknown) {
+      plan.notes.push_back("display " + device + " is not attached");
+    }
+    if (changes.size() + unknown.size() < goal.displays.size()) {
+      plan.notes.push_back(std::to_string(goal.displays.size() - changes.size() - unknown.size()) + " displays are already in their modes");
+    }
+    if (!changes.empty()) {
+      plan.actions.push_back({SessionAction::Kind::set_display_modes, std::move(changes), {}, {}});
+    }
+  }
+
+  if (goal.launch) {
+    plan.actions.push_back({SessionAction::Kind::launch, {}, {}, std::move(executable)});
+  }
+  return plan;
+}
+
+SessionPlan plan_hdr(bool hdr, const std::optional<std::vector<HdrDisplay>> &hdr_off) {
+  SessionPlan plan;
+  if (hdr) {
+    if (!hdr_off) {
+      plan.notes.push_back("HDR cannot be controlled");
+    } else if (hdr_off->empty()) {
+      plan.notes.push_back("HDR is already on for every HDR capable display");
+    } else {
+      plan.actions.push_back({SessionAction::Kind::enable_hdr, {}, *hdr_off, {}});
+    }
+  }
+  return plan;
+}
+
+SessionPlan plan_session(const SessionGoal &goal, const SessionSnapshot &snapshot, const ExecutableResolver &resolve) {
+  auto plan = plan_displays(goal, snapshot, resolve);
+  if (!plan.blocked.empty()) {
+    return plan;
+  }
+  // after the modes, a mode change reconfigures the displays HDR is switched on
+  auto hdr = plan_hdr(goal.hdr, snapshot.hdr_off);
+  auto launch = std::find_if(plan.actions.begin(), plan.actions.end(), [](const SessionAction &action) { return action.kind == SessionAction::Kind::launch; });
+  plan.actions.insert(launch, std::make_move_iterator(hdr.actions.begin()), std::make_move_iterator(hdr.actions.end()));
+  plan.notes.insert(plan.notes.end(), hdr.notes.begin(), hdr.notes.end());
+  return plan;
+}
+
+std::vector<std::string> describe_session_plan(const SessionPlan &plan) {
+  std::vector<std::string> lines;
+  if (!plan.blocked.empty()) {
+    lines.push_back("blocked: " + plan.blocked);
+  }
+  for (const auto &action : plan.actions) {
+    switch (action.kind) {
+    case SessionAction::Kind::set_primary_mode:
+      lines.push_back("set primary display mode " + describe_mode(action.display_changes.front().original) + " -> " +
+                      describe_mode(action.display_changes.front().target));
+      break;
+    case SessionAction::Kind::set_display_modes: {
+      std::string line = "set display modes";
+      for (const auto &change : action.display_changes) {
+        line += (&change == &action.display_changes.front() ? " " : ", ") + change.device + " " + describe_mode(change.original) + " -> " +
+                describe_mode(change.target);
+      }
+      lines.push_back(std::move(line));
+      break;
+    }
+    case SessionAction::Kind::enable_hdr:
+      lines.push_back("enable HDR on " + std::to_string(action.hdr_displays.size()) + " displays");
+      break;
+    case SessionAction::Kind::launch:
+      lines.push_back("launch " + action.executable);
+      break;
+    }
+  }
+  for (const auto &note : plan.notes) {
+    lines.push_back("skip: " + note);
+  }
+  return lines;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "display_batch.hpp"
+#include "hdr_toggle.hpp"
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// The state a session asks for. Modes are already resolved against the available modes, a refresh rate of 0 keeps
+// the current one.
+struct SessionGoal {
+  std::optional<DisplayMode> primary_mode;
+  std::vector<DisplayTarget> displays;
+  bool hdr = false;
+  // the launcher_exe command line, nothing if the session does not start it
+  std::optional<std::string> launch;
+};
+
+// The state of the displays before the session changes anything, read once.
+struct SessionSnapshot {
+  std::optional<DisplayMode> primary_mode;
+  std::vector<DisplayTarget> displays;
+  // HDR capable displays that have HDR off, nothing if HDR cannot be controlled
+  std::optional<std::vector<HdrDisplay>> hdr_off;
+};
+
+struct SessionAction {
+  enum class Kind { set_primary_mode, set_display_modes, enable_hdr, launch };
+
+  Kind kind;
+  // a single change for device "" to set the primary mode, one change per display to set display modes
+  std::vector<DisplayChange> display_changes;
+  std::vector<HdrDisplay> hdr_displays;
+  // the resolved executable to launch
+  std::string executable;
+};
+
+struct SessionPlan {
+  // in the order they are carried out, nothing that is already in place is changed again
+  std::vector<SessionAction> actions;
+  // why launcher_exe cannot be started; a blocked plan has no actions, so nothing is changed for a doomed launch
+  std::string blocked;
+  // what was left out and why
+  std::vector<std::string> notes;
+
+  const SessionAction *find(SessionAction::Kind kind) const;
+};
+
+// The executables CreateProcess tries for a command line, in order: the quoted part, or for an unquoted command line
+// the text up to each space and then the whole command line.
+std::vector<std::string> executable_candidates(std::string_view command_line);
+
+// Returns the full path of an executable as CreateProcess would find it, nothing if there is none.
+using ExecutableResolver = std::function<std::optional<std::string>(const std::string &executable)>;
+
+// The display modes and the launch. goal.hdr and snapshot.hdr_off are not read, so the display modes can be planned
+// and switched while NVAPI is still being initialised.
+SessionPlan plan_displays(const SessionGoal &goal, const SessionSnapshot &snapshot, const ExecutableResolver &resolve);
+// Enabling HDR on the displays that have it off, nothing else.
+SessionPlan plan_hdr(bool hdr, const std::optional<std::vector<HdrDisplay>> &hdr_off);
+// Both, with HDR enabled after the modes and before the launch.
+SessionPlan plan_session(const SessionGoal &goal, const SessionSnapshot &snapshot, const ExecutableResolver &resolve);
+// One line per action and note, for the log.
+std::vector<std::string> describe_session_plan(const SessionPlan &plan);
@@ -0,0 +1,123 @@
+#include "target_processes.hpp"
+#include "event_loop.hpp"
+#include "logger.hpp"
+#include <stdexcept>
+#include <system_error>
+#include <tlhelp32.h>
+
+namespace {
+std::string narrow(std::wstring_view text) {
+  std::string result(WideCharToMultiByte(CP_ACP, 0, text.data(), static_cast<int>(text.size()), nullptr, 0, nullptr, nullptr), '\0');
+  WideCharToMultiByte(CP_ACP, 0, text.data(), static_cast<int>(text.size()), result.data(), static_cast<int>(result.size()), nullptr, nullptr);
+  return result;
+}
+
+std::string query_image_path(DWORD pid) {
+  auto process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+  if (!process) {
+    return {};
+  }
+  char path[MAX_PATH];
+  DWORD size = MAX_PATH;
+  std::string result;
+  if (QueryFullProcessImageNameA(process, 0, path, &size)) {
+    result.assign(path, size);
+  }
+  CloseHandle(process);
+  return result;
+}
+
+std::vector<std::pair<std::string, std::string>> drive_device_paths() {
+  std::vector<std::pair<std::string, std::string>> drives;
+  char device[MAX_PATH];
+  for (char letter = 'A'; letter <= 'Z'; ++letter) {
+    std::string drive{letter, ':'};
+    if (QueryDosDeviceA(drive.c_str(), device, MAX_PATH)) {
+      drives.emplace_back(device + std::string("\\"), drive + "\\");
+    }
+  }
+  return drives;
+}
+} // namespace
+
+TargetProcessWatch::TargetProcessWatch(EventLoop &loop, std::string_view patterns, std::function<void()> on_change, Logger &logger)
+    : m_loop{loop}, m_matcher{patterns}, m_on_change{std::move(on_change)}, m_logger{logger} {
+  if (m_matcher.has_path_patterns()) {
+    m_drives = drive_device_paths();
+  }
+  try {
+    m_trace.emplace([this](DWORD pid, std::wstring_view image_path) { process_started(pid, narrow(image_path)); });
+  } catch (std::system_error &e) {
+    m_logger.warn("Cannot watch for target processes started outside of launcher_exe ({}), run the launcher service as administrator to do so",
+                  e.what());
+  }
+  // after starting the trace, so that a target cannot start unnoticed in between
+  auto snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+  if (snapshot != INVALID_HANDLE_VALUE) {
+    PROCESSENTRY32W entry{};
+    entry.dwSize = sizeof(entry);
+    for (bool more = Process32FirstW(snapshot, &entry); more; more = Process32NextW(snapshot, &entry)) {
+      // the snapshot only has executable names
+      process_started(entry.th32ProcessID, m_matcher.has_path_patterns() ? query_image_path(entry.th32ProcessID) : narrow(entry.szExeFile));
+    }
+    CloseHandle(snapshot);
+  }
+}
+
+TargetProcessWatch::~TargetProcessWatch() {
+  m_trace.reset();
+  for (auto [pid, process] : m_running) {
+    m_loop.unwatch(process);
+    CloseHandle(process);
+  }
+}
+
+bool TargetProcessWatch::matches(std::string_view image_path) const {
+  if (m_matcher.matches(image_path)) {
+    return true;
+  }
+  for (const auto &[device, drive] : m_drives) {
+    if (image_path.starts_with(device)) {
+      return m_matcher.matches(drive + std::string(image_path.substr(device.size())));
+    }
+  }
+  return false;
+}
+
+void TargetProcessWatch::process_started(DWORD pid, std::string_view image_path) {
+  if (matches(image_path)) {
+    m_loop.post([this, pid, path = std::string(image_path)]() { watch(pid, path); });
+  }
+}
+
+void TargetProcessWatch::watch(DWORD pid, const std::string &image_path) {
+  if (m_running.count(pid)) {
+    return;
+  }
+  m_seen = true;
+  auto process = OpenProcess(SYNCHRONIZE | PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+  if (!process) {
+    m_logger.info("Target process {} ({}) has already exited", pid, image_path);
+    m_on_change();
+    return;
+  }
+  try {
+    m_loop.watch(process, [this, pid]() { exited(pid); });
+  } catch (std::length_error &) {
+    m_logger.warn("Too many target processes, not waiting for {} ({})", pid, image_path);
+    CloseHandle(process);
+    return;
+  }
+  m_running.emplace(pid, process);
+  m_logger.info("Target process {} ({}) started", pid, image_path);
+  m_on_change();
+}
+
+void TargetProcessWatch::exited(DWORD pid) {
+  auto it = m_running.find(pid);
+  m_loop.unwatch(it->second);
+  CloseHandle(it->second);
+  m_running.erase(it);
+  m_logger.info("Target process {} exited", pid);
+  m_on_change();
+}
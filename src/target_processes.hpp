@@ -0,0 +1,50 @@
+#pragma once
+#include "process_matcher.hpp"
+#include "process_start_trace.hpp"
+#include "windows.h"
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class EventLoop;
+class Logger;
+
+// Holds the session while processes matching target_processes run, including processes that are not descendants
+// of launcher_exe. Starts are reported by the kernel (ProcessStartTrace) and by the session's job, exits by waiting
+// on the process handles in the event loop. Nothing is polled; the process list is read once, for targets that are
+// already running.
+class TargetProcessWatch {
+public:
+  // Without the rights for the system-wide trace, only targets in the session's process tree and targets that are
+  // already running are found, which is logged.
+  TargetProcessWatch(EventLoop &loop, std::string_view patterns, std::function<void()> on_change, Logger &logger);
+  TargetProcessWatch(const TargetProcessWatch &) = delete;
+  TargetProcessWatch &operator=(const TargetProcessWatch &) = delete;
+  ~TargetProcessWatch();
+
+  // May be called from any thread, accepts Win32 and native image paths.
+  void process_started(DWORD pid, std::string_view image_path);
+
+  bool seen() const { return m_seen; }
+  size_t running() const { return m_running.size(); }
+
+private:
+  bool matches(std::string_view image_path) const;
+  void watch(DWORD pid, const std::string &image_path);
+  void exited(DWORD pid);
+
+  EventLoop &m_loop;
+  ProcessMatcher m_matcher;
+  // native device path prefix -> drive, for path patterns
+  std::vector<std::pair<std::string, std::string>> m_drives;
+  std::function<void()> m_on_change;
+  Logger &m_logger;
+  std::unordered_map<DWORD, HANDLE> m_running;
+  bool m_seen = false;
+  // last, so that the trace thread is stopped before anything it uses goes away
+  std::optional<ProcessStartTrace> m_trace;
+};
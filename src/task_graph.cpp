@@ -0,0 +1,123 @@
+#include "task_graph.hpp"
+#include "trace.hpp"
+#include <stdexcept>
+
+TaskGraph::TaskId TaskGraph::add(std::string name, std::function<void()> function, std::vector<TaskId> dependencies) {
+  if (m_pool) {
+    throw std::logic_error("TaskGraph: cannot add tasks after start");
+  }
+  auto id = m_tasks.size();
+  auto task = std::make_unique<Task>();
+  task->name = std::move(name);
+  task->function = std::move(function);
+  task->done = task->promise.get_future().share();
+  task->timing.name = task->name;
+  for (auto dependency : dependencies) {
+    if (dependency >= id) {
+      throw std::invalid_argument("TaskGraph: unknown dependency of " + task->name);
+    }
+    m_tasks[dependency]->dependents.push_back(id);
+    ++task->pending_dependencies;
+  }
+  m_tasks.push_back(std::move(task));
+  return id;
+}
+
+void TaskGraph::start(WorkerPool &pool) {
+  m_pool = &pool;
+  m_start = std::chrono::steady_clock::now();
+  std::vector<TaskId> ready;
+  {
+    std::lock_guard lock{m_mutex};
+    for (TaskId id = 0; id < m_tasks.size(); ++id) {
+      if (m_tasks[id]->pending_dependencies == 0) {
+        ready.push_back(id);
+      }
+    }
+  }
+  for (auto id : ready) {
+    submit(id);
+  }
+}
+
+void TaskGraph::wait(TaskId id) { m_tasks.at(id)->done.get(); }
+
+void TaskGraph::wait_all() {
+  std::exception_ptr first_error;
+  for (auto &task : m_tasks) {
+    task->done.wait();
+    if (!first_error && task->error) {
+      first_error = task->error;
+    }
+  }
+  if (first_error) {
+    std::rethrow_exception(first_error);
+  }
+}
+
+std::vector<TaskTiming> TaskGraph::timings() const {
+  std::lock_guard lock{m_mutex};
+  std::vector<TaskTiming> timings;
+  for (const auto &task : m_tasks) {
+    timings.push_back(task->timing);
+  }
+  return timings;
+}
+
+void TaskGraph::submit(TaskId id) {
+  m_pool->submit([this, id]() {
+    auto &task = *m_tasks[id];
+    auto started = std::chrono::steady_clock::now();
+    std::exception_ptr error;
+    try {
+      task.function();
+    } catch (...) {
+      error = std::current_exception();
+    }
+    auto finished = std::chrono::steady_clock::now();
+    trace::complete_event(task.name, started, finished);
+    {
+      std::lock_guard lock{m_mutex};
+      task.timing.started = std::chrono::duration_cast<std::chrono::microseconds>(started - m_start);
+      task.timing.duration = std::chrono::duration_cast<std::chrono::microseconds>(finished - started);
+      task.timing.failed = static_cast<bool>(error);
+    }
+    finish(id, error);
+  });
+}
+
+void TaskGraph::finish(TaskId id, std::exception_ptr error) {
+  std::vector<TaskId> ready;
+  std::vector<TaskId> skipped;
+  {
+    std::lock_guard lock{m_mutex};
+    auto &task = *m_tasks[id];
+    task.error = error;
+    for (auto dependent_id : task.dependents) {
+      auto &dependent = *m_tasks[dependent_id];
+      if (error && !dependent.error) {
+        dependent.error = error;
+      }
+      if (--dependent.pending_dependencies == 0) {
+        if (dependent.error) {
+          dependent.timing.skipped = true;
+          dependent.timing.failed = true;
+          skipped.push_back(dependent_id);
+        } else {
+          ready.push_back(dependent_id);
+        }
+      }
+    }
+  }
+  if (error) {
+    m_tasks[id]->promise.set_exception(error);
+  } else {
+    m_tasks[id]->promise.set_value();
+  }
+  for (auto dependent_id : skipped) {
+    finish(dependent_id, m_tasks[dependent_id]->error);
+  }
+  for (auto dependent_id : ready) {
+    submit(dependent_id);
+  }
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "worker_pool.hpp"
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct TaskTiming {
+  std::string name;
+  std::chrono::microseconds started; // relative to TaskGraph::start
+  std::chrono::microseconds duration;
+  bool failed = false;
+  bool skipped = false; // a dependency failed, the task never ran
+};
+
+// Small dependency graph of tasks. Each task is submitted to the pool as soon as all of its dependencies have
+// completed, so independent tasks overlap. A failing task fails all of its dependents without running them.
+class TaskGraph {
+public:
+  using TaskId = size_t;
+
+  TaskId add(std::string name, std::function<void()> function, std::vector<TaskId> dependencies = {});
+
+  // The pool has to outlive the graph's execution, i.e. until wait_all() returns.
+  void start(WorkerPool &pool);
+  // Blocks until the task has finished and rethrows its exception, or the one of the dependency that failed first.
+  void wait(TaskId id);
+  // Blocks until every task has finished, then rethrows the first failure if there was one.
+  void wait_all();
+
+  std::vector<TaskTiming> timings() const;
+
+private:
+  struct Task {
+    std::string name;
+    std::function<void()> function;
+    std::vector<TaskId> dependents;
+    size_t pending_dependencies = 0;
+    std::exception_ptr error;
+    std::promise<void> promise;
+    std::shared_future<void> done;
+    TaskTiming timing;
+  };
+
+  void submit(TaskId id);
+  void finish(TaskId id, std::exception_ptr error);
+
+  std::vector<std::unique_ptr<Task>> m_tasks;
+  WorkerPool *m_pool = nullptr;
+  std::chrono::steady_clock::time_point m_start;
+  mutable std::mutex m_mutex;
+};
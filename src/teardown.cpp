@@ -0,0 +1,282 @@
+#include "teardown.hpp"
+#include "logger.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+std::string describe_error(std::exception_ptr error) {
+  try {
+    std::rethrow_exception(error);
+  } catch (std::exception &e) {
+    return e.what();
+  } catch (...) {
+    return "unknown error";
+  }
+}
+
+std::chrono::microseconds elapsed(TeardownAttempt::clock::time_point from, TeardownAttempt::clock::time_point to) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(to - from);
+}
+} // namespace
+
+std::shared_ptr<TeardownAttempt> TeardownAttempt::start(std::function<void()> action, std::function<void()> on_finished) {
+  auto attempt = std::make_shared<TeardownAttempt>();
+  // detached, the thread keeps the attempt alive for as long as the action runs
+  std::thread([attempt, action = std::move(action), on_finished = std::move(on_finished)]() {
+    std::exception_ptr error;
+    try {
+      action();
+    } catch (...) {
+      error = std::current_exception();
+    }
+    {
+      std::lock_guard lock{attempt->m_mutex};
+      attempt->m_finished = true;
+      attempt->m_error = error;
+      attempt->m_finished_at = clock::now();
+    }
+    attempt->m_cv.notify_all();
+    if (on_finished) {
+      on_finished();
+    }
+  }).detach();
+  return attempt;
+}
+
+bool TeardownAttempt::wait_until(clock::time_point deadline) {
+  std::unique_lock lock{m_mutex};
+  return m_cv.wait_until(lock, deadline, [this]() { return m_finished; });
+}
+
+void TeardownAttempt::wait() {
+  std::unique_lock lock{m_mutex};
+  m_cv.wait(lock, [this]() { return m_finished; });
+}
+
+bool TeardownAttempt::finished() const {
+  std::lock_guard lock{m_mutex};
+  return m_finished;
+}
+
+std::exception_ptr TeardownAttempt::error() const {
+  std::lock_guard lock{m_mutex};
+  return m_error;
+}
+
+TeardownAttempt::clock::time_point TeardownAttempt::finished_at() const {
+  std::lock_guard lock{m_mutex};
+  return m_finished_at;
+}
+
+const char *teardown_outcome_name(TeardownOutcome outcome) {
+  switch (outcome) {
+  case TeardownOutcome::done:
+    return "done";
+  case TeardownOutcome::failed:
+    return "failed";
+  case TeardownOutcome::timed_out:
+    return "timed out";
+  case TeardownOutcome::missed_deadline:
+    return "missed the deadline";
+  case TeardownOutcome::not_started:
+    return "not started";
+  }
+  return "unknown";
+}
+
+TeardownPlan::ActionId TeardownPlan::add(std::string name, std::function<void()> action, std::chrono::milliseconds timeout, std::vector<ActionId> after) {
+  auto id = m_actions.size();
+  for (auto dependency : after) {
+    if (dependency >= id) {
+      throw std::invalid_argument("TeardownPlan: unknown action before " + name);
+    }
+  }
+  m_actions.push_back({std::move(name), std::move(action), timeout, std::move(after)});
+  return id;
+}
+
+std::vector<TeardownTiming> TeardownPlan::run(std::chrono::milliseconds deadline, TeardownRetry &retry) {
+  using clock = TeardownAttempt::clock;
+  // shared with the attempts, which may outlive this call
+  struct Signal {
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t finished = 0;
+  };
+  auto signal = std::make_shared<Signal>();
+
+  auto start = clock::now();
+  auto deadline_at = start + deadline;
+  std::vector<TeardownTiming> timings(m_actions.size());
+  std::vector<std::shared_ptr<TeardownAttempt>> attempts(m_actions.size());
+  std::vector<clock::time_point> started(m_actions.size());
+  std::vector<bool> settled(m_actions.size(), false);
+  for (size_t i = 0; i < m_actions.size(); ++i) {
+    timings[i].name = m_actions[i].name;
+  }
+
+  for (;;) {
+    size_t seen;
+    {
+      std::lock_guard lock{signal->mutex};
+      seen = signal->finished;
+    }
+    auto now = clock::now();
+    for (size_t i = 0; i < m_actions.size(); ++i) {
+      if (!attempts[i] || settled[i]) {
+        continue;
+      }
+      if (attempts[i]->finished()) {
+        auto error = attempts[i]->error();
+        timings[i].outcome = error ? TeardownOutcome::failed : TeardownOutcome::done;
+        timings[i].duration = elapsed(started[i], attempts[i]->finished_at());
+        if (error) {
+          timings[i].error = describe_error(error);
+        }
+        trace::complete_event(m_actions[i].name, started[i], attempts[i]->finished_at());
+        settled[i] = true;
+      } else if (now >= started[i] + m_actions[i].timeout) {
+        timings[i].outcome = TeardownOutcome::timed_out;
+        timings[i].duration = elapsed(started[i], now);
+        settled[i] = true;
+      }
+    }
+    for (size_t i = 0; i < m_actions.size(); ++i) {
+      auto &after = m_actions[i].after;
+      if (attempts[i] || now >= deadline_at || !std::all_of(after.begin(), after.end(), [&](ActionId id) { return settled[id]; })) {
+        continue;
+      }
+      started[i] = now;
+      timings[i].started = elapsed(start, now);
+      attempts[i] = TeardownAttempt::start(m_actions[i].function, [signal]() {
+        {
+          std::lock_guard lock{signal->mutex};
+          ++signal->finished;
+        }
+        signal->cv.notify_all();
+      });
+    }
+    if (std::all_of(settled.begin(), settled.end(), [](bool s) { return s; }) || now >= deadline_at) {
+      break;
+    }
+
+    auto wake_at = deadline_at;
+    for (size_t i = 0; i < m_actions.size(); ++i) {
+      if (attempts[i] && !settled[i]) {
+        wake_at = std::min(wake_at, started[i] + m_actions[i].timeout);
+      }
+    }
+    std::unique_lock lock{signal->mutex};
+    signal->cv.wait_until(lock, wake_at, [&]() { return signal->finished != seen; });
+  }
+
+  auto now = clock::now();
+  for (size_t i = 0; i < m_actions.size(); ++i) {
+    if (attempts[i] && !settled[i]) {
+      timings[i].outcome = TeardownOutcome::missed_deadline;
+      timings[i].duration = elapsed(started[i], now);
+    }
+    if (timings[i].outcome != TeardownOutcome::done) {
+      // also once it has finished: an attempt that timed out may have succeeded since, the retry reads its result
+      retry.hand_over(m_actions[i].name, m_actions[i].function, m_actions[i].timeout, attempts[i]);
+    }
+  }
+  return timings;
+}
+
+TeardownRetry::TeardownRetry(Logger &logger, unsigned attempts) : m_logger{logger}, m_attempts{attempts} {
+  m_thread = std::thread([this]() { work(); });
+}
+
+TeardownRetry::~TeardownRetry() {
+  {
+    std::lock_guard lock{m_mutex};
+    m_stopping = true;
+  }
+  m_cv.notify_all();
+  m_thread.join();
+  for (auto &attempt : m_hung) {
+    if (!attempt->finished()) {
+      m_logger.warn("Waiting for a hanging restore action to return");
+      attempt->wait();
+    }
+  }
+}
+
+void TeardownRetry::hand_over(std::string name, std::function<void()> action, std::chrono::milliseconds timeout,
+                              std::shared_ptr<TeardownAttempt> in_flight) {
+  m_logger.warn("Restore action '{}' did not complete, retrying in the background", name);
+  {
+    std::lock_guard lock{m_mutex};
+    m_queue.push_back({std::move(name), std::move(action), timeout, std::move(in_flight)});
+  }
+  m_cv.notify_all();
+}
+
+bool TeardownRetry::wait_idle(std::chrono::milliseconds timeout) {
+  std::unique_lock lock{m_mutex};
+  return m_cv.wait_for(lock, timeout, [this]() { return m_queue.empty() && !m_busy; });
+}
+
+bool TeardownRetry::idle() {
+  std::lock_guard lock{m_mutex};
+  return m_queue.empty() && !m_busy && std::all_of(m_hung.begin(), m_hung.end(), [](const auto &hung) { return hung->finished(); });
+}
+
+void TeardownRetry::work() {
+  for (;;) {
+    Pending pending;
+    {
+      std::unique_lock lock{m_mutex};
+      m_cv.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+      if (m_queue.empty()) {
+        return;
+      }
+      pending = std::move(m_queue.front());
+      m_queue.pop_front();
+      m_busy = true;
+    }
+    retry(pending);
+    {
+      std::lock_guard lock{m_mutex};
+      m_busy = false;
+    }
+    m_cv.notify_all();
+  }
+}
+
+void TeardownRetry::give_up(std::shared_ptr<TeardownAttempt> attempt) {
+  std::lock_guard lock{m_mutex};
+  // the ones that have returned meanwhile are let go
+  std::erase_if(m_hung, [](const std::shared_ptr<TeardownAttempt> &hung) { return hung->finished(); });
+  m_hung.push_back(std::move(attempt));
+}
+
+void TeardownRetry::retry(Pending &pending) {
+  if (auto attempt = std::move(pending.in_flight)) {
+    if (!attempt->wait_until(TeardownAttempt::clock::now() + pending.timeout)) {
+      m_logger.error("Restore action '{}' is still hanging, giving up", pending.name);
+      give_up(std::move(attempt));
+      return;
+    }
+    if (!attempt->error()) {
+      m_logger.info("Restore action '{}' completed late", pending.name);
+      return;
+    }
+  }
+  for (unsigned i = 1; i <= m_attempts; ++i) {
+    auto attempt = TeardownAttempt::start(pending.action);
+    if (!attempt->wait_until(TeardownAttempt::clock::now() + pending.timeout)) {
+      m_logger.error("Restore action '{}' hung on retry {}, giving up", pending.name, i);
+      give_up(std::move(attempt));
+      return;
+    }
+    if (!attempt->error()) {
+      m_logger.info("Restore action '{}' succeeded on retry {}", pending.name, i);
+      return;
+    }
+    m_logger.warn("Restore action '{}' failed on retry {}: {}", pending.name, i, describe_error(attempt->error()));
+  }
+  m_logger.error("Restore action '{}' failed, giving up", pending.name);
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Logger;
+
+// One run of a restore action on a thread of its own, so that a call that hangs (in a driver, typically) holds up
+// nothing but that thread. Whoever waits for the attempt can give up on it at any time.
+class TeardownAttempt {
+public:
+  using clock = std::chrono::steady_clock;
+
+  // on_finished runs on the attempt's thread once the action has returned or thrown.
+  static std::shared_ptr<TeardownAttempt> start(std::function<void()> action, std::function<void()> on_finished = {});
+
+  // Returns false if the attempt is still running at the deadline.
+  bool wait_until(clock::time_point deadline);
+  void wait();
+  bool finished() const;
+  // Valid once finished.
+  std::exception_ptr error() const;
+  clock::time_point finished_at() const;
+
+private:
+  mutable std::mutex m_mutex;
+  std::condition_variable m_cv;
+  bool m_finished = false;
+  std::exception_ptr m_error;
+  clock::time_point m_finished_at;
+};
+
+enum class TeardownOutcome { done, failed, timed_out, missed_deadline, not_started };
+
+const char *teardown_outcome_name(TeardownOutcome outcome);
+
+struct TeardownTiming {
+  std::string name;
+  std::chrono::microseconds started{}; // relative to TeardownPlan::run
+  std::chrono::microseconds duration{};
+  TeardownOutcome outcome = TeardownOutcome::not_started;
+  std::string error;
+};
+
+class TeardownRetry;
+
+// The restore actions of a session. Actions run concurrently unless ordered, each under its own timeout, and the
+// whole plan under a deadline.
+class TeardownPlan {
+public:
+  using ActionId = size_t;
+
+  // The action starts once every action in `after` has finished or timed out, so an order is kept without letting
+  // a hung action hold up the ones after it.
+  ActionId add(std::string name, std::function<void()> action, std::chrono::milliseconds timeout, std::vector<ActionId> after = {});
+
+  // Returns once every action has finished or timed out, or the deadline has passed. Actions that did not complete
+  // are handed to retry, together with their attempt if they started one.
+  std::vector<TeardownTiming> run(std::chrono::milliseconds deadline, TeardownRetry &retry);
+
+private:
+  struct Action {
+    std::string name;
+    std::function<void()> function;
+    std::chrono::milliseconds timeout;
+    std::vector<ActionId> after;
+  };
+
+  std::vector<Action> m_actions;
+};
+
+// Keeps trying restore actions that did not complete during teardown, one at a time on a thread of its own. The
+// launcher service keeps it between sessions, so the client does not wait for it.
+class TeardownRetry {
+public:
+  // Each action is tried up to `attempts` more times. An attempt that hangs ends the retries of its action.
+  explicit TeardownRetry(Logger &logger, unsigned attempts = 2);
+  TeardownRetry(const TeardownRetry &) = delete;
+  TeardownRetry &operator=(const TeardownRetry &) = delete;
+  // Works off everything handed over, which is bounded by the attempts and timeouts, then waits for the attempts it
+  // gave up on: their actions use what the owner destroys next, so a hung action keeps the owner alive.
+  ~TeardownRetry();
+
+  // in_flight is the attempt made during teardown, if any. One that is still running is given the action's timeout
+  // once more, and the action is tried again only if the attempt failed.
+  void hand_over(std::string name, std::function<void()> action, std::chrono::milliseconds timeout, std::shared_ptr<TeardownAttempt> in_flight);
+  // Returns false if actions are still pending after the timeout.
+  bool wait_idle(std::chrono::milliseconds timeout);
+  // Nothing pending and no attempt given up on is still running, so nothing touches what the actions use.
+  bool idle();
+
+private:
+  struct Pending {
+    std::string name;
+    std::function<void()> action;
+    std::chrono::milliseconds timeout;
+    std::shared_ptr<TeardownAttempt> in_flight;
+  };
+
+  void work();
+  void retry(Pending &pending);
+  void give_up(std::shared_ptr<TeardownAttempt> attempt);
+
+  Logger &m_logger;
+  unsigned m_attempts;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::deque<Pending> m_queue;
+  // still running when they were given up on
+  std::vector<std::shared_ptr<TeardownAttempt>> m_hung;
+  bool m_busy = false;
+  bool m_stopping = false;
+  std::thread m_thread;
+};
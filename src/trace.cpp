@@ -0,0 +1,108 @@
+#include "trace.hpp"
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace trace {
+std::atomic_bool enabled_flag{false};
+
+namespace {
+struct Event {
+  std::string name;
+  char phase;
+  clock::time_point start;
+  clock::duration duration;
+  uint32_t thread;
+};
+
+std::mutex events_mutex;
+std::vector<Event> events;
+std::unordered_map<std::thread::id, uint32_t> thread_ids;
+clock::time_point epoch = clock::now();
+
+// call with events_mutex held
+uint32_t current_thread() {
+  auto [it, inserted] = thread_ids.try_emplace(std::this_thread::get_id(), static_cast<uint32_t>(thread_ids.size() + 1));
+  return it->second;
+}
+
+void record(std::string_view name, char phase, clock::time_point start, clock::duration duration) {
+  if (!enabled()) {
+    return;
+  }
+  std::lock_guard lock{events_mutex};
+  if (!enabled()) {
+    return;
+  }
+  events.push_back({std::string(name), phase, start, duration, current_thread()});
+}
+
+void write_json_string(std::ofstream &out, std::string_view text) {
+  out << '"';
+  for (auto c : text) {
+    switch (c) {
+    case '"':
+      out << "\\\"";
+      break;
+    case '\\':
+      out << "\\\\";
+      break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        out << ' ';
+      } else {
+        out << c;
+      }
+    }
+  }
+  out << '"';
+}
+} // namespace
+
+void enable() {
+  std::lock_guard lock{events_mutex};
+  if (!enabled()) {
+    epoch = clock::now();
+    enabled_flag.store(true);
+  }
+}
+
+void disable() {
+  std::lock_guard lock{events_mutex};
+  enabled_flag.store(false);
+  events.clear();
+  thread_ids.clear();
+}
+
+void complete_event(std::string_view name, clock::time_point start, clock::time_point end) { record(name, 'X', start, end - start); }
+
+void instant_event(std::string_view name) { record(name, 'i', clock::now(), {}); }
+
+bool write(const std::filesystem::path &path) {
+  std::lock_guard lock{events_mutex};
+  std::ofstream out{path, std::ios::trunc};
+  if (!out) {
+    return false;
+  }
+  auto micros = [](clock::duration d) { return std::chrono::duration_cast<std::chrono::microseconds>(d).count(); };
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  for (const auto &event : events) {
+    out << (first ? "\n" : ",\n") << "{\"name\":";
+    write_json_string(out, event.name);
+    out << ",\"cat\":\"launcher\",\"ph\":\"" << event.phase << "\",\"ts\":" << micros(event.start - epoch) << ",\"pid\":1,\"tid\":" << event.thread;
+    if (event.phase == 'X') {
+      out << ",\"dur\":" << micros(event.duration);
+    } else {
+      out << ",\"s\":\"p\"";
+    }
+    out << "}";
+    first = false;
+  }
+  out << "\n]}\n";
+  return static_cast<bool>(out.flush());
+}
+} // namespace trace
@@ -0,0 +1,49 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <string_view>
+
+// Session timeline in the Chrome trace-event format, viewable in chrome://tracing or ui.perfetto.dev.
+// While tracing is disabled a span costs one relaxed atomic load.
+namespace trace {
+using clock = std::chrono::steady_clock;
+
+extern std::atomic_bool enabled_flag;
+
+inline bool enabled() { return enabled_flag.load(std::memory_order_relaxed); }
+void enable();
+// Stops recording and drops everything recorded so far.
+void disable();
+
+void complete_event(std::string_view name, clock::time_point start, clock::time_point end);
+void instant_event(std::string_view name);
+
+// Writes the recorded events as a trace-event JSON document. Returns false if the file could not be written.
+bool write(const std::filesystem::path &path);
+
+class Span {
+public:
+  explicit Span(std::string_view name) : m_name{name}, m_active{enabled()} {
+    if (m_active) {
+      m_start = clock::now();
+    }
+  }
+  Span(const Span &) = delete;
+  Span &operator=(const Span &) = delete;
+  ~Span() {
+    if (m_active) {
+      complete_event(m_name, m_start, clock::now());
+    }
+  }
+
+private:
+  std::string_view m_name;
+  bool m_active;
+  clock::time_point m_start;
+};
+} // namespace trace
+
+#define MHDRL_TRACE_CONCAT_IMPL(a, b) a##b
+#define MHDRL_TRACE_CONCAT(a, b) MHDRL_TRACE_CONCAT_IMPL(a, b)
+#define TRACE_SCOPE(name) trace::Span MHDRL_TRACE_CONCAT(trace_span_, __LINE__){name}
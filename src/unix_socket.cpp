@@ -0,0 +1,154 @@
+#include "unix_socket.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <system_error>
+#include <unistd.h>
+
+namespace {
+IpcError last_error(const char *what) { return IpcError(std::string(what) + ": " + std::generic_category().message(errno)); }
+
+sockaddr_un socket_address(const std::string &path) {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(address.sun_path)) {
+    throw IpcError("socket path too long: " + path);
+  }
+  std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+  return address;
+}
+
+// Waits until the socket is ready for events, returns false once closed_fd became readable instead.
+bool wait_ready(int socket, short events, int closed_fd) {
+  pollfd fds[] = {{socket, events, 0}, {closed_fd, POLLIN, 0}};
+  for (;;) {
+    auto result = poll(fds, closed_fd >= 0 ? 2 : 1, -1);
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    if (result < 0) {
+      throw last_error("poll");
+    }
+    if (closed_fd >= 0 && fds[1].revents) {
+      return false;
+    }
+    return true;
+  }
+}
+} // namespace
+
+UnixSocketChannel::UnixSocketChannel(int socket, int closed_fd) : m_socket{socket}, m_closed_fd{closed_fd} {}
+
+UnixSocketChannel::~UnixSocketChannel() { ::close(m_socket); }
+
+std::unique_ptr<UnixSocketChannel> UnixSocketChannel::connect(const std::string &path) {
+  auto address = socket_address(path);
+  auto socket = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (socket < 0) {
+    throw last_error("socket");
+  }
+  if (::connect(socket, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+    ::close(socket);
+    return nullptr;
+  }
+  return std::make_unique<UnixSocketChannel>(socket);
+}
+
+void UnixSocketChannel::wait(short events) {
+  if (!wait_ready(m_socket, events, m_closed_fd)) {
+    throw IpcError("listener closed");
+  }
+}
+
+void UnixSocketChannel::write(const char *data, size_t size) {
+  while (size > 0) {
+    wait(POLLOUT);
+    // MSG_NOSIGNAL: a peer that went away is an IpcError, not a SIGPIPE
+    auto written = ::send(m_socket, data, size, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+      continue;
+    }
+    if (written < 0) {
+      throw last_error("send");
+    }
+    data += written;
+    size -= static_cast<size_t>(written);
+  }
+}
+
+void UnixSocketChannel::read(char *data, size_t size) {
+  while (size > 0) {
+    wait(POLLIN);
+    auto read = ::recv(m_socket, data, size, MSG_DONTWAIT);
+    if (read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+      continue;
+    }
+    if (read < 0) {
+      throw last_error("recv");
+    }
+    if (read == 0) {
+      throw IpcError("socket closed");
+    }
+    data += read;
+    size -= static_cast<size_t>(read);
+  }
+}
+
+UnixSocketListener::UnixSocketListener(std::string path) : m_path{std::move(path)} {
+  if (pipe2(m_closed_pipe, O_CLOEXEC) != 0) {
+    throw last_error("pipe");
+  }
+}
+
+UnixSocketListener::~UnixSocketListener() {
+  ::unlink(m_path.c_str());
+  ::close(m_closed_pipe[0]);
+  ::close(m_closed_pipe[1]);
+}
+
+void UnixSocketListener::close() {
+  char byte = 0;
+  // only the first byte matters, later ones may fail once the pipe is full
+  [[maybe_unused]] auto ignored = ::write(m_closed_pipe[1], &byte, 1);
+}
+
+std::unique_ptr<IpcChannel> UnixSocketListener::accept() {
+  pollfd closed{m_closed_pipe[0], POLLIN, 0};
+  if (poll(&closed, 1, 0) > 0) {
+    throw IpcError("listener closed");
+  }
+  auto address = socket_address(m_path);
+  // a socket file nobody listens on is left over from a listener that is busy or gone; if someone answers, another process owns the name
+  if (auto owner = UnixSocketChannel::connect(m_path)) {
+    throw IpcError("another process listens on " + m_path);
+  }
+  ::unlink(m_path.c_str());
+  auto listening = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listening < 0) {
+    throw last_error("socket");
+  }
+  if (::bind(listening, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 || ::listen(listening, 1) != 0) {
+    auto error = last_error("bind");
+    ::close(listening);
+    throw error;
+  }
+  int socket = -1;
+  try {
+    if (!wait_ready(listening, POLLIN, m_closed_pipe[0])) {
+      throw IpcError("listener closed");
+    }
+    socket = ::accept4(listening, nullptr, nullptr, SOCK_CLOEXEC);
+    if (socket < 0) {
+      throw last_error("accept");
+    }
+  } catch (...) {
+    ::close(listening);
+    throw;
+  }
+  // no more clients until the next accept(), a client that queued up in the meantime sees the connection reset
+  ::close(listening);
+  return std::make_unique<UnixSocketChannel>(socket, m_closed_pipe[0]);
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "ipc.hpp"
+#include <memory>
+#include <string>
+
+// One end of a Unix domain stream socket connection, the POSIX counterpart of NamedPipeChannel. A server side channel
+// gives up as soon as its listener is closed.
+class UnixSocketChannel : public IpcChannel {
+public:
+  explicit UnixSocketChannel(int socket, int closed_fd = -1);
+  UnixSocketChannel(const UnixSocketChannel &) = delete;
+  UnixSocketChannel &operator=(const UnixSocketChannel &) = delete;
+  ~UnixSocketChannel() override;
+
+  // Returns nullptr when nobody is listening or the listener is busy with another client.
+  static std::unique_ptr<UnixSocketChannel> connect(const std::string &path);
+
+  void write(const char *data, size_t size) override;
+  void read(char *data, size_t size) override;
+
+private:
+  void wait(short events);
+
+  int m_socket;
+  int m_closed_fd;
+};
+
+// Serves one client at a time like NamedPipeListener: the socket only listens while accept() runs, so other clients
+// are refused immediately instead of queueing. A client that connects in the instant before accept() returns is reset
+// instead of refused. The listener has to outlive the channels it accepted.
+class UnixSocketListener : public IpcListener {
+public:
+  explicit UnixSocketListener(std::string path);
+  UnixSocketListener(const UnixSocketListener &) = delete;
+  UnixSocketListener &operator=(const UnixSocketListener &) = delete;
+  ~UnixSocketListener() override;
+
+  std::unique_ptr<IpcChannel> accept() override;
+  void close() override;
+
+private:
+  std::string m_path;
+  // the read end becomes readable for good once the listener is closed
+  int m_closed_pipe[2];
+};
@@ -0,0 +1,144 @@
+#include "win_display_backend.hpp"
+#include "WinReg.hpp"
+
+namespace {
+std::string narrow(const wchar_t *text) {
+  auto length = WideCharToMultiByte(CP_UTF8, 0, text, -1, nullptr, 0, nullptr, nullptr);
+  if (length <= 1) {
+    return {};
+  }
+  std::string result(length - 1, '\0');
+  WideCharToMultiByte(CP_UTF8, 0, text, -1, result.data(), length, nullptr, nullptr);
+  return result;
+}
+
+std::wstring widen(const std::string &text) {
+  auto length = MultiByteToWideChar(CP_UTF8, 0, text.c_str(), -1, nullptr, 0);
+  if (length <= 1) {
+    return {};
+  }
+  std::wstring result(length - 1, L'\0');
+  MultiByteToWideChar(CP_UTF8, 0, text.c_str(), -1, result.data(), length);
+  return result;
+}
+
+std::optional<DISPLAY_DEVICE> get_primary_adapter() {
+  for (DWORD index = 0;; ++index) {
+    DISPLAY_DEVICE adapter{};
+    adapter.cb = sizeof(adapter);
+    if (!EnumDisplayDevices(nullptr, index, &adapter, 0)) {
+      return {};
+    }
+    if (adapter.StateFlags & DISPLAY_DEVICE_PRIMARY_DEVICE) {
+      return adapter;
+    }
+  }
+}
+
+std::wstring get_driver_version(const DISPLAY_DEVICE &adapter) {
+  // DeviceKey is a kernel path like \Registry\Machine\System\CurrentControlSet\Control\Video\{GUID}\0000
+  constexpr std::wstring_view machine_prefix = L"\\Registry\\Machine\\";
+  std::wstring_view device_key = adapter.DeviceKey;
+  if (device_key.size() <= machine_prefix.size() || _wcsnicmp(device_key.data(), machine_prefix.data(), machine_prefix.size()) != 0) {
+    return {};
+  }
+  winreg::RegKey key;
+  if (!key.TryOpen(HKEY_LOCAL_MACHINE, std::wstring(device_key.substr(machine_prefix.size())), KEY_READ)) {
+    return {};
+  }
+  return key.TryGetStringValue(L"DriverVersion").value_or(L"");
+}
+} // namespace
+
+DisplayMode to_display_mode(const DEVMODE &devmode) { return {devmode.dmPelsWidth, devmode.dmPelsHeight, devmode.dmDisplayFrequency}; }
+
+std::vector<DisplayMode> WinDisplayBackend::enumerate_modes() {
+  std::vector<DisplayMode> modes;
+  for (DWORD graphics_mode_index = 0;; ++graphics_mode_index) {
+    DEVMODE devmode{};
+    devmode.dmSize = sizeof(devmode);
+    if (!EnumDisplaySettings(nullptr, graphics_mode_index, &devmode)) {
+      break;
+    }
+    modes.push_back(to_display_mode(devmode));
+  }
+  return modes;
+}
+
+std::optional<DisplayMode> WinDisplayBackend::current_mode() {
+  DEVMODE devmode{};
+  devmode.dmSize = sizeof(devmode);
+  if (!EnumDisplaySettings(nullptr, ENUM_CURRENT_SETTINGS, &devmode)) {
+    return {};
+  }
+  return to_display_mode(devmode);
+}
+
+std::string WinDisplayBackend::identity() {
+  auto adapter = get_primary_adapter();
+  if (!adapter) {
+    return {};
+  }
+  DISPLAY_DEVICE monitor{};
+  monitor.cb = sizeof(monitor);
+  if (!EnumDisplayDevices(adapter->DeviceName, 0, &monitor, EDD_GET_DEVICE_INTERFACE_NAME)) {
+    return {};
+  }
+  auto driver_version = get_driver_version(*adapter);
+  if (driver_version.empty()) {
+    return {};
+  }
+  return narrow(adapter->DeviceID) + "|" + narrow(monitor.DeviceID) + "|" + narrow(driver_version.c_str());
+}
+
+std::vector<std::string> WinMultiDisplayBackend::devices() {
+  std::vector<std::string> devices;
+  for (DWORD index = 0;; ++index) {
+    DISPLAY_DEVICE adapter{};
+    adapter.cb = sizeof(adapter);
+    if (!EnumDisplayDevices(nullptr, index, &adapter, 0)) {
+      return devices;
+    }
+    if (adapter.StateFlags & DISPLAY_DEVICE_ATTACHED_TO_DESKTOP) {
+      devices.push_back(narrow(adapter.DeviceName));
+    }
+  }
+}
+
+std::vector<DisplayMode> WinMultiDisplayBackend::modes(const std::string &device) {
+  auto name = widen(device);
+  std::vector<DisplayMode> modes;
+  for (DWORD graphics_mode_index = 0;; ++graphics_mode_index) {
+    DEVMODE devmode{};
+    devmode.dmSize = sizeof(devmode);
+    if (!EnumDisplaySettings(name.c_str(), graphics_mode_index, &devmode)) {
+      break;
+    }
+    modes.push_back(to_display_mode(devmode));
+  }
+  return modes;
+}
+
+std::optional<DisplayMode> WinMultiDisplayBackend::current_mode(const std::string &device) {
+  DEVMODE devmode{};
+  devmode.dmSize = sizeof(devmode);
+  if (!EnumDisplaySettings(widen(device).c_str(), ENUM_CURRENT_SETTINGS, &devmode)) {
+    return {};
+  }
+  return to_display_mode(devmode);
+}
+
+bool WinMultiDisplayBackend::stage(const std::string &device, const DisplayMode &mode) {
+  DEVMODE devmode{};
+  devmode.dmSize = sizeof(devmode);
+  devmode.dmPelsWidth = mode.width;
+  devmode.dmPelsHeight = mode.height;
+  devmode.dmFields = DM_PELSWIDTH | DM_PELSHEIGHT;
+  if (mode.refresh_rate != 0) {
+    devmode.dmDisplayFrequency = mode.refresh_rate;
+    devmode.dmFields |= DM_DISPLAYFREQUENCY;
+  }
+  return ChangeDisplaySettingsEx(widen(device).c_str(), &devmode, nullptr, CDS_UPDATEREGISTRY | CDS_NORESET, nullptr) == DISP_CHANGE_SUCCESSFUL;
+}
+
+bool WinMultiDisplayBackend::apply() { return ChangeDisplaySettingsEx(nullptr, nullptr, nullptr, 0, nullptr) == DISP_CHANGE_SUCCESSFUL; }
@@ -0,0 +1,25 @@
+#pragma once
+#include "display_backend.hpp"
+#include "display_batch.hpp"
+#include "windows.h"
+
+DisplayMode to_display_mode(const DEVMODE &devmode);
+
+// Primary display as seen through EnumDisplaySettings/EnumDisplayDevices.
+class WinDisplayBackend : public DisplayBackend {
+public:
+  std::vector<DisplayMode> enumerate_modes() override;
+  std::optional<DisplayMode> current_mode() override;
+  std::string identity() override;
+};
+
+// Every display attached to the desktop. Staging uses CDS_NORESET, which is only valid together with
+// CDS_UPDATEREGISTRY, so batched modes are written to the registry until they are restored.
+class WinMultiDisplayBackend : public MultiDisplayBackend {
+public:
+  std::vector<std::string> devices() override;
+  std::vector<DisplayMode> modes(const std::string &device) override;
+  std::optional<DisplayMode> current_mode(const std::string &device) override;
+  bool stage(const std::string &device, const DisplayMode &mode) override;
+  bool apply() override;
+};
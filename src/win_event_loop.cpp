@@ -0,0 +1,51 @@
+#include "event_loop.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+const HANDLE EventLoop::no_object = nullptr;
+
+EventLoop::EventLoop() : m_posted_event{CreateEventW(nullptr, FALSE, FALSE, nullptr)} {}
+
+EventLoop::~EventLoop() { CloseHandle(m_posted_event); }
+
+void EventLoop::watch(HANDLE object, Handler on_signaled) {
+  // MsgWaitForMultipleObjectsEx takes MAXIMUM_WAIT_OBJECTS - 1 objects, the posted work event and run_until need one each
+  if (m_watches.size() >= MAXIMUM_WAIT_OBJECTS - 3) {
+    throw std::length_error("EventLoop: too many watched objects");
+  }
+  m_watches.push_back({object, std::move(on_signaled)});
+}
+
+void EventLoop::unwatch(HANDLE object) {
+  m_watches.erase(std::remove_if(m_watches.begin(), m_watches.end(), [object](const Watch &w) { return w.object == object; }), m_watches.end());
+}
+
+void EventLoop::wake() { SetEvent(m_posted_event); }
+
+void EventLoop::wait_once(HANDLE extra_object, std::vector<HANDLE> &ready) {
+  std::vector<HANDLE> objects;
+  objects.reserve(m_watches.size() + 2);
+  objects.push_back(m_posted_event);
+  for (const auto &w : m_watches) {
+    objects.push_back(w.object);
+  }
+  if (extra_object != no_object) {
+    objects.push_back(extra_object);
+  }
+
+  auto timeout = time_to_next_timer();
+  auto result = MsgWaitForMultipleObjectsEx(static_cast<DWORD>(objects.size()), objects.data(), timeout ? static_cast<DWORD>(timeout->count()) : INFINITE,
+                                            QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+  if (result < WAIT_OBJECT_0 + objects.size()) {
+    ready.push_back(objects[result - WAIT_OBJECT_0]);
+  } else if (result == WAIT_OBJECT_0 + objects.size()) {
+    MSG msg;
+    while (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE)) {
+      TranslateMessage(&msg);
+      DispatchMessage(&msg);
+    }
+  } else if (result == WAIT_FAILED) {
+    throw std::runtime_error("MsgWaitForMultipleObjectsEx failed with error " + std::to_string(GetLastError()));
+  }
+}
@@ -0,0 +1,74 @@
+#include "win_flight_recorder.hpp"
+#include "flight_recorder.hpp"
+#include "logger.hpp"
+#include "windows.h"
+#include <fstream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+namespace {
+bool process_alive(uint32_t pid) {
+  // a ring with this process's id was left by an earlier process that had the same id
+  if (pid == GetCurrentProcessId()) {
+    return false;
+  }
+  auto process = OpenProcess(SYNCHRONIZE, FALSE, pid);
+  if (!process) {
+    return false;
+  }
+  bool alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+  CloseHandle(process);
+  return alive;
+}
+} // namespace
+
+bool start_flight_recorder(const fs::path &path, const fs::path &report_path, uint32_t capacity, Logger &logger) {
+  std::string previous;
+  if (std::ifstream in{path, std::ios::binary}) {
+    previous.assign(std::istreambuf_iterator<char>(in), {});
+  }
+  if (auto report = flight::recover(previous); report && !report->clean) {
+    if (process_alive(report->owner_pid)) {
+      logger.warn("Launcher process {} is still recording into {}, the flight recorder is off", report->owner_pid, path.string());
+      return false;
+    }
+    auto lines = flight::describe(*report);
+    std::ofstream out{report_path, std::ios::trunc};
+    for (const auto &line : lines) {
+      out << line << '\n';
+    }
+    logger.warn("The previous launcher did not shut down cleanly, its last {} events are in {}", report->records.size(), report_path.string());
+    // the last few are usually enough to tell what it was doing
+    constexpr size_t logged_events = 10;
+    auto first = lines.size() > logged_events + 1 ? lines.size() - logged_events : size_t{1};
+    logger.warn("{}", lines.front());
+    for (auto i = first; i < lines.size(); ++i) {
+      logger.warn("  {}", lines[i]);
+    }
+  }
+
+  auto size = flight::region_size(capacity);
+  auto file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    logger.warn("Cannot open {}, error {}, the flight recorder is off", path.string(), GetLastError());
+    return false;
+  }
+  // the mapping grows the file to the size of the ring, the view keeps the mapping and the file open
+  auto mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(uint64_t{size} >> 32), static_cast<DWORD>(size), nullptr);
+  auto view = mapping ? MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, size) : nullptr;
+  auto error = GetLastError();
+  if (mapping) {
+    CloseHandle(mapping);
+  }
+  CloseHandle(file);
+  if (!view) {
+    logger.warn("Cannot map {}, error {}, the flight recorder is off", path.string(), error);
+    return false;
+  }
+  if (!flight::attach(view, size, capacity, GetCurrentProcessId())) {
+    UnmapViewOfFile(view);
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+
+class Logger;
+
+// Reports what the previous launcher left in the flight recorder file if it did not end cleanly, then maps the file
+// and records into it. The view stays mapped until the process exits. Returns false, and nothing is recorded, if the
+// file cannot be mapped or a launcher that is still running records into it.
+bool start_flight_recorder(const std::filesystem::path &path, const std::filesystem::path &report_path, uint32_t capacity, Logger &logger);
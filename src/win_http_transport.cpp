@@ -0,0 +1,72 @@
+#include "win_http_transport.hpp"
+#include "windows.h"
+#include <winhttp.h>
+
+namespace {
+std::wstring widen(const std::string &text) {
+  auto length = MultiByteToWideChar(CP_UTF8, 0, text.c_str(), -1, nullptr, 0);
+  if (length <= 1) {
+    return {};
+  }
+  std::wstring result(length - 1, L'\0');
+  MultiByteToWideChar(CP_UTF8, 0, text.c_str(), -1, result.data(), length);
+  return result;
+}
+
+class InternetHandle {
+public:
+  explicit InternetHandle(HINTERNET handle) : m_handle{handle} {}
+  InternetHandle(const InternetHandle &) = delete;
+  InternetHandle &operator=(const InternetHandle &) = delete;
+  ~InternetHandle() {
+    if (m_handle) {
+      WinHttpCloseHandle(m_handle);
+    }
+  }
+  HINTERNET get() const { return m_handle; }
+  explicit operator bool() const { return m_handle != nullptr; }
+
+private:
+  HINTERNET m_handle;
+};
+} // namespace
+
+UploadResult post_sentry_envelope(const SentryEndpoint &endpoint, const std::string &envelope, std::chrono::milliseconds timeout) {
+  auto url = widen(endpoint.url);
+  URL_COMPONENTS components{};
+  components.dwStructSize = sizeof(components);
+  components.dwHostNameLength = static_cast<DWORD>(-1);
+  components.dwUrlPathLength = static_cast<DWORD>(-1);
+  if (!WinHttpCrackUrl(url.c_str(), 0, 0, &components)) {
+    return UploadResult::rejected;
+  }
+  std::wstring host(components.lpszHostName, components.dwHostNameLength);
+  std::wstring path(components.lpszUrlPath, components.dwUrlPathLength);
+
+  InternetHandle session{WinHttpOpen(L"moonlight_hdr_launcher", WINHTTP_ACCESS_TYPE_DEFAULT_PROXY, WINHTTP_NO_PROXY_NAME, WINHTTP_NO_PROXY_BYPASS, 0)};
+  if (!session) {
+    return UploadResult::retry_later;
+  }
+  auto ms = static_cast<int>(timeout.count());
+  WinHttpSetTimeouts(session.get(), ms, ms, ms, ms);
+  InternetHandle connection{WinHttpConnect(session.get(), host.c_str(), components.nPort, 0)};
+  InternetHandle request{connection ? WinHttpOpenRequest(connection.get(), L"POST", path.c_str(), nullptr, WINHTTP_NO_REFERER, WINHTTP_DEFAULT_ACCEPT_TYPES,
+                                                         components.nScheme == INTERNET_SCHEME_HTTPS ? WINHTTP_FLAG_SECURE : 0)
+                                    : nullptr};
+  if (!request) {
+    return UploadResult::retry_later;
+  }
+  auto headers = widen("Content-Type: application/x-sentry-envelope\r\nX-Sentry-Auth: " + endpoint.auth + "\r\n");
+  if (!WinHttpSendRequest(request.get(), headers.c_str(), static_cast<DWORD>(-1), const_cast<char *>(envelope.data()), static_cast<DWORD>(envelope.size()),
+                          static_cast<DWORD>(envelope.size()), 0) ||
+      !WinHttpReceiveResponse(request.get(), nullptr)) {
+    return UploadResult::retry_later;
+  }
+  DWORD status = 0;
+  DWORD size = sizeof(status);
+  if (!WinHttpQueryHeaders(request.get(), WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER, WINHTTP_HEADER_NAME_BY_INDEX, &status, &size,
+                           WINHTTP_NO_HEADER_INDEX)) {
+    return UploadResult::retry_later;
+  }
+  return classify_upload_status(static_cast<int>(status));
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include "report_uploader.hpp"
+#include <chrono>
+#include <string>
+
+// Posts a Sentry envelope with WinHTTP, which brings TLS and the system's proxy settings. The timeout bounds each
+// step of the request, and so how long the launcher waits for an upload in progress when it exits.
+UploadResult post_sentry_envelope(const SentryEndpoint &endpoint, const std::string &envelope, std::chrono::milliseconds timeout);
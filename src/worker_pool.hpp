@@ -0,0 +1,70 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed number of threads working off a shared FIFO queue. The destructor finishes the queued work and joins.
+class WorkerPool {
+public:
+  explicit WorkerPool(size_t thread_count) {
+    thread_count = thread_count == 0 ? 1 : thread_count;
+    m_threads.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+      m_threads.emplace_back([this]() { work(); });
+    }
+  }
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+  virtual ~WorkerPool() {
+    {
+      std::lock_guard lock{m_mutex};
+      m_stopping = true;
+    }
+    m_cv.notify_all();
+    for (auto &thread : m_threads) {
+      thread.join();
+    }
+  }
+
+  template <typename task_function> auto submit(task_function &&task) -> std::future<std::invoke_result_t<task_function>> {
+    using result_type = std::invoke_result_t<task_function>;
+    auto packaged = std::make_shared<std::packaged_task<result_type()>>(std::forward<task_function>(task));
+    auto future = packaged->get_future();
+    {
+      std::lock_guard lock{m_mutex};
+      m_queue.emplace_back([packaged]() { (*packaged)(); });
+    }
+    m_cv.notify_one();
+    return future;
+  }
+
+  size_t size() const { return m_threads.size(); }
+
+private:
+  void work() {
+    for (;;) {
+      std::function<void()> task;
+      {
+        std::unique_lock lock{m_mutex};
+        m_cv.wait(lock, [this]() { return m_stopping || !m_queue.empty(); });
+        if (m_queue.empty()) {
+          return;
+        }
+        task = std::move(m_queue.front());
+        m_queue.pop_front();
+      }
+      task();
+    }
+  }
+
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::deque<std::function<void()>> m_queue;
+  bool m_stopping = false;
+  std::vector<std::thread> m_threads;
+};
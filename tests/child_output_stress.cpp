@@ -0,0 +1,162 @@
+#include "line_framer.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+// Pushes a large amount of output through a child's stdout and stderr and frames it the way ChildOutputPump does:
+// large reads driven by readiness, one LineFramer per stream, and a full drain after the child exits.
+// Usage: child_output_stress [megabytes per stream], e.g. 4096 for a multi-gigabyte run.
+
+namespace {
+
+struct Stream {
+  int fd = -1;
+  LineFramer framer;
+  std::uint64_t lines = 0;
+  std::uint64_t bytes = 0;
+};
+
+// Lines of varying length so they straddle read boundaries, each line is "<index>:" followed by filler.
+std::string make_block(std::size_t size, std::uint64_t &lines) {
+  std::string block;
+  block.reserve(size + 200);
+  while (block.size() < size) {
+    auto line = std::to_string(lines) + ':';
+    line.append(lines % 157, 'x');
+    block += line;
+    block += (lines % 3 == 0) ? "\r\n" : "\n";
+    ++lines;
+  }
+  return block;
+}
+
+void write_all(int fd, std::string_view data) {
+  while (!data.empty()) {
+    auto written = ::write(fd, data.data(), data.size());
+    if (written <= 0) {
+      std::_Exit(2);
+    }
+    data.remove_prefix(static_cast<std::size_t>(written));
+  }
+}
+
+double cpu_seconds() {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  const std::uint64_t megabytes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 256;
+  const std::uint64_t total = megabytes * 1024 * 1024;
+  std::uint64_t block_lines = 0;
+  const auto block = make_block(1024 * 1024, block_lines);
+  const auto blocks = total / block.size() + 1;
+
+  int out[2], err[2];
+  if (pipe(out) != 0 || pipe(err) != 0) {
+    std::perror("pipe");
+    return 1;
+  }
+  auto child = fork();
+  if (child == 0) {
+    close(out[0]);
+    close(err[0]);
+    // Half on each stream, with an idle gap in the middle during which the reader must not wake up
+    for (std::uint64_t i = 0; i < blocks; ++i) {
+      write_all(i % 2 ? err[1] : out[1], block);
+      if (i == blocks / 2) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{200});
+      }
+    }
+    // A last unterminated line that only the final flush hands out
+    write_all(out[1], "tail");
+    std::_Exit(0);
+  }
+  close(out[1]);
+  close(err[1]);
+
+  Stream streams[2];
+  streams[0].fd = out[0];
+  streams[1].fd = err[0];
+  std::string buffer(64 * 1024, '\0');
+  std::uint64_t wakeups = 0;
+  std::string last_line;
+  const auto cpu_start = cpu_seconds();
+  const auto start = std::chrono::steady_clock::now();
+
+  for (int open = 2; open > 0;) {
+    pollfd fds[2];
+    nfds_t count = 0;
+    for (auto &stream : streams) {
+      if (stream.fd >= 0) {
+        fds[count++] = {stream.fd, POLLIN, 0};
+      }
+    }
+    if (poll(fds, count, -1) < 0) {
+      std::perror("poll");
+      return 1;
+    }
+    ++wakeups;
+    for (nfds_t i = 0; i < count; ++i) {
+      if (!fds[i].revents) {
+        continue;
+      }
+      auto &stream = fds[i].fd == streams[0].fd ? streams[0] : streams[1];
+      auto on_line = [&](std::string_view line) {
+        ++stream.lines;
+        stream.bytes += line.size();
+        if (&stream == &streams[0]) {
+          last_line = line;
+        }
+      };
+      auto bytes_read = ::read(stream.fd, buffer.data(), buffer.size());
+      if (bytes_read > 0) {
+        stream.framer.feed(std::string_view{buffer.data(), static_cast<std::size_t>(bytes_read)}, on_line);
+      } else {
+        stream.framer.flush(on_line);
+        close(stream.fd);
+        stream.fd = -1;
+        --open;
+      }
+    }
+  }
+
+  const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  const auto cpu = cpu_seconds() - cpu_start;
+  int status = 0;
+  waitpid(child, &status, 0);
+
+  const auto out_blocks = blocks / 2;
+  const auto err_blocks = blocks - out_blocks;
+  const auto expected_out = out_blocks * block_lines + 1;
+  const auto expected_err = err_blocks * block_lines;
+  const auto mib = static_cast<double>(blocks * block.size()) / (1024 * 1024);
+  std::printf("%.0f MiB in %.3f s: %.0f MiB/s, launcher CPU %.3f s (%.1f%% of one core), %llu wakeups\n", mib, seconds, mib / seconds, cpu,
+              100 * cpu / seconds, static_cast<unsigned long long>(wakeups));
+  std::printf("stdout %llu lines, stderr %llu lines\n", static_cast<unsigned long long>(streams[0].lines), static_cast<unsigned long long>(streams[1].lines));
+
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    std::fprintf(stderr, "the child failed\n");
+    return 1;
+  }
+  if (streams[0].lines != expected_out || streams[1].lines != expected_err) {
+    std::fprintf(stderr, "expected %llu and %llu lines\n", static_cast<unsigned long long>(expected_out), static_cast<unsigned long long>(expected_err));
+    return 1;
+  }
+  if (last_line != "tail") {
+    std::fprintf(stderr, "the trailing partial line was lost\n");
+    return 1;
+  }
+  return 0;
+}
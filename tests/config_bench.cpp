@@ -0,0 +1,78 @@
+#include "config.hpp"
+#include "logger.hpp"
+#include <benchmark/benchmark.h>
+#include <boost/property_tree/ini_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+// The string_view reader and schema against the boost::property_tree path it replaced, on the same document.
+
+namespace {
+
+const std::string document = R"(; moonlight_hdr_launcher.ini
+[options]
+launcher_exe = gamestream_launchpad.exe 2560 1440 gamestream_gog_galaxy.ini --no-nv-kill
+wait_on_process = 1
+toggle_hdr = 1
+res_x = 2560
+res_y = 1440
+refresh_rate = 120
+refresh_rate_use_max = 0
+remote_desktop = 0
+compatibility_window = 1
+)";
+
+void BM_PropertyTree(benchmark::State &state) {
+  namespace pt = boost::property_tree;
+  for (auto _ : state) {
+    std::istringstream ini_f{document};
+    pt::ptree ini;
+    pt::read_ini(ini_f, ini);
+    std::string launcher_exe;
+    bool wait_on_process = true, toggle_hdr = false, refresh_rate_use_max = true, remote_desktop = false, compatibility_window = true;
+    uint16_t res_x = 0, res_y = 0, refresh_rate = 0;
+    launcher_exe = ini.get_optional<std::string>("options.launcher_exe").get_value_or(launcher_exe);
+    wait_on_process = ini.get_optional<bool>("options.wait_on_process").get_value_or(wait_on_process);
+    toggle_hdr = ini.get_optional<bool>("options.toggle_hdr").get_value_or(toggle_hdr);
+    res_x = ini.get_optional<uint16_t>("options.res_x").get_value_or(res_x);
+    res_y = ini.get_optional<uint16_t>("options.res_y").get_value_or(res_y);
+    refresh_rate = ini.get_optional<uint16_t>("options.refresh_rate").get_value_or(refresh_rate);
+    refresh_rate_use_max = ini.get_optional<bool>("options.refresh_rate_use_max").get_value_or(refresh_rate_use_max);
+    remote_desktop = ini.get_optional<bool>("options.remote_desktop").get_value_or(remote_desktop);
+    compatibility_window = ini.get_optional<bool>("options.compatibility_window").get_value_or(compatibility_window);
+    benchmark::DoNotOptimize(launcher_exe);
+    benchmark::DoNotOptimize(res_x + res_y + refresh_rate + wait_on_process + toggle_hdr + refresh_rate_use_max + remote_desktop + compatibility_window);
+  }
+}
+BENCHMARK(BM_PropertyTree);
+
+void BM_IniReader(benchmark::State &state) {
+  for (auto _ : state) {
+    IniReader reader{document};
+    IniReader::Entry entry;
+    size_t entries = 0;
+    while (reader.next(entry)) {
+      ++entries;
+    }
+    benchmark::DoNotOptimize(entries);
+  }
+}
+BENCHMARK(BM_IniReader);
+
+void BM_ParseConfig(benchmark::State &state) {
+  auto path = std::filesystem::temp_directory_path() / ("mhdrl_config_bench_" + std::to_string(getpid()) + ".txt");
+  {
+    Logger logger{path, false};
+    for (auto _ : state) {
+      auto config = parse_config(document, logger);
+      benchmark::DoNotOptimize(config);
+    }
+  }
+  std::filesystem::remove(path);
+}
+BENCHMARK(BM_ParseConfig);
+
+} // namespace
@@ -0,0 +1,189 @@
+#include "display_batch.hpp"
+#include "fake_display_backend.hpp"
+#include <catch2/catch.hpp>
+#include <optional>
+#include <string>
+#include <vector>
+
+bool operator==(const DisplayTarget &a, const DisplayTarget &b) { return a.device == b.device && a.mode == b.mode; }
+
+namespace {
+
+// A real monitor and a dummy plug, each with its own modes
+FakeMultiDisplayBackend two_displays() {
+  FakeMultiDisplayBackend backend;
+  backend.displays["\\\\.\\DISPLAY1"] = {{{2560, 1440, 144}, {1920, 1080, 60}, {1920, 1080, 120}}, {2560, 1440, 144}};
+  backend.displays["\\\\.\\DISPLAY2"] = {{{1920, 1080, 60}, {3840, 2160, 60}}, {1920, 1080, 60}};
+  return backend;
+}
+
+DisplayMode current(FakeMultiDisplayBackend &backend, const std::string &device) { return *backend.current_mode(device); }
+
+} // namespace
+
+TEST_CASE("All displays change in one reconfiguration and restore the same way", "[display_batch]") {
+  auto backend = two_displays();
+  std::vector<DisplayChange> changes = {{"\\\\.\\DISPLAY1", {2560, 1440, 144}, {1920, 1080, 120}}, {"\\\\.\\DISPLAY2", {1920, 1080, 60}, {3840, 2160, 60}}};
+  REQUIRE(apply_display_changes(backend, changes));
+  CHECK(backend.resyncs == 1);
+  CHECK(current(backend, "\\\\.\\DISPLAY1") == DisplayMode{1920, 1080, 120});
+  CHECK(current(backend, "\\\\.\\DISPLAY2") == DisplayMode{3840, 2160, 60});
+
+  REQUIRE(restore_display_changes(backend, changes));
+  CHECK(backend.resyncs == 2);
+  CHECK(current(backend, "\\\\.\\DISPLAY1") == DisplayMode{2560, 1440, 144});
+  CHECK(current(backend, "\\\\.\\DISPLAY2") == DisplayMode{1920, 1080, 60});
+}
+
+TEST_CASE("Nothing to change does not resync", "[display_batch]") {
+  auto backend = two_displays();
+  CHECK(apply_display_changes(backend, {}));
+  CHECK(restore_display_changes(backend, {}));
+  CHECK(backend.resyncs == 0);
+  CHECK(backend.stage_calls.empty());
+}
+
+TEST_CASE("A rejected stage rolls back what was staged and applies nothing", "[display_batch]") {
+  auto backend = two_displays();
+  // DISPLAY2 does not offer 2560x1440
+  std::vector<DisplayChange> changes = {{"\\\\.\\DISPLAY1", {2560, 1440, 144}, {1920, 1080, 60}}, {"\\\\.\\DISPLAY2", {1920, 1080, 60}, {2560, 1440, 60}}};
+  CHECK_FALSE(apply_display_changes(backend, changes));
+  CHECK(backend.resyncs == 0);
+  CHECK(backend.stage_calls ==
+        std::vector<DisplayTarget>{{"\\\\.\\DISPLAY1", {1920, 1080, 60}}, {"\\\\.\\DISPLAY2", {2560, 1440, 60}}, {"\\\\.\\DISPLAY1", {2560, 1440, 144}}});
+  // whatever applies next sees the original mode staged again
+  CHECK(backend.staged.at("\\\\.\\DISPLAY1") == DisplayMode{2560, 1440, 144});
+  CHECK(current(backend, "\\\\.\\DISPLAY1") == DisplayMode{2560, 1440, 144});
+  CHECK(current(backend, "\\\\.\\DISPLAY2") == DisplayMode{1920, 1080, 60});
+}
+
+TEST_CASE("A rejected first stage stages nothing back", "[display_batch]") {
+  auto backend = two_displays();
+  std::vector<DisplayChange> changes = {{"\\\\.\\DISPLAY3", {1920, 1080, 60}, {1280, 720, 60}}, {"\\\\.\\DISPLAY1", {2560, 1440, 144}, {1920, 1080, 60}}};
+  CHECK_FALSE(apply_display_changes(backend, changes));
+  CHECK(backend.stage_calls.size() == 1);
+  CHECK(backend.staged.empty());
+}
+
+TEST_CASE("A failed apply is reported", "[display_batch]") {
+  auto backend = two_displays();
+  backend.fail_apply = true;
+  CHECK_FALSE(apply_display_changes(backend, {{"\\\\.\\DISPLAY1", {2560, 1440, 144}, {1920, 1080, 60}}}));
+  CHECK(backend.resyncs == 1);
+  CHECK(current(backend, "\\\\.\\DISPLAY1") == DisplayMode{2560, 1440, 144});
+}
+
+TEST_CASE("Current modes of every attached display", "[display_batch]") {
+  auto backend = two_displays();
+  CHECK(current_display_modes(backend) == std::vector<DisplayTarget>{{"\\\\.\\DISPLAY1", {2560, 1440, 144}}, {"\\\\.\\DISPLAY2", {1920, 1080, 60}}});
+}
+
+TEST_CASE("Display targets are parsed", "[display_batch]") {
+  struct Case {
+    const char *text;
+    std::optional<std::vector<DisplayTarget>> expected;
+  };
+  const std::vector<Case> cases = {
+      {"DISPLAY1=1920x1080@60", std::vector<DisplayTarget>{{"\\\\.\\DISPLAY1", {1920, 1080, 60}}}},
+      {"\\\\.\\DISPLAY2=2560x1440", std::vector<DisplayTarget>{{"\\\\.\\DISPLAY2", {2560, 1440, 0}}}},
+      {" DISPLAY1 = 1920x1080 ; DISPLAY2=3840x2160@120 ",
+       std::vector<DisplayTarget>{{"\\\\.\\DISPLAY1", {1920, 1080, 0}}, {"\\\\.\\DISPLAY2", {3840, 2160, 120}}}},
+      {"DISPLAY1=1280x720;;", std::vector<DisplayTarget>{{"\\\\.\\DISPLAY1", {1280, 720, 0}}}},
+      {"", std::vector<DisplayTarget>{}},
+      {";;", std::vector<DisplayTarget>{}},
+      {" ; ", std::vector<DisplayTarget>{}},
+      {"DISPLAY1=1920x@60", std::nullopt},
+      {"DISPLAY1=x1080", std::nullopt},
+      {"DISPLAY1=1920x1080@", std::nullopt},
+      {"DISPLAY1=1920@60x1080", std::nullopt},
+      {"DISPLAY1=0x1080", std::nullopt},
+      {"DISPLAY1=1920x0", std::nullopt},
+      {"DISPLAY1=-1920x1080", std::nullopt},
+      {"DISPLAY1=1920x1080@60Hz", std::nullopt},
+      {"DISPLAY1=99999999999x1080", std::nullopt},
+      {"DISPLAY1=1920*1080", std::nullopt},
+      {"DISPLAY1", std::nullopt},
+      {"=1920x1080", std::nullopt},
+      {"DISPLAY1=1920x1080;DISPLAY2", std::nullopt},
+  };
+  for (const auto &c : cases) {
+    SECTION(c.text) { CHECK(parse_display_targets(c.text) == c.expected); }
+  }
+}
+
+TEST_CASE("Targets are diffed against the current modes", "[display_batch]") {
+  const std::vector<DisplayTarget> current = {{"\\\\.\\DISPLAY1", {2560, 1440, 144}}, {"\\\\.\\DISPLAY2", {1920, 1080, 60}}};
+  struct Case {
+    const char *name;
+    std::vector<DisplayTarget> targets;
+    std::vector<DisplayChange> changes;
+    std::vector<std::string> unknown;
+  };
+  const std::vector<Case> cases = {
+      {"already in the mode", {{"\\\\.\\DISPLAY1", {2560, 1440, 144}}}, {}, {}},
+      {"no refresh rate keeps the current one", {{"\\\\.\\DISPLAY1", {1920, 1080, 0}}},
+       {{"\\\\.\\DISPLAY1", {2560, 1440, 144}, {1920, 1080, 144}}}, {}},
+      {"no refresh rate and the same size", {{"\\\\.\\DISPLAY2", {1920, 1080, 0}}}, {}, {}},
+      {"only the refresh rate", {{"\\\\.\\DISPLAY2", {1920, 1080, 120}}}, {{"\\\\.\\DISPLAY2", {1920, 1080, 60}, {1920, 1080, 120}}}, {}},
+      {"not attached", {{"\\\\.\\DISPLAY3", {1920, 1080, 60}}}, {}, {"\\\\.\\DISPLAY3"}},
+      {"mixed",
+       {{"\\\\.\\DISPLAY3", {1280, 720, 60}}, {"\\\\.\\DISPLAY2", {3840, 2160, 60}}, {"\\\\.\\DISPLAY1", {2560, 1440, 144}}},
+       {{"\\\\.\\DISPLAY2", {1920, 1080, 60}, {3840, 2160, 60}}},
+       {"\\\\.\\DISPLAY3"}},
+  };
+  for (const auto &c : cases) {
+    SECTION(c.name) {
+      std::vector<std::string> unknown;
+      auto changes = diff_display_targets(current, c.targets, unknown);
+      REQUIRE(changes.size() == c.changes.size());
+      for (size_t i = 0; i < changes.size(); ++i) {
+        CHECK(changes[i].device == c.changes[i].device);
+        CHECK(changes[i].original == c.changes[i].original);
+        CHECK(changes[i].target == c.changes[i].target);
+      }
+      CHECK(unknown == c.unknown);
+    }
+  }
+}
+
+TEST_CASE("A rejected stage during restore stages the targets back", "[display_batch]") {
+  const std::vector<DisplayChange> changes = {{"\\\\.\\DISPLAY1", {2560, 1440, 144}, {1920, 1080, 120}},
+                                              {"\\\\.\\DISPLAY2", {1920, 1080, 60}, {3840, 2160, 60}},
+                                              {"\\\\.\\DISPLAY3", {1920, 1080, 60}, {1280, 720, 60}}};
+  struct Case {
+    const char *name;
+    size_t rejected; // the change whose original mode is no longer offered
+    std::vector<DisplayTarget> stage_calls;
+  };
+  const std::vector<Case> cases = {
+      {"first", 0, {{"\\\\.\\DISPLAY1", {2560, 1440, 144}}}},
+      {"middle", 1,
+       {{"\\\\.\\DISPLAY1", {2560, 1440, 144}}, {"\\\\.\\DISPLAY2", {1920, 1080, 60}}, {"\\\\.\\DISPLAY1", {1920, 1080, 120}}}},
+      {"last", 2,
+       {{"\\\\.\\DISPLAY1", {2560, 1440, 144}},
+        {"\\\\.\\DISPLAY2", {1920, 1080, 60}},
+        {"\\\\.\\DISPLAY3", {1920, 1080, 60}},
+        {"\\\\.\\DISPLAY1", {1920, 1080, 120}},
+        {"\\\\.\\DISPLAY2", {3840, 2160, 60}}}},
+  };
+  for (const auto &c : cases) {
+    SECTION(c.name) {
+      FakeMultiDisplayBackend backend;
+      for (size_t i = 0; i < changes.size(); ++i) {
+        auto &display = backend.displays[changes[i].device];
+        display.modes = {changes[i].target};
+        if (i != c.rejected) {
+          display.modes.push_back(changes[i].original);
+        }
+        display.current = changes[i].target;
+      }
+      CHECK_FALSE(restore_display_changes(backend, changes));
+      CHECK(backend.resyncs == 0);
+      CHECK(backend.stage_calls == c.stage_calls);
+      // what applies next leaves the displays in the session's modes
+      for (const auto &[device, mode] : backend.staged) {
+        CHECK(mode == backend.displays.at(device).current);
+      }
+    }
+  }
+}
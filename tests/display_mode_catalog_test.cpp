@@ -0,0 +1,98 @@
+#include "display_mode_catalog.hpp"
+#include "fake_display_backend.hpp"
+#include <catch2/catch.hpp>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+const std::vector<DisplayMode> monitor = {{1920, 1080, 144}, {1280, 720, 60}, {1920, 1080, 60}, {1920, 1080, 120}, {1920, 1080, 60}, {3840, 2160, 30}};
+
+class CatalogCache {
+protected:
+  ~CatalogCache() { std::filesystem::remove(m_path); }
+  std::filesystem::path m_path = std::filesystem::temp_directory_path() / ("mhdrl_catalog_" + std::to_string(getpid()) + ".bin");
+};
+
+} // namespace
+
+TEST_CASE("Modes are sorted and deduplicated", "[display_mode_catalog]") {
+  DisplayModeCatalog catalog{monitor};
+  CHECK(std::vector<DisplayMode>(catalog.modes().begin(), catalog.modes().end()) ==
+        std::vector<DisplayMode>{{1280, 720, 60}, {1920, 1080, 60}, {1920, 1080, 120}, {1920, 1080, 144}, {3840, 2160, 30}});
+  CHECK(catalog.modes_for(1920, 1080).size() == 3);
+  CHECK(catalog.modes_for(2560, 1440).empty());
+}
+
+TEST_CASE("Size queries", "[display_mode_catalog]") {
+  DisplayModeCatalog catalog{monitor};
+  CHECK(catalog.max_refresh_rate(1920, 1080) == 144);
+  CHECK(catalog.max_refresh_rate(3840, 2160) == 30);
+  CHECK(catalog.max_refresh_rate(2560, 1440) == 0);
+  CHECK(catalog.contains({1920, 1080, 120}));
+  CHECK_FALSE(catalog.contains({1920, 1080, 0}));
+  CHECK(catalog.offers({1920, 1080, 0}));
+  CHECK_FALSE(catalog.offers({1920, 1080, 75}));
+  CHECK_FALSE(catalog.offers({2560, 1440, 0}));
+}
+
+TEST_CASE("Nearest refresh rate", "[display_mode_catalog]") {
+  DisplayModeCatalog catalog{monitor};
+  struct Case {
+    uint32_t refresh_rate;
+    std::optional<uint32_t> expected;
+  };
+  const std::vector<Case> cases = {{30, 60}, {60, 60}, {75, 60}, {90, 120}, {132, 144}, {130, 120}, {240, 144}, {0, 60}};
+  for (const auto &c : cases) {
+    auto nearest = catalog.nearest_refresh_rate(1920, 1080, c.refresh_rate);
+    INFO("requested " << c.refresh_rate);
+    REQUIRE(nearest);
+    CHECK(nearest->refresh_rate == *c.expected);
+  }
+  CHECK_FALSE(catalog.nearest_refresh_rate(2560, 1440, 60));
+}
+
+TEST_CASE_METHOD(CatalogCache, "The cache is used while the identity matches", "[display_mode_catalog]") {
+  FakeDisplayBackend backend{monitor, "DEL4321|460.89"};
+  auto cold = DisplayModeCatalog::open(backend, m_path);
+  CHECK_FALSE(cold.from_cache());
+  auto warm = DisplayModeCatalog::open(backend, m_path);
+  CHECK(warm.from_cache());
+  CHECK(std::vector<DisplayMode>(warm.modes().begin(), warm.modes().end()) == std::vector<DisplayMode>(cold.modes().begin(), cold.modes().end()));
+  CHECK(backend.enumerations == 1);
+
+  backend.identity_key = "DEL4321|461.09";
+  CHECK_FALSE(DisplayModeCatalog::open(backend, m_path).from_cache());
+  CHECK(backend.enumerations == 2);
+}
+
+TEST_CASE_METHOD(CatalogCache, "A cache without the required mode is refreshed", "[display_mode_catalog]") {
+  FakeDisplayBackend backend{monitor, "DEL4321|460.89"};
+  DisplayModeCatalog::open(backend, m_path);
+  backend.modes.push_back({2560, 1440, 60}); // a custom resolution added in the control panel
+  auto catalog = DisplayModeCatalog::open(backend, m_path, DisplayMode{2560, 1440, 0});
+  CHECK_FALSE(catalog.from_cache());
+  CHECK(catalog.offers({2560, 1440, 60}));
+  CHECK(DisplayModeCatalog::open(backend, m_path, DisplayMode{2560, 1440, 60}).from_cache());
+}
+
+TEST_CASE_METHOD(CatalogCache, "Without an identity nothing is cached", "[display_mode_catalog]") {
+  FakeDisplayBackend backend{monitor, ""};
+  DisplayModeCatalog::open(backend, m_path);
+  DisplayModeCatalog::open(backend, m_path);
+  CHECK(backend.enumerations == 2);
+  CHECK_FALSE(std::filesystem::exists(m_path));
+}
+
+TEST_CASE_METHOD(CatalogCache, "A damaged cache is ignored", "[display_mode_catalog]") {
+  DisplayModeCatalog{monitor, "id"}.save(m_path);
+  REQUIRE(DisplayModeCatalog::load(m_path, "id"));
+  std::filesystem::resize_file(m_path, std::filesystem::file_size(m_path) - 5);
+  CHECK_FALSE(DisplayModeCatalog::load(m_path, "id"));
+  std::ofstream{m_path, std::ios::trunc} << "garbage";
+  CHECK_FALSE(DisplayModeCatalog::load(m_path, "id"));
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "display_backend.hpp"
+#include "display_batch.hpp"
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+// A display with a fixed mode list. Counts enumerations so tests can tell a cached catalog from a fresh one.
+class FakeDisplayBackend : public DisplayBackend {
+public:
+  FakeDisplayBackend(std::vector<DisplayMode> modes, std::string identity) : modes{std::move(modes)}, identity_key{std::move(identity)} {}
+
+  std::vector<DisplayMode> enumerate_modes() override {
+    ++enumerations;
+    return modes;
+  }
+  std::optional<DisplayMode> current_mode() override { return current; }
+  std::string identity() override { return identity_key; }
+
+  std::vector<DisplayMode> modes;
+  std::string identity_key;
+  std::optional<DisplayMode> current;
+  int enumerations = 0;
+};
+
+// Several displays that each accept only their own modes. Staged modes take effect on apply(), which counts as one
+// resync of every display however many were staged.
+class FakeMultiDisplayBackend : public MultiDisplayBackend {
+public:
+  struct Display {
+    std::vector<DisplayMode> modes;
+    DisplayMode current;
+  };
+
+  std::vector<std::string> devices() override {
+    std::vector<std::string> names;
+    for (const auto &[name, display] : displays) {
+      names.push_back(name);
+    }
+    return names;
+  }
+  std::vector<DisplayMode> modes(const std::string &device) override { return displays.at(device).modes; }
+  std::optional<DisplayMode> current_mode(const std::string &device) override {
+    auto it = displays.find(device);
+    return it == displays.end() ? std::nullopt : std::optional{it->second.current};
+  }
+  bool stage(const std::string &device, const DisplayMode &mode) override {
+    stage_calls.push_back({device, mode});
+    auto it = displays.find(device);
+    if (it == displays.end() || std::find(it->second.modes.begin(), it->second.modes.end(), mode) == it->second.modes.end()) {
+      return false;
+    }
+    staged[device] = mode;
+    return true;
+  }
+  bool apply() override {
+    ++resyncs;
+    if (fail_apply) {
+      return false;
+    }
+    for (const auto &[device, mode] : staged) {
+      displays[device].current = mode;
+    }
+    staged.clear();
+    return true;
+  }
+
+  std::map<std::string, Display> displays;
+  std::map<std::string, DisplayMode> staged;
+  std::vector<DisplayTarget> stage_calls;
+  int resyncs = 0;
+  bool fail_apply = false;
+};
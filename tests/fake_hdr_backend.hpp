@@ -0,0 +1,81 @@
+#pragma once
+#include "hdr_backend.hpp"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// In-memory GPUs and displays with a configurable delay per colour control call and injected failures.
+// The state is shared through a pointer so a test keeps access after HdrToggle took ownership of the backend.
+struct FakeHdrState {
+  std::string driver_version = "460.89";
+  std::vector<std::vector<uint32_t>> gpus;
+  std::set<uint32_t> hdr_capable;
+  std::set<uint32_t> hdr_enabled;
+  std::set<uint32_t> failing_set;
+  std::set<uint32_t> failing_capability;
+  std::set<uint32_t> failing_gpus;
+  std::chrono::milliseconds set_delay{0};
+
+  std::atomic<int> capability_queries{0};
+  std::atomic<int> set_calls{0};
+  std::atomic<int> in_flight{0};
+  std::atomic<int> max_in_flight{0};
+  std::mutex mutex;
+};
+
+class FakeHdrBackend : public HdrBackend {
+public:
+  explicit FakeHdrBackend(FakeHdrState &state) : m_state{state} {}
+
+  std::string driver_version() override {
+    std::lock_guard lock{m_state.mutex};
+    return m_state.driver_version;
+  }
+  uint32_t gpu_count() override {
+    std::lock_guard lock{m_state.mutex};
+    return static_cast<uint32_t>(m_state.gpus.size());
+  }
+  std::vector<uint32_t> connected_display_ids(uint32_t gpu_index) override {
+    std::lock_guard lock{m_state.mutex};
+    if (m_state.failing_gpus.count(gpu_index)) {
+      throw HdrError("NVAPI_NVIDIA_DEVICE_NOT_FOUND");
+    }
+    return m_state.gpus.at(gpu_index);
+  }
+  bool is_hdr_supported(uint32_t display_id) override {
+    ++m_state.capability_queries;
+    std::lock_guard lock{m_state.mutex};
+    if (m_state.failing_capability.count(display_id)) {
+      throw HdrError("NVAPI_ERROR");
+    }
+    return m_state.hdr_capable.count(display_id) != 0;
+  }
+  bool is_hdr_enabled(uint32_t display_id) override {
+    std::lock_guard lock{m_state.mutex};
+    return m_state.hdr_enabled.count(display_id) != 0;
+  }
+  void set_hdr_mode(uint32_t display_id, bool enabled) override {
+    ++m_state.set_calls;
+    auto in_flight = ++m_state.in_flight;
+    for (auto max = m_state.max_in_flight.load(); in_flight > max && !m_state.max_in_flight.compare_exchange_weak(max, in_flight);) {
+    }
+    std::this_thread::sleep_for(m_state.set_delay);
+    --m_state.in_flight;
+    std::lock_guard lock{m_state.mutex};
+    if (m_state.failing_set.count(display_id)) {
+      throw HdrError("NVAPI_TIMEOUT");
+    }
+    if (enabled) {
+      m_state.hdr_enabled.insert(display_id);
+    } else {
+      m_state.hdr_enabled.erase(display_id);
+    }
+  }
+
+private:
+  FakeHdrState &m_state;
+};
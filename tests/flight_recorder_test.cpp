@@ -0,0 +1,183 @@
+#include "flight_recorder.hpp"
+#include <catch2/catch.hpp>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+// An 8-byte aligned region for a ring of `capacity` slots; detaches whatever a test left attached.
+class FlightRecorderTest {
+protected:
+  ~FlightRecorderTest() { flight::detach(false); }
+
+  void *memory(uint32_t capacity) {
+    m_memory.assign(flight::region_size(capacity) / sizeof(uint64_t), 0);
+    return m_memory.data();
+  }
+  std::string_view bytes() const { return {reinterpret_cast<const char *>(m_memory.data()), m_memory.size() * sizeof(uint64_t)}; }
+
+  std::vector<uint64_t> m_memory;
+};
+
+std::vector<uint16_t> events(const flight::Report &report) {
+  std::vector<uint16_t> result;
+  for (const auto &record : report.records) {
+    result.push_back(record.event);
+  }
+  return result;
+}
+
+} // namespace
+
+TEST_CASE_METHOD(FlightRecorderTest, "Rings that do not fit are refused", "[flight_recorder]") {
+  CHECK_FALSE(flight::attach(memory(8), flight::region_size(8), 6, 1));
+  CHECK_FALSE(flight::attach(memory(8), flight::region_size(8) - 1, 8, 1));
+  CHECK_FALSE(flight::attach(static_cast<char *>(memory(16)) + 4, flight::region_size(8), 8, 1));
+  CHECK_FALSE(flight::attached());
+  // nothing is recorded without a ring
+  flight::record(flight::Event::session_start);
+}
+
+TEST_CASE_METHOD(FlightRecorderTest, "Recorded events are recovered in order", "[flight_recorder]") {
+  REQUIRE(flight::attach(memory(8), flight::region_size(8), 8, 4242));
+  flight::record(flight::Event::session_start);
+  flight::record(flight::Event::display_mode_set, flight::pack_mode(1920, 1080), 60);
+  flight::record(flight::Event::child_exited, 42, 3);
+  auto report = flight::recover(bytes());
+  REQUIRE(report);
+  CHECK(report->owner_pid == 4242u);
+  CHECK_FALSE(report->clean);
+  CHECK(report->recorded == 3u);
+  CHECK(report->torn == 0u);
+  REQUIRE(report->records.size() == 3u);
+  CHECK(report->records[1].a == flight::pack_mode(1920, 1080));
+  CHECK(report->records[1].b == 60u);
+  CHECK(report->records[2].sequence == 2u);
+  CHECK(report->records[0].time >= report->start_time);
+
+  auto lines = flight::describe(*report);
+  REQUIRE(lines.size() == 4u);
+  CHECK(lines[0].find("Launcher process 4242 started at") == 0);
+  CHECK(lines[0].ends_with("did not end cleanly"));
+  CHECK(lines[1].ends_with(" session_start"));
+  CHECK(lines[2].ends_with(" display_mode_set 1920x1080@60"));
+  CHECK(lines[3].ends_with(" child_exited pid 42, exit code 3"));
+}
+
+TEST_CASE_METHOD(FlightRecorderTest, "A clean detach is recorded", "[flight_recorder]") {
+  REQUIRE(flight::attach(memory(4), flight::region_size(4), 4, 1));
+  flight::record(flight::Event::session_end);
+  flight::detach(true);
+  flight::record(flight::Event::session_start);
+  auto report = flight::recover(bytes());
+  REQUIRE(report);
+  CHECK(report->clean);
+  CHECK(events(*report) == std::vector<uint16_t>{static_cast<uint16_t>(flight::Event::session_end)});
+}
+
+TEST_CASE_METHOD(FlightRecorderTest, "Only the last lap of the ring is kept", "[flight_recorder]") {
+  REQUIRE(flight::attach(memory(4), flight::region_size(4), 4, 1));
+  for (uint64_t i = 0; i < 10; ++i) {
+    flight::record(flight::Event::process_joined, i);
+  }
+  auto report = flight::recover(bytes());
+  REQUIRE(report);
+  CHECK(report->recorded == 10u);
+  REQUIRE(report->records.size() == 4u);
+  CHECK(report->records.front().a == 6u);
+  CHECK(report->records.back().a == 9u);
+  CHECK(flight::describe(*report)[1] == "10 events were recorded, only the last 4 are kept");
+}
+
+TEST_CASE_METHOD(FlightRecorderTest, "A slot the owner died writing is counted as torn", "[flight_recorder]") {
+  REQUIRE(flight::attach(memory(4), flight::region_size(4), 4, 1));
+  flight::record(flight::Event::hdr_enabled);
+  flight::record(flight::Event::hdr_disabled);
+  flight::detach(false);
+  // the second slot's sequence number is cleared first and stored last
+  std::memset(reinterpret_cast<char *>(m_memory.data()) + flight::header_size + flight::slot_size, 0, sizeof(uint64_t));
+  auto report = flight::recover(bytes());
+  REQUIRE(report);
+  CHECK(report->torn == 1u);
+  CHECK(events(*report) == std::vector<uint16_t>{static_cast<uint16_t>(flight::Event::hdr_enabled)});
+  CHECK(flight::describe(*report)[1] == "1 events were still being written");
+}
+
+TEST_CASE_METHOD(FlightRecorderTest, "Damaged rings are not recovered", "[flight_recorder]") {
+  REQUIRE(flight::attach(memory(4), flight::region_size(4), 4, 1));
+  flight::detach(true);
+  auto data = std::string(bytes());
+  CHECK(flight::recover(data));
+  CHECK_FALSE(flight::recover(data.substr(0, flight::region_size(4) - 1)));
+  CHECK_FALSE(flight::recover(data.substr(0, flight::header_size - 1)));
+  data[0] = 'X';
+  CHECK_FALSE(flight::recover(data));
+}
+
+// The ring in a shared file mapping, written by a child that is killed with SIGKILL while it records as fast as it
+// can, then read back from the file the way the next launcher start reads it.
+TEST_CASE("A ring survives kill -9 of its owner", "[flight_recorder]") {
+  constexpr uint32_t capacity = 256;
+  auto path = std::filesystem::temp_directory_path() / ("mhdrl_flight_test_" + std::to_string(getpid()) + ".bin");
+  int ready[2];
+  REQUIRE(pipe(ready) == 0);
+  auto child = fork();
+  REQUIRE(child >= 0);
+  if (child == 0) {
+    close(ready[0]);
+    auto fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0 || ftruncate(fd, flight::region_size(capacity)) != 0) {
+      std::_Exit(2);
+    }
+    auto memory = mmap(nullptr, flight::region_size(capacity), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED || !flight::attach(memory, flight::region_size(capacity), capacity, static_cast<uint32_t>(getpid()))) {
+      std::_Exit(3);
+    }
+    flight::record(flight::Event::session_start);
+    for (uint64_t i = 0;; ++i) {
+      flight::record(flight::Event::process_joined, i);
+      if (i == 10000 && write(ready[1], "x", 1) != 1) {
+        std::_Exit(4);
+      }
+    }
+  }
+  close(ready[1]);
+  char byte = 0;
+  auto signalled = read(ready[0], &byte, 1);
+  close(ready[0]);
+  kill(child, SIGKILL);
+  int status = 0;
+  waitpid(child, &status, 0);
+  REQUIRE(signalled == 1);
+  REQUIRE(WIFSIGNALED(status));
+
+  std::ifstream file{path, std::ios::binary};
+  std::string data{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+  std::filesystem::remove(path);
+  auto report = flight::recover(data);
+  REQUIRE(report);
+  CHECK(report->owner_pid == static_cast<uint32_t>(child));
+  CHECK_FALSE(report->clean);
+  CHECK(report->recorded > 10000u);
+  // at most the slot being written when the signal arrived is torn, the rest is the last lap in order
+  CHECK(report->torn <= 1u);
+  REQUIRE(report->records.size() + report->torn == capacity);
+  for (size_t i = 1; i < report->records.size(); ++i) {
+    CHECK(report->records[i].sequence > report->records[i - 1].sequence);
+    CHECK(report->records[i].a - report->records[i - 1].a == report->records[i].sequence - report->records[i - 1].sequence);
+  }
+  CHECK(report->records.back().sequence >= report->recorded - 2);
+  CHECK_FALSE(flight::describe(*report).front().ends_with("ended cleanly"));
+}
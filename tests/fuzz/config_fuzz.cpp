@@ -0,0 +1,27 @@
+#include "config.hpp"
+#include "logger.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <string_view>
+
+// Fuzzes the INI reader and the schema applied on top of it. Entries must be views into the document, in line order.
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  static Logger logger{std::filesystem::temp_directory_path() / "mhdrl_config_fuzz.txt", false, FlushPolicy::on_shutdown,
+                       std::chrono::milliseconds{250}, LogRotation{1024 * 1024, 1}};
+  std::string_view document{reinterpret_cast<const char *>(data), size};
+  auto inside = [&](std::string_view view) { return view.empty() || (view.data() >= document.data() && view.data() + view.size() <= document.data() + size); };
+
+  IniReader reader{document};
+  IniReader::Entry entry;
+  size_t line = 0;
+  while (reader.next(entry)) {
+    if (!inside(entry.section) || !inside(entry.key) || !inside(entry.value) || entry.key.empty() || entry.line <= line) {
+      std::abort();
+    }
+    line = entry.line;
+  }
+  parse_config(document, logger);
+  return 0;
+}
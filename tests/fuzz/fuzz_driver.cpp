@@ -0,0 +1,89 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Stand-in for libFuzzer's main where it is not available: runs every seed of the given corpus files or folders, then
+// a fixed number of mutations of each (bit flips, truncations, duplicated and inserted bytes) from a fixed seed, so a
+// failure reproduces. Usage: <fuzzer> [-runs=N] corpus...
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+namespace {
+
+void run(const std::string &input) { LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t *>(input.data()), input.size()); }
+
+std::string mutate(std::string input, std::mt19937 &random) {
+  auto pick = [&](size_t bound) { return bound == 0 ? 0 : std::uniform_int_distribution<size_t>{0, bound - 1}(random); };
+  for (auto edits = 1 + pick(4); edits != 0; --edits) {
+    switch (pick(5)) {
+    case 0:
+      if (!input.empty()) {
+        input[pick(input.size())] ^= static_cast<char>(1 << pick(8));
+      }
+      break;
+    case 1:
+      input.resize(pick(input.size() + 1));
+      break;
+    case 2:
+      input.insert(pick(input.size() + 1), 1, static_cast<char>(pick(256)));
+      break;
+    case 3:
+      if (!input.empty()) {
+        auto start = pick(input.size());
+        input.insert(pick(input.size() + 1), input.substr(start, pick(input.size() - start) + 1));
+      }
+      break;
+    default:
+      if (!input.empty()) {
+        input[pick(input.size())] = static_cast<char>("\n\r=[]; \xff\x80\x00"[pick(10)]);
+      }
+      break;
+    }
+  }
+  return input;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  size_t runs = 1000;
+  std::vector<std::string> seeds;
+  for (int i = 1; i < argc; ++i) {
+    std::string_view arg{argv[i]};
+    if (arg.starts_with("-runs=")) {
+      runs = std::strtoull(argv[i] + 6, nullptr, 10);
+      continue;
+    }
+    std::vector<std::filesystem::path> files;
+    if (std::filesystem::is_directory(arg)) {
+      for (const auto &entry : std::filesystem::directory_iterator{arg}) {
+        files.push_back(entry.path());
+      }
+    } else {
+      files.emplace_back(arg);
+    }
+    for (const auto &file : files) {
+      std::ifstream stream{file, std::ios::binary};
+      seeds.emplace_back(std::istreambuf_iterator<char>{stream}, std::istreambuf_iterator<char>{});
+    }
+  }
+  if (seeds.empty()) {
+    std::fprintf(stderr, "usage: %s [-runs=N] corpus...\n", argv[0]);
+    return 2;
+  }
+  std::mt19937 random{20201}; // fixed so that a failing input can be found again
+  for (const auto &seed : seeds) {
+    run(seed);
+    for (size_t i = 0; i < runs; ++i) {
+      run(mutate(seed, random));
+    }
+  }
+  std::printf("%zu seeds, %zu inputs\n", seeds.size(), seeds.size() * (runs + 1));
+  return 0;
+}
@@ -0,0 +1,54 @@
+#include "log_format.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <variant>
+
+namespace {
+
+std::string encode(const std::vector<LogArg> &args) {
+  std::string out;
+  for (const auto &arg : args) {
+    std::visit([&](const auto &value) { log_encoding::put_arg(out, value); }, arg);
+  }
+  return out;
+}
+
+// Whatever decodes must encode to something that decodes to the same arguments.
+void check_args(std::string_view data) {
+  auto args = decode_log_args(data);
+  if (!args) {
+    return;
+  }
+  auto encoded = encode(*args);
+  auto again = decode_log_args(encoded);
+  if (!again || encode(*again) != encoded) {
+    std::abort();
+  }
+  render_log_event("{} and {}", *args);
+}
+
+} // namespace
+
+// Fuzzes the argument decoder and the binary log framing the same way mhdrl_log_decode reads a file.
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  std::string_view input{reinterpret_cast<const char *>(data), size};
+  check_args(input);
+
+  BinaryLogReader reader{input};
+  BinaryLogRecord record;
+  while (reader.next(record)) {
+    if (record.args.size() > size || (!record.args.empty() && (record.args.data() < input.data() || record.args.data() + record.args.size() > input.data() + size))) {
+      std::abort();
+    }
+    if (record.event < static_cast<uint16_t>(LogEvent::count)) {
+      if (auto args = decode_log_args(record.args)) {
+        render_log_event(log_event_format(static_cast<LogEvent>(record.event)).format, *args);
+      }
+    }
+    check_args(record.args);
+  }
+  return 0;
+}
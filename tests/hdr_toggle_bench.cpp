@@ -0,0 +1,50 @@
+#include "fake_hdr_backend.hpp"
+#include "hdr_toggle.hpp"
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <memory>
+#include <unistd.h>
+
+// Enabling HDR on several displays whose colour control call blocks for a resync, serially and in parallel, and the
+// cost of capability discovery with and without the persisted snapshot. Arguments: displays, parallel calls.
+
+namespace {
+
+void setup(FakeHdrState &state, int displays) {
+  state.gpus.assign(2, {});
+  for (int id = 1; id <= displays; ++id) {
+    state.gpus[id % 2].push_back(id);
+    state.hdr_capable.insert(id);
+  }
+}
+
+void BM_EnableHdr(benchmark::State &state) {
+  FakeHdrState fake;
+  setup(fake, static_cast<int>(state.range(0)));
+  fake.set_delay = std::chrono::milliseconds{20};
+  HdrToggle toggle{std::make_unique<FakeHdrBackend>(fake), static_cast<size_t>(state.range(1))};
+  toggle.capabilities();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(toggle.set_hdr_mode(true));
+  }
+}
+BENCHMARK(BM_EnableHdr)->Args({4, 1})->Args({4, 4})->Args({8, 4})->Unit(benchmark::kMillisecond)->UseRealTime();
+
+void BM_Discovery(benchmark::State &state) {
+  FakeHdrState fake;
+  setup(fake, 8);
+  auto cache = std::filesystem::temp_directory_path() / ("mhdrl_hdr_bench_" + std::to_string(getpid()) + ".txt");
+  std::optional<std::filesystem::path> cache_path;
+  if (state.range(0)) {
+    cache_path = cache;
+    HdrToggle{std::make_unique<FakeHdrBackend>(fake), 4, cache_path}.capabilities();
+  }
+  for (auto _ : state) {
+    HdrToggle toggle{std::make_unique<FakeHdrBackend>(fake), 4, cache_path};
+    benchmark::DoNotOptimize(toggle.capabilities());
+  }
+  std::filesystem::remove(cache);
+}
+BENCHMARK(BM_Discovery)->ArgName("cached")->Arg(0)->Arg(1);
+
+} // namespace
@@ -0,0 +1,145 @@
+#include "fake_hdr_backend.hpp"
+#include "hdr_toggle.hpp"
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <set>
+#include <unistd.h>
+
+namespace {
+
+std::set<uint32_t> ids(const std::vector<HdrDisplay> &displays) {
+  std::set<uint32_t> result;
+  for (const auto &display : displays) {
+    result.insert(display.display_id);
+  }
+  return result;
+}
+
+std::set<uint32_t> succeeded(const std::vector<HdrDisplayResult> &results) {
+  std::set<uint32_t> result;
+  for (const auto &r : results) {
+    if (r.success) {
+      result.insert(r.display.display_id);
+    }
+  }
+  return result;
+}
+
+class HdrToggleTest {
+protected:
+  HdrToggleTest() {
+    m_state.gpus = {{1, 2}, {3, 4}};
+    m_state.hdr_capable = {1, 3, 4};
+  }
+  ~HdrToggleTest() { std::filesystem::remove(m_cache); }
+
+  std::unique_ptr<HdrToggle> make(size_t max_parallel = 4, bool cache = false) {
+    return std::make_unique<HdrToggle>(std::make_unique<FakeHdrBackend>(m_state), max_parallel, cache ? std::optional{m_cache} : std::nullopt);
+  }
+
+  FakeHdrState m_state;
+  std::filesystem::path m_cache = std::filesystem::temp_directory_path() / ("mhdrl_hdr_cache_" + std::to_string(getpid()) + ".txt");
+};
+
+TEST_CASE_METHOD(HdrToggleTest, "Discovers displays on every GPU", "[hdr_toggle]") {
+  auto toggle = make();
+  const auto &snapshot = toggle->capabilities();
+  REQUIRE(snapshot.displays.size() == 4u);
+  CHECK(snapshot.displays[2].display.gpu_index == 1u);
+  CHECK(snapshot.errors.empty());
+  CHECK(succeeded(toggle->set_hdr_mode(true)) == (std::set<uint32_t>{1, 3, 4}));
+  CHECK(m_state.hdr_enabled == (std::set<uint32_t>{1, 3, 4}));
+}
+
+TEST_CASE_METHOD(HdrToggleTest, "Capabilities are queried once", "[hdr_toggle]") {
+  auto toggle = make();
+  toggle->set_hdr_mode(true);
+  toggle->set_hdr_mode(false);
+  CHECK(m_state.capability_queries == 4);
+}
+
+TEST_CASE_METHOD(HdrToggleTest, "Disable switches back only what enable changed", "[hdr_toggle]") {
+  m_state.hdr_enabled = {3}; // on before the session
+  auto toggle = make();
+  toggle->enable_hdr(toggle->hdr_off_displays());
+  toggle->set_hdr_mode(false);
+  CHECK(m_state.hdr_enabled == (std::set<uint32_t>{3}));
+}
+
+TEST_CASE_METHOD(HdrToggleTest, "A failed disable keeps the displays it could not switch back", "[hdr_toggle]") {
+  m_state.hdr_enabled = {3};
+  auto toggle = make();
+  toggle->enable_hdr(toggle->hdr_off_displays());
+  m_state.failing_set = {4};
+  CHECK(succeeded(toggle->set_hdr_mode(false)) == (std::set<uint32_t>{1}));
+  m_state.failing_set.clear();
+  // a retry switches back only the display that failed, the one that was on before the session stays on
+  CHECK(succeeded(toggle->set_hdr_mode(false)) == (std::set<uint32_t>{4}));
+  CHECK(m_state.hdr_enabled == (std::set<uint32_t>{3}));
+  CHECK(toggle->set_hdr_mode(false).empty());
+}
+
+TEST_CASE_METHOD(HdrToggleTest, "Failures are recorded per display or GPU", "[hdr_toggle]") {
+  m_state.failing_capability = {3};
+  m_state.failing_set = {4};
+  m_state.gpus.push_back({5});
+  m_state.failing_gpus = {2};
+  auto toggle = make();
+  const auto &snapshot = toggle->capabilities();
+  CHECK(snapshot.errors.size() == 1u);
+  REQUIRE(snapshot.displays.size() == 4u);
+  CHECK_FALSE(snapshot.displays[2].hdr_supported);
+  CHECK_FALSE(snapshot.displays[2].error.empty());
+  auto results = toggle->set_hdr_mode(true);
+  CHECK(succeeded(results) == (std::set<uint32_t>{1}));
+  CHECK(any_succeeded(results));
+  REQUIRE(results.size() == 2u);
+  CHECK(results[1].error == "NVAPI_TIMEOUT");
+}
+
+TEST_CASE_METHOD(HdrToggleTest, "Displays are switched in parallel", "[hdr_toggle]") {
+  m_state.gpus = {{1, 2, 3, 4}};
+  m_state.hdr_capable = {1, 2, 3, 4};
+  m_state.set_delay = std::chrono::milliseconds{50};
+  auto toggle = make(4);
+  auto start = std::chrono::steady_clock::now();
+  toggle->set_hdr_mode(true);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  CHECK(m_state.max_in_flight == 4);
+  CHECK(elapsed < std::chrono::milliseconds{150});
+}
+
+TEST_CASE_METHOD(HdrToggleTest, "Max parallel bounds concurrent calls", "[hdr_toggle]") {
+  m_state.gpus = {{1, 2, 3, 4, 5, 6}};
+  m_state.hdr_capable = {1, 2, 3, 4, 5, 6};
+  m_state.set_delay = std::chrono::milliseconds{10};
+  make(2)->set_hdr_mode(true);
+  CHECK(m_state.max_in_flight == 2);
+}
+
+TEST_CASE_METHOD(HdrToggleTest, "Cache is reused until the driver or displays change", "[hdr_toggle]") {
+  make(4, true)->capabilities();
+  CHECK(m_state.capability_queries == 4);
+
+  auto warm = make(4, true);
+  CHECK(warm->capabilities().from_cache);
+  CHECK(ids(warm->hdr_off_displays()) == (std::set<uint32_t>{1, 3, 4}));
+  CHECK(m_state.capability_queries == 4);
+
+  m_state.driver_version = "461.09";
+  CHECK_FALSE(make(4, true)->capabilities().from_cache);
+  m_state.gpus[1].push_back(7);
+  CHECK_FALSE(make(4, true)->capabilities().from_cache);
+  CHECK(m_state.capability_queries == 4 + 4 + 5);
+}
+
+TEST_CASE_METHOD(HdrToggleTest, "Incomplete discovery is not cached", "[hdr_toggle]") {
+  m_state.failing_capability = {1};
+  make(4, true)->capabilities();
+  m_state.failing_capability.clear();
+  CHECK_FALSE(make(4, true)->capabilities().from_cache);
+}
+
+} // namespace
@@ -0,0 +1,106 @@
+#pragma once
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// A local HTTP server standing in for Sentry: answers every request with the next scripted status (200 once the
+// script is used up) after an optional delay, and records what it received.
+class HttpStandIn {
+public:
+  struct Request {
+    std::string head;
+    std::string body;
+  };
+
+  explicit HttpStandIn(std::vector<int> statuses = {}, std::chrono::milliseconds delay = {}) : m_statuses{statuses.begin(), statuses.end()}, m_delay{delay} {
+    m_socket = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t size = sizeof(address);
+    if (m_socket < 0 || bind(m_socket, reinterpret_cast<sockaddr *>(&address), size) != 0 || listen(m_socket, 16) != 0 ||
+        getsockname(m_socket, reinterpret_cast<sockaddr *>(&address), &size) != 0) {
+      std::abort();
+    }
+    m_port = ntohs(address.sin_port);
+    m_thread = std::thread([this]() { serve(); });
+  }
+  HttpStandIn(const HttpStandIn &) = delete;
+  HttpStandIn &operator=(const HttpStandIn &) = delete;
+  ~HttpStandIn() {
+    m_stopping = true;
+    m_thread.join();
+    ::close(m_socket);
+  }
+
+  std::string url(const std::string &path = "/api/5/envelope/") const { return "http://127.0.0.1:" + std::to_string(m_port) + path; }
+
+  std::vector<Request> requests() {
+    std::lock_guard lock{m_mutex};
+    return m_requests;
+  }
+
+private:
+  void serve() {
+    while (!m_stopping) {
+      pollfd ready{m_socket, POLLIN, 0};
+      if (poll(&ready, 1, 20) <= 0) {
+        continue;
+      }
+      auto client = accept4(m_socket, nullptr, nullptr, SOCK_CLOEXEC);
+      if (client >= 0) {
+        answer(client);
+        ::close(client);
+      }
+    }
+  }
+
+  void answer(int client) {
+    std::string received;
+    char buffer[16 * 1024];
+    size_t head_end = std::string::npos;
+    size_t length = 0;
+    while (head_end == std::string::npos || received.size() < head_end + 4 + length) {
+      auto count = recv(client, buffer, sizeof(buffer), 0);
+      if (count <= 0) {
+        return;
+      }
+      received.append(buffer, static_cast<size_t>(count));
+      if (head_end == std::string::npos && (head_end = received.find("\r\n\r\n")) != std::string::npos) {
+        auto field = received.find("Content-Length: ");
+        length = field < head_end ? std::strtoull(received.c_str() + field + 16, nullptr, 10) : 0;
+      }
+    }
+    int status = 200;
+    {
+      std::lock_guard lock{m_mutex};
+      m_requests.push_back({received.substr(0, head_end), received.substr(head_end + 4, length)});
+      if (!m_statuses.empty()) {
+        status = m_statuses.front();
+        m_statuses.pop_front();
+      }
+    }
+    std::this_thread::sleep_for(m_delay);
+    auto response = "HTTP/1.1 " + std::to_string(status) + " Stand-in\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+    send(client, response.data(), response.size(), MSG_NOSIGNAL);
+  }
+
+  int m_socket = -1;
+  uint16_t m_port = 0;
+  std::mutex m_mutex;
+  std::deque<int> m_statuses;
+  std::chrono::milliseconds m_delay;
+  std::vector<Request> m_requests;
+  std::atomic_bool m_stopping{false};
+  std::thread m_thread;
+};
@@ -0,0 +1,220 @@
+#include "ipc.hpp"
+#include "launcher_service.hpp"
+#include "logger.hpp"
+#include "unix_socket.hpp"
+#include <catch2/catch.hpp>
+#include <filesystem>
+#include <future>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+std::string socket_path(const char *name) {
+  return (std::filesystem::temp_directory_path() / ("mhdrl_" + std::string(name) + "_" + std::to_string(getpid()) + ".sock")).string();
+}
+
+// Feeds a fixed byte string to receive_message
+class BufferChannel : public IpcChannel {
+public:
+  explicit BufferChannel(std::string data) : m_data{std::move(data)} {}
+  void write(const char *data, size_t size) override { m_data.append(data, size); }
+  void read(char *data, size_t size) override {
+    if (m_data.size() - m_offset < size) {
+      throw IpcError("pipe closed");
+    }
+    m_data.copy(data, size, m_offset);
+    m_offset += size;
+  }
+
+private:
+  std::string m_data;
+  size_t m_offset = 0;
+};
+
+std::string frame(std::string_view payload) {
+  std::string data;
+  for (int shift = 0; shift < 32; shift += 8) {
+    data.push_back(static_cast<char>(payload.size() >> shift));
+  }
+  return data.append(payload);
+}
+
+TEST_CASE("Every message survives encoding and decoding", "[ipc]") {
+  std::vector<IpcMessage> messages = {SessionRequest{ipc_protocol_version, {"--config", "a b.ini", ""}},
+                                      SessionStarted{true},
+                                      SessionEnded{-5},
+                                      SessionRejected{"busy"},
+                                      SetDisplayModeCommand{{2560, 1440, 120}},
+                                      SetHdrCommand{true},
+                                      QueryStateCommand{},
+                                      EndSessionCommand{},
+                                      SessionState{{3840, 2160, 60}, false, "MassEffectAndromeda.exe"},
+                                      ControlReply{false, "no such mode"}};
+  for (const auto &message : messages) {
+    auto decoded = decode_message(encode_message(message));
+    REQUIRE(decoded.index() == message.index());
+    CHECK(encode_message(decoded) == encode_message(message));
+  }
+}
+
+TEST_CASE("Malformed payloads are rejected", "[ipc]") {
+  auto hdr = encode_message(SetHdrCommand{true});
+  CHECK_THROWS_WITH(decode_message(hdr + "x"), "trailing bytes in message");
+  CHECK_THROWS_WITH(decode_message(hdr.substr(0, 1)), "truncated message");
+  CHECK_THROWS_WITH(decode_message(std::string(1, '\x7f')), "unknown message type");
+  // a string claiming more bytes than the payload holds
+  auto rejected = encode_message(SessionRejected{"busy"});
+  rejected[1] = '\x40';
+  CHECK_THROWS_WITH(decode_message(rejected), "truncated message");
+}
+
+TEST_CASE("A request from another protocol version decodes to its version only", "[ipc]") {
+  auto payload = encode_message(SessionRequest{ipc_protocol_version, {"a"}});
+  payload[1] = static_cast<char>(ipc_protocol_version + 1);
+  payload += "whatever a later release sends";
+  auto message = decode_message(payload);
+  auto request = std::get_if<SessionRequest>(&message);
+  REQUIRE(request);
+  CHECK(request->protocol_version == ipc_protocol_version + 1);
+  CHECK(request->args.empty());
+}
+
+TEST_CASE("Frames carry their size in front", "[ipc]") {
+  BufferChannel channel{""};
+  send_message(channel, SessionEnded{3});
+  send_message(channel, ControlReply{true, "done"});
+  auto first = receive_message(channel);
+  REQUIRE(std::holds_alternative<SessionEnded>(first));
+  CHECK(std::get<SessionEnded>(first).exit_code == 3);
+  CHECK(std::get<ControlReply>(receive_message(channel)).message == "done");
+  CHECK_THROWS_WITH(receive_message(channel), "pipe closed");
+
+  BufferChannel empty_frame{frame("")};
+  CHECK_THROWS_WITH(receive_message(empty_frame), "invalid frame size 0");
+  BufferChannel oversized{std::string("\x01\x00\x01\x00", 4)};
+  CHECK_THROWS_WITH(receive_message(oversized), "invalid frame size 65537");
+  BufferChannel truncated{frame(encode_message(SessionRejected{"busy"})).substr(0, 7)};
+  CHECK_THROWS_WITH(receive_message(truncated), "pipe closed");
+}
+
+class UnixSocketTest {
+protected:
+  ~UnixSocketTest() {
+    std::filesystem::remove(m_log_path);
+    std::filesystem::remove(m_path);
+  }
+
+  std::string m_path = socket_path("ipc_test");
+  std::filesystem::path m_log_path = std::filesystem::temp_directory_path() / ("mhdrl_ipc_test_" + std::to_string(getpid()) + ".txt");
+  Logger m_logger{m_log_path, false};
+};
+
+TEST_CASE_METHOD(UnixSocketTest, "Messages travel through a Unix socket", "[ipc]") {
+  UnixSocketListener listener{m_path};
+  auto server = std::async(std::launch::async, [&]() {
+    auto channel = listener.accept();
+    auto message = receive_message(*channel);
+    // large enough to take several socket writes
+    send_message(*channel, SessionRejected{std::string(60000, 'r')});
+    return message;
+  });
+  std::unique_ptr<UnixSocketChannel> client;
+  while (!(client = UnixSocketChannel::connect(m_path))) {
+    std::this_thread::yield();
+  }
+  send_message(*client, SessionRequest{ipc_protocol_version, {"--hdr"}});
+  auto reply = receive_message(*client);
+  CHECK(std::get<SessionRejected>(reply).reason.size() == 60000);
+  CHECK(std::get<SessionRequest>(server.get()).args == std::vector<std::string>{"--hdr"});
+  // the server side closed its end
+  CHECK_THROWS_WITH(receive_message(*client), "socket closed");
+}
+
+TEST_CASE_METHOD(UnixSocketTest, "Nobody listening and a busy listener both refuse the connection", "[ipc]") {
+  CHECK_FALSE(UnixSocketChannel::connect(m_path));
+  UnixSocketListener listener{m_path};
+  auto server = std::async(std::launch::async, [&]() { return listener.accept(); });
+  std::unique_ptr<UnixSocketChannel> client;
+  while (!(client = UnixSocketChannel::connect(m_path))) {
+    std::this_thread::yield();
+  }
+  auto channel = server.get();
+  CHECK_FALSE(UnixSocketChannel::connect(m_path));
+}
+
+TEST_CASE_METHOD(UnixSocketTest, "Closing the listener wakes accept and server side reads", "[ipc]") {
+  UnixSocketListener listener{m_path};
+  auto pending = std::async(std::launch::async, [&]() { return listener.accept(); });
+  std::unique_ptr<UnixSocketChannel> client;
+  while (!(client = UnixSocketChannel::connect(m_path))) {
+    std::this_thread::yield();
+  }
+  auto channel = pending.get();
+  auto reading = std::async(std::launch::async, [&]() { return receive_message(*channel); });
+  listener.close();
+  CHECK_THROWS_WITH(reading.get(), "listener closed");
+  CHECK_THROWS_WITH(listener.accept(), "listener closed");
+}
+
+TEST_CASE_METHOD(UnixSocketTest, "A session is handed to the service and runs to its end", "[ipc]") {
+  UnixSocketListener listener{m_path};
+  std::vector<std::string> received_args;
+  auto service = std::thread([&]() {
+    try {
+      serve_sessions(
+          listener,
+          [&](const SessionRequest &request, const std::function<void(bool)> &started) {
+            received_args = request.args;
+            started(true);
+            return 7;
+          },
+          m_logger);
+    } catch (IpcError &) {
+      // the listener was closed
+    }
+  });
+  std::unique_ptr<UnixSocketChannel> client;
+  while (!(client = UnixSocketChannel::connect(m_path))) {
+    std::this_thread::yield();
+  }
+  int opened = 0;
+  int closed = 0;
+  auto exit_code = request_session(*client, {"--config", "x.ini"}, [&](bool window) { opened += window; }, [&]() { ++closed; }, m_logger);
+  listener.close();
+  service.join();
+  CHECK(exit_code == 7);
+  CHECK(opened == 1);
+  CHECK(closed == 1);
+  CHECK(received_args == std::vector<std::string>{"--config", "x.ini"});
+}
+
+TEST_CASE_METHOD(UnixSocketTest, "The service rejects a client of another protocol version", "[ipc]") {
+  UnixSocketListener listener{m_path};
+  bool ran = false;
+  auto service = std::thread([&]() {
+    try {
+      serve_sessions(
+          listener,
+          [&](const SessionRequest &, const std::function<void(bool)> &) {
+            ran = true;
+            return 0;
+          },
+          m_logger);
+    } catch (IpcError &) {
+    }
+  });
+  std::unique_ptr<UnixSocketChannel> client;
+  while (!(client = UnixSocketChannel::connect(m_path))) {
+    std::this_thread::yield();
+  }
+  send_message(*client, SessionRequest{ipc_protocol_version + 1, {}});
+  auto reply = receive_message(*client);
+  listener.close();
+  service.join();
+  CHECK(std::get<SessionRejected>(reply).reason == "protocol version mismatch");
+  CHECK_FALSE(ran);
+}
+
+} // namespace
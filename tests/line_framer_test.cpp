@@ -0,0 +1,55 @@
+#include "line_framer.hpp"
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+std::vector<std::string> frame(std::initializer_list<std::string_view> chunks, size_t max_line = LineFramer::default_max_line) {
+  LineFramer framer{max_line};
+  std::vector<std::string> lines;
+  auto on_line = [&](std::string_view line) { lines.emplace_back(line); };
+  for (auto chunk : chunks) {
+    framer.feed(chunk, on_line);
+  }
+  framer.flush(on_line);
+  return lines;
+}
+
+} // namespace
+
+TEST_CASE("Splits lines inside one chunk", "[line_framer]") { CHECK(frame({"a\nbb\nccc\n"}) == (std::vector<std::string>{"a", "bb", "ccc"})); }
+
+TEST_CASE("Joins lines across chunks", "[line_framer]") { CHECK(frame({"ab", "c\nd", "e", "f\n"}) == (std::vector<std::string>{"abc", "def"})); }
+
+TEST_CASE("Strips carriage return and skips empty lines", "[line_framer]") { CHECK(frame({"a\r\n\r\n\nb\r", "\n"}) == (std::vector<std::string>{"a", "b"})); }
+
+TEST_CASE("Flush hands out the trailing partial line", "[line_framer]") { CHECK(frame({"a\nrest"}) == (std::vector<std::string>{"a", "rest"})); }
+
+TEST_CASE("Over-long lines are handed out in pieces", "[line_framer]") {
+  CHECK(frame({"abcdefghij\n"}, 4) == (std::vector<std::string>{"abcd", "efgh", "ij"}));
+  CHECK(frame({"ab", "cdef", "ghij\nk"}, 4) == (std::vector<std::string>{"abcd", "efgh", "ij", "k"}));
+  CHECK(frame({"abcd\r\nefgh"}, 4) == (std::vector<std::string>{"abcd", "efgh"}));
+}
+
+TEST_CASE("Output without line ends stays within the line limit", "[line_framer]") {
+  // a progress bar that only ever returns the carriage
+  std::string chunk;
+  for (int i = 0; i < 1000; ++i) {
+    chunk += std::to_string(i % 100) + "%\r";
+  }
+  LineFramer framer{256};
+  size_t pieces = 0;
+  size_t longest = 0;
+  auto on_line = [&](std::string_view line) {
+    ++pieces;
+    longest = std::max(longest, line.size());
+  };
+  for (int i = 0; i < 100; ++i) {
+    framer.feed(chunk, on_line);
+  }
+  CHECK(pieces >= chunk.size() * 100 / 256 - 1);
+  CHECK(longest <= 256u);
+}
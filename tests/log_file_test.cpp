@@ -0,0 +1,107 @@
+#include "log_file.hpp"
+#include <catch2/catch.hpp>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+class LogFileTest {
+protected:
+  LogFileTest() { std::filesystem::create_directories(m_folder); }
+  ~LogFileTest() { std::filesystem::remove_all(m_folder); }
+
+  std::string contents(const std::filesystem::path &path) const {
+    std::ifstream file{path, std::ios::binary};
+    std::stringstream text;
+    text << file.rdbuf();
+    return text.str();
+  }
+
+  std::string rotated(uint32_t index) const { return contents(rotated_log_path(m_path, index)); }
+  bool rotated_exists(uint32_t index) const { return std::filesystem::exists(rotated_log_path(m_path, index)); }
+
+  void write_run(LogRotation rotation, const std::string &text) {
+    RotatingLogFile file{m_path, rotation, true};
+    file.write(text.data(), text.size());
+  }
+
+  std::filesystem::path m_folder = std::filesystem::temp_directory_path() / ("mhdrl_log_file_test_" + std::to_string(getpid()));
+  std::filesystem::path m_path = m_folder / "launcher_log.txt";
+};
+
+} // namespace
+
+TEST_CASE("Rotated files are numbered before the extension", "[log_file]") {
+  CHECK(rotated_log_path("logs/moonlight_hdr_launcher_log.txt", 2) == std::filesystem::path{"logs/moonlight_hdr_launcher_log.2.txt"});
+  CHECK(rotated_log_path("binary_log", 1) == std::filesystem::path{"binary_log.1"});
+}
+
+TEST_CASE_METHOD(LogFileTest, "Opening rotates the previous runs out of the way", "[log_file]") {
+  for (int run = 1; run <= 4; ++run) {
+    write_run({0, 2}, "run " + std::to_string(run));
+  }
+  CHECK(contents(m_path) == "run 4");
+  CHECK(rotated(1) == "run 3");
+  CHECK(rotated(2) == "run 2");
+  CHECK_FALSE(rotated_exists(3));
+}
+
+TEST_CASE_METHOD(LogFileTest, "Without a size cap writes never rotate", "[log_file]") {
+  write_run({}, "previous");
+  // on_open is ignored without a cap, so this still rotates when opened
+  RotatingLogFile file{m_path, LogRotation{0, 5, false}, true};
+  const std::string block(64 * 1024, 'x');
+  for (int i = 0; i < 16; ++i) {
+    file.write(block.data(), block.size());
+  }
+  file.flush();
+  CHECK(file.rotations() == 0);
+  CHECK(std::filesystem::file_size(m_path) == 16 * block.size());
+  CHECK(rotated(1) == "previous");
+  CHECK_FALSE(rotated_exists(2));
+}
+
+TEST_CASE_METHOD(LogFileTest, "Size-only rotation appends and rotates at the cap", "[log_file]") {
+  write_run({}, "12345");
+  RotatingLogFile file{m_path, LogRotation{10, 2, false}, true};
+  // what the earlier run wrote counts towards the cap
+  file.write("6789", 4);
+  CHECK(file.rotations() == 0);
+  file.write("AB", 2);
+  CHECK(file.rotations() == 1);
+  file.write("CDEFGHIJ", 8);
+  file.write("K", 1);
+  CHECK(file.rotations() == 2);
+  file.flush();
+  CHECK(contents(m_path) == "K");
+  CHECK(rotated(1) == "ABCDEFGHIJ");
+  CHECK(rotated(2) == "123456789");
+}
+
+TEST_CASE_METHOD(LogFileTest, "A write larger than the cap goes into a file of its own", "[log_file]") {
+  RotatingLogFile file{m_path, LogRotation{4, 1, false}, true};
+  file.write("0123456789", 10);
+  CHECK(file.rotations() == 0);
+  file.write("ab", 2);
+  CHECK(file.rotations() == 1);
+  file.flush();
+  CHECK(contents(m_path) == "ab");
+  CHECK(rotated(1) == "0123456789");
+}
+
+TEST_CASE_METHOD(LogFileTest, "Keeping nothing truncates", "[log_file]") {
+  write_run({0, 0}, "first");
+  write_run({0, 0}, "second");
+  CHECK(contents(m_path) == "second");
+  CHECK_FALSE(rotated_exists(1));
+
+  RotatingLogFile file{m_path, LogRotation{4, 0, true}, true};
+  file.write("abc", 3);
+  file.write("de", 2);
+  file.flush();
+  CHECK(contents(m_path) == "de");
+  CHECK_FALSE(rotated_exists(1));
+}
@@ -0,0 +1,95 @@
+#include "log_format.hpp"
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+// Encoding cost, size and decode speed of the binary records against rendering the same event as text.
+
+namespace {
+
+constexpr size_t records = 1000;
+
+std::string binary_log() {
+  auto log = encode_binary_log_header(0);
+  std::string args;
+  for (size_t i = 0; i < records; ++i) {
+    args.clear();
+    encode_log_args(args, uint64_t{i}, uint64_t{1}, uint64_t{i % 300}, std::string_view{"NVAPI_ERROR"});
+    encode_binary_log_record(log, 1000, static_cast<uint16_t>(LogEvent::hdr_display_failed), args);
+  }
+  return log;
+}
+
+void BM_EncodeArgs(benchmark::State &state) {
+  std::string out;
+  uint64_t i = 0;
+  for (auto _ : state) {
+    out.clear();
+    encode_log_args(out, i++, uint64_t{1}, uint64_t{80}, std::string_view{"NVAPI_ERROR"});
+    benchmark::DoNotOptimize(out.data());
+  }
+  state.counters["bytes"] = static_cast<double>(out.size());
+}
+BENCHMARK(BM_EncodeArgs);
+
+// What the text log pays for the same event on the caller's side
+void BM_FormatText(benchmark::State &state) {
+  char buffer[128];
+  uint64_t i = 0;
+  int size = 0;
+  for (auto _ : state) {
+    size = std::snprintf(buffer, sizeof(buffer), "HDR display %llu on GPU %llu: failed after %llu ms: %s", static_cast<unsigned long long>(i++), 1ULL, 80ULL,
+                         "NVAPI_ERROR");
+    benchmark::DoNotOptimize(buffer);
+  }
+  state.counters["bytes"] = size;
+}
+BENCHMARK(BM_FormatText);
+
+void BM_DecodeArgs(benchmark::State &state) {
+  std::string data;
+  encode_log_args(data, uint64_t{12345}, uint64_t{1}, uint64_t{80}, std::string_view{"NVAPI_ERROR"});
+  for (auto _ : state) {
+    auto args = decode_log_args(data);
+    benchmark::DoNotOptimize(args);
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+}
+BENCHMARK(BM_DecodeArgs);
+
+void BM_ReadBinaryLog(benchmark::State &state) {
+  auto log = binary_log();
+  for (auto _ : state) {
+    BinaryLogReader reader{log};
+    BinaryLogRecord record;
+    size_t count = 0;
+    while (reader.next(record)) {
+      ++count;
+    }
+    benchmark::DoNotOptimize(count);
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * records));
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * log.size()));
+}
+BENCHMARK(BM_ReadBinaryLog);
+
+// What mhdrl_log_decode does per record when it renders text
+void BM_DecodeAndRender(benchmark::State &state) {
+  auto log = binary_log();
+  const auto format = log_event_format(LogEvent::hdr_display_failed).format;
+  for (auto _ : state) {
+    BinaryLogReader reader{log};
+    BinaryLogRecord record;
+    size_t bytes = 0;
+    while (reader.next(record)) {
+      bytes += render_log_event(format, *decode_log_args(record.args)).size();
+    }
+    benchmark::DoNotOptimize(bytes);
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * records));
+}
+BENCHMARK(BM_DecodeAndRender);
+
+} // namespace
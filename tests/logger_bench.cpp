@@ -0,0 +1,88 @@
+#include "logger.hpp"
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unistd.h>
+
+// Records per second and caller-side time per call of the asynchronous logger against the synchronous log() it replaced,
+// which formatted the timestamp with put_time and flushed the file twice on the caller's thread.
+
+namespace {
+
+std::filesystem::path bench_log_path(const char *name) {
+  return std::filesystem::temp_directory_path() / ("mhdrl_bench_" + std::to_string(getpid()) + "_" + name + ".txt");
+}
+
+// The old free function, behind a mutex so it can be called from several threads (stdout left out to keep the run quiet)
+std::mutex sync_log_mutex;
+void sync_log(const std::string &message, std::ofstream &file) {
+  std::lock_guard lock{sync_log_mutex};
+  auto now = std::chrono::system_clock::now();
+  auto in_time_t = std::chrono::system_clock::to_time_t(now);
+  auto time = std::put_time(std::localtime(&in_time_t), "%Y-%m-%d %X");
+  file << time << ": " << message << std::endl;
+  file.flush();
+}
+
+std::unique_ptr<std::ofstream> sync_file;
+std::unique_ptr<Logger> async_logger;
+
+void BM_SyncLog(benchmark::State &state) {
+  if (state.thread_index() == 0) {
+    sync_file = std::make_unique<std::ofstream>(bench_log_path("sync"));
+  }
+  int i = 0;
+  for (auto _ : state) {
+    sync_log("SUBPROCESS: line " + std::to_string(i++) + " of the child's output", *sync_file);
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) {
+    sync_file.reset();
+    std::filesystem::remove(bench_log_path("sync"));
+  }
+}
+BENCHMARK(BM_SyncLog)->ThreadRange(1, 4)->UseRealTime();
+
+void run_async(benchmark::State &state, FlushPolicy policy) {
+  if (state.thread_index() == 0) {
+    async_logger = std::make_unique<Logger>(bench_log_path("async"), false, policy);
+  }
+  int i = 0;
+  for (auto _ : state) {
+    async_logger->info("SUBPROCESS: line {} of the child's output", i++);
+  }
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index() == 0) {
+    // the drain is outside the timed loop: what the callers pay is the point, the writer keeps up separately
+    async_logger.reset();
+    std::filesystem::remove(bench_log_path("async"));
+  }
+}
+
+void BM_AsyncLogInterval(benchmark::State &state) { run_async(state, FlushPolicy::interval); }
+BENCHMARK(BM_AsyncLogInterval)->ThreadRange(1, 4)->UseRealTime();
+
+void BM_AsyncLogEveryRecord(benchmark::State &state) { run_async(state, FlushPolicy::every_record); }
+BENCHMARK(BM_AsyncLogEveryRecord)->ThreadRange(1, 4)->UseRealTime();
+
+// Includes the drain, so this is the end-to-end rate the writer thread sustains
+void BM_AsyncLogDrained(benchmark::State &state) {
+  Logger logger{bench_log_path("drained"), false, FlushPolicy::interval};
+  int i = 0;
+  for (auto _ : state) {
+    logger.info("SUBPROCESS: line {} of the child's output", i++);
+  }
+  logger.drain();
+  state.SetItemsProcessed(state.iterations());
+  logger.shutdown();
+  std::filesystem::remove(bench_log_path("drained"));
+}
+BENCHMARK(BM_AsyncLogDrained)->UseRealTime();
+
+} // namespace
@@ -0,0 +1,118 @@
+#include "logger.hpp"
+#include <catch2/catch.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+// Counts the allocations made by the calling thread, the writer thread allocates on its own account.
+namespace {
+thread_local uint64_t thread_allocations = 0;
+}
+
+void *operator new(std::size_t size) {
+  ++thread_allocations;
+  if (auto memory = std::malloc(size ? size : 1)) {
+    return memory;
+  }
+  throw std::bad_alloc{};
+}
+void operator delete(void *memory) noexcept { std::free(memory); }
+void operator delete(void *memory, std::size_t) noexcept { std::free(memory); }
+
+namespace {
+
+class LoggerTest {
+protected:
+  ~LoggerTest() { std::filesystem::remove(m_path); }
+
+  std::string contents() const {
+    std::ifstream file{m_path};
+    std::stringstream text;
+    text << file.rdbuf();
+    return text.str();
+  }
+
+  std::filesystem::path m_path = std::filesystem::temp_directory_path() / ("mhdrl_logger_test_" + std::to_string(getpid()) + ".txt");
+};
+
+TEST_CASE_METHOD(LoggerTest, "Writes records in order with level names", "[logger]") {
+  Logger logger{m_path, false};
+  logger.info("first {}", 1);
+  logger.warn("second {}", "two");
+  logger.error("third");
+  REQUIRE(logger.drain());
+  auto text = contents();
+  auto first = text.find("first 1");
+  auto second = text.find("second two");
+  auto third = text.find("third");
+  REQUIRE(first != std::string::npos);
+  REQUIRE(second != std::string::npos);
+  REQUIRE(third != std::string::npos);
+  CHECK(first < second);
+  CHECK(second < third);
+}
+
+TEST_CASE_METHOD(LoggerTest, "Runtime level filters records", "[logger]") {
+  Logger logger{m_path, false};
+  logger.set_level(LogLevel::warn);
+  logger.info("hidden");
+  logger.warn("shown");
+  REQUIRE(logger.drain());
+  auto text = contents();
+  CHECK(text.find("hidden") == std::string::npos);
+  CHECK(text.find("shown") != std::string::npos);
+}
+
+TEST_CASE_METHOD(LoggerTest, "Events are rendered into the text log", "[logger]") {
+  Logger logger{m_path, false};
+  logger.event<LogEvent::child_output>(std::string_view{"hello"});
+  REQUIRE(logger.drain());
+  CHECK(contents().find("SUBPROCESS: hello") != std::string::npos);
+}
+
+TEST_CASE_METHOD(LoggerTest, "Shutdown drains everything", "[logger]") {
+  {
+    Logger logger{m_path, false, FlushPolicy::on_shutdown};
+    for (int i = 0; i < 10000; ++i) {
+      logger.info("line {}", i);
+    }
+  }
+  CHECK(contents().find("line 9999") != std::string::npos);
+}
+
+TEST_CASE_METHOD(LoggerTest, "Disabled levels allocate nothing", "[logger]") {
+  Logger logger{m_path, false};
+  logger.set_level(LogLevel::error);
+  const std::string text(1000, 'x');
+  auto before = thread_allocations;
+  for (int i = 0; i < 1000; ++i) {
+    logger.trace("trace {} {}", i, text);
+    logger.debug("debug {} {}", i, text);
+    logger.info("info {} {}", i, text);
+    logger.warn("warn {} {}", i, text);
+    logger.event<LogEvent::child_output>(std::string_view{text});
+  }
+  CHECK(thread_allocations == before);
+}
+
+TEST_CASE_METHOD(LoggerTest, "Enabled calls reuse records from the pool", "[logger]") {
+  Logger logger{m_path, false};
+  // every pooled record grows its message once, after that logging the same length allocates nothing
+  for (int i = 0; i < 2000; ++i) {
+    logger.info("warm up {:>60}", i);
+  }
+  REQUIRE(logger.drain());
+  auto before = thread_allocations;
+  for (int i = 0; i < 100; ++i) {
+    logger.info("measured {:>58}", i);
+  }
+  CHECK(thread_allocations == before);
+  REQUIRE(logger.drain());
+}
+
+} // namespace
@@ -0,0 +1,73 @@
+#include "display_mode_catalog.hpp"
+#include "fake_display_backend.hpp"
+#include "mode_selector.hpp"
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <random>
+#include <unistd.h>
+#include <vector>
+
+// Best-fit selection and catalog queries over synthetic mode lists of the given size, and a warm catalog load
+// against enumerating the backend.
+
+namespace {
+
+std::vector<DisplayMode> synthetic_modes(size_t count) {
+  std::mt19937 random{42};
+  std::uniform_int_distribution<uint32_t> width{320, 7680}, height{200, 4320}, rate{24, 240};
+  std::vector<DisplayMode> modes;
+  modes.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    modes.push_back({width(random), height(random), rate(random)});
+  }
+  return modes;
+}
+
+void BM_SelectDisplayMode(benchmark::State &state) {
+  auto modes = synthetic_modes(static_cast<size_t>(state.range(0)));
+  ModeRequest request{2560, 1440, 120, 60};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(select_display_mode(modes, request));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SelectDisplayMode)->Range(64, 16384);
+
+void BM_CatalogMaxRefreshRate(benchmark::State &state) {
+  auto modes = synthetic_modes(static_cast<size_t>(state.range(0)));
+  modes.push_back({2560, 1440, 165});
+  DisplayModeCatalog catalog{modes};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(catalog.max_refresh_rate(2560, 1440));
+  }
+}
+BENCHMARK(BM_CatalogMaxRefreshRate)->Range(64, 16384);
+
+// What get_max_refresh_rate did before the catalog: a scan over every mode
+void BM_LinearMaxRefreshRate(benchmark::State &state) {
+  auto modes = synthetic_modes(static_cast<size_t>(state.range(0)));
+  modes.push_back({2560, 1440, 165});
+  for (auto _ : state) {
+    uint32_t max = 0;
+    for (const auto &mode : modes) {
+      if (mode.width == 2560 && mode.height == 1440 && mode.refresh_rate > max) {
+        max = mode.refresh_rate;
+      }
+    }
+    benchmark::DoNotOptimize(max);
+  }
+}
+BENCHMARK(BM_LinearMaxRefreshRate)->Range(64, 16384);
+
+void BM_CatalogOpen(benchmark::State &state) {
+  FakeDisplayBackend backend{synthetic_modes(1024), state.range(0) ? "DEL4321|460.89" : ""};
+  auto path = std::filesystem::temp_directory_path() / ("mhdrl_catalog_bench_" + std::to_string(getpid()) + ".bin");
+  DisplayModeCatalog::open(backend, path);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(DisplayModeCatalog::open(backend, path));
+  }
+  std::filesystem::remove(path);
+}
+BENCHMARK(BM_CatalogOpen)->ArgName("cached")->Arg(0)->Arg(1);
+
+} // namespace
@@ -0,0 +1,62 @@
+#include "mode_selector.hpp"
+#include <catch2/catch.hpp>
+#include <cmath>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct SelectionCase {
+  std::string name;
+  std::vector<DisplayMode> modes;
+  ModeRequest request;
+  ModeSelectionPolicy policy;
+  std::optional<DisplayMode> expected;
+};
+
+ModeSelectionPolicy tie_break(ModeTieBreak rule, double undersize = 2.0) {
+  ModeSelectionPolicy policy;
+  policy.tie_break = rule;
+  policy.weights.undersize = undersize;
+  return policy;
+}
+
+} // namespace
+
+TEST_CASE("Best fit selection", "[mode_selector]") {
+  const std::vector<DisplayMode> desktop = {{1920, 1080, 60}, {1920, 1080, 120}, {1920, 1080, 144}, {2560, 1080, 60}, {3840, 2160, 60}, {1280, 720, 60}};
+  const std::vector<SelectionCase> cases = {
+      {"an exact match wins", desktop, {1920, 1080, 144, 60}, {}, DisplayMode{1920, 1080, 144}},
+      {"the closest refresh rate of the same size", desktop, {1920, 1080, 165, 0}, {}, DisplayMode{1920, 1080, 144}},
+      {"a multiple of the stream frame rate beats a closer rate", desktop, {1920, 1080, 0, 60}, {}, DisplayMode{1920, 1080, 120}},
+      {"a rate below the stream frame rate is penalised", {{1920, 1080, 30}, {1920, 1080, 50}}, {1920, 1080, 0, 60}, {}, DisplayMode{1920, 1080, 50}},
+      {"larger modes are preferred to smaller ones", desktop, {2560, 1440, 60, 0}, {}, DisplayMode{3840, 2160, 60}},
+      {"without the undersize weight the closer pixel count wins", desktop, {2560, 1440, 60, 0}, tie_break(ModeTieBreak::higher_refresh_rate, 1.0),
+       DisplayMode{1920, 1080, 60}},
+      {"the aspect ratio outweighs the pixel count", {{2560, 1080, 60}, {2560, 1440, 60}}, {3440, 1440, 60, 0}, {}, DisplayMode{2560, 1080, 60}},
+      {"a tie goes to the higher refresh rate", {{2000, 2000, 60}, {500, 500, 120}}, {1000, 1000, 0, 0}, tie_break(ModeTieBreak::higher_refresh_rate, 1.0),
+       DisplayMode{500, 500, 120}},
+      {"or to the larger mode", {{2000, 2000, 60}, {500, 500, 120}}, {1000, 1000, 0, 0}, tie_break(ModeTieBreak::larger_mode, 1.0),
+       DisplayMode{2000, 2000, 60}},
+      {"equal sizes tie on refresh rate under both rules", {{1920, 1080, 60}, {1920, 1080, 120}}, {1920, 1080, 0, 0}, tie_break(ModeTieBreak::larger_mode),
+       DisplayMode{1920, 1080, 120}},
+      {"a mode of unknown refresh rate is not penalised", {{1920, 1080, 0}, {1920, 1080, 75}}, {1920, 1080, 60, 0}, {}, DisplayMode{1920, 1080, 0}},
+      {"zero sized modes never win", {{0, 0, 60}, {640, 480, 60}}, {1920, 1080, 60, 0}, {}, DisplayMode{640, 480, 60}},
+      {"no modes", {}, {1920, 1080, 60, 0}, {}, std::nullopt},
+      {"no requested size", desktop, {0, 1080, 60, 0}, {}, std::nullopt},
+  };
+  for (const auto &c : cases) {
+    SECTION(c.name) { CHECK(select_display_mode(c.modes, c.request, c.policy) == c.expected); }
+  }
+}
+
+TEST_CASE("Scores add up the weighted penalties", "[mode_selector]") {
+  ModeSelectionWeights weights;
+  CHECK(score_display_mode({1920, 1080, 60}, {1920, 1080, 60, 0}, weights) == 0.0);
+  CHECK(score_display_mode({3840, 2160, 60}, {1920, 1080, 60, 0}, weights) == Approx(std::log(4.0)));
+  CHECK(score_display_mode({960, 540, 60}, {1920, 1080, 60, 0}, weights) == Approx(2 * std::log(4.0)));
+  CHECK(score_display_mode({1920, 1080, 120}, {1920, 1080, 60, 0}, weights) == Approx(2 * std::log(2.0)));
+  CHECK(score_display_mode({1920, 1080, 90}, {1920, 1080, 0, 60}, weights) == Approx(2 * 0.5 / 2));
+  CHECK(score_display_mode({0, 1080, 60}, {1920, 1080, 60, 0}, weights) == HUGE_VAL);
+}
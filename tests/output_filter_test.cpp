@@ -0,0 +1,102 @@
+#include "output_filter.hpp"
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+class OutputFilterTest {
+protected:
+  OutputFilter make(OutputLimits limits) {
+    return OutputFilter{limits, [this](OutputStream stream, std::string_view line) { m_logged.emplace_back(stream, line); }};
+  }
+
+  std::vector<std::string> logged(OutputStream stream = OutputStream::out) const {
+    std::vector<std::string> lines;
+    for (const auto &[s, line] : m_logged) {
+      if (s == stream) {
+        lines.push_back(line);
+      }
+    }
+    return lines;
+  }
+
+  std::vector<std::pair<OutputStream, std::string>> m_logged;
+  OutputFilter::clock::time_point m_start = OutputFilter::clock::now();
+};
+
+} // namespace
+
+TEST_CASE_METHOD(OutputFilterTest, "Repeats of the previous line are collapsed into a count", "[output_filter]") {
+  auto filter = make({0, 1, 1024});
+  for (auto line : {"a", "a", "a", "b", "b", "a"}) {
+    filter.line(OutputStream::out, line, m_start);
+  }
+  filter.flush();
+  CHECK(logged() == std::vector<std::string>{"a", "(previous line repeated 2 more times)", "b", "(previous line repeated 1 more times)", "a"});
+  CHECK(filter.dropped() == 3);
+}
+
+TEST_CASE_METHOD(OutputFilterTest, "Streams are filtered apart", "[output_filter]") {
+  auto filter = make({0, 1, 1024});
+  filter.line(OutputStream::out, "same", m_start);
+  filter.line(OutputStream::err, "same", m_start);
+  filter.line(OutputStream::out, "same", m_start);
+  filter.flush();
+  CHECK(logged(OutputStream::out) == std::vector<std::string>{"same", "(previous line repeated 1 more times)"});
+  CHECK(logged(OutputStream::err) == std::vector<std::string>{"same"});
+}
+
+TEST_CASE_METHOD(OutputFilterTest, "Lines over the rate limit are sampled", "[output_filter]") {
+  auto filter = make({3, 2, 1024});
+  for (int i = 1; i <= 10; ++i) {
+    filter.line(OutputStream::out, std::to_string(i), m_start + std::chrono::milliseconds{i});
+  }
+  CHECK(logged() == std::vector<std::string>{"1", "2", "3", "5", "7", "9"});
+  // the next second reports what was left out and starts a fresh window
+  filter.line(OutputStream::out, "11", m_start + 1s + 1ms);
+  CHECK(logged() == std::vector<std::string>{"1", "2", "3", "5", "7", "9", "(4 lines over the rate limit not logged)", "11"});
+  CHECK(filter.dropped() == 4);
+}
+
+TEST_CASE_METHOD(OutputFilterTest, "Pending counts are logged on flush", "[output_filter]") {
+  auto filter = make({1, 100, 1024});
+  filter.line(OutputStream::err, "x", m_start);
+  filter.line(OutputStream::err, "y", m_start);
+  filter.line(OutputStream::err, "z", m_start);
+  filter.flush();
+  CHECK(logged(OutputStream::err) == std::vector<std::string>{"x", "(2 lines over the rate limit not logged)"});
+}
+
+TEST_CASE_METHOD(OutputFilterTest, "Every line goes into the tail", "[output_filter]") {
+  auto filter = make({1, 1000, 1024});
+  filter.line(OutputStream::out, "a", m_start);
+  filter.line(OutputStream::out, "a", m_start);
+  filter.line(OutputStream::err, "b", m_start);
+  filter.line(OutputStream::out, "c", m_start);
+  CHECK(filter.tail().contents() == "a\na\nstderr: b\nc\n");
+}
+
+TEST_CASE("The tail keeps the last complete lines", "[output_filter]") {
+  OutputTail tail{16};
+  for (int i = 0; i < 100; ++i) {
+    tail.append(OutputStream::out, "line " + std::to_string(i));
+  }
+  CHECK(tail.contents() == "line 99\n");
+  CHECK(tail.capacity() == 16u);
+
+  tail.append(OutputStream::out, std::string(40, 'x') + "end");
+  CHECK(tail.contents().empty());
+  tail.append(OutputStream::out, "ok");
+  CHECK(tail.contents() == "ok\n");
+}
+
+TEST_CASE("A tail without capacity keeps nothing", "[output_filter]") {
+  OutputTail tail{0};
+  tail.append(OutputStream::err, "lost");
+  CHECK(tail.contents().empty());
+}
@@ -0,0 +1,150 @@
+#include "prep_command.hpp"
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+const std::string display1 = "\\\\.\\DISPLAY1";
+const std::string display2 = "\\\\.\\DISPLAY2";
+
+// Keeps the current mode of every display, a device in `failing` rejects every change and restore.
+class FakePrepTarget : public PrepTarget {
+public:
+  bool apply_primary_mode(const DisplayMode &mode) override {
+    ++applied;
+    if (failing.count("")) {
+      return false;
+    }
+    primary = mode;
+    return true;
+  }
+
+  bool apply_display_modes(const std::vector<DisplayChange> &changes) override {
+    ++applied;
+    if (std::any_of(changes.begin(), changes.end(), [&](const DisplayChange &change) { return failing.count(change.device); })) {
+      return false;
+    }
+    for (const auto &change : changes) {
+      modes[change.device] = change.target;
+    }
+    return true;
+  }
+
+  std::vector<JournalDisplay> restore_displays(const std::vector<JournalDisplay> &displays) override {
+    std::vector<JournalDisplay> failed;
+    for (const auto &display : displays) {
+      if (failing.count(display.device)) {
+        failed.push_back(display);
+      } else {
+        (display.device.empty() ? primary : modes[display.device]) = display.original_mode;
+      }
+    }
+    return failed;
+  }
+
+  SessionSnapshot snapshot() const {
+    SessionSnapshot snapshot;
+    snapshot.primary_mode = primary;
+    for (const auto &[device, mode] : modes) {
+      snapshot.displays.push_back({device, mode});
+    }
+    return snapshot;
+  }
+
+  DisplayMode primary{2560, 1440, 144};
+  std::map<std::string, DisplayMode> modes{{display1, {2560, 1440, 144}}, {display2, {1920, 1080, 60}}};
+  std::set<std::string> failing;
+  int applied = 0;
+};
+
+class PrepCommandTest {
+protected:
+  ~PrepCommandTest() { std::filesystem::remove(m_state_path); }
+
+  std::filesystem::path m_state_path = std::filesystem::temp_directory_path() / ("mhdrl_prep_test_" + std::to_string(getpid()) + ".bin");
+  FakePrepTarget m_target;
+  SessionGoal m_goal{DisplayMode{1920, 1080, 60}, {{display2, {3840, 2160, 120}}}, false, std::nullopt};
+};
+
+} // namespace
+
+TEST_CASE_METHOD(PrepCommandTest, "Undo restores what do changed and removes the state file", "[prep_command]") {
+  auto before = m_target.snapshot();
+  REQUIRE(prep_do(m_goal, before, m_state_path, 42, m_target).ok);
+  CHECK(m_target.primary == DisplayMode{1920, 1080, 60});
+  CHECK(m_target.modes[display2] == DisplayMode{3840, 2160, 120});
+  auto state = read_journal(m_state_path);
+  REQUIRE(state);
+  CHECK(state->owner_pid == 42u);
+  CHECK(state->displays == std::vector<JournalDisplay>{{"", {2560, 1440, 144}}, {display2, {1920, 1080, 60}}});
+
+  REQUIRE(prep_undo(m_state_path, m_target).ok);
+  CHECK(m_target.primary == *before.primary_mode);
+  CHECK(m_target.modes[display1] == DisplayMode{2560, 1440, 144});
+  CHECK(m_target.modes[display2] == DisplayMode{1920, 1080, 60});
+  CHECK_FALSE(std::filesystem::exists(m_state_path));
+}
+
+TEST_CASE_METHOD(PrepCommandTest, "Undo without a state file changes nothing", "[prep_command]") {
+  auto outcome = prep_undo(m_state_path, m_target);
+  CHECK(outcome.ok);
+  CHECK(outcome.messages == std::vector<std::string>{"nothing to undo"});
+  CHECK(m_target.primary == DisplayMode{2560, 1440, 144});
+  CHECK_FALSE(std::filesystem::exists(m_state_path));
+}
+
+TEST_CASE_METHOD(PrepCommandTest, "A second do keeps the originals of the first", "[prep_command]") {
+  REQUIRE(prep_do(m_goal, m_target.snapshot(), m_state_path, 42, m_target).ok);
+  SessionGoal second{DisplayMode{1280, 720, 60}, {{display1, {1920, 1080, 60}}, {display2, {2560, 1440, 60}}}, false, std::nullopt};
+  REQUIRE(prep_do(second, m_target.snapshot(), m_state_path, 43, m_target).ok);
+  auto state = read_journal(m_state_path);
+  REQUIRE(state);
+  CHECK(state->owner_pid == 43u);
+  // display1 was first changed by the second --do, so its original is the mode from before that one
+  CHECK(state->displays ==
+        std::vector<JournalDisplay>{{"", {2560, 1440, 144}}, {display2, {1920, 1080, 60}}, {display1, {2560, 1440, 144}}});
+
+  REQUIRE(prep_undo(m_state_path, m_target).ok);
+  CHECK(m_target.primary == DisplayMode{2560, 1440, 144});
+  CHECK(m_target.modes[display1] == DisplayMode{2560, 1440, 144});
+  CHECK(m_target.modes[display2] == DisplayMode{1920, 1080, 60});
+  CHECK_FALSE(std::filesystem::exists(m_state_path));
+}
+
+TEST_CASE_METHOD(PrepCommandTest, "A failed do forgets only what it recorded itself", "[prep_command]") {
+  REQUIRE(prep_do(SessionGoal{DisplayMode{1920, 1080, 60}, {}, false, std::nullopt}, m_target.snapshot(), m_state_path, 42, m_target).ok);
+  m_target.failing = {display2};
+  CHECK_FALSE(prep_do(m_goal, m_target.snapshot(), m_state_path, 43, m_target).ok);
+  auto state = read_journal(m_state_path);
+  REQUIRE(state);
+  CHECK(state->displays == std::vector<JournalDisplay>{{"", {2560, 1440, 144}}});
+}
+
+TEST_CASE_METHOD(PrepCommandTest, "What cannot be restored is kept for the next undo", "[prep_command]") {
+  REQUIRE(prep_do(m_goal, m_target.snapshot(), m_state_path, 42, m_target).ok);
+  m_target.failing = {display2};
+  CHECK_FALSE(prep_undo(m_state_path, m_target).ok);
+  CHECK(m_target.primary == DisplayMode{2560, 1440, 144});
+  auto state = read_journal(m_state_path);
+  REQUIRE(state);
+  CHECK(state->displays == std::vector<JournalDisplay>{{display2, {1920, 1080, 60}}});
+
+  m_target.failing.clear();
+  REQUIRE(prep_undo(m_state_path, m_target).ok);
+  CHECK(m_target.modes[display2] == DisplayMode{1920, 1080, 60});
+  CHECK_FALSE(std::filesystem::exists(m_state_path));
+}
+
+TEST_CASE_METHOD(PrepCommandTest, "A damaged state file is deleted", "[prep_command]") {
+  std::ofstream{m_state_path} << "garbage";
+  CHECK_FALSE(prep_undo(m_state_path, m_target).ok);
+  CHECK_FALSE(std::filesystem::exists(m_state_path));
+  CHECK(m_target.applied == 0);
+}
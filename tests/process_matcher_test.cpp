@@ -0,0 +1,105 @@
+#include "event_loop.hpp"
+#include "netlink_process_trace.hpp"
+#include "process_matcher.hpp"
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <sys/wait.h>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+TEST_CASE("Patterns match names and paths", "[process_matcher]") {
+  struct Case {
+    const char *patterns;
+    const char *image_path;
+    bool matches;
+  };
+  const Case cases[] = {
+      // names, with or without .exe, in any case and behind any path
+      {"game.exe", "C:\\Games\\game.exe", true},
+      {"game", "C:\\Games\\game.exe", true},
+      {"game", "/usr/bin/game", true},
+      {"GAME.EXE", "c:\\games\\Game.exe", true},
+      {"game.exe", "C:\\Games\\game", false},
+      {"game", "C:\\Games\\game2.exe", false},
+      {"game", "C:\\game\\other.exe", false},
+      // several patterns, blanks around them and empty ones
+      {" launcher.exe ; game ;; ", "D:\\game.exe", true},
+      {" launcher.exe ; game ;; ", "D:\\launcher.exe", true},
+      {" launcher.exe ; game ;; ", "D:\\other.exe", false},
+      // path patterns
+      {"C:\\Games\\*\\bin\\game*.exe", "C:\\Games\\Mass Effect\\bin\\game_dx12.exe", true},
+      {"C:\\Games\\*\\bin\\game*.exe", "c:/games/x/bin/GAME.exe", true},
+      {"C:\\Games\\*\\bin\\game*.exe", "C:\\Games\\x\\bin\\launcher.exe", false},
+      {"C:\\Games\\*\\bin\\game*.exe", "D:\\Games\\x\\bin\\game.exe", false},
+      {"C:\\Games\\game?.exe", "C:\\Games\\game2.exe", true},
+      {"C:\\Games\\game?.exe", "C:\\Games\\game.exe", false},
+      {"C:\\Games\\game?.exe", "C:\\Games\\game22.exe", false},
+      {"*\\game.exe", "C:\\Games\\game.exe", true},
+      {"*", "anything", true},
+      {"C:\\a*b*c.exe", "C:\\aXbYbZc.exe", true},
+      {"C:\\a*b*c.exe", "C:\\aXcYb.exe", false},
+      // a path without wildcards has to match the whole path
+      {"C:\\Games\\game.exe", "C:\\Games\\game.exe", true},
+      {"C:\\Games\\game.exe", "D:\\C:\\Games\\game.exe", false},
+      {"", "C:\\game.exe", false},
+  };
+  for (const auto &test : cases) {
+    SECTION(std::string(test.patterns) + " / " + test.image_path) {
+      CHECK(ProcessMatcher{test.patterns}.matches(test.image_path) == test.matches);
+    }
+  }
+}
+
+TEST_CASE("A matcher knows whether it has patterns and path patterns", "[process_matcher]") {
+  CHECK(ProcessMatcher{}.empty());
+  CHECK(ProcessMatcher{" ; ;"}.empty());
+  CHECK_FALSE(ProcessMatcher{"game"}.empty());
+  CHECK_FALSE(ProcessMatcher{"game"}.has_path_patterns());
+  CHECK(ProcessMatcher{"game;C:\\*.exe"}.has_path_patterns());
+}
+
+TEST_CASE("Backtracking stays linear on patterns with many stars", "[process_matcher]") {
+  std::string path(4096, 'a');
+  ProcessMatcher matcher{"*a*a*a*a*a*a*a*a*a*a*b"};
+  auto start = std::chrono::steady_clock::now();
+  CHECK_FALSE(matcher.matches(path));
+  CHECK(std::chrono::steady_clock::now() - start < 1s);
+}
+
+TEST_CASE("Programs started on the system are reported with their image path", "[process_matcher]") {
+  EventLoop loop;
+  ProcessMatcher matcher{"/usr/*/sleep;/bin/sleep"};
+  std::vector<pid_t> matched;
+  std::optional<NetlinkProcessTrace> trace;
+  try {
+    trace.emplace(loop, [&](pid_t pid, const std::string &image_path) {
+      if (matcher.matches(image_path)) {
+        matched.push_back(pid);
+        loop.stop();
+      }
+    });
+  } catch (std::system_error &e) {
+    WARN("The process connector is not available here: " << e.what());
+    return;
+  }
+  auto child = fork();
+  if (child == 0) {
+    execlp("sleep", "sleep", "0.1", nullptr);
+    std::_Exit(127);
+  }
+  auto timeout = loop.add_timer(5s, [&]() { loop.stop(); });
+  loop.run();
+  loop.cancel_timer(timeout);
+  waitpid(child, nullptr, 0);
+  // other programs that happen to run sleep may match as well
+  CHECK(std::find(matched.begin(), matched.end(), child) != matched.end());
+}
+
+} // namespace
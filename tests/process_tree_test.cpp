@@ -0,0 +1,202 @@
+#include "event_loop.hpp"
+#include "process_reaper.hpp"
+#include "process_tree.hpp"
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+TEST_CASE("Image names are taken from Windows and POSIX paths", "[process_tree]") {
+  CHECK(image_name("C:\\Games\\Game\\game.exe") == "game.exe");
+  CHECK(image_name("/usr/bin/sleep") == "sleep");
+  CHECK(image_name("C:/Games/mixed\\game.exe") == "game.exe");
+  CHECK(image_name("game.exe") == "game.exe");
+  CHECK(image_name("C:\\Games\\") == "");
+}
+
+TEST_CASE("Without a session process the session lasts until the tree is empty", "[process_tree]") {
+  ProcessTreeTracker tree;
+  tree.started(1, "C:\\launcher.exe");
+  tree.started(2, "C:\\game.exe");
+  tree.exited(1);
+  CHECK_FALSE(tree.session_over());
+  CHECK(tree.running() == 1);
+  tree.exited(2);
+  CHECK_FALSE(tree.session_over());
+  tree.tree_empty();
+  CHECK(tree.session_over());
+  CHECK_FALSE(tree.session_process_seen());
+}
+
+TEST_CASE("With a session process the session ends once every instance of it has exited", "[process_tree]") {
+  ProcessTreeTracker tree{"Game"};
+  tree.started(1, "C:\\launcher.exe");
+  tree.started(2, "C:\\Games\\GAME.EXE");
+  tree.started(3, "C:\\Games\\game.exe");
+  CHECK(tree.session_process_seen());
+  tree.exited(2);
+  CHECK_FALSE(tree.session_over());
+  tree.exited(3);
+  // the launcher still runs, the game is done
+  CHECK(tree.session_over());
+}
+
+TEST_CASE("Repeated and unknown notifications are ignored", "[process_tree]") {
+  ProcessTreeTracker tree{"game.exe"};
+  tree.started(2, "C:\\game.exe");
+  tree.started(2, "C:\\game.exe");
+  CHECK(tree.running() == 1);
+  tree.exited(7);
+  tree.exited(2);
+  tree.exited(2);
+  CHECK(tree.session_over());
+  CHECK(tree.running() == 0);
+}
+
+TEST_CASE("An empty tree ends the session even if the session process never ran or is still listed", "[process_tree]") {
+  SECTION("never ran") {
+    ProcessTreeTracker tree{"game"};
+    tree.started(1, "C:\\launcher.exe");
+    tree.exited(1);
+    CHECK_FALSE(tree.session_over());
+    tree.tree_empty();
+    CHECK(tree.session_over());
+    CHECK_FALSE(tree.session_process_seen());
+  }
+  SECTION("exit notification lost") {
+    ProcessTreeTracker tree{"game"};
+    tree.started(2, "C:\\game.exe");
+    tree.tree_empty();
+    CHECK(tree.session_over());
+    CHECK(tree.running() == 0);
+  }
+  SECTION("a process joins after the tree was empty") {
+    ProcessTreeTracker tree;
+    tree.tree_empty();
+    tree.started(3, "C:\\updater.exe");
+    CHECK_FALSE(tree.session_over());
+  }
+}
+
+// Runs the reaper's notifications into a tracker until the session is over, like run_session does with the job object.
+struct ReaperSession {
+  explicit ReaperSession(std::string session_process = {}) : tree{std::move(session_process)} {}
+
+  // The child is spawned once the reaper exists, like launcher_exe is started into the job.
+  void run(const std::function<pid_t()> &spawn) {
+    ProcessReaper reaper{loop, {[&](pid_t pid, const std::string &image_path) {
+                                  started.push_back(pid);
+                                  images.push_back(image_path);
+                                  tree.started(static_cast<uint32_t>(pid), image_path);
+                                },
+                                [&](pid_t pid) {
+                                  exited.push_back(pid);
+                                  tree.exited(static_cast<uint32_t>(pid));
+                                  stop_if_over();
+                                },
+                                [&]() {
+                                  tree.tree_empty();
+                                  stop_if_over();
+                                }}};
+    if (on_start) {
+      on_start(reaper);
+    }
+    reaper.add(spawn());
+    // a safety net, a working reaper stops the loop long before
+    auto timeout = loop.add_timer(10s, [&]() { loop.stop(); });
+    auto start = std::chrono::steady_clock::now();
+    if (!tree.session_over()) {
+      loop.run();
+    }
+    duration = std::chrono::steady_clock::now() - start;
+    loop.cancel_timer(timeout);
+  }
+
+  void stop_if_over() {
+    if (tree.session_over()) {
+      loop.stop();
+    }
+  }
+
+  EventLoop loop;
+  ProcessTreeTracker tree;
+  std::function<void(ProcessReaper &)> on_start;
+  std::vector<pid_t> started;
+  std::vector<pid_t> exited;
+  std::vector<std::string> images;
+  std::chrono::steady_clock::duration duration{};
+};
+
+// A launcher that starts the game detached and exits at once, the game runs for a while.
+pid_t spawn_launcher(const char *game_seconds) {
+  auto launcher = fork();
+  if (launcher == 0) {
+    if (fork() == 0) {
+      execlp("sleep", "sleep", game_seconds, nullptr);
+      std::_Exit(127);
+    }
+    std::_Exit(0);
+  }
+  return launcher;
+}
+
+TEST_CASE("The reaper follows a game that outlives its launcher", "[process_tree]") {
+  ReaperSession session;
+  session.run([]() { return spawn_launcher("0.3"); });
+  REQUIRE(session.tree.session_over());
+  // the launcher and the reparented game
+  CHECK(session.started.size() == 2);
+  CHECK(session.exited.size() == 2);
+  CHECK(session.duration >= 250ms);
+  CHECK(session.duration < 5s);
+}
+
+TEST_CASE("The reaper reports the image path that ends a session with a session process", "[process_tree]") {
+  ReaperSession session{"sleep"};
+  session.run([]() { return spawn_launcher("0.2"); });
+  REQUIRE(session.tree.session_over());
+  CHECK(session.tree.session_process_seen());
+  CHECK(std::find_if(session.images.begin(), session.images.end(), [](const std::string &path) { return image_name(path) == "sleep"; }) !=
+        session.images.end());
+}
+
+TEST_CASE("A launcher that is gone before it is added still ends the session", "[process_tree]") {
+  pid_t child = 0;
+  ReaperSession session;
+  session.run([&child]() {
+    child = fork();
+    if (child == 0) {
+      std::_Exit(0);
+    }
+    // give it time to exit
+    std::this_thread::sleep_for(50ms);
+    return child;
+  });
+  CHECK(session.tree.session_over());
+  CHECK(session.exited == std::vector<pid_t>{child});
+}
+
+TEST_CASE("Terminating the tree ends a session that would run for long", "[process_tree]") {
+  ReaperSession session;
+  session.on_start = [&session](ProcessReaper &reaper) { session.loop.add_timer(100ms, [&reaper]() { reaper.terminate(SIGKILL); }); };
+  session.run([]() {
+    auto launcher = fork();
+    if (launcher == 0) {
+      execlp("sleep", "sleep", "30", nullptr);
+      std::_Exit(127);
+    }
+    return launcher;
+  });
+  CHECK(session.tree.session_over());
+  CHECK(session.duration < 5s);
+}
+
+} // namespace
@@ -0,0 +1,53 @@
+#include "http_stand_in.hpp"
+#include "posix_http_transport.hpp"
+#include "report_spool.hpp"
+#include "report_uploader.hpp"
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unistd.h>
+
+// What crash reporting adds to the startup path, with a crash report of an earlier run waiting to be sent: nothing
+// without reporting, the spool and the deferred uploader as the launcher starts them now, and a synchronous upload to
+// a local HTTP stand-in as the startup path paid when reports were sent before the stream started. The stand-in
+// answers after the given delay in milliseconds, a real network adds its round trips on top.
+
+namespace {
+
+const std::string pending_report(64 * 1024, 'r');
+
+std::filesystem::path spool_folder() { return std::filesystem::temp_directory_path() / ("mhdrl_report_bench_" + std::to_string(getpid())); }
+
+void BM_StartupWithoutReporting(benchmark::State &state) {
+  for (auto _ : state) {
+    benchmark::ClobberMemory();
+  }
+}
+BENCHMARK(BM_StartupWithoutReporting)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+void BM_StartupDeferredUpload(benchmark::State &state) {
+  HttpStandIn server;
+  SentryEndpoint endpoint{server.url(), "auth"};
+  ReportSpool spool{spool_folder(), 1};
+  spool.add(pending_report);
+  for (auto _ : state) {
+    // the uploader waits for its start delay, the launcher does not
+    ReportSpool startup_spool{spool_folder(), 1};
+    ReportUploader uploader{startup_spool, [&](const std::string &report) { return post_sentry_envelope(endpoint, report, std::chrono::seconds{5}); }};
+    benchmark::DoNotOptimize(&uploader);
+  }
+  std::filesystem::remove_all(spool_folder());
+}
+BENCHMARK(BM_StartupDeferredUpload)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+void BM_StartupSynchronousUpload(benchmark::State &state) {
+  HttpStandIn server{{}, std::chrono::milliseconds{state.range(0)}};
+  SentryEndpoint endpoint{server.url(), "auth"};
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(post_sentry_envelope(endpoint, pending_report, std::chrono::seconds{5}));
+  }
+}
+BENCHMARK(BM_StartupSynchronousUpload)->Arg(0)->Arg(20)->Unit(benchmark::kMicrosecond)->UseRealTime();
+
+} // namespace
@@ -0,0 +1,220 @@
+#include "logger.hpp"
+#include "restore_journal.hpp"
+#include <catch2/catch.hpp>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+const std::string secondary = "\\\\.\\DISPLAY2";
+
+// The displays as the replay target sees them: the primary mode, the other displays' modes and where HDR is on.
+struct World {
+  DisplayMode primary{1920, 1080, 60};
+  std::map<std::string, DisplayMode> modes{{secondary, {2560, 1440, 144}}};
+  std::set<uint32_t> hdr_on{3};
+  std::set<uint32_t> hdr_capable{1, 3, 4};
+
+  friend bool operator==(const World &, const World &) = default;
+};
+
+class FakeReplayTarget : public JournalReplayTarget {
+public:
+  explicit FakeReplayTarget(World &world) : m_world{world} {}
+
+  bool process_alive(uint32_t pid, uint64_t) override { return alive.count(pid) != 0; }
+
+  bool restore_display(const JournalDisplay &display) override {
+    (display.device.empty() ? m_world.primary : m_world.modes[display.device]) = display.original_mode;
+    return true;
+  }
+
+  bool disable_hdr(const std::vector<HdrDisplay> &displays) override {
+    ++disable_calls;
+    if (fail_hdr) {
+      return false;
+    }
+    if (displays.empty()) {
+      for (auto id : m_world.hdr_capable) {
+        m_world.hdr_on.erase(id);
+      }
+    }
+    for (const auto &display : displays) {
+      m_world.hdr_on.erase(display.display_id);
+    }
+    return true;
+  }
+
+  std::set<uint32_t> alive;
+  bool fail_hdr = false;
+  int disable_calls = 0;
+
+private:
+  World &m_world;
+};
+
+class RestoreJournalTest {
+protected:
+  RestoreJournalTest() { std::filesystem::create_directories(m_folder); }
+  ~RestoreJournalTest() {
+    m_logger.shutdown();
+    std::filesystem::remove_all(m_folder);
+    std::filesystem::remove(m_log_path);
+  }
+
+  size_t journal_count() const {
+    size_t count = 0;
+    for ([[maybe_unused]] const auto &entry : std::filesystem::directory_iterator{m_folder}) {
+      ++count;
+    }
+    return count;
+  }
+
+  std::filesystem::path m_folder = std::filesystem::temp_directory_path() / ("mhdrl_journal_test_" + std::to_string(getpid()));
+  std::filesystem::path m_log_path = std::filesystem::temp_directory_path() / ("mhdrl_journal_test_" + std::to_string(getpid()) + ".txt");
+  Logger m_logger{m_log_path, false};
+};
+
+uint32_t fnv1a(const std::string &data) {
+  uint32_t hash = 2166136261u;
+  for (auto c : data) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+  }
+  return hash;
+}
+
+void put_u32(std::string &out, uint32_t value) {
+  for (int shift = 0; shift < 32; shift += 8) {
+    out.push_back(static_cast<char>(value >> shift));
+  }
+}
+
+} // namespace
+
+TEST_CASE("Journals round trip", "[restore_journal]") {
+  RestoreJournal journal;
+  journal.owner_pid = 4242;
+  journal.owner_start_time = 0x0123456789abcdefull;
+  journal.displays = {{"", {1920, 1080, 60}}, {secondary, {2560, 1440, 144}}};
+  journal.hdr_enabled = true;
+  journal.hdr_displays = {{0, 1}, {1, 4}};
+  auto decoded = decode_journal(encode_journal(journal));
+  REQUIRE(decoded);
+  CHECK(*decoded == journal);
+}
+
+TEST_CASE("Damaged journals are rejected", "[restore_journal]") {
+  RestoreJournal journal;
+  journal.owner_pid = 1;
+  journal.hdr_enabled = true;
+  journal.hdr_displays = {{0, 1}};
+  auto data = encode_journal(journal);
+  for (size_t i = 0; i < data.size(); ++i) {
+    auto damaged = data;
+    damaged[i] ^= 0x40;
+    CHECK_FALSE(decode_journal(damaged));
+  }
+  CHECK_FALSE(decode_journal(data.substr(0, data.size() - 1)));
+  CHECK_FALSE(decode_journal(""));
+}
+
+TEST_CASE("Journals from before the HDR displays were recorded are read without them", "[restore_journal]") {
+  std::string data = "MHDRLRJ2";
+  put_u32(data, 77);
+  put_u32(data, 5);
+  put_u32(data, 0);
+  data.push_back(1);
+  put_u32(data, 0);
+  put_u32(data, fnv1a(data));
+  auto journal = decode_journal(data);
+  REQUIRE(journal);
+  CHECK(journal->owner_pid == 77u);
+  CHECK(journal->owner_start_time == 5u);
+  CHECK(journal->hdr_enabled);
+  CHECK(journal->hdr_displays.empty());
+}
+
+// A session's changes, each journal write and each change a step of its own. The launcher is killed after every
+// step in turn; the journal is written synchronously, so abandoning it leaves on disk what a killed process leaves.
+// The next start's replay must bring the displays back to where they were, HDR included, and leave no journal.
+TEST_CASE_METHOD(RestoreJournalTest, "A crash at every step is restored by the next start", "[restore_journal]") {
+  const World before;
+  const std::vector<HdrDisplay> enabled = {{0, 1}, {1, 4}};
+  std::vector<std::function<void(SessionJournal &, World &)>> steps = {
+      [&](SessionJournal &journal, World &world) { REQUIRE(journal.display_changing({"", world.primary})); },
+      [](SessionJournal &, World &world) { world.primary = {1280, 720, 120}; },
+      [&](SessionJournal &journal, World &world) { REQUIRE(journal.display_changing({secondary, world.modes[secondary]})); },
+      [](SessionJournal &, World &world) { world.modes[secondary] = {1920, 1080, 60}; },
+      [&](SessionJournal &journal, World &) { REQUIRE(journal.hdr_enabling(enabled)); },
+      [](SessionJournal &, World &world) { world.hdr_on.insert(1); },
+      [](SessionJournal &, World &world) { world.hdr_on.insert(4); },
+      // teardown, HDR first
+      [](SessionJournal &, World &world) { world.hdr_on = {3}; },
+      [](SessionJournal &journal, World &) { journal.hdr_restored(); },
+      [&](SessionJournal &, World &world) { world.primary = before.primary; },
+      [](SessionJournal &journal, World &) { journal.display_restored(""); },
+      [&](SessionJournal &, World &world) { world.modes[secondary] = before.modes.at(secondary); },
+      [](SessionJournal &journal, World &) { journal.display_restored(secondary); },
+  };
+  for (size_t crash_after = 0; crash_after <= steps.size(); ++crash_after) {
+    DYNAMIC_SECTION("crash after step " << crash_after) {
+      World world;
+      {
+        SessionJournal journal{journal_path(m_folder, 100), 100, 1};
+        for (size_t i = 0; i < crash_after; ++i) {
+          steps[i](journal, world);
+        }
+      }
+      FakeReplayTarget target{world};
+      replay_stale_journals(m_folder, target, m_logger);
+      CHECK(world == before);
+      CHECK(journal_count() == 0);
+      // HDR on display 3 was on before the session and stays on
+      CHECK(world.hdr_on.count(3) == 1);
+    }
+  }
+}
+
+TEST_CASE_METHOD(RestoreJournalTest, "What fails to restore is kept for the next start", "[restore_journal]") {
+  World world;
+  {
+    SessionJournal journal{journal_path(m_folder, 100), 100, 1};
+    REQUIRE(journal.hdr_enabling({{0, 4}}));
+    world.hdr_on.insert(4);
+  }
+  FakeReplayTarget target{world};
+  target.fail_hdr = true;
+  replay_stale_journals(m_folder, target, m_logger);
+  REQUIRE(journal_count() == 1);
+  auto kept = read_journal(journal_path(m_folder, 100));
+  REQUIRE(kept);
+  CHECK(kept->hdr_displays == std::vector<HdrDisplay>{{0, 4}});
+
+  target.fail_hdr = false;
+  replay_stale_journals(m_folder, target, m_logger);
+  CHECK(journal_count() == 0);
+  CHECK(world.hdr_on == std::set<uint32_t>{3});
+}
+
+TEST_CASE_METHOD(RestoreJournalTest, "Journals of live launchers are left alone", "[restore_journal]") {
+  World world;
+  SessionJournal journal{journal_path(m_folder, 100), 100, 1};
+  REQUIRE(journal.display_changing({"", world.primary}));
+  world.primary = {1280, 720, 60};
+  FakeReplayTarget target{world};
+  target.alive = {100};
+  replay_stale_journals(m_folder, target, m_logger);
+  CHECK(journal_count() == 1);
+  CHECK(world.primary == DisplayMode{1280, 720, 60});
+}
+
+TEST_CASE_METHOD(RestoreJournalTest, "Enabling HDR on no display records nothing", "[restore_journal]") {
+  SessionJournal journal{journal_path(m_folder, 100), 100, 1};
+  REQUIRE(journal.hdr_enabling({}));
+  CHECK(journal_count() == 0);
+}
@@ -0,0 +1,181 @@
+#include "logger.hpp"
+#include "session_control.hpp"
+#include "unix_socket.hpp"
+#include <catch2/catch.hpp>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+class FakeController : public SessionController {
+public:
+  ControlReply set_display_mode(const DisplayMode &mode) override {
+    if (mode.width == 0) {
+      return {false, "no such mode"};
+    }
+    m_mode = mode;
+    return {true, ""};
+  }
+  ControlReply set_hdr(bool enabled) override {
+    m_hdr = enabled;
+    return {true, ""};
+  }
+  SessionState query_state() override { return {m_mode, m_hdr, "game.exe"}; }
+  ControlReply end_session() override {
+    ended = true;
+    return {true, "session ending"};
+  }
+
+  bool ended = false;
+
+private:
+  DisplayMode m_mode{1920, 1080, 60};
+  bool m_hdr = false;
+};
+
+std::vector<std::string> split(const std::string &line) {
+  std::vector<std::string> words;
+  size_t start = 0;
+  while (start < line.size()) {
+    auto end = line.find(' ', start);
+    end = end == std::string::npos ? line.size() : end;
+    if (end > start) {
+      words.push_back(line.substr(start, end - start));
+    }
+    start = end + 1;
+  }
+  return words;
+}
+
+TEST_CASE("Control commands are parsed from words", "[session_control]") {
+  struct Case {
+    const char *line;
+    std::optional<IpcMessage> expected;
+  };
+  const Case cases[] = {
+      {"set-mode 2560 1440", SetDisplayModeCommand{{2560, 1440, 0}}},
+      {"set-mode 2560 1440 120", SetDisplayModeCommand{{2560, 1440, 120}}},
+      {"hdr on", SetHdrCommand{true}},
+      {"hdr off", SetHdrCommand{false}},
+      {"state", QueryStateCommand{}},
+      {"end", EndSessionCommand{}},
+      {"", std::nullopt},
+      {"set-mode 2560", std::nullopt},
+      {"set-mode 2560 1440 120 1", std::nullopt},
+      {"set-mode 2560x1440", std::nullopt},
+      {"set-mode -1 1440", std::nullopt},
+      {"set-mode 2560 1440hz", std::nullopt},
+      {"set-mode 99999999999 1440", std::nullopt},
+      {"hdr", std::nullopt},
+      {"hdr yes", std::nullopt},
+      {"state now", std::nullopt},
+      {"end now", std::nullopt},
+      {"END", std::nullopt},
+      {"restart", std::nullopt},
+  };
+  for (const auto &test : cases) {
+    SECTION(std::string("\"") + test.line + "\"") {
+      auto parsed = parse_control_command(split(test.line));
+      REQUIRE(parsed.has_value() == test.expected.has_value());
+      if (parsed) {
+        CHECK(encode_message(*parsed) == encode_message(*test.expected));
+      }
+    }
+  }
+}
+
+TEST_CASE("Replies are described for the command line", "[session_control]") {
+  CHECK(describe_control_reply(ControlReply{true, ""}) == "ok");
+  CHECK(describe_control_reply(ControlReply{false, "no such mode"}) == "failed: no such mode");
+  CHECK(describe_control_reply(SessionState{{2560, 1440, 120}, true, "game.exe"}) == "mode 2560x1440@120, HDR on, launcher_exe game.exe");
+  CHECK(describe_control_reply(SessionEnded{0}) == "unexpected reply");
+}
+
+class ControlServerTest {
+protected:
+  ~ControlServerTest() { std::filesystem::remove(m_log_path); }
+
+  std::unique_ptr<UnixSocketChannel> connect() {
+    std::unique_ptr<UnixSocketChannel> client;
+    while (!(client = UnixSocketChannel::connect(m_path))) {
+      std::this_thread::yield();
+    }
+    return client;
+  }
+
+  IpcMessage command(IpcChannel &channel, const IpcMessage &message) {
+    send_message(channel, message);
+    return receive_message(channel);
+  }
+
+  std::string m_path = (std::filesystem::temp_directory_path() / ("mhdrl_control_test_" + std::to_string(getpid()) + ".sock")).string();
+  std::filesystem::path m_log_path = std::filesystem::temp_directory_path() / ("mhdrl_control_test_" + std::to_string(getpid()) + ".txt");
+  Logger m_logger{m_log_path, false};
+  FakeController m_controller;
+};
+
+TEST_CASE_METHOD(ControlServerTest, "Every command gets exactly one reply", "[session_control]") {
+  ControlServer server{std::make_unique<UnixSocketListener>(m_path), m_controller, m_logger};
+  auto client = connect();
+  CHECK(std::get<ControlReply>(command(*client, SetDisplayModeCommand{{2560, 1440, 120}})).ok);
+  CHECK(std::get<ControlReply>(command(*client, SetHdrCommand{true})).ok);
+  auto state = std::get<SessionState>(command(*client, QueryStateCommand{}));
+  CHECK(state.mode == DisplayMode{2560, 1440, 120});
+  CHECK(state.hdr_enabled);
+  auto failed = std::get<ControlReply>(command(*client, SetDisplayModeCommand{{0, 0, 0}}));
+  CHECK_FALSE(failed.ok);
+  CHECK(failed.message == "no such mode");
+  CHECK(std::get<ControlReply>(command(*client, EndSessionCommand{})).ok);
+  CHECK(m_controller.ended);
+}
+
+TEST_CASE_METHOD(ControlServerTest, "Messages that are not commands are refused and the connection stays usable", "[session_control]") {
+  ControlServer server{std::make_unique<UnixSocketListener>(m_path), m_controller, m_logger};
+  auto client = connect();
+  for (const IpcMessage &message : {IpcMessage{SessionEnded{0}}, IpcMessage{SessionRequest{}}, IpcMessage{ControlReply{true, ""}}}) {
+    auto reply = std::get<ControlReply>(command(*client, message));
+    CHECK_FALSE(reply.ok);
+    CHECK(reply.message == "not a control command");
+  }
+  CHECK(std::holds_alternative<SessionState>(command(*client, QueryStateCommand{})));
+}
+
+TEST_CASE_METHOD(ControlServerTest, "A client that hangs up makes room for the next one", "[session_control]") {
+  ControlServer server{std::make_unique<UnixSocketListener>(m_path), m_controller, m_logger};
+  {
+    // the reply shows the server took this client, a second one would be refused until it hangs up
+    auto first = connect();
+    CHECK(std::holds_alternative<SessionState>(command(*first, QueryStateCommand{})));
+    CHECK_FALSE(UnixSocketChannel::connect(m_path));
+  }
+  auto second = connect();
+  CHECK(std::holds_alternative<SessionState>(command(*second, QueryStateCommand{})));
+}
+
+TEST_CASE_METHOD(ControlServerTest, "Commands run on the executor, a dropped command means the session is ending", "[session_control]") {
+  bool drop = false;
+  ControlServer server{std::make_unique<UnixSocketListener>(m_path), m_controller, m_logger, [&](std::function<void()> task) {
+                         if (!drop) {
+                           task();
+                         }
+                       }};
+  auto client = connect();
+  CHECK(std::get<ControlReply>(command(*client, SetHdrCommand{true})).ok);
+  drop = true;
+  auto reply = std::get<ControlReply>(command(*client, EndSessionCommand{}));
+  CHECK_FALSE(reply.ok);
+  CHECK(reply.message == "the session is ending");
+  CHECK_FALSE(m_controller.ended);
+}
+
+TEST_CASE_METHOD(ControlServerTest, "Stopping the server disconnects a waiting client", "[session_control]") {
+  ControlServer server{std::make_unique<UnixSocketListener>(m_path), m_controller, m_logger};
+  auto client = connect();
+  CHECK(std::holds_alternative<SessionState>(command(*client, QueryStateCommand{})));
+  server.stop();
+  CHECK_THROWS_AS(receive_message(*client), IpcError);
+}
+
+} // namespace
@@ -0,0 +1,130 @@
+#include "session_plan.hpp"
+#include <catch2/catch.hpp>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<SessionAction::Kind> kinds(const SessionPlan &plan) {
+  std::vector<SessionAction::Kind> result;
+  for (const auto &action : plan.actions) {
+    result.push_back(action.kind);
+  }
+  return result;
+}
+
+// Resolves only the executables it knows, a bare name to a path under C:\Games
+ExecutableResolver resolver(std::set<std::string> known) {
+  return [known = std::move(known)](const std::string &executable) -> std::optional<std::string> {
+    if (!known.count(executable)) {
+      return std::nullopt;
+    }
+    return executable.find('\\') == std::string::npos ? "C:\\Games\\" + executable : executable;
+  };
+}
+
+SessionSnapshot snapshot() {
+  SessionSnapshot snapshot;
+  snapshot.primary_mode = DisplayMode{2560, 1440, 144};
+  snapshot.displays = {{"\\\\.\\DISPLAY1", {2560, 1440, 144}}, {"\\\\.\\DISPLAY2", {1920, 1080, 60}}};
+  snapshot.hdr_off = std::vector<HdrDisplay>{{0, 1}, {0, 2}};
+  return snapshot;
+}
+
+using Kind = SessionAction::Kind;
+
+} // namespace
+
+TEST_CASE("Executable candidates follow CreateProcess", "[session_plan]") {
+  struct Case {
+    const char *command_line;
+    std::vector<std::string> candidates;
+  };
+  const std::vector<Case> cases = {
+      {"\"C:\\Program Files\\Steam\\steam.exe\" -bigpicture", {"C:\\Program Files\\Steam\\steam.exe"}},
+      {"  \"quoted.exe\"", {"quoted.exe"}},
+      {"\"unterminated quote", {"unterminated quote"}},
+      {"\"\"", {""}},
+      {"steam.exe", {"steam.exe"}},
+      {"C:\\Program Files\\app.exe -x", {"C:\\Program", "C:\\Program Files\\app.exe", "C:\\Program Files\\app.exe -x"}},
+      {"a  b\t c  ", {"a", "a  b", "a  b\t c"}},
+      {" \tapp.exe --flag", {"app.exe", "app.exe --flag"}},
+      {"", {}},
+      {" \t ", {}},
+  };
+  for (const auto &c : cases) {
+    SECTION(c.command_line) { CHECK(executable_candidates(c.command_line) == c.candidates); }
+  }
+}
+
+TEST_CASE("The first candidate that resolves is launched", "[session_plan]") {
+  SessionGoal goal;
+  goal.launch = "C:\\Program Files\\app.exe -x";
+  auto plan = plan_session(goal, snapshot(), resolver({"C:\\Program Files\\app.exe", "C:\\Program Files\\app.exe -x"}));
+  REQUIRE(plan.find(Kind::launch));
+  CHECK(plan.find(Kind::launch)->executable == "C:\\Program Files\\app.exe");
+}
+
+TEST_CASE("HDR is enabled after the modes and before the launch", "[session_plan]") {
+  struct Case {
+    const char *name;
+    SessionGoal goal;
+    std::vector<Kind> kinds;
+  };
+  const std::vector<Case> cases = {
+      {"everything", {DisplayMode{1920, 1080, 60}, {{"\\\\.\\DISPLAY2", {3840, 2160, 60}}}, true, "game.exe"},
+       {Kind::set_primary_mode, Kind::set_display_modes, Kind::enable_hdr, Kind::launch}},
+      {"no modes", {std::nullopt, {}, true, "game.exe"}, {Kind::enable_hdr, Kind::launch}},
+      {"no launch", {DisplayMode{1920, 1080, 60}, {}, true, std::nullopt}, {Kind::set_primary_mode, Kind::enable_hdr}},
+      {"HDR alone", {std::nullopt, {}, true, std::nullopt}, {Kind::enable_hdr}},
+      {"no HDR", {DisplayMode{1920, 1080, 60}, {}, false, "game.exe"}, {Kind::set_primary_mode, Kind::launch}},
+  };
+  for (const auto &c : cases) {
+    SECTION(c.name) {
+      auto plan = plan_session(c.goal, snapshot(), resolver({"game.exe"}));
+      CHECK(plan.blocked.empty());
+      CHECK(kinds(plan) == c.kinds);
+    }
+  }
+}
+
+TEST_CASE("A launch that cannot start blocks the whole plan", "[session_plan]") {
+  SessionGoal goal{DisplayMode{1920, 1080, 60}, {{"\\\\.\\DISPLAY2", {3840, 2160, 60}}}, true, "missing.exe --flag"};
+  auto plan = plan_session(goal, snapshot(), resolver({}));
+  CHECK(plan.actions.empty());
+  CHECK(plan.blocked == "the executable of 'missing.exe --flag' was not found");
+
+  goal.launch = "";
+  CHECK(plan_session(goal, snapshot(), resolver({})).blocked == "launcher_exe is not set");
+}
+
+TEST_CASE("What is already in place is left out with a note", "[session_plan]") {
+  SessionGoal goal{DisplayMode{2560, 1440, 0}, {{"\\\\.\\DISPLAY1", {2560, 1440, 144}}, {"\\\\.\\DISPLAY9", {1920, 1080, 60}}}, true, std::nullopt};
+  auto state = snapshot();
+  state.hdr_off = std::vector<HdrDisplay>{};
+  auto plan = plan_session(goal, state, resolver({}));
+  CHECK(plan.actions.empty());
+  CHECK(plan.notes == std::vector<std::string>{"primary display is already in 2560x1440@144", "display \\\\.\\DISPLAY9 is not attached",
+                                               "1 displays are already in their modes", "HDR is already on for every HDR capable display"});
+
+  state.hdr_off.reset();
+  CHECK(plan_hdr(true, state.hdr_off).notes == std::vector<std::string>{"HDR cannot be controlled"});
+}
+
+TEST_CASE("Only the displays that have HDR off are enabled", "[session_plan]") {
+  auto plan = plan_hdr(true, std::vector<HdrDisplay>{{1, 4}});
+  REQUIRE(plan.find(Kind::enable_hdr));
+  CHECK(plan.find(Kind::enable_hdr)->hdr_displays == std::vector<HdrDisplay>{{1, 4}});
+  CHECK(plan_hdr(false, std::vector<HdrDisplay>{{1, 4}}).actions.empty());
+}
+
+TEST_CASE("Plans are described one line per action and note", "[session_plan]") {
+  SessionGoal goal{DisplayMode{1920, 1080, 60}, {{"\\\\.\\DISPLAY2", {3840, 2160, 0}}}, true, "game.exe"};
+  auto state = snapshot();
+  state.hdr_off = std::vector<HdrDisplay>{{0, 1}};
+  CHECK(describe_session_plan(plan_session(goal, state, resolver({"game.exe"}))) ==
+        std::vector<std::string>{"set primary display mode 2560x1440@144 -> 1920x1080@60", "set display modes \\\\.\\DISPLAY2 1920x1080@60 -> 3840x2160@60",
+                                 "enable HDR on 1 displays", "launch C:\\Games\\game.exe"});
+}
@@ -0,0 +1,143 @@
+#include "task_graph.hpp"
+#include <catch2/catch.hpp>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+// A fake startup step with a known latency that records when it ran
+struct Step {
+  std::chrono::milliseconds latency;
+  std::vector<std::string> *order;
+  std::mutex *mutex;
+  std::string name;
+
+  void operator()() const {
+    std::this_thread::sleep_for(latency);
+    std::lock_guard lock{*mutex};
+    order->push_back(name);
+  }
+};
+
+} // namespace
+
+TEST_CASE("Independent tasks overlap and dependents wait for them", "[task_graph]") {
+  std::vector<std::string> order;
+  std::mutex mutex;
+  WorkerPool pool{4};
+  TaskGraph graph;
+  // the launcher's startup shape: config, then display state and NVAPI side by side, then the steps that need both
+  auto config = graph.add("load config", Step{10ms, &order, &mutex, "load config"});
+  auto display = graph.add("read display state", Step{100ms, &order, &mutex, "read display state"}, {config});
+  auto nvapi = graph.add("initialize NVAPI", Step{100ms, &order, &mutex, "initialize NVAPI"}, {config});
+  graph.add("enable HDR", Step{10ms, &order, &mutex, "enable HDR"}, {display, nvapi});
+
+  auto start = std::chrono::steady_clock::now();
+  graph.start(pool);
+  graph.wait_all();
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  // serially this takes 220 ms
+  CHECK(elapsed < 200ms);
+  REQUIRE(order.size() == 4);
+  CHECK(order.front() == "load config");
+  CHECK(order.back() == "enable HDR");
+
+  auto timings = graph.timings();
+  REQUIRE(timings.size() == 4);
+  CHECK(timings[1].started >= timings[0].started + timings[0].duration);
+  CHECK(timings[3].started >= timings[2].started + timings[2].duration);
+  // the two middle steps ran at the same time
+  CHECK(timings[2].started < timings[1].started + timings[1].duration);
+  CHECK(timings[1].duration >= 100ms);
+  for (const auto &timing : timings) {
+    CHECK_FALSE(timing.failed);
+    CHECK_FALSE(timing.skipped);
+  }
+}
+
+TEST_CASE("Waiting for one task does not wait for the rest", "[task_graph]") {
+  WorkerPool pool{2};
+  TaskGraph graph;
+  std::atomic_bool slow_done{false};
+  auto fast = graph.add("fast", []() {});
+  graph.add("slow", [&]() {
+    std::this_thread::sleep_for(100ms);
+    slow_done = true;
+  });
+  graph.start(pool);
+  graph.wait(fast);
+  CHECK_FALSE(slow_done);
+  graph.wait_all();
+  CHECK(slow_done);
+}
+
+TEST_CASE("A single worker still runs every task", "[task_graph]") {
+  WorkerPool pool{1};
+  TaskGraph graph;
+  std::atomic<int> runs{0};
+  std::vector<TaskGraph::TaskId> previous;
+  for (int i = 0; i < 20; ++i) {
+    previous = {graph.add("step " + std::to_string(i), [&]() { ++runs; }, previous)};
+  }
+  graph.start(pool);
+  graph.wait_all();
+  CHECK(runs == 20);
+}
+
+TEST_CASE("Tasks can only depend on earlier tasks and are fixed once started", "[task_graph]") {
+  WorkerPool pool{1};
+  TaskGraph graph;
+  auto first = graph.add("first", []() {});
+  CHECK_THROWS_AS(graph.add("second", []() {}, {first + 1}), std::invalid_argument);
+  graph.start(pool);
+  CHECK_THROWS_AS(graph.add("late", []() {}), std::logic_error);
+  graph.wait_all();
+}
+
+TEST_CASE("A failed dependency cancels its dependents", "[task_graph]") {
+  WorkerPool pool{2};
+  TaskGraph graph;
+  std::atomic<int> runs{0};
+  auto nvapi = graph.add("initialize NVAPI", []() { throw std::runtime_error("no NVIDIA GPU"); });
+  auto display = graph.add("read display state", [&]() { ++runs; });
+  auto hdr = graph.add("enable HDR", [&]() { ++runs; }, {display, nvapi});
+  graph.add("watch HDR", [&]() { ++runs; }, {hdr});
+  graph.start(pool);
+
+  CHECK_THROWS_WITH(graph.wait(hdr), "no NVIDIA GPU");
+  CHECK_NOTHROW(graph.wait(display));
+  CHECK_THROWS_WITH(graph.wait_all(), "no NVIDIA GPU");
+  // only the independent step ran
+  CHECK(runs == 1);
+
+  auto timings = graph.timings();
+  CHECK(timings[0].failed);
+  CHECK_FALSE(timings[0].skipped);
+  CHECK_FALSE(timings[1].failed);
+  for (size_t i : {2, 3}) {
+    CHECK(timings[i].failed);
+    CHECK(timings[i].skipped);
+  }
+}
+
+TEST_CASE("wait_all waits for every task before rethrowing", "[task_graph]") {
+  WorkerPool pool{2};
+  TaskGraph graph;
+  std::atomic_bool slow_done{false};
+  graph.add("fails", []() { throw std::runtime_error("first"); });
+  graph.add("slow", [&]() {
+    std::this_thread::sleep_for(50ms);
+    slow_done = true;
+  });
+  graph.start(pool);
+  CHECK_THROWS_WITH(graph.wait_all(), "first");
+  CHECK(slow_done);
+}
@@ -0,0 +1,65 @@
+#include "logger.hpp"
+#include "teardown.hpp"
+#include <catch2/catch.hpp>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+using namespace std::chrono_literals;
+
+namespace {
+
+class TeardownTest {
+protected:
+  ~TeardownTest() {
+    m_logger.shutdown();
+    std::filesystem::remove(m_path);
+  }
+
+  std::filesystem::path m_path = std::filesystem::temp_directory_path() / ("mhdrl_teardown_test_" + std::to_string(getpid()) + ".txt");
+  Logger m_logger{m_path, false};
+};
+
+TEST_CASE_METHOD(TeardownTest, "An attempt that succeeds after its timeout is not run again", "[teardown]") {
+  std::atomic<int> calls{0};
+  TeardownRetry retry{m_logger};
+  TeardownPlan plan;
+  plan.add("late", [&]() { ++calls; std::this_thread::sleep_for(60ms); }, 20ms);
+  // keeps the plan running until the late attempt has finished, so it is handed over finished
+  plan.add("slow", []() { std::this_thread::sleep_for(150ms); }, 1s);
+  auto timings = plan.run(1s, retry);
+  CHECK(timings[0].outcome == TeardownOutcome::timed_out);
+  CHECK(timings[1].outcome == TeardownOutcome::done);
+  REQUIRE(retry.wait_idle(1s));
+  CHECK(calls == 1);
+}
+
+TEST_CASE_METHOD(TeardownTest, "An attempt still running at hand-over is waited for", "[teardown]") {
+  std::atomic<int> calls{0};
+  TeardownRetry retry{m_logger};
+  TeardownPlan plan;
+  plan.add("late", [&]() { ++calls; std::this_thread::sleep_for(60ms); }, 40ms);
+  CHECK(plan.run(1s, retry)[0].outcome == TeardownOutcome::timed_out);
+  REQUIRE(retry.wait_idle(1s));
+  CHECK(calls == 1);
+}
+
+TEST_CASE_METHOD(TeardownTest, "A failed action is retried until it succeeds", "[teardown]") {
+  std::atomic<int> calls{0};
+  TeardownRetry retry{m_logger, 3};
+  TeardownPlan plan;
+  plan.add("flaky", [&]() {
+    if (++calls < 3) {
+      throw std::runtime_error("busy");
+    }
+  }, 1s);
+  CHECK(plan.run(1s, retry)[0].outcome == TeardownOutcome::failed);
+  REQUIRE(retry.wait_idle(1s));
+  CHECK(calls == 3);
+}
+
+} // namespace
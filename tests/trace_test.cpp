@@ -0,0 +1,76 @@
+#include "trace.hpp"
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+class TraceTest {
+protected:
+  TraceTest() { trace::disable(); }
+  ~TraceTest() {
+    trace::disable();
+    std::filesystem::remove(m_path);
+  }
+
+  std::string written() const {
+    REQUIRE(trace::write(m_path));
+    std::ifstream file{m_path};
+    std::stringstream text;
+    text << file.rdbuf();
+    return text.str();
+  }
+
+  std::filesystem::path m_path = std::filesystem::temp_directory_path() / ("mhdrl_trace_test_" + std::to_string(getpid()) + ".json");
+};
+
+TEST_CASE_METHOD(TraceTest, "Nothing is recorded while tracing is disabled", "[trace]") {
+  {
+    TRACE_SCOPE("ignored");
+  }
+  trace::instant_event("ignored too");
+  CHECK(written() == "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n]}\n");
+}
+
+TEST_CASE_METHOD(TraceTest, "Spans and instants use the trace-event format", "[trace]") {
+  trace::enable();
+  {
+    TRACE_SCOPE("load config");
+    std::this_thread::sleep_for(std::chrono::milliseconds{2});
+  }
+  trace::instant_event("game started");
+  auto text = written();
+
+  std::regex complete{R"(\{"name":"load config","cat":"launcher","ph":"X","ts":(\d+),"pid":1,"tid":1,"dur":(\d+)\})"};
+  std::smatch match;
+  REQUIRE(std::regex_search(text, match, complete));
+  CHECK(std::stoll(match[2]) >= 2000);
+  CHECK(std::regex_search(text, std::regex{R"(\{"name":"game started","cat":"launcher","ph":"i","ts":\d+,"pid":1,"tid":1,"s":"p"\})"}));
+  CHECK(text.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", 0) == 0);
+  CHECK(text.find("},\n{") != std::string::npos);
+  CHECK(text.substr(text.size() - 4) == "\n]}\n");
+}
+
+TEST_CASE_METHOD(TraceTest, "Names are escaped and threads get their own ids", "[trace]") {
+  trace::enable();
+  trace::instant_event("quote \" backslash \\ tab\t");
+  std::thread{[]() { trace::instant_event("other thread"); }}.join();
+  auto text = written();
+  CHECK(text.find(R"("name":"quote \" backslash \\ tab ")") != std::string::npos);
+  CHECK(std::regex_search(text, std::regex{R"("name":"other thread"[^}]*"tid":2)"}));
+}
+
+TEST_CASE_METHOD(TraceTest, "Disabling drops the recorded events", "[trace]") {
+  trace::enable();
+  trace::instant_event("dropped");
+  trace::disable();
+  CHECK(written().find("dropped") == std::string::npos);
+}
+
+} // namespace